@@ -0,0 +1,135 @@
+// Compares the previous character at a time std::stringstream string
+// decoder with lexer::scan_string, on configs full of long strings.
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <lexer.hpp>
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // The decoder Parser::match_string_value used to have (with the
+    // missing break after escapes put back so it can finish).
+    bool legacy_decode(const char *&p, const char *end, std::string &out) {
+        std::stringstream buf{};
+        ++p;
+        while (p < end) {
+            char c = *p;
+            if (c == '\\') {
+                switch (p[1]) {
+                    case 'f' : buf << '\f'; break;
+                    case 'n' : buf << '\n'; break;
+                    case 'r' : buf << '\r'; break;
+                    case 't' : buf << '\t'; break;
+                    case '"' : buf << '"'; break;
+                    case '\\' : buf << '\\'; break;
+                    default : return false;
+                }
+                p += 2;
+            } else if (c == '\n') {
+                return false;
+            } else if (c == '"') {
+                ++p;
+                out = buf.str();
+                return true;
+            } else {
+                buf << c;
+                p += 1;
+            }
+        }
+        return false;
+    }
+
+    std::string make_certificate(std::mt19937 &gen) {
+        static const char b64[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::uniform_int_distribution<int> pick(0, 63);
+
+        std::string retval = "\"-----BEGIN CERTIFICATE-----\\n\"\n";
+        for (int line = 0; line < 25; ++line) {
+            retval += "    \"";
+            for (int i = 0; i < 64; ++i) retval += b64[pick(gen)];
+            retval += "\\n\"\n";
+        }
+        retval += "    \"-----END CERTIFICATE-----\\n\"";
+        return retval;
+    }
+
+    std::string make_template(std::mt19937 &gen) {
+        std::uniform_int_distribution<int> pick('a', 'z');
+        std::string retval = "\"";
+        for (int i = 0; i < 2000; ++i) {
+            retval += char(pick(gen));
+            if (i % 97 == 0) retval += "\\t";
+            if (i % 331 == 0) retval += "\\\"";
+        }
+        retval += "\"";
+        return retval;
+    }
+
+    std::string make_plain(std::mt19937 &gen) {
+        std::uniform_int_distribution<int> pick('a', 'z');
+        std::string retval = "\"";
+        for (int i = 0; i < 4000; ++i) retval += char(pick(gen));
+        retval += "\"";
+        return retval;
+    }
+}
+
+int main() {
+    std::mt19937 gen{5000};
+
+    std::string config;
+    std::vector<std::string> literals;
+
+    for (int i = 0; i < 2000; ++i) {
+        auto cert = make_certificate(gen);
+        auto tmpl = make_template(gen);
+        auto plain = make_plain(gen);
+
+        config += "tenant" + std::to_string(i) + " = {\n  cert = " + cert +
+            ";\n  template = " + tmpl + ";\n  blob = " + plain + ";\n};\n";
+
+        literals.push_back(tmpl);
+        literals.push_back(plain);
+    }
+
+    std::size_t literal_bytes = 0;
+    for (auto &l : literals) literal_bytes += l.size();
+
+    std::cout << "config size " << config.size() / (1024 * 1024) << " MB\n";
+
+    auto legacy = bench::best_of(5, [&]() {
+        std::string out;
+        for (auto &l : literals) {
+            const char *p = l.data();
+            legacy_decode(p, p + l.size(), out);
+            bench::keep(out);
+        }
+    });
+    bench::report("decode literals (stringstream)", legacy, literal_bytes);
+
+    auto fast = bench::best_of(5, [&]() {
+        for (auto &l : literals) {
+            std::string out;
+            Configinator5000::lexer::scan_string(l.data(), l.data() + l.size(), out);
+            bench::keep(out);
+        }
+    });
+    bench::report("decode literals (scan_string)", fast, literal_bytes);
+
+    Configinator5000::Config cfg;
+    auto full = bench::best_of(5, [&]() {
+        if (not cfg.parse(config)) {
+            cfg.stream_errors(std::cerr);
+        }
+    });
+    bench::report("Config::parse", full, config.size());
+
+    return 0;
+}
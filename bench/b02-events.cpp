@@ -0,0 +1,90 @@
+// Parsing with and without building a tree.
+//
+// The same document is parsed four ways :
+//   - Config::parse, which builds the Setting tree
+//   - the event parser with a handler that does nothing
+//   - the event parser with a handler that adds up the integers
+//   - the event parser skipping every group below the top level
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <parser.hpp>
+
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+
+    std::string make_config(std::mt19937 &gen) {
+        std::uniform_int_distribution<int> num(0, 1000000);
+        std::uniform_int_distribution<int> letter('a', 'z');
+
+        std::string retval;
+        for (int i = 0; i < 20000; ++i) {
+            retval += "service" + std::to_string(i) + " = {\n";
+            retval += "  port = " + std::to_string(num(gen)) + ";\n";
+            retval += "  weight = " + std::to_string(num(gen)) + ".25;\n";
+            retval += "  enabled = true;\n";
+            retval += "  name = \"";
+            for (int j = 0; j < 24; ++j) retval += char(letter(gen));
+            retval += "\";\n";
+            retval += "  limits = [ " + std::to_string(num(gen)) + ", " +
+                std::to_string(num(gen)) + ", " + std::to_string(num(gen)) + " ];\n";
+            retval += "  backends = ( { host = \"10.0.0.1\"; port = 80; },\n"
+                      "               { host = \"10.0.0.2\"; port = 81; } );\n";
+            retval += "};\n";
+        }
+        return retval;
+    }
+
+    struct summer : event_handler {
+        long total = 0;
+        event_action on_integer(std::string_view, long v) {
+            total += v;
+            return event_action::proceed;
+        }
+    };
+
+    struct skipper : event_handler {
+        event_action begin_group(std::string_view) { return event_action::skip; }
+    };
+}
+
+int main() {
+    std::mt19937 gen{5000};
+    std::string config = make_config(gen);
+
+    std::cout << "config size " << config.size() / (1024 * 1024) << " MB\n";
+
+    Config cfg;
+    auto tree = bench::best_of(5, [&]() {
+        if (not cfg.parse(config)) {
+            cfg.stream_errors(std::cerr);
+        }
+    });
+    bench::report("Config::parse (tree)", tree, config.size());
+
+    auto nothing = bench::best_of(5, [&]() {
+        event_handler h;
+        if (not parse_events(config, h, &std::cerr)) return;
+    });
+    bench::report("parse_events (no handler work)", nothing, config.size());
+
+    auto sum = bench::best_of(5, [&]() {
+        summer h;
+        if (not parse_events(config, h, &std::cerr)) return;
+        bench::keep(h.total);
+    });
+    bench::report("parse_events (sum integers)", sum, config.size());
+
+    auto skip = bench::best_of(5, [&]() {
+        skipper h;
+        if (not parse_events(config, h, &std::cerr)) return;
+    });
+    bench::report("parse_events (skip groups)", skip, config.size());
+
+    return 0;
+}
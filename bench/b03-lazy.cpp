@@ -0,0 +1,91 @@
+// Start up cost of a lazy parse on a big multi-tenant config.
+//
+// Compares a full parse, a lazy parse, a lazy parse that then reads a
+// few tenants, and the plain bracket scan (events skipping every group)
+// that a lazy parse should cost about the same as. The config is written
+// to a scratch file and read with parse_file / parse_file_lazy.
+//
+// The size in MB can be given on the command line (default 100).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <parser.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    struct skipper : event_handler {
+        event_action begin_group(std::string_view) { return event_action::skip; }
+        event_action begin_list(std::string_view) { return event_action::skip; }
+        event_action begin_array(std::string_view) { return event_action::skip; }
+    };
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    std::cout << "config size " << config.size() / (1024 * 1024) << " MB, "
+        << tenants << " tenants\n";
+
+    const std::string file_name = "b03-lazy.cfg";
+    {
+        std::ofstream out{file_name};
+        out << config;
+    }
+
+    auto scan = bench::best_of(3, [&]() {
+        skipper h;
+        if (not parse_events(config, h, &std::cerr)) return;
+    });
+    bench::report("bracket scan (events, skip all)", scan, config.size());
+
+    auto lazy = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.parse_file_lazy(file_name)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("Config::parse_file_lazy", lazy, config.size());
+
+    auto touch = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.parse_file_lazy(file_name)) cfg.stream_errors(std::cerr);
+        long total = 0;
+        for (int i = 0; i < tenants; i += tenants / 3 + 1) {
+            auto &t = cfg.get_settings().at("tenant" + std::to_string(i));
+            total += t.at("quota").at("cpu").get<long>();
+            total += t.at("routes").at(7).at("port").get<long>();
+        }
+        bench::keep(total);
+    });
+    bench::report("parse_file_lazy + read 3 tenants", touch, config.size());
+
+    auto full = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.parse_file(file_name)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("Config::parse_file (full)", full, config.size());
+
+    auto validate = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.parse_file_lazy(file_name)) cfg.stream_errors(std::cerr);
+        if (not cfg.validate_all()) cfg.stream_errors(std::cerr);
+    });
+    bench::report("parse_file_lazy + validate_all", validate, config.size());
+
+    std::remove(file_name.c_str());
+
+    return 0;
+}
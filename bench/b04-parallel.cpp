@@ -0,0 +1,55 @@
+// Scaling of Config::parse_parallel from one thread up to one per core,
+// on a config made of many top level tenant groups.
+//
+// Arguments (both optional) : size in MB (default 64) and the largest
+// thread count to try (default the number of hardware threads).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 64;
+    unsigned max_threads = (argc > 2) ? unsigned(std::strtoul(argv[2], nullptr, 10)) :
+        std::thread::hardware_concurrency();
+    if (max_threads == 0) max_threads = 1;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    std::cout << "config size " << config.size() / (1024 * 1024) << " MB, "
+        << tenants << " tenants, " << std::thread::hardware_concurrency()
+        << " hardware threads\n";
+
+    auto serial = bench::best_of(3, [&]() {
+        Configinator5000::Config cfg;
+        if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("Config::parse (serial)", serial, config.size());
+
+    // powers of two, and the top count itself.
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2) counts.push_back(threads);
+    counts.push_back(max_threads);
+
+    for (unsigned threads : counts) {
+        auto t = bench::best_of(3, [&]() {
+            Configinator5000::Config cfg;
+            if (not cfg.parse_parallel(config, threads)) cfg.stream_errors(std::cerr);
+        });
+        bench::report("parse_parallel " + std::to_string(threads) + " threads", t, config.size());
+        std::cout << "    speedup " << std::setprecision(2) << serial / t << "x\n";
+    }
+
+    return 0;
+}
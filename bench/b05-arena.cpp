@@ -0,0 +1,113 @@
+// Heap vs arena backed settings trees : number of heap allocations, parse
+// time and teardown time.
+//
+// Allocations are counted by replacing the global operator new, so they
+// include everything (parser scratch space too), not just the tree.
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+
+namespace {
+    std::atomic<long> allocations{0};
+}
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+// std::pmr::new_delete_resource() uses the aligned versions.
+void *operator new(std::size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t a = static_cast<std::size_t>(align);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc{};
+}
+
+// These free what the operator news above got from malloc, which is
+// right, but once GCC inlines them it sees free() of a pointer from
+// operator new and warns (-Wmismatched-new-delete).
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+    std::string make_config(std::mt19937 &gen) {
+        std::uniform_int_distribution<int> num(0, 1000000);
+        std::uniform_int_distribution<int> letter('a', 'z');
+
+        std::string retval;
+        for (int i = 0; i < 20000; ++i) {
+            retval += "service_number_" + std::to_string(i) + " = {\n";
+            retval += "  port = " + std::to_string(num(gen)) + ";\n";
+            retval += "  weight = " + std::to_string(num(gen)) + ".25;\n";
+            retval += "  enabled = true;\n";
+            retval += "  description = \"";
+            for (int j = 0; j < 40; ++j) retval += char(letter(gen));
+            retval += "\";\n";
+            retval += "  limits = [ " + std::to_string(num(gen)) + ", " +
+                std::to_string(num(gen)) + ", " + std::to_string(num(gen)) + " ];\n";
+            retval += "  backends = ( { hostname = \"backend-one.example.com\"; port = 80; },\n"
+                      "               { hostname = \"backend-two.example.com\"; port = 81; } );\n";
+            retval += "};\n";
+        }
+        return retval;
+    }
+
+    void run(const char *name, Configinator5000::tree_memory where, const std::string &config) {
+        using clock = std::chrono::steady_clock;
+
+        double best_parse = 1e30;
+        double best_free = 1e30;
+        long allocs = 0;
+
+        for (int i = 0; i < 5; ++i) {
+            auto *cfg = new Configinator5000::Config{where};
+
+            long before = allocations.load();
+            auto start = clock::now();
+            if (not cfg->parse(config)) cfg->stream_errors(std::cerr);
+            auto parsed = clock::now();
+            allocs = allocations.load() - before;
+
+            delete cfg;
+            auto freed = clock::now();
+
+            best_parse = std::min(best_parse, std::chrono::duration<double>(parsed - start).count());
+            best_free = std::min(best_free, std::chrono::duration<double>(freed - parsed).count());
+        }
+
+        std::cout << name << " : " << allocs << " allocations\n";
+        bench::report("    parse", best_parse, config.size());
+        bench::report("    teardown", best_free);
+    }
+}
+
+int main() {
+    std::mt19937 gen{5000};
+    std::string config = make_config(gen);
+
+    std::cout << "config size " << config.size() / (1024 * 1024) << " MB\n";
+
+    run("heap", Configinator5000::tree_memory::heap, config);
+    run("arena", Configinator5000::tree_memory::arena, config);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Size of a Setting and how much memory a whole tree takes.
+//
+// Tree memory is measured as the growth in resident set size while the
+// Config is alive (Linux only - read from /proc/self/statm), so it
+// includes malloc overhead as well as the nodes themselves. Each kind of
+// tree is run in its own process so one can't reuse memory the other
+// gave back.
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+
+#include <fstream>
+#include <random>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    long resident_bytes() {
+        std::ifstream statm{"/proc/self/statm"};
+        long size = 0, resident = 0;
+        statm >> size >> resident;
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+
+    std::string make_config(std::mt19937 &gen, int services) {
+        std::uniform_int_distribution<int> num(0, 1000000);
+        std::uniform_int_distribution<int> letter('a', 'z');
+
+        std::string retval;
+        for (int i = 0; i < services; ++i) {
+            retval += "service_number_" + std::to_string(i) + " = {\n";
+            retval += "  port = " + std::to_string(num(gen)) + ";\n";
+            retval += "  weight = " + std::to_string(num(gen)) + ".25;\n";
+            retval += "  enabled = true;\n";
+            retval += "  description = \"";
+            for (int j = 0; j < 40; ++j) retval += char(letter(gen));
+            retval += "\";\n";
+            retval += "  limits = [ " + std::to_string(num(gen)) + ", " +
+                std::to_string(num(gen)) + ", " + std::to_string(num(gen)) + " ];\n";
+            retval += "  backends = ( { hostname = \"backend-one.example.com\"; port = 80; },\n"
+                      "               { hostname = \"backend-two.example.com\"; port = 81; } );\n";
+            retval += "  tags = ( );\n";
+            retval += "};\n";
+        }
+        return retval;
+    }
+
+    // each service above is this many Settings.
+    constexpr long settings_per_service = 1 + 4 + 1 + 3 + 1 + 2 * 3 + 1;
+
+    void run(const char *name, Configinator5000::tree_memory where,
+            const std::string &config, long settings) {
+
+        // memory first, while nothing has been freed yet.
+        long before = resident_bytes();
+        auto *cfg = new Configinator5000::Config{where};
+        if (not cfg->parse(config)) cfg->stream_errors(std::cerr);
+        long grown = resident_bytes() - before;
+        delete cfg;
+
+        double best = bench::best_of(3, [&]() {
+                Configinator5000::Config c{where};
+                if (not c.parse(config)) c.stream_errors(std::cerr);
+            });
+
+        std::cout << name << " : " << grown / 1024 << " KiB resident, "
+            << std::fixed << std::setprecision(1) << double(grown) / double(settings)
+            << " bytes per Setting\n";
+        bench::report("    parse", best, config.size());
+    }
+
+    void run_apart(const char *name, Configinator5000::tree_memory where,
+            const std::string &config, long settings) {
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            run(name, where, config, settings);
+            std::cout.flush();
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int services = (argc > 1) ? std::stoi(argv[1]) : 50000;
+
+    std::mt19937 gen{5000};
+    std::string config = make_config(gen, services);
+    long settings = services * settings_per_service;
+
+    std::cout << "sizeof(Setting) = " << sizeof(Configinator5000::Setting) << "\n";
+    std::cout << "config size " << config.size() / (1024 * 1024) << " MB, "
+        << settings << " Settings\n";
+
+    run_apart("heap", Configinator5000::tree_memory::heap, config, settings);
+    run_apart("arena", Configinator5000::tree_memory::arena, config, settings);
+
+    return 0;
+}
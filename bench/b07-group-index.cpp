@@ -0,0 +1,63 @@
+// Group key lookup : at(name) and exists(name) on groups of different
+// sizes, for keys that are there and keys that aren't.
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Configinator5000::Setting;
+
+    constexpr int lookups = 1000000;
+
+    void run(int size, std::mt19937 &gen) {
+        Setting group{Setting::setting_type::GROUP};
+
+        std::vector<std::string> keys;
+        for (int i = 0; i < size; ++i) {
+            keys.push_back("setting_name_" + std::to_string(i));
+            group.add_child(keys.back(), i);
+        }
+
+        std::vector<std::string> missing;
+        for (int i = 0; i < size; ++i) missing.push_back("setting_name_x" + std::to_string(i));
+
+        // look them up in a random order so we aren't just measuring a
+        // single hot key.
+        std::uniform_int_distribution<int> pick(0, size - 1);
+        std::vector<int> order(lookups);
+        for (auto &o : order) o = pick(gen);
+
+        long sum = 0;
+        double at = bench::best_of(5, [&]() {
+                for (int i : order) sum += group.at(keys[i]).get<long>();
+            });
+        double hit = bench::best_of(5, [&]() {
+                for (int i : order) sum += group.exists(keys[i]);
+            });
+        double miss = bench::best_of(5, [&]() {
+                for (int i : order) sum += group.exists(missing[i]);
+            });
+        bench::keep(sum);
+
+        std::string label = std::to_string(size) + " keys";
+        std::cout << label << " (ns per lookup)\n";
+        auto ns = [](double seconds) { return seconds * 1e9 / lookups; };
+        std::cout << "    at           " << std::fixed << std::setprecision(1) << ns(at) << "\n";
+        std::cout << "    exists hit   " << ns(hit) << "\n";
+        std::cout << "    exists miss  " << ns(miss) << "\n";
+    }
+}
+
+int main() {
+    std::mt19937 gen{5000};
+
+    for (int size : { 4, 64, 10000 }) run(size, gen);
+
+    return 0;
+}
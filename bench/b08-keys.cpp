@@ -0,0 +1,72 @@
+// Interned keys : looking up the same few keys in lots of small groups,
+// by name and by a key_handle from Config::key().
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+
+#include <string>
+
+namespace {
+
+    std::string make_config(int devices) {
+        std::string retval;
+        for (int i = 0; i < devices; ++i) {
+            retval += "device_" + std::to_string(i) + " = {\n"
+                "  in = " + std::to_string(i) + ";\n"
+                "  osc = \"/mixer/" + std::to_string(i) + "\";\n"
+                "  address = \"10.0.0." + std::to_string(i % 250) + "\";\n"
+                "  port = " + std::to_string(9000 + i) + ";\n"
+                "  channel_name = \"main\";\n"
+                "  gain = 0.5;\n"
+                "};\n";
+        }
+        return retval;
+    }
+}
+
+int main() {
+    using Configinator5000::Setting;
+
+    std::string config = make_config(20000);
+
+    Configinator5000::Config cfg;
+    double parse = bench::best_of(3, [&]() { cfg.parse(config); });
+    bench::report("parse", parse, config.size());
+
+    auto &root = cfg.get_settings();
+    auto port = cfg.key("port");
+    auto channel = cfg.key("channel_name");
+    auto nope = cfg.key("not_there");
+
+    const int rounds = 20;
+    long sum = 0;
+
+    double by_name = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds; ++r) {
+                for (auto &dev : root) {
+                    sum += dev.at("port").get<long>();
+                    sum += dev.exists("channel_name");
+                    sum += dev.exists("not_there");
+                }
+            }
+        });
+
+    double by_handle = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds; ++r) {
+                for (auto &dev : root) {
+                    sum += dev.at(port).get<long>();
+                    sum += dev.exists(channel);
+                    sum += dev.exists(nope);
+                }
+            }
+        });
+    bench::keep(sum);
+
+    double lookups = 3.0 * rounds * root.count();
+    std::cout << std::fixed << std::setprecision(1)
+        << "by name    " << by_name * 1e9 / lookups << " ns per lookup\n"
+        << "by handle  " << by_handle * 1e9 / lookups << " ns per lookup\n";
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Paths : getting at a Setting four levels down with chained at() calls,
+// a Path, a _path literal, and a Path resolved against the Config (which
+// only walks the tree once).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <path.hpp>
+
+#include <string>
+
+namespace {
+
+    std::string make_config(int devices) {
+        std::string retval = "midi = {\n  devices = (\n";
+        for (int i = 0; i < devices; ++i) {
+            retval += "    { in = " + std::to_string(i) + "; osc = \"/mixer/" +
+                std::to_string(i) + "\"; address = { host = \"10.0.0.1\"; port = " +
+                std::to_string(9000 + i) + "; }; }";
+            retval += (i + 1 < devices) ? ",\n" : "\n";
+        }
+        retval += "  );\n  channel_name = \"main\";\n};\n";
+        return retval;
+    }
+}
+
+int main() {
+    using namespace Configinator5000::literals;
+    using Configinator5000::Path;
+
+    Configinator5000::Config cfg;
+    cfg.parse(make_config(100));
+    auto &root = cfg.get_settings();
+
+    Path path{"midi.devices[42].address.port"};
+    constexpr auto literal = "midi.devices[42].address.port"_path;
+    Path from_literal{literal};
+    Path cached{path};
+
+    const int rounds = 1000000;
+    long sum = 0;
+
+    double chained = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds; ++r) {
+                sum += root.at("midi").at("devices").at(42).at("address").at("port").get<long>();
+            }
+        });
+
+    double by_path = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds; ++r) {
+                sum += path.find(root)->get<long>();
+            }
+        });
+
+    double by_literal = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds; ++r) {
+                sum += from_literal.find(root)->get<long>();
+            }
+        });
+
+    double resolved = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds; ++r) {
+                sum += cached.resolve(cfg)->get<long>();
+            }
+        });
+
+    double parse = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds / 10; ++r) {
+                Path p{"midi.devices[42].address.port"};
+                sum += long(p.size());
+            }
+        });
+
+    double made_from_literal = bench::best_of(5, [&]() {
+            for (int r = 0; r < rounds / 10; ++r) {
+                Path p{literal};
+                sum += long(p.size());
+            }
+        });
+    bench::keep(sum);
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "chained at()   " << chained * 1e9 / rounds << " ns\n"
+        << "Path::find     " << by_path * 1e9 / rounds << " ns\n"
+        << "_path literal  " << by_literal * 1e9 / rounds << " ns\n"
+        << "resolve        " << resolved * 1e9 / rounds << " ns\n"
+        << "making a Path  " << parse * 1e9 / (rounds / 10) << " ns\n"
+        << "from a literal " << made_from_literal * 1e9 / (rounds / 10) << " ns\n";
+
+    return 0;
+}
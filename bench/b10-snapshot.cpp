@@ -0,0 +1,117 @@
+// Start up from a binary snapshot against parsing the text, on the same
+// big multi-tenant config as b03-lazy.
+//
+// Both files are read warm (they were just written, so they are in the
+// page cache). Opening a snapshot only maps it; the "open + read" and
+// "open + walk" rows show what it costs to then use a few values, or all
+// of them.
+//
+// The size in MB can be given on the command line (default 100).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <snapshot.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    // every integer in the tree.
+    template<class S>
+    long walk(const S &s) {
+        if (s.is_integer()) return s.template get<long>();
+
+        long total = 0;
+        if (s.is_composite()) {
+            for (int i = 0; i < s.count(); ++i) total += walk(s.at(i));
+        }
+        return total;
+    }
+
+    long walk(Setting &s) {
+        if (s.is_integer()) return s.get<long>();
+
+        long total = 0;
+        for (auto &c : s) total += walk(c);
+        return total;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    const std::string file_name = "b10-snapshot.cfg";
+    const std::string snap_name = "b10-snapshot.snap";
+    {
+        std::ofstream out{file_name};
+        out << config;
+    }
+
+    auto full = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.parse_file(file_name)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("Config::parse_file", full, config.size());
+
+    Config parsed;
+    parsed.parse_file(file_name);
+
+    auto write = bench::best_of(3, [&]() {
+        if (not parsed.write_snapshot(snap_name)) std::cerr << "write failed\n";
+    });
+    bench::report("Config::write_snapshot", write, config.size());
+
+    std::size_t snap_size = 0;
+    {
+        std::ifstream in{snap_name, std::ios::binary | std::ios::ate};
+        snap_size = std::size_t(in.tellg());
+    }
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, snapshot "
+        << snap_size / (1024 * 1024) << " MB, " << tenants << " tenants\n";
+
+    auto open = bench::best_of(5, [&]() {
+        Config cfg;
+        if (not cfg.open_snapshot(snap_name)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("Config::open_snapshot", open, config.size());
+
+    auto read = bench::best_of(5, [&]() {
+        Config cfg;
+        if (not cfg.open_snapshot(snap_name)) cfg.stream_errors(std::cerr);
+        long total = 0;
+        for (int i = 0; i < tenants; i += tenants / 3 + 1) {
+            auto t = cfg.get_frozen().at("tenant" + std::to_string(i));
+            total += t.at("quota").at("cpu").get<long>();
+            total += t.at("routes").at(7).at("port").get<long>();
+        }
+        bench::keep(total);
+    });
+    bench::report("open_snapshot + read 3 tenants", read, config.size());
+
+    long expected = walk(parsed.get_settings());
+
+    auto walk_all = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.open_snapshot(snap_name)) cfg.stream_errors(std::cerr);
+        if (walk(cfg.get_frozen()) != expected) std::cerr << "walk differs\n";
+    });
+    bench::report("open_snapshot + walk everything", walk_all, config.size());
+
+    std::remove(file_name.c_str());
+    std::remove(snap_name.c_str());
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Read-heavy lookups in a parsed tree against the same Config after
+// freeze() : random tenants, then a route and its port, as a service
+// answering requests would. Also a walk over every value.
+//
+// Cache misses are counted with perf_event_open where the machine has
+// hardware counters (many VMs don't); otherwise only times are shown.
+//
+// The number of tenants can be given on the command line (default 20000).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <snapshot.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Configinator5000;
+
+namespace {
+    struct request {
+        std::string tenant;
+        int route;
+    };
+
+    template<class S>
+    long walk(const S &s) {
+        if (s.is_integer()) return s.template get<long>();
+
+        long total = 0;
+        if (s.is_composite()) {
+            for (int i = 0; i < s.count(); ++i) total += walk(s.at(i));
+        }
+        return total;
+    }
+
+    long walk(Setting &s) {
+        if (s.is_integer()) return s.get<long>();
+
+        long total = 0;
+        for (auto &c : s) total += walk(c);
+        return total;
+    }
+
+    template<class F>
+    void run(const std::string &name, std::size_t ops, F &&f) {
+        double t = bench::best_of(5, f);
+
+        bench::counter misses{bench::counter::event::cache_misses};
+        bench::counter l1d{bench::counter::event::l1d_misses};
+
+        std::cout << std::left << std::setw(28) << name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(8)
+            << t * 1e9 / double(ops) << " ns/op";
+        if (misses.available()) {
+            std::cout << std::setprecision(2)
+                << std::setw(8) << double(misses.measure(f)) / double(ops) << " LLC misses/op"
+                << std::setw(8) << double(l1d.measure(f)) / double(ops) << " L1D misses/op";
+        } else {
+            std::cout << "    (no hardware counters here)";
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int tenants = (argc > 1) ? std::atoi(argv[1]) : 20000;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    for (int i = 0; i < tenants; ++i) config += bench::make_tenant(gen, i);
+
+    Config tree;
+    tree.parse(config);
+    Config frozen;
+    frozen.parse(config);
+    frozen.freeze();
+
+    std::uniform_int_distribution<int> pick(0, tenants - 1);
+    std::uniform_int_distribution<int> route(0, 7);
+    std::vector<request> requests;
+    for (int i = 0; i < 1000000; ++i) {
+        requests.push_back({"tenant" + std::to_string(pick(gen)), route(gen)});
+    }
+
+    std::cout << tenants << " tenants, " << requests.size() << " lookups\n";
+
+    long sum = 0;
+    auto &root = tree.get_settings();
+    run("Setting lookups", requests.size(), [&]() {
+        for (auto const &r : requests) {
+            sum += root.at(r.tenant).at("routes").at(r.route).at("port").get<long>();
+        }
+    });
+
+    auto froot = frozen.get_frozen();
+    run("FrozenSetting lookups", requests.size(), [&]() {
+        for (auto const &r : requests) {
+            sum += froot.at(r.tenant).at("routes").at(r.route).at("port").get<long>();
+        }
+    });
+
+    std::size_t values = std::size_t(tenants) * 71;
+    run("Setting walk", values, [&]() { sum += walk(root); });
+    run("FrozenSetting walk", values, [&]() { sum += walk(froot); });
+
+    bench::keep(sum);
+
+    return 0;
+}
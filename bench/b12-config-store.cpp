@@ -0,0 +1,141 @@
+// Reader latency while the config is reloaded over and over.
+//
+// Reader threads each take a handle, look up one value and let go, timing
+// every read. One writer thread parses and publishes a new config as fast
+// as it can the whole time. The same is run with a mutex around a
+// shared_ptr<Config> (the obvious way to do it) for comparison.
+//
+// Arguments (all optional) : reader threads (default 8), seconds per run
+// (default 3) and tenants in the config (default 1000).
+//
+// On a machine with fewer cores than threads, the tail is mostly the
+// scheduler; compare the two runs rather than the numbers themselves.
+
+#include "bench.hpp"
+
+#include <config_store.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Configinator5000;
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    std::string make_config(int tenants, int version) {
+        std::string retval = "version = " + std::to_string(version) + ";\n";
+        for (int i = 0; i < tenants; ++i) {
+            retval += "tenant" + std::to_string(i) + " = { id = " + std::to_string(i) +
+                "; quota = { cpu = " + std::to_string(version + i) + "; mem = 64; }; };\n";
+        }
+        return retval;
+    }
+
+    // The mutex version.
+    class locked_config {
+        std::mutex lock_;
+        std::shared_ptr<const Config> cfg_;
+
+    public :
+        std::shared_ptr<const Config> read() {
+            std::lock_guard<std::mutex> guard{lock_};
+            return cfg_;
+        }
+
+        void reload(std::string_view input) {
+            auto cfg = std::make_shared<Config>();
+            cfg->parse(input);
+
+            std::lock_guard<std::mutex> guard{lock_};
+            cfg_ = std::move(cfg);
+        }
+    };
+
+    template<class Read, class Reload>
+    void run(const std::string &name, unsigned readers, double seconds, int tenants,
+            Read &&read, Reload &&reload) {
+        std::atomic<bool> done{false};
+        std::vector<std::vector<std::uint32_t>> latencies(readers);
+        std::vector<std::thread> threads;
+
+        for (unsigned t = 0; t < readers; ++t) {
+            threads.emplace_back([&, t]() {
+                auto &mine = latencies[t];
+                mine.reserve(1 << 22);
+                std::string key = "tenant" + std::to_string(int(t) % tenants);
+                long sum = 0;
+
+                while (not done.load(std::memory_order_relaxed)) {
+                    auto start = clock_type::now();
+                    sum += read(key);
+                    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            clock_type::now() - start).count();
+                    if (mine.size() < mine.capacity()) mine.push_back(std::uint32_t(ns));
+                }
+                bench::keep(sum);
+            });
+        }
+
+        long reloads = 0;
+        auto stop = clock_type::now() + std::chrono::duration<double>(seconds);
+        while (clock_type::now() < stop) {
+            reload(make_config(tenants, int(++reloads)));
+        }
+
+        done = true;
+        for (auto &t : threads) t.join();
+
+        std::vector<std::uint32_t> all;
+        for (auto &l : latencies) all.insert(all.end(), l.begin(), l.end());
+        std::sort(all.begin(), all.end());
+
+        auto pct = [&all](double p) {
+            return all.empty() ? 0u : all[std::min(all.size() - 1, std::size_t(p * double(all.size())))];
+        };
+
+        std::cout << name << " : " << reloads << " reloads, "
+            << std::fixed << std::setprecision(1) << double(all.size()) / seconds / 1e6
+            << " M reads/s\n"
+            << "    p50 " << pct(0.50) << " ns   p90 " << pct(0.90)
+            << " ns   p99 " << pct(0.99) << " ns   p99.9 " << pct(0.999)
+            << " ns   max " << (all.empty() ? 0u : all.back()) << " ns\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned readers = (argc > 1) ? unsigned(std::atoi(argv[1])) : 8;
+    double seconds = (argc > 2) ? std::atof(argv[2]) : 3.0;
+    int tenants = (argc > 3) ? std::atoi(argv[3]) : 1000;
+
+    std::cout << readers << " readers, " << tenants << " tenants, "
+        << std::thread::hardware_concurrency() << " hardware threads\n";
+
+    ConfigStore store;
+    store.reload(make_config(tenants, 0));
+    run("ConfigStore", readers, seconds, tenants,
+        [&](const std::string &key) {
+            auto h = store.read();
+            return h->get_settings().at(key).at("quota").at("cpu").get<long>();
+        },
+        [&](const std::string &text) { store.reload(text); });
+
+    locked_config locked;
+    locked.reload(make_config(tenants, 0));
+    run("mutex + shared_ptr", readers, seconds, tenants,
+        [&](const std::string &key) {
+            auto cfg = locked.read();
+            return cfg->get_settings().at(key).at("quota").at("cpu").get<long>();
+        },
+        [&](const std::string &text) { locked.reload(text); });
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+// What a reload costs when one line of a big config changed.
+//
+// The config is the multi-tenant one from b10-snapshot; the edit changes
+// one port in the middle of it. "re-apply everything" stands in for an
+// application that hands every Setting to its own code after a reload;
+// "diff" is what finding the one change costs instead, and the last row
+// is a whole ConfigStore::reload() with a subscriber on one tenant.
+//
+// The size in MB can be given on the command line (default 50).
+
+#include "bench.hpp"
+
+#include <config_store.hpp>
+#include <diff.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    // Calls apply for every scalar, as an application re-reading all of
+    // its settings would.
+    template<class F>
+    void apply_all(Setting &s, F &&apply) {
+        if (s.is_composite()) {
+            for (auto &c : s) apply_all(c, apply);
+        } else {
+            apply(s);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 50;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    // one port in the middle tenant.
+    std::string edited = config;
+    auto middle = edited.find("tenant" + std::to_string(tenants / 2) + " = {");
+    auto port = edited.find("port = ", middle) + 7;
+    edited.insert(port, "1");
+
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, " << tenants << " tenants\n";
+
+    Config before, after;
+    before.parse(config);
+
+    auto parse = bench::best_of(3, [&]() {
+        Config cfg;
+        if (not cfg.parse(edited)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("parse", parse, edited.size());
+
+    after.parse(edited);
+
+    long applied = 0;
+    auto reapply = bench::best_of(3, [&]() {
+        applied = 0;
+        apply_all(after.get_settings(), [&applied](Setting &s) {
+            if (s.is_integer()) bench::keep(s.get<long>());
+            ++applied;
+        });
+    });
+    bench::report("re-apply everything", reapply);
+
+    std::size_t changed = 0;
+    auto diffing = bench::best_of(3, [&]() {
+        auto changes = diff(before.get_settings(), after.get_settings());
+        changed = changes.size();
+    });
+    bench::report("diff", diffing);
+
+    std::cout << "settings re-applied " << applied << ", changes found " << changed << "\n";
+
+    ConfigStore store;
+    std::size_t told = 0;
+    store.subscribe("tenant" + std::to_string(tenants / 2),
+            [&told](const setting_change &) { ++told; });
+
+    auto reload = bench::best_of(3, [&]() {
+        store.reload(config);
+        if (not store.reload(edited)) store.stream_errors(std::cerr);
+    });
+    bench::report("ConfigStore::reload x2 + notify", reload, 2 * edited.size());
+    std::cout << "subscriber told " << told << " times\n";
+
+    return 0;
+}
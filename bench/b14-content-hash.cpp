@@ -0,0 +1,106 @@
+// Comparing big trees with and without content hashes.
+//
+// Two copies of the multi-tenant config from b10-snapshot, and a third
+// with one port changed. "deep compare" walks both trees comparing
+// values, the way it had to be done before. The first content_hash() of
+// a tree visits all of it; after that the hash is kept, so operator==
+// on trees that differ is a compare of two numbers, and diff() follows
+// one chain of hashes down to the change.
+//
+// The size in MB can be given on the command line (default 20).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <diff.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    // Compare everything, without hashes.
+    bool deep_equal(Setting &a, Setting &b) {
+        if (a.is_composite() != b.is_composite()) return false;
+        if (not a.is_composite()) return a == b;
+
+        if (a.is_group() != b.is_group() or a.is_list() != b.is_list()) return false;
+        if (a.count() != b.count()) return false;
+
+        for (int i = 0; i < a.count(); ++i) {
+            if (a.is_group()) {
+                auto name = a.name_at(i);
+                if (not b.exists(name) or not deep_equal(a.at(i), b.at(name))) return false;
+            } else if (not deep_equal(a.at(i), b.at(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    // one port in the middle tenant.
+    std::string edited = config;
+    auto middle = edited.find("tenant" + std::to_string(tenants / 2) + " = {");
+    edited.insert(edited.find("port = ", middle) + 7, "1");
+
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, " << tenants << " tenants\n";
+
+    Config a, same, changed;
+    a.parse(config);
+    same.parse(config);
+    changed.parse(edited);
+
+    auto &root = a.get_settings();
+
+    bool answer = false;
+    auto deep_same = bench::best_of(3, [&]() { answer = deep_equal(root, same.get_settings()); });
+    bench::report("deep compare, equal", deep_same);
+    if (not answer) std::cerr << "deep compare got it wrong\n";
+
+    auto deep_changed = bench::best_of(3, [&]() { answer = deep_equal(root, changed.get_settings()); });
+    bench::report("deep compare, one change", deep_changed);
+    if (answer) std::cerr << "deep compare got it wrong\n";
+
+    // every hash goes stale, so each run starts from nothing.
+    auto first = bench::best_of(3, [&]() {
+        root.at("tenant0").at("id").set_value(0);
+        bench::keep(root.content_hash());
+    });
+    bench::report("first content_hash()", first, config.size());
+
+    same.get_settings().content_hash();
+    changed.get_settings().content_hash();
+
+    auto cached = bench::best_of(5, [&]() { bench::keep(root.content_hash()); });
+    bench::report("cached content_hash()", cached);
+
+    auto eq_changed = bench::best_of(5, [&]() { answer = (root == changed.get_settings()); });
+    bench::report("operator==, one change", eq_changed);
+    if (answer) std::cerr << "operator== got it wrong\n";
+
+    auto eq_same = bench::best_of(3, [&]() { answer = (root == same.get_settings()); });
+    bench::report("operator==, equal", eq_same);
+    if (not answer) std::cerr << "operator== got it wrong\n";
+
+    std::size_t found = 0;
+    auto diffing = bench::best_of(5, [&]() {
+        found = diff(root, changed.get_settings()).size();
+    });
+    bench::report("diff, hashes kept", diffing);
+    std::cout << "changes found " << found << "\n";
+
+    return 0;
+}
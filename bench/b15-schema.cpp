@@ -0,0 +1,176 @@
+// What checking a schema adds to a parse.
+//
+// The multi-tenant config from b10-snapshot, with a schema for all of it
+// but the routes. "parse" has no schema and "parse + schema" checks it
+// as it parses. For comparison, "map schema" parses and then walks the
+// tree checking the same rules from a tree of std::maps keyed by string
+// (one node per entry, as the schema reads), which is the obvious way to
+// write it.
+//
+// Then the time to turn down a config with a string for the id of the
+// first tenant, or of the middle one: checking after the parse, checking
+// while parsing, and checking while parsing with set_fail_fast().
+//
+// The size in MB can be given on the command line (default 20).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    const char *schema =
+        "key* = { type = \"group\";\n"
+        "  keys = {\n"
+        "    id = { type = \"int\"; required = \"yes\"; };\n"
+        "    name = { type = \"string\"; required = \"yes\"; };\n"
+        "    quota = { type = \"group\"; required = \"yes\";\n"
+        "      keys = {\n"
+        "        cpu = { type = \"int\"; required = \"yes\"; };\n"
+        "        mem = { type = \"int\"; required = \"yes\"; };\n"
+        "        ratio = { type = \"float\"; };\n"
+        "      };\n"
+        "    };\n"
+        "    routes = { type = \"list\"; };\n"
+        "  };\n"
+        "};\n";
+
+    // The same rules, the obvious way.
+    struct map_node {
+        unsigned types = 0x7f;
+        bool required = false;
+        std::map<std::string, std::unique_ptr<map_node>, std::less<>> keys;
+        std::unique_ptr<map_node> any;
+    };
+
+    std::unique_ptr<map_node> entry(unsigned types, bool required) {
+        auto n = std::make_unique<map_node>();
+        n->types = types;
+        n->required = required;
+        return n;
+    }
+
+    unsigned bit(Setting::setting_type t) { return 1u << unsigned(t); }
+
+    std::unique_ptr<map_node> make_map_schema() {
+        using st = Setting::setting_type;
+
+        auto quota = entry(bit(st::GROUP), true);
+        quota->keys["cpu"] = entry(bit(st::INTEGER), true);
+        quota->keys["mem"] = entry(bit(st::INTEGER), true);
+        quota->keys["ratio"] = entry(bit(st::FLOAT) | bit(st::INTEGER), false);
+
+        auto tenant = entry(bit(st::GROUP), false);
+        tenant->keys["id"] = entry(bit(st::INTEGER), true);
+        tenant->keys["name"] = entry(bit(st::STRING), true);
+        tenant->keys["quota"] = std::move(quota);
+        tenant->keys["routes"] = entry(bit(st::LIST), false);
+
+        auto root = entry(bit(st::GROUP), true);
+        root->any = std::move(tenant);
+        return root;
+    }
+
+    unsigned type_of(Setting &s) {
+        using st = Setting::setting_type;
+        if (s.is_integer()) return bit(st::INTEGER);
+        if (s.is_float()) return bit(st::FLOAT);
+        if (s.is_boolean()) return bit(st::BOOL);
+        if (s.is_string()) return bit(st::STRING);
+        if (s.is_group()) return bit(st::GROUP);
+        if (s.is_list()) return bit(st::LIST);
+        return bit(st::ARRAY);
+    }
+
+    long map_check(Setting &s, const map_node &n) {
+        if (not (n.types & type_of(s))) return 1;
+        if (not s.is_group() or (n.keys.empty() and not n.any)) return 0;
+
+        long problems = 0;
+        for (int i = 0; i < s.count(); ++i) {
+            auto found = n.keys.find(s.name_at(i));
+            if (found != n.keys.end()) {
+                problems += map_check(s.at(i), *found->second);
+            } else if (n.any) {
+                problems += map_check(s.at(i), *n.any);
+            } else {
+                ++problems;
+            }
+        }
+        for (auto const &[key, child] : n.keys) {
+            if (child->required and not s.exists(key)) ++problems;
+        }
+        return problems;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, " << tenants << " tenants\n";
+
+    auto plain = bench::best_of(5, [&]() {
+        Config cfg;
+        if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("parse", plain, config.size());
+
+    auto checked = bench::best_of(5, [&]() {
+        Config cfg;
+        if (not cfg.set_schema(schema)) cfg.stream_errors(std::cerr);
+        if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("parse + schema", checked, config.size());
+
+    auto map_schema = make_map_schema();
+    auto by_map = bench::best_of(5, [&]() {
+        Config cfg;
+        if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+        if (map_check(cfg.get_settings(), *map_schema) != 0) std::cerr << "map schema failed\n";
+    });
+    bench::report("parse + map schema", by_map, config.size());
+
+    std::cout << "schema check " << std::fixed << std::setprecision(1)
+        << (checked - plain) * 1000.0 << " ms, map schema "
+        << (by_map - plain) * 1000.0 << " ms\n";
+
+    for (int bad : {0, tenants / 2}) {
+        std::string broken = config;
+        auto id = broken.find("id = ", broken.find("tenant" + std::to_string(bad) + " = {"));
+        broken.replace(id + 5, broken.find(';', id) - id - 5, "\"x\"");
+        auto at = "tenant " + std::to_string(bad);
+
+        auto after = bench::best_of(5, [&]() {
+            Config cfg;
+            if (cfg.parse(broken) and map_check(cfg.get_settings(), *map_schema) == 0) {
+                std::cerr << "map schema missed it\n";
+            }
+        });
+        bench::report("reject " + at + ", map schema", after);
+
+        for (bool fast : {false, true}) {
+            auto rejected = bench::best_of(5, [&]() {
+                Config cfg;
+                cfg.set_fail_fast(fast);
+                cfg.set_schema(schema);
+                if (cfg.parse(broken)) std::cerr << "schema missed it\n";
+            });
+            bench::report("reject " + at + (fast ? ", fail fast" : ", schema"), rejected);
+        }
+    }
+
+    return 0;
+}
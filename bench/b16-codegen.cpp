@@ -0,0 +1,87 @@
+// Filling structs from a config: parse then at(), or a parser made by
+// c5k-codegen.
+//
+// The multi-tenant config from b10-snapshot, and b16-codegen.schema for
+// it (the routes aren't kept). "parse + at()" parses into a Config and
+// then copies each value into the structs c5k-codegen made, by name, the
+// way a program without them would. "c5k-codegen parse" fills the same
+// structs straight from the parser's events.
+//
+// The generated parser steps over the routes without parsing them, which
+// is most of the text, so it is run again on the tenants without routes
+// to show what filling the structs costs on its own.
+//
+// The size in MB can be given on the command line (default 20).
+
+#include "bench.hpp"
+
+// made by c5k-codegen from b16-codegen.schema
+#include <fleet.hpp>
+
+#include <configinator5000.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    void copy(Setting &root, b16::fleet &out) {
+        out = b16::fleet{};
+        for (int i = 0; i < root.count(); ++i) {
+            auto &tenant = root.at(i);
+            auto &e = out.others[std::string(root.name_at(i))];
+            e.id = tenant.at("id").get<long>();
+            e.name = tenant.at("name").get<std::string>();
+
+            auto &quota = tenant.at("quota");
+            e.quota.cpu = quota.at("cpu").get<long>();
+            e.quota.mem = quota.at("mem").get<long>();
+            if (quota.exists("ratio")) e.quota.ratio = quota.at("ratio").get<double>();
+        }
+    }
+
+    void run(const std::string &config) {
+        b16::fleet by_at;
+        double copying = 0;
+        auto parse_at = bench::best_of(5, [&]() {
+            Config cfg;
+            if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+            auto start = std::chrono::steady_clock::now();
+            copy(cfg.get_settings(), by_at);
+            copying = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        });
+        bench::report("parse + at()", parse_at, config.size());
+        bench::report("  of which at()", copying);
+
+        b16::fleet generated;
+        auto direct = bench::best_of(5, [&]() {
+            if (not b16::parse(config, generated, &std::cerr)) std::cerr << "parse failed\n";
+        });
+        bench::report("c5k-codegen parse", direct, config.size());
+
+        auto same = generated.others.size() == by_at.others.size() and
+            generated.others.at("tenant7").quota.mem == by_at.others.at("tenant7").quota.mem and
+            generated.others.at("tenant7").name == by_at.others.at("tenant7").name;
+        if (not same) std::cerr << "the structs differ\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    for (bool routes : {true, false}) {
+        std::mt19937 gen{5000};
+        std::string config;
+        int tenants = 0;
+        while (config.size() < target_mb * 1024 * 1024) {
+            config += bench::make_tenant(gen, tenants++, routes);
+        }
+        std::cout << "config " << config.size() / (1024 * 1024) << " MB, " << tenants << " tenants"
+            << (routes ? "" : ", no routes") << "\n";
+        run(config);
+    }
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Filling structs from a config: by hand with at() and get<T>(), or with
+// C5K_BIND.
+//
+// The tenants of b10-snapshot, as a list, all of them kept (routes too).
+// "at() + get<T>()" fills the structs from a parsed Config with a chain
+// of at("key").get<T>() calls, the way a program would by hand. "bind"
+// fills them from the same tree with bind(), which finds each key by a
+// hash the compiler worked out. Those two are timed on their own, after
+// the parse. "parse_into" fills the structs straight from the parser's
+// events, with no tree, and is compared with parsing then binding.
+//
+// The size in MB can be given on the command line (default 20).
+
+#include "bench.hpp"
+
+#include <bind.hpp>
+#include <configinator5000.hpp>
+
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Configinator5000;
+
+namespace b17 {
+    struct quota {
+        long cpu = 0;
+        long mem = 0;
+        std::optional<double> ratio;
+    };
+    C5K_BIND(quota, cpu, mem, ratio)
+
+    struct route {
+        std::string path;
+        long port = 0;
+        std::vector<long> weights;
+    };
+    C5K_BIND(route, path, port, weights)
+
+    struct tenant {
+        long id = 0;
+        std::string name;
+        quota limits;
+        std::vector<route> routes;
+    };
+    C5K_BIND(tenant, id, name, limits, routes)
+
+    struct fleet {
+        std::vector<tenant> tenants;
+    };
+    C5K_BIND(fleet, tenants)
+}
+
+namespace {
+
+    std::string make_tenant(std::mt19937 &gen, int i) {
+        std::uniform_int_distribution<int> num(0, 1000000);
+        std::uniform_int_distribution<int> letter('a', 'z');
+
+        std::string retval = "  {\n";
+        retval += "    id = " + std::to_string(i) + ";\n";
+        retval += "    name = \"";
+        for (int j = 0; j < 32; ++j) retval += char(letter(gen));
+        retval += "\";\n";
+        retval += "    limits = { cpu = " + std::to_string(num(gen)) + "; mem = " +
+            std::to_string(num(gen)) + "; ratio = 0." + std::to_string(num(gen)) + "; };\n";
+        retval += "    routes = (\n";
+        for (int r = 0; r < 8; ++r) {
+            retval += "      { path = \"/api/v" + std::to_string(r) + "/{id}\"; port = " +
+                std::to_string(num(gen)) + "; weights = [ 1, 2, 3, 4 ]; },\n";
+        }
+        retval += "    );\n  },\n";
+        return retval;
+    }
+
+    void by_hand(Setting &root, b17::fleet &out) {
+        auto &tenants = root.at("tenants");
+        out.tenants.clear();
+        out.tenants.reserve(tenants.count());
+        for (auto &t : tenants) {
+            auto &dest = out.tenants.emplace_back();
+            dest.id = t.at("id").get<long>();
+            dest.name = t.at("name").get<std::string>();
+
+            auto &limits = t.at("limits");
+            dest.limits.cpu = limits.at("cpu").get<long>();
+            dest.limits.mem = limits.at("mem").get<long>();
+            if (limits.exists("ratio")) dest.limits.ratio = limits.at("ratio").get<double>();
+
+            auto &routes = t.at("routes");
+            dest.routes.reserve(routes.count());
+            for (auto &r : routes) {
+                auto &route = dest.routes.emplace_back();
+                route.path = r.at("path").get<std::string>();
+                route.port = r.at("port").get<long>();
+                if (r.exists("weights")) {
+                    for (auto &w : r.at("weights")) route.weights.push_back(w.get<long>());
+                }
+            }
+        }
+    }
+
+    long checksum(const b17::fleet &f) {
+        long retval = 0;
+        for (auto &t : f.tenants) {
+            retval += t.id + t.limits.cpu + long(t.name.size());
+            for (auto &r : t.routes) retval += r.port + long(r.weights.size());
+        }
+        return retval;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    std::mt19937 gen{5000};
+    std::string config = "tenants = (\n";
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += make_tenant(gen, tenants++);
+    }
+    config += ");\n";
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, " << tenants << " tenants\n";
+
+    Config cfg;
+    auto parse = bench::best_of(5, [&]() {
+        if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+    });
+    bench::report("parse", parse, config.size());
+
+    long expect = 0;
+    auto hand = bench::best_of(5, [&]() {
+        b17::fleet f;
+        by_hand(cfg.get_settings(), f);
+        expect = checksum(f);
+    });
+    bench::report("at() + get<T>()", hand);
+
+    auto bound = bench::best_of(5, [&]() {
+        b17::fleet f;
+        bind(cfg, f);
+        if (checksum(f) != expect) std::cerr << "bind doesn't match\n";
+    });
+    bench::report("bind", bound);
+
+    auto events = bench::best_of(5, [&]() {
+        b17::fleet f;
+        if (not parse_into(config, f, &std::cerr)) std::cerr << "parse_into failed\n";
+        if (checksum(f) != expect) std::cerr << "parse_into doesn't match\n";
+    });
+    bench::report("parse + bind", parse + bound, config.size());
+    bench::report("parse_into", events, config.size());
+
+    return 0;
+}
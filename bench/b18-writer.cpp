@@ -0,0 +1,127 @@
+// Writing a settings tree back out as text.
+//
+// The tenants of b10-snapshot (a couple of million Settings at the
+// default size), written with to_text() and write_text_file(), compact
+// and pretty. For comparison, "ostream" writes the same compact text
+// with an std::ostringstream and operator<<, the obvious way, with
+// precision 17 so the floats read back the same. MB/s is of the text
+// written.
+//
+// The size in MB of the config to start from can be given on the command
+// line (default 20).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <writer.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    long count_settings(Setting &s) {
+        long retval = 1;
+        if (s.is_composite()) {
+            for (auto &child : s) retval += count_settings(child);
+        }
+        return retval;
+    }
+
+    void escaped(std::ostream &strm, std::string_view text) {
+        strm << '"';
+        for (char c : text) {
+            switch (c) {
+                case '"' :  strm << "\\\""; break;
+                case '\\' : strm << "\\\\"; break;
+                case '\n' : strm << "\\n"; break;
+                default :   strm << c;
+            }
+        }
+        strm << '"';
+    }
+
+    void ostream_value(std::ostream &strm, Setting &s) {
+        if (s.is_integer()) {
+            strm << s.get<long>();
+        } else if (s.is_float()) {
+            strm << s.get<double>();
+        } else if (s.is_boolean()) {
+            strm << (s.get<bool>() ? "true" : "false");
+        } else if (s.is_string()) {
+            escaped(strm, s.get<std::string_view>());
+        } else if (s.is_group()) {
+            strm << '{';
+            for (int i = 0; i < s.count(); ++i) {
+                strm << s.name_at(i) << '=';
+                ostream_value(strm, s.at(i));
+                strm << ';';
+            }
+            strm << '}';
+        } else {
+            strm << (s.is_list() ? '(' : '[');
+            for (int i = 0; i < s.count(); ++i) {
+                if (i > 0) strm << ',';
+                ostream_value(strm, s.at(i));
+            }
+            strm << (s.is_list() ? ')' : ']');
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    Config cfg;
+    if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+    auto &root = cfg.get_settings();
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, "
+        << count_settings(root) << " settings\n";
+
+    for (auto style : {text_style::compact, text_style::pretty}) {
+        std::string name = (style == text_style::compact) ? "compact" : "pretty";
+
+        std::string text;
+        auto in_memory = bench::best_of(5, [&]() { text = to_text(root, style); });
+        bench::report("to_text, " + name, in_memory, text.size());
+
+        Config again;
+        if (not again.parse(text) or not (again.get_settings() == root)) {
+            std::cerr << name << " text doesn't parse back to the same tree\n";
+        }
+
+        std::string file_name = "b18-writer.cfg";
+        auto to_file = bench::best_of(5, [&]() {
+            if (not write_text_file(root, file_name, style)) std::cerr << "write failed\n";
+        });
+        bench::report("write_text_file, " + name, to_file, text.size());
+        std::remove(file_name.c_str());
+    }
+
+    std::string text;
+    auto by_ostream = bench::best_of(5, [&]() {
+        std::ostringstream strm;
+        strm.precision(std::numeric_limits<double>::max_digits10);
+        for (int i = 0; i < root.count(); ++i) {
+            strm << root.name_at(i) << '=';
+            ostream_value(strm, root.at(i));
+            strm << ';';
+        }
+        text = strm.str();
+    });
+    bench::report("ostream, compact", by_ostream, text.size());
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+// JSON against libconfig text, both ways, on the same settings.
+//
+// The tenants of b10-snapshot (a couple of million Settings at the
+// default size). Each is written with to_text() and to_json(), compact
+// and pretty, and read back with Config::parse() and Config::parse_json().
+// MB/s is of the text written or read, which isn't quite the same size
+// for the two (JSON quotes its keys).
+//
+// The size in MB of the config to start from can be given on the command
+// line (default 20).
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <writer.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace Configinator5000;
+
+namespace {
+    long count_settings(Setting &s) {
+        long retval = 1;
+        if (s.is_composite()) {
+            for (auto &child : s) retval += count_settings(child);
+        }
+        return retval;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    std::mt19937 gen{5000};
+    std::string config;
+    int tenants = 0;
+    while (config.size() < target_mb * 1024 * 1024) {
+        config += bench::make_tenant(gen, tenants++);
+    }
+
+    Config cfg;
+    if (not cfg.parse(config)) cfg.stream_errors(std::cerr);
+    auto &root = cfg.get_settings();
+    std::cout << "config " << config.size() / (1024 * 1024) << " MB, "
+        << count_settings(root) << " settings\n";
+
+    for (auto style : {text_style::compact, text_style::pretty}) {
+        std::string name = (style == text_style::compact) ? "compact" : "pretty";
+
+        std::string text, json;
+        auto to_text_time = bench::best_of(5, [&]() { text = to_text(root, style); });
+        auto to_json_time = bench::best_of(5, [&]() { json = to_json(root, style); });
+        bench::report("to_text, " + name, to_text_time, text.size());
+        bench::report("to_json, " + name, to_json_time, json.size());
+
+        Config again;
+        auto parse_time = bench::best_of(5, [&]() {
+            if (not again.parse(text)) again.stream_errors(std::cerr);
+        });
+        bench::report("parse, " + name, parse_time, text.size());
+
+        auto parse_json_time = bench::best_of(5, [&]() {
+            if (not again.parse_json(json)) again.stream_errors(std::cerr);
+        });
+        bench::report("parse_json, " + name, parse_json_time, json.size());
+
+        // the tenants have no lists of plain scalars, so nothing changes
+        // from list to array on the way through.
+        if (not (again.get_settings() == root)) {
+            std::cerr << name << " JSON doesn't read back to the same tree\n";
+        }
+    }
+
+    return 0;
+}
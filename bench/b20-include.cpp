@@ -0,0 +1,139 @@
+// @include against putting the files together by hand.
+//
+// A defaults file (the tenants of b19-json, 30 MB by default) is
+// included by each of a number of small tenant configs. Each tenant is
+// read in turn: by gluing defaults.cfg on the front of it and parsing
+// that, and with Config::parse_file() and a shared include_cache, which
+// parses the defaults the first time only.
+//
+// Then one config made of many independent included parts, against the
+// same parts glued together, with no cache (so every part is parsed
+// every time, but on a pool).
+//
+// The size in MB of defaults.cfg and the number of tenants can be given
+// on the command line (default 30 and 50). The files go in a directory
+// b20-include.d made (and removed) in the current directory.
+
+#include "bench.hpp"
+
+#include <configinator5000.hpp>
+#include <include.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Configinator5000;
+
+namespace {
+
+    const std::string dir = "b20-include.d/";
+
+    std::vector<std::string> made;
+
+    std::string write_file(const std::string &name, const std::string &text) {
+        std::string path = dir + name;
+        std::ofstream{path, std::ios::binary | std::ios::trunc} << text;
+        made.push_back(path);
+        return path;
+    }
+
+    std::string read_file(const std::string &path) {
+        std::ifstream in{path, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    }
+
+    void parse_or_complain(Config &cfg, bool ok) {
+        if (not ok) cfg.stream_errors(std::cerr);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t target_mb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 30;
+    int tenants = (argc > 2) ? std::atoi(argv[2]) : 50;
+
+    ::mkdir(dir.c_str(), 0777);
+
+    std::mt19937 gen{5000};
+    std::string defaults;
+    for (int i = 0; defaults.size() < target_mb * 1024 * 1024; ++i) {
+        defaults += bench::make_tenant(gen, i);
+    }
+    write_file("defaults.cfg", defaults);
+
+    std::vector<std::string> names;
+    for (int i = 0; i < tenants; ++i) {
+        names.push_back(write_file("tenant" + std::to_string(i) + ".cfg",
+            "tenant_id = " + std::to_string(i) + ";\n@include \"defaults.cfg\"\n"));
+    }
+    std::cout << "defaults.cfg " << defaults.size() / (1024 * 1024) << " MB, "
+        << tenants << " tenants\n";
+
+    // by hand: read both and parse the lot, every time.
+    auto glued_time = bench::best_of(1, [&]() {
+        for (int i = 0; i < tenants; ++i) {
+            Config cfg;
+            std::string text = "tenant_id = " + std::to_string(i) + ";\n" +
+                read_file(dir + "defaults.cfg");
+            parse_or_complain(cfg, cfg.parse(text));
+        }
+    });
+    bench::report("glued, all tenants", glued_time, defaults.size() * std::size_t(tenants));
+
+    auto cache = std::make_shared<include_cache>();
+    auto first_time = bench::best_of(1, [&]() {
+        Config cfg;
+        cfg.set_include_cache(cache);
+        parse_or_complain(cfg, cfg.parse_file(names[0]));
+    });
+    bench::report("@include, first tenant", first_time, defaults.size());
+
+    auto cached_time = bench::best_of(3, [&]() {
+        for (int i = 0; i < tenants; ++i) {
+            Config cfg;
+            cfg.set_include_cache(cache);
+            parse_or_complain(cfg, cfg.parse_file(names[std::size_t(i)]));
+        }
+    });
+    bench::report("@include, all tenants cached", cached_time, defaults.size() * std::size_t(tenants));
+
+    // the same total, in independent parts.
+    const int parts = 16;
+    std::string main_text, glued;
+    std::size_t piece = defaults.size() / parts;
+    for (int i = 0; i < parts; ++i) {
+        std::string part;
+        for (int j = 0; part.size() < piece; ++j) part += bench::make_tenant(gen, j);
+        write_file("part" + std::to_string(i) + ".cfg", part);
+        main_text += "part" + std::to_string(i) + " = {\n@include \"part" +
+            std::to_string(i) + ".cfg\"\n};\n";
+        glued += "part" + std::to_string(i) + " = {\n" + part + "};\n";
+    }
+    auto main = write_file("parts.cfg", main_text);
+
+    auto glued_parts_time = bench::best_of(3, [&]() {
+        Config cfg;
+        parse_or_complain(cfg, cfg.parse(glued));
+    });
+    bench::report("glued, " + std::to_string(parts) + " parts", glued_parts_time, glued.size());
+
+    auto parts_time = bench::best_of(3, [&]() {
+        Config cfg;
+        cfg.set_include_cache(nullptr);
+        parse_or_complain(cfg, cfg.parse_file(main));
+    });
+    bench::report("@include, " + std::to_string(parts) + " parts", parts_time, glued.size());
+
+    for (auto &f : made) std::remove(f.c_str());
+    ::rmdir(dir.c_str());
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+// Minimal timing helpers shared by the benchmarks. We don't want to pull
+// in a benchmark framework just for these.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+    // Run f `runs` times and return the fastest time in seconds.
+    template<class F>
+    double best_of(int runs, F &&f) {
+        double best = 1e30;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+            if (d.count() < best) best = d.count();
+        }
+        return best;
+    }
+
+    inline void report(const std::string &name, double seconds, std::size_t bytes = 0) {
+        std::cout << std::left << std::setw(40) << name
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << seconds * 1000.0 << " ms";
+        if (bytes) {
+            std::cout << std::setw(10) << std::setprecision(1)
+                << (double(bytes) / (1024.0 * 1024.0)) / seconds << " MB/s";
+        }
+        std::cout << "\n";
+    }
+
+    // Keep the optimizer from throwing away results.
+    template<class T>
+    inline void keep(T const &v) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&v) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &v;
+#endif
+    }
+
+    // One tenant of a made up multi-tenant config, as libconfig text: a
+    // group named tenant<i> with an id, a name, a quota group and (unless
+    // routes is false) a list of eight routes. About 600 bytes; the same
+    // gen gives the same text.
+    inline std::string make_tenant(std::mt19937 &gen, int i, bool routes = true) {
+        std::uniform_int_distribution<int> num(0, 1000000);
+        std::uniform_int_distribution<int> letter('a', 'z');
+
+        std::string retval = "tenant" + std::to_string(i) + " = {\n";
+        retval += "  id = " + std::to_string(i) + ";\n";
+        retval += "  name = \"";
+        for (int j = 0; j < 32; ++j) retval += char(letter(gen));
+        retval += "\";\n";
+        retval += "  quota = { cpu = " + std::to_string(num(gen)) + "; mem = " +
+            std::to_string(num(gen)) + "; ratio = 0." + std::to_string(num(gen)) + "; };\n";
+        if (routes) {
+            retval += "  routes = (\n";
+            for (int r = 0; r < 8; ++r) {
+                retval += "    { path = \"/api/v" + std::to_string(r) + "/{id}\"; port = " +
+                    std::to_string(num(gen)) + "; weights = [ 1, 2, 3, 4 ]; },\n";
+            }
+            retval += "  );\n";
+        }
+        retval += "};\n";
+        return retval;
+    }
+
+    // A hardware event counter for this thread (perf_event_open). Not
+    // every machine (or VM) has them; available() says if this one does.
+    class counter {
+        int fd_ = -1;
+
+    public :
+        enum class event { cache_misses, l1d_misses };
+
+        explicit counter(event e) {
+#ifdef __linux__
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            if (e == event::cache_misses) {
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            } else {
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D |
+                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            }
+            fd_ = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+            (void)e;
+#endif
+        }
+
+        counter(const counter &) = delete;
+        counter &operator=(const counter &) = delete;
+
+        ~counter() {
+#ifdef __linux__
+            if (fd_ >= 0) ::close(fd_);
+#endif
+        }
+
+        bool available() const { return fd_ >= 0; }
+
+        // Count the events while f runs.
+        template<class F>
+        std::uint64_t measure(F &&f) {
+            std::uint64_t count = 0;
+#ifdef __linux__
+            if (fd_ >= 0) {
+                ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+                f();
+                ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fd_, &count, sizeof count) != sizeof count) count = 0;
+                return count;
+            }
+#endif
+            f();
+            return count;
+        }
+    };
+
+} // end namespace bench
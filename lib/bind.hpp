@@ -0,0 +1,613 @@
+#pragma once
+
+#include <configinator5000.hpp>
+#include <key_table.hpp>
+#include <parser.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Filling plain structs from a config.
+//
+// A struct says once which of its members come from which keys, with
+// C5K_BIND (or by writing its c5k_fields() by hand). That is a tuple of
+// field descriptors, each a member pointer and a key hashed by the
+// compiler. bind() fills the struct from a Setting tree, finding each key
+// by that hash, and parse_into() fills it straight from the parser's
+// events, without making a tree. Both are templates over the member
+// types, so each member is read with the conversion for its own type.
+//
+//     struct quota { long cpu; long mem; std::optional<double> ratio; };
+//     C5K_BIND(quota, cpu, mem, ratio)
+
+namespace Configinator5000 {
+
+    // The member of S that the setting `key` goes in.
+    template<class S, class T>
+    struct field {
+        hashed_key key;
+        T S::*member;
+    };
+
+    template<class S, class T>
+    constexpr field<S, T> make_field(std::string_view key, T S::*member) {
+        return field<S, T>{hashed_key{key, key_hash(key)}, member};
+    }
+
+    namespace detail {
+
+        template<class T, class = void>
+        struct is_bound : std::false_type {};
+
+        // found by ADL, in the namespace of T.
+        template<class T>
+        struct is_bound<T, std::void_t<decltype(c5k_fields(static_cast<const T *>(nullptr)))>> :
+            std::true_type {};
+
+        template<class T>
+        struct is_optional : std::false_type {};
+
+        template<class T>
+        struct is_optional<std::optional<T>> : std::true_type {};
+
+        template<class T>
+        struct is_vector : std::false_type {};
+
+        template<class T, class A>
+        struct is_vector<std::vector<T, A>> : std::true_type {};
+
+        template<class T>
+        struct unwrapped { using type = T; };
+
+        template<class T>
+        struct unwrapped<std::optional<T>> { using type = T; };
+
+        // bool, int, float or string; maybe optional.
+        template<class T, class U = typename unwrapped<T>::type>
+        constexpr bool is_bound_scalar = std::is_arithmetic_v<U> or std::is_same_v<U, std::string>;
+
+        // Members the config can leave out. Everything else must be there.
+        template<class T>
+        constexpr bool is_optional_member = is_optional<T>::value or is_vector<T>::value;
+
+        template<class T>
+        inline constexpr auto bound_fields = c5k_fields(static_cast<const T *>(nullptr));
+
+        template<class T>
+        constexpr std::size_t bound_field_count = std::tuple_size_v<decltype(bound_fields<T>)>;
+
+        template<class T>
+        constexpr bool is_bindable() {
+            using U = typename unwrapped<T>::type;
+            if constexpr (is_vector<U>::value) {
+                return is_bindable<typename U::value_type>();
+            } else {
+                return is_bound_scalar<U> or is_bound<U>::value;
+            }
+        }
+
+        // What a member of type T can be, for messages.
+        template<class T>
+        constexpr const char *bind_wants() {
+            static_assert(is_bindable<T>(),
+                    "members must be bool, numbers, std::string, bound structs, or "
+                    "std::optional or std::vector of those");
+            using U = typename unwrapped<T>::type;
+            if constexpr (is_vector<U>::value) return "list or array";
+            else if constexpr (is_bound<U>::value) return "group";
+            else if constexpr (std::is_same_v<U, bool>) return "bool";
+            else if constexpr (std::is_integral_v<U>) return "int";
+            else if constexpr (std::is_floating_point_v<U>) return "float";
+            else return "string";
+        }
+
+        inline const char *bind_type_name(const Setting &s) {
+            if (s.is_string()) return "string";
+            if (s.is_boolean()) return "bool";
+            if (s.is_integer()) return "int";
+            if (s.is_float()) return "float";
+            if (s.is_group()) return "group";
+            if (s.is_list()) return "list";
+            return "array";
+        }
+
+        inline void add_bind_step(std::string &path, std::string_view key, int index) {
+            if (key.empty()) {
+                path += '[' + std::to_string(index) + ']';
+            } else {
+                if (not path.empty()) path += '.';
+                path += key;
+            }
+        }
+
+        /***************************************************************
+         * From a tree
+         ***************************************************************/
+
+        // The way down to the Setting being bound, for messages. Each
+        // level keeps one on the stack; the path is only put together if
+        // there is a problem.
+        struct bind_where {
+            const bind_where *up;
+            std::string_view key;
+            int index;
+        };
+
+        inline std::string bind_path(const bind_where *w) {
+            if (not w) return "";
+            auto retval = bind_path(w->up);
+            add_bind_step(retval, w->key, w->index);
+            return retval;
+        }
+
+        template<class T>
+        [[noreturn]] void wrong_type(const Setting &s, const bind_where *w) {
+            throw std::runtime_error((w ? "Setting " + bind_path(w) : "The top level"s) +
+                    " has type " + bind_type_name(s) + ", but the struct wants " + bind_wants<T>());
+        }
+
+        template<class T>
+        void read_setting(Setting &s, T &out, const bind_where *w);
+
+        template<class S, class T>
+        void read_field(Setting &group, S &out, const field<S, T> &f, const bind_where *w) {
+            Setting *child = group.find(f.key);
+            if (not child) {
+                if constexpr (is_optional_member<T>) {
+                    out.*f.member = T{};
+                    return;
+                } else {
+                    throw std::runtime_error((w ? "Group " + bind_path(w) : "The top level"s) +
+                            " is missing required setting " + std::string(f.key.name));
+                }
+            }
+
+            bind_where here{w, f.key.name, 0};
+            read_setting(*child, out.*f.member, &here);
+        }
+
+        template<class T>
+        void read_setting(Setting &s, T &out, const bind_where *w) {
+            if constexpr (is_optional<T>::value) {
+                read_setting(s, out.emplace(), w);
+            } else if constexpr (is_vector<T>::value) {
+                if (not s.is_list() and not s.is_array()) wrong_type<T>(s, w);
+
+                int count = s.count();
+                out.clear();
+                out.reserve(count);
+                for (int i = 0; i < count; ++i) {
+                    // not read into out[i], which std::vector<bool> can't do.
+                    typename T::value_type element{};
+                    bind_where here{w, {}, i};
+                    read_setting(s.at(i), element, &here);
+                    out.push_back(std::move(element));
+                }
+            } else if constexpr (is_bound<T>::value) {
+                if (not s.is_group()) wrong_type<T>(s, w);
+
+                std::apply([&](const auto &...f) { (read_field(s, out, f, w), ...); },
+                        bound_fields<T>);
+            } else {
+                bool fits;
+                if constexpr (std::is_same_v<T, bool>) fits = s.is_boolean();
+                else if constexpr (std::is_integral_v<T>) fits = s.is_integer();
+                else if constexpr (std::is_floating_point_v<T>) fits = s.is_numeric();
+                else fits = s.is_string();
+
+                if (not fits) wrong_type<T>(s, w);
+                out = s.get<T>();
+            }
+        }
+
+        /***************************************************************
+         * From events
+         ***************************************************************/
+
+        struct bind_ops;
+
+        // Somewhere a value goes, and what to do with it there.
+        struct bind_target {
+            void *obj = nullptr;
+            const bind_ops *how = nullptr;
+
+            // the key (from the struct) or index, for messages.
+            std::string_view key;
+            int index = 0;
+
+            // set by member() for a key the group has had already.
+            bool again = false;
+        };
+
+        //
+        // What the event binder does with each type, as plain functions so
+        // the binder's stack doesn't need to know the types it is filling.
+        // The functions that don't make sense for a type are null.
+        //
+        struct bind_ops {
+            const char *wants;
+
+            // Put a scalar in obj. False if the type can't take it.
+            bool (*on_bool)(void *obj, bool v);
+            bool (*on_integer)(void *obj, long v);
+            bool (*on_float)(void *obj, double v);
+            bool (*on_string)(void *obj, std::string_view v);
+
+            // A group, list or array is starting for obj: what fills it.
+            // A null obj if the type can't be one of those.
+            bind_target (*open)(void *obj, ST type);
+
+            // For structs. Where the value of key goes (a null obj if no
+            // member is bound to it), setting the member's bit in seen.
+            bind_target (*member)(void *obj, std::string_view key, std::uint64_t &seen);
+
+            // At the end of the group. Clears the optional members not in
+            // seen, and returns the first required one not in it, if any.
+            std::string_view (*finish)(void *obj, std::uint64_t seen);
+
+            // For vectors. Where the next element goes.
+            bind_target (*element)(void *obj);
+        };
+
+        template<class T, class V>
+        bool put_scalar(T &out, V v) {
+            if constexpr (is_optional<T>::value) {
+                typename T::value_type inner{};
+                if (not put_scalar(inner, v)) return false;
+                out = std::move(inner);
+                return true;
+            } else if constexpr (std::is_same_v<V, bool>) {
+                if constexpr (std::is_same_v<T, bool>) {
+                    out = v;
+                    return true;
+                }
+            } else if constexpr (std::is_same_v<V, long>) {
+                if constexpr (std::is_arithmetic_v<T> and not std::is_same_v<T, bool>) {
+                    out = T(v);
+                    return true;
+                }
+            } else if constexpr (std::is_same_v<V, double>) {
+                if constexpr (std::is_floating_point_v<T>) {
+                    out = T(v);
+                    return true;
+                }
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                out.assign(v.data(), v.size());
+                return true;
+            }
+            return false;
+        }
+
+        template<class T, class V>
+        bool put(void *obj, V v) {
+            return put_scalar(*static_cast<T *>(obj), v);
+        }
+
+        // scalar elements are converted and then pushed on the end.
+        template<class Vec, class V>
+        bool append(void *obj, V v) {
+            typename Vec::value_type element{};
+            if (not put_scalar(element, v)) return false;
+            static_cast<Vec *>(obj)->push_back(std::move(element));
+            return true;
+        }
+
+        template<class T>
+        struct bound_ops { static const bind_ops table; };
+
+        template<class Vec>
+        struct appender_ops { static const bind_ops table; };
+
+        template<class T>
+        bind_target open(void *obj, ST type) {
+            auto &out = *static_cast<T *>(obj);
+            if constexpr (is_optional<T>::value) {
+                return open<typename T::value_type>(&out.emplace(), type);
+            } else if constexpr (is_vector<T>::value) {
+                if (type != ST::LIST and type != ST::ARRAY) return {};
+                out.clear();
+                return {obj, &bound_ops<T>::table, {}, 0};
+            } else if constexpr (is_bound<T>::value) {
+                if (type != ST::GROUP) return {};
+                return {obj, &bound_ops<T>::table, {}, 0};
+            } else {
+                return {};
+            }
+        }
+
+        template<class S>
+        bind_target member(void *obj, std::string_view key, std::uint64_t &seen) {
+            auto &out = *static_cast<S *>(obj);
+            auto hash = key_hash(key);
+
+            bind_target retval;
+            std::uint64_t bit = 1;
+            std::apply([&](const auto &...f) {
+                ((f.key.hash == hash and f.key.name == key
+                  ? (retval = {&(out.*f.member), &bound_ops<std::remove_reference_t<
+                         decltype(out.*f.member)>>::table, f.key.name, 0, (seen & bit) != 0},
+                     seen |= bit,
+                     true)
+                  : (bit <<= 1, false)) or ...);
+            }, bound_fields<S>);
+            return retval;
+        }
+
+        template<class S>
+        std::string_view finish(void *obj, std::uint64_t seen) {
+            auto &out = *static_cast<S *>(obj);
+
+            std::string_view missing;
+            std::uint64_t bit = 1;
+            std::apply([&](const auto &...f) {
+                ([&](const auto &f) {
+                    using T = std::remove_reference_t<decltype(out.*f.member)>;
+                    if (not (seen & bit)) {
+                        if constexpr (is_optional_member<T>) {
+                            out.*f.member = T{};
+                        } else if (missing.empty()) {
+                            missing = f.key.name;
+                        }
+                    }
+                    bit <<= 1;
+                }(f), ...);
+            }, bound_fields<S>);
+            return missing;
+        }
+
+        template<class Vec>
+        bind_target element(void *obj) {
+            using U = typename Vec::value_type;
+            if constexpr (is_bound_scalar<U>) {
+                return {obj, &appender_ops<Vec>::table, {}, 0};
+            } else {
+                return {&static_cast<Vec *>(obj)->emplace_back(), &bound_ops<U>::table, {}, 0};
+            }
+        }
+
+        template<class T>
+        const bind_ops bound_ops<T>::table = [] {
+            bind_ops retval{bind_wants<T>(), &put<T, bool>, &put<T, long>, &put<T, double>,
+                &put<T, std::string_view>, &open<T>, nullptr, nullptr, nullptr};
+            if constexpr (is_bound<T>::value) {
+                static_assert(bound_field_count<T> <= 64, "at most 64 members can be bound");
+                retval.member = &member<T>;
+                retval.finish = &finish<T>;
+            } else if constexpr (is_vector<T>::value) {
+                retval.element = &element<T>;
+            }
+            return retval;
+        }();
+
+        template<class Vec>
+        const bind_ops appender_ops<Vec>::table = {
+            bind_wants<typename Vec::value_type>(), &append<Vec, bool>, &append<Vec, long>,
+            &append<Vec, double>, &append<Vec, std::string_view>, &open<typename Vec::value_type>,
+            nullptr, nullptr, nullptr};
+
+        //
+        // The handler for parse_into(). A stack of what is being filled:
+        // the struct at the bottom, then a frame for each group, list or
+        // array down to where the parser is.
+        //
+        class event_binder : public event_handler {
+            struct frame {
+                bind_target to;
+                std::uint64_t seen;
+                int count;
+            };
+            std::vector<frame> frames_;
+
+            bind_target child(std::string_view name) {
+                auto &top = frames_.back();
+                if (top.to.how->member) return top.to.how->member(top.to.obj, name, top.seen);
+
+                auto retval = top.to.how->element(top.to.obj);
+                retval.index = top.count++;
+                return retval;
+            }
+
+            std::string path(const bind_target *last = nullptr) const {
+                std::string retval;
+                for (std::size_t i = 1; i < frames_.size(); ++i) {
+                    add_bind_step(retval, frames_[i].to.key, frames_[i].to.index);
+                }
+                if (last) add_bind_step(retval, last->key, last->index);
+                return retval;
+            }
+
+            event_action again(std::string_view name) {
+                return fail("Setting named " + std::string(name) + " already defined in this context");
+            }
+
+            event_action wrong(const bind_target &t, const char *type) {
+                return fail("Setting " + path(&t) + " has type " + type +
+                        ", but the struct wants " + t.how->wants);
+            }
+
+            template<class V>
+            event_action scalar(std::string_view name, V v, const char *type) {
+                auto t = child(name);
+                if (not t.obj) return event_action::proceed;
+                if (t.again) return again(name);
+
+                bool ok;
+                if constexpr (std::is_same_v<V, bool>) ok = t.how->on_bool(t.obj, v);
+                else if constexpr (std::is_same_v<V, long>) ok = t.how->on_integer(t.obj, v);
+                else if constexpr (std::is_same_v<V, double>) ok = t.how->on_float(t.obj, v);
+                else ok = t.how->on_string(t.obj, v);
+
+                return ok ? event_action::proceed : wrong(t, type);
+            }
+
+            event_action begin(std::string_view name, ST type, const char *type_name) {
+                auto t = child(name);
+                if (not t.obj) return event_action::skip;
+                if (t.again) return again(name);
+
+                auto inner = t.how->open(t.obj, type);
+                if (not inner.obj) return wrong(t, type_name);
+
+                inner.key = t.key;
+                inner.index = t.index;
+                frames_.push_back({inner, 0, 0});
+                return event_action::proceed;
+            }
+
+        public :
+            template<class T>
+            explicit event_binder(T &out) {
+                frames_.push_back({{&out, &bound_ops<T>::table, {}, 0}, 0, 0});
+            }
+
+            event_action begin_group(std::string_view name) { return begin(name, ST::GROUP, "group"); }
+            event_action begin_list(std::string_view name) { return begin(name, ST::LIST, "list"); }
+            event_action begin_array(std::string_view name) { return begin(name, ST::ARRAY, "array"); }
+
+            event_action end_group() {
+                auto missing = finish();
+                if (not missing.empty()) return fail(std::move(missing));
+                frames_.pop_back();
+                return event_action::proceed;
+            }
+
+            event_action end_list() { frames_.pop_back(); return event_action::proceed; }
+            event_action end_array() { frames_.pop_back(); return event_action::proceed; }
+
+            event_action on_bool(std::string_view name, bool v) { return scalar(name, v, "bool"); }
+            event_action on_integer(std::string_view name, long v) { return scalar(name, v, "int"); }
+            event_action on_float(std::string_view name, double v) { return scalar(name, v, "float"); }
+            event_action on_string(std::string_view name, std::string_view v) {
+                return scalar(name, v, "string");
+            }
+
+            // Finish the innermost group: what it is missing, or "".
+            std::string finish() {
+                auto &top = frames_.back();
+                auto missing = top.to.how->finish(top.to.obj, top.seen);
+                if (missing.empty()) return "";
+                return (frames_.size() > 1 ? "Group " + path() : "The top level"s) +
+                    " is missing required setting " + std::string(missing);
+            }
+        };
+    }
+
+    //
+    // Fill out from the group `from`. Keys that no member is bound to are
+    // left alone. Throws std::runtime_error, naming the setting, if one
+    // is missing or can't go in its member.
+    //
+    template<class T>
+    void bind(Setting &from, T &out) {
+        static_assert(detail::is_bound<T>::value, "bind() needs a struct with C5K_BIND");
+        detail::read_setting(from, out, nullptr);
+    }
+
+    template<class T>
+    void bind(Config &from, T &out) {
+        bind(from.get_settings(), out);
+    }
+
+    //
+    // Parse input straight into out. Stops at the first parse error, or
+    // the first setting that is missing, given twice or can't go in its
+    // member, and writes it to errs. Groups that no member is bound to are skipped
+    // over without being parsed.
+    //
+    template<class T>
+    bool parse_into(std::string_view input, T &out, std::ostream *errs = nullptr) {
+        static_assert(detail::is_bound<T>::value, "parse_into() needs a struct with C5K_BIND");
+
+        detail::event_binder binder{out};
+        EventParser<detail::event_binder> parser{input, binder};
+        bool retval = parser.do_parse();
+        if (retval) {
+            auto missing = binder.finish();
+            if (not missing.empty()) {
+                parser.record_error(missing, parser.current_loc);
+                retval = false;
+            }
+        }
+
+        if (errs) *errs << parser.errors;
+        return retval;
+    }
+
+} // end namespace Configinator5000
+
+//
+// C5K_BIND(type, member, ...) binds each member to the key of the same
+// name. It goes at namespace scope, in the namespace of type. For other
+// keys, write the function it makes yourself:
+//
+//     constexpr auto c5k_fields(const quota *) {
+//         using Configinator5000::make_field;
+//         return std::make_tuple(make_field("cpu-count", &quota::cpu), ...);
+//     }
+//
+#define C5K_BIND(type, ...) \
+    [[maybe_unused]] constexpr auto c5k_fields(const type *) { \
+        return std::make_tuple(C5K_DETAIL_EACH(C5K_DETAIL_FIELD, type, __VA_ARGS__)); \
+    }
+
+#define C5K_DETAIL_FIELD(type, member) ::Configinator5000::make_field(#member, &type::member)
+
+#define C5K_DETAIL_CAT(a, b) C5K_DETAIL_CAT_(a, b)
+#define C5K_DETAIL_CAT_(a, b) a##b
+
+#define C5K_DETAIL_EACH(m, t, ...) \
+    C5K_DETAIL_CAT(C5K_DETAIL_EACH_, C5K_DETAIL_COUNT(__VA_ARGS__))(m, t, __VA_ARGS__)
+
+#define C5K_DETAIL_EACH_1(m, t, a) m(t, a)
+#define C5K_DETAIL_EACH_2(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_1(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_3(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_2(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_4(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_3(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_5(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_4(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_6(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_5(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_7(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_6(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_8(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_7(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_9(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_8(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_10(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_9(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_11(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_10(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_12(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_11(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_13(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_12(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_14(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_13(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_15(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_14(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_16(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_15(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_17(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_16(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_18(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_17(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_19(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_18(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_20(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_19(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_21(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_20(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_22(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_21(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_23(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_22(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_24(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_23(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_25(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_24(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_26(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_25(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_27(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_26(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_28(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_27(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_29(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_28(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_30(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_29(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_31(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_30(m, t, __VA_ARGS__)
+#define C5K_DETAIL_EACH_32(m, t, a, ...) m(t, a), C5K_DETAIL_EACH_31(m, t, __VA_ARGS__)
+
+#define C5K_DETAIL_COUNT(...) C5K_DETAIL_COUNT_N(__VA_ARGS__, \
+    32, 31, 30, 29, 28, 27, 26, 25, \
+    24, 23, 22, 21, 20, 19, 18, 17, \
+    16, 15, 14, 13, 12, 11, 10, 9, \
+    8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define C5K_DETAIL_COUNT_N( \
+    _1, _2, _3, _4, _5, _6, _7, _8, \
+    _9, _10, _11, _12, _13, _14, _15, _16, \
+    _17, _18, _19, _20, _21, _22, _23, _24, \
+    _25, _26, _27, _28, _29, _30, _31, _32, \
+    n, ...) n
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Support for the parsers c5k-codegen writes.
+
+namespace Configinator5000::codegen {
+
+    // FNV-1a from a seed, with the bits mixed at the end so the low ones
+    // are good. For each struct, c5k-codegen looks for a seed that puts
+    // every one of its keys in a slot of its own (the low bits), so a key
+    // is found with one switch and one compare.
+    constexpr std::uint32_t slot_hash(std::string_view key, std::uint32_t seed) {
+        std::uint32_t h = 2166136261u ^ seed;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        return h;
+    }
+
+} // end namespace Configinator5000::codegen
@@ -0,0 +1,212 @@
+#include <config_store.hpp>
+#include <path.hpp>
+
+#include <algorithm>
+
+namespace Configinator5000 {
+
+    namespace {
+        // Spreads the threads over the slots.
+        std::atomic<unsigned> next_hint{0};
+        thread_local unsigned slot_hint = next_hint.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ConfigStore::~ConfigStore() {
+        delete current_.load();
+
+        auto *block = slots_.next.load();
+        while (block) {
+            auto *next = block->next.load();
+            delete block;
+            block = next;
+        }
+    }
+
+    detail::reader_slot *ConfigStore::claim_slot() const {
+        using slots = detail::reader_slots;
+
+        slots *block = &slots_;
+        unsigned start = slot_hint % slots::size;
+
+        for (;;) {
+            for (unsigned i = 0; i < slots::size; ++i) {
+                auto &slot = block->slots[(start + i) % slots::size];
+                if (slot.epoch.load(std::memory_order_relaxed) != 0) continue;
+
+                // If the epoch moves on before this lands, the reader just
+                // holds things up for a little longer than it needs to.
+                std::uint64_t expected = 0;
+                if (slot.epoch.compare_exchange_strong(expected, epoch_.load())) {
+                    return &slot;
+                }
+            }
+
+            slots *next = block->next.load(std::memory_order_acquire);
+            if (not next) {
+                auto *grown = new slots();
+                if (block->next.compare_exchange_strong(next, grown)) {
+                    next = grown;
+                } else {
+                    // someone else added one first; next is theirs.
+                    delete grown;
+                }
+            }
+            block = next;
+        }
+    }
+
+    ConfigHandle ConfigStore::read() const {
+        auto *slot = claim_slot();
+
+        // Anything retired after the slot was claimed waits for us, so
+        // whatever this loads stays put.
+        return ConfigHandle{slot, current_.load()};
+    }
+
+    bool ConfigStore::publish(std::unique_ptr<Config> cfg) {
+        // Readers only read. Lazy parts would be filled in by whichever
+        // reader got there first, so they can't be left for later.
+        if (not cfg->validate_all()) {
+            std::lock_guard<std::mutex> guard{lock_};
+            failed_ = std::move(cfg);
+            return false;
+        }
+
+        std::unique_lock<std::mutex> guard{lock_};
+
+        // Holds on to the old Config (and the new one) while subscribers
+        // look at them, as a reader would.
+        ConfigHandle pinned;
+        std::vector<subscription> to_tell;
+        if (not subscriptions_.empty()) {
+            pinned = ConfigHandle{claim_slot(), nullptr};
+            to_tell = subscriptions_;
+        }
+
+        const Config *fresh = cfg.release();
+        const Config *old = current_.exchange(fresh);
+
+        // Readers that start from here on can only see the new one.
+        std::uint64_t epoch = epoch_.fetch_add(1) + 1;
+        std::uint64_t turn = next_turn_++;
+
+        if (old) retired_.push_back(retired_config{std::unique_ptr<const Config>(old), epoch});
+
+        reclaim_locked();
+        guard.unlock();
+
+        // Wait for the publishes before this one to tell theirs (without
+        // lock_, so subscribers can still look at the store), and let the
+        // next one go when done, even if a subscriber throws.
+        struct my_turn {
+            ConfigStore &store;
+            std::unique_lock<std::mutex> telling;
+
+            my_turn(ConfigStore &s, std::uint64_t turn) : store{s}, telling{s.telling_} {
+                store.turn_changed_.wait(telling, [&]() { return store.turn_ == turn; });
+            }
+
+            ~my_turn() {
+                store.turn_ += 1;
+                telling.unlock();
+                store.turn_changed_.notify_all();
+            }
+        } in_turn{*this, turn};
+
+        if (old and not to_tell.empty()) {
+            for (auto const &change : diff(old->get_settings(), fresh->get_settings())) {
+                for (auto const &s : to_tell) {
+                    if (path_overlaps(change.path, s.prefix)) s.fn(change);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool ConfigStore::reload(std::string_view input) {
+        auto cfg = std::make_unique<Config>();
+        if (not cfg->parse(input)) {
+            std::lock_guard<std::mutex> guard{lock_};
+            failed_ = std::move(cfg);
+            return false;
+        }
+
+        return publish(std::move(cfg));
+    }
+
+    bool ConfigStore::reload_file(const std::string &file_name) {
+        auto cfg = std::make_unique<Config>();
+        if (not cfg->parse_file(file_name)) {
+            std::lock_guard<std::mutex> guard{lock_};
+            failed_ = std::move(cfg);
+            return false;
+        }
+
+        return publish(std::move(cfg));
+    }
+
+    std::ostream &ConfigStore::stream_errors(std::ostream &strm) {
+        std::lock_guard<std::mutex> guard{lock_};
+        if (failed_) failed_->stream_errors(strm);
+
+        return strm;
+    }
+
+    int ConfigStore::subscribe(std::string_view prefix, subscriber fn) {
+        // checks it, and the changes are written "a[3]" rather than "a.[3]".
+        Path checked{prefix};
+        std::string normal = checked.str();
+        for (auto pos = normal.find(".["); pos != std::string::npos; pos = normal.find(".[")) {
+            normal.erase(pos, 1);
+        }
+
+        std::lock_guard<std::mutex> guard{lock_};
+        subscriptions_.push_back(subscription{next_id_, std::move(normal), std::move(fn)});
+        return next_id_++;
+    }
+
+    void ConfigStore::unsubscribe(int id) {
+        std::lock_guard<std::mutex> guard{lock_};
+        subscriptions_.erase(std::remove_if(subscriptions_.begin(), subscriptions_.end(),
+                    [id](const subscription &s) { return s.id == id; }),
+                subscriptions_.end());
+    }
+
+    void ConfigStore::reclaim() {
+        std::lock_guard<std::mutex> guard{lock_};
+        reclaim_locked();
+    }
+
+    std::size_t ConfigStore::retired() const {
+        std::lock_guard<std::mutex> guard{lock_};
+        return retired_.size();
+    }
+
+    std::uint64_t ConfigStore::oldest_reader() const {
+        std::uint64_t oldest = 0;
+
+        for (auto *block = &slots_; block; block = block->next.load(std::memory_order_acquire)) {
+            for (auto &slot : block->slots) {
+                std::uint64_t e = slot.epoch.load();
+                if (e != 0 and (oldest == 0 or e < oldest)) oldest = e;
+            }
+        }
+
+        return oldest;
+    }
+
+    void ConfigStore::reclaim_locked() {
+        if (retired_.empty()) return;
+
+        std::uint64_t oldest = oldest_reader();
+
+        // a reader in an earlier epoch may have loaded it.
+        retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                    [oldest](const retired_config &r) {
+                        return oldest == 0 or oldest >= r.epoch;
+                    }),
+                retired_.end());
+    }
+
+} // end namespace Configinator5000
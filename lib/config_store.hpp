@@ -0,0 +1,202 @@
+#pragma once
+
+#include <configinator5000.hpp>
+#include <diff.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reloading a config while other threads read it.
+//
+// A ConfigStore holds the current Config behind an atomic pointer. A
+// reader takes a ConfigHandle, which keeps the Config it saw alive (and
+// unchanged) for as long as the handle lives, however many reloads
+// happen meanwhile. Publishing a new Config never waits for readers, and
+// readers never take a lock.
+//
+// Old Configs are reclaimed by epoch: each reader claims a slot and
+// writes the epoch it started in there, and a Config retired in epoch e
+// is deleted once no slot shows an epoch before e. Slots are on their own
+// cache lines and each thread starts looking for a free one at a
+// different place, so readers on different threads don't touch the same
+// memory.
+//
+// Code that keeps its own state built from the config can subscribe to
+// the parts it cares about, and after each publish is told only about
+// the Settings that changed there (see diff.hpp). Publishes take turns
+// at telling subscribers, in the order they made their Configs current,
+// so the changes always add up to the current Config.
+
+namespace Configinator5000 {
+
+    class ConfigStore;
+
+    namespace detail {
+        struct alignas(64) reader_slot {
+            // the epoch of the reader using the slot, 0 if it is free.
+            std::atomic<std::uint64_t> epoch{0};
+        };
+
+        struct reader_slots {
+            static constexpr unsigned size = 32;
+
+            reader_slot slots[size];
+            std::atomic<reader_slots *> next{nullptr};
+        };
+    }
+
+    //
+    // A reader's hold on a published Config. Cheap to take; keep it only
+    // as long as needed, since the Config it holds (and any older ones)
+    // can't be deleted while it exists. Not to be passed between threads.
+    //
+    class ConfigHandle {
+        friend class ConfigStore;
+
+        detail::reader_slot *slot_ = nullptr;
+        const Config *cfg_ = nullptr;
+
+        ConfigHandle(detail::reader_slot *slot, const Config *cfg) :
+            slot_{slot}, cfg_{cfg} {}
+
+    public :
+        ConfigHandle() = default;
+
+        ConfigHandle(const ConfigHandle &) = delete;
+        ConfigHandle &operator=(const ConfigHandle &) = delete;
+
+        ConfigHandle(ConfigHandle &&o) noexcept : slot_{o.slot_}, cfg_{o.cfg_} {
+            o.slot_ = nullptr;
+            o.cfg_ = nullptr;
+        }
+
+        ConfigHandle &operator=(ConfigHandle &&o) noexcept {
+            if (this != &o) {
+                release();
+                slot_ = o.slot_;
+                cfg_ = o.cfg_;
+                o.slot_ = nullptr;
+                o.cfg_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~ConfigHandle() { release(); }
+
+        // false if nothing had been published.
+        explicit operator bool() const { return cfg_ != nullptr; }
+
+        const Config &operator*() const { return *cfg_; }
+        const Config *operator->() const { return cfg_; }
+
+        // Let go early.
+        void release() {
+            if (slot_) slot_->epoch.store(0, std::memory_order_release);
+            slot_ = nullptr;
+            cfg_ = nullptr;
+        }
+    };
+
+    class ConfigStore {
+    public :
+        ConfigStore() = default;
+
+        ConfigStore(const ConfigStore &) = delete;
+        ConfigStore &operator=(const ConfigStore &) = delete;
+
+        // There mustn't be any ConfigHandles left.
+        ~ConfigStore();
+
+        // The current Config.
+        ConfigHandle read() const;
+
+        // Make cfg the current Config. Readers with a handle keep the one
+        // they had. The store owns cfg from now on and it is only read;
+        // anything a lazy parse put off is parsed first, and if that finds
+        // errors nothing is published, this returns false and the errors
+        // are in stream_errors().
+        bool publish(std::unique_ptr<Config> cfg);
+
+        // Parse into a new Config and publish it. If the parse fails the
+        // current Config stays, and the errors are in stream_errors().
+        bool reload(std::string_view input);
+        bool reload_file(const std::string &file_name);
+
+        // The errors from the last reload (or publish) that failed.
+        std::ostream &stream_errors(std::ostream &strm);
+
+        using subscriber = std::function<void(const setting_change &)>;
+
+        // Call fn with each change a later publish makes at or under
+        // prefix (a path, as for Path; "" for everything), including ones
+        // that replace something above it. fn is called on the publishing
+        // thread once the new Config is current; the change's Settings
+        // are good until it returns. It mustn't publish or (un)subscribe.
+        // Subscribers are told about one publish at a time, in the order
+        // the Configs were published, so fn is never called on two
+        // threads at once, and never hears of version 3 before 2.
+        // Throws std::runtime_error if prefix isn't a good path.
+        int subscribe(std::string_view prefix, subscriber fn);
+        void unsubscribe(int id);
+
+        // Delete the retired Configs no reader can still be using. Done
+        // by every publish() as well.
+        void reclaim();
+
+        // How many retired Configs are waiting to be deleted.
+        std::size_t retired() const;
+
+    private :
+        struct retired_config {
+            std::unique_ptr<const Config> cfg;
+
+            // deleted once every reader started in this epoch or later.
+            std::uint64_t epoch;
+        };
+
+        std::atomic<const Config *> current_{nullptr};
+        std::atomic<std::uint64_t> epoch_{1};
+
+        // more are chained on as needed and kept until the store goes.
+        mutable detail::reader_slots slots_;
+
+        // publishers take turns.
+        mutable std::mutex lock_;
+        std::vector<retired_config> retired_;
+        std::unique_ptr<Config> failed_;
+
+        // Publishes tell subscribers in turn: each takes the next number
+        // (with lock_ held) as it makes its Config current, and waits
+        // for turn_ to get to it.
+        std::uint64_t next_turn_ = 0;
+        std::mutex telling_;
+        std::condition_variable turn_changed_;
+        std::uint64_t turn_ = 0;
+
+        struct subscription {
+            int id;
+            std::string prefix;
+            subscriber fn;
+        };
+        std::vector<subscription> subscriptions_;
+        int next_id_ = 0;
+
+        detail::reader_slot *claim_slot() const;
+
+        // oldest epoch a reader is in, or 0 if there are none.
+        std::uint64_t oldest_reader() const;
+
+        // with lock_ held
+        void reclaim_locked();
+    };
+
+} // end namespace Configinator5000
@@ -1,726 +1,598 @@
 #include <configinator5000.hpp>
-
-#include <string_view>
-#include <list>
-#include <charconv>
+#include <file_replacement.hpp>
+#include <include.hpp>
+#include <json.hpp>
+#include <mapped_file.hpp>
+#include <parser.hpp>
+#include <schema.hpp>
+#include <snapshot.hpp>
+#include <tree_arena.hpp>
+#include <work_pool.hpp>
+#include <writer.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <sstream>
+#include <vector>
 
-#include <ostream>
+namespace Configinator5000 {
 
+    namespace {
+        // Parse the top level of `input`, leaving composites lazy. `owner`
+        // keeps the text alive for them.
+        Parser *parse_top_level(std::string_view input, Setting *root,
+                std::shared_ptr<const void> owner) {
+            auto *parser = new Parser(input, root);
+            parser->lazy = true;
+            parser->lazy_owner = std::move(owner);
+            parser->do_parse();
+            return parser;
+        }
 
-namespace Configinator5000 {
+        void validate_tree(Setting &s, error_list &errs) {
+            if (not expand_lazy(s, errs)) return;
 
-    using ST = Setting::setting_type;
+            if (s.is_composite()) {
+                for (auto &child : s) validate_tree(child, errs);
+            }
+        }
+    }
 
-    struct parse_loc {
-        std::string_view sv;
-        int offset = 0;
-        int line = 0;
-    };
+    bool expand_lazy(Setting &target, error_list &errs, bool all_levels) {
+        auto *rep = target.rep();
+        if (not rep or not rep->lazy) return true;
 
-    struct error_info {
-        std::string message;
-        parse_loc loc;
+        // the lazy pointer is about to be reset, so hang on to it.
+        auto source = std::move(rep->lazy);
 
-        error_info() = default;
-        error_info(const std::string &mesg, const parse_loc &l) :
-            message{mesg}, loc{l} {}
+        TreeBuilder builder{&target};
+        builder.lazy = not all_levels;
+        builder.lazy_owner = source->owner;
+        builder.keys = source->keys;
 
-        friend std::ostream & operator<<(std::ostream &strm, const error_info& ei) {
-            strm << "line " << ei.loc.line << " : " << ei.message << "\n";
-            return strm;
-        }
-    };
+        EventParser<TreeBuilder> parser{source->text, builder,
+            source->loc.offset, source->loc.line};
 
-    struct error_list {
-        std::string_view src;
-        std::list<error_info> errors;
+        if (parser.do_parse_composite()) return true;
 
-        int count() const {
-            return static_cast<int>(errors.size());
-        }
+        target.clear_subobjects();
+        target.composite().lazy = std::move(source);
+        errs.errors.splice(errs.errors.end(), parser.errors.errors);
+        return false;
+    }
 
-        bool empty() const { return errors.empty(); }
+    void Setting::expand() const {
+        error_list errs;
 
-        void add(const std::string &mesg, const parse_loc &l) {
-            errors.emplace_back(mesg, l);
+        // Filling in the children doesn't change the value the Setting
+        // represents, so this is still logically const.
+        if (not expand_lazy(const_cast<Setting &>(*this), errs)) {
+            std::ostringstream msg;
+            msg << errs;
+            throw std::runtime_error(msg.str());
         }
+    }
 
-        friend std::ostream & operator<<(std::ostream &strm, const error_list & el){
-            for (auto &e : el.errors) {
-                strm << e;
-            }
-            return strm;
+    namespace {
+        std::uint64_t mix(std::uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
         }
-    };
-
-    struct Parser {
 
-        std::string_view src;
+        // As key_hash(), but all 64 bits, and with the whole of a long
+        // string mixed in.
+        std::uint64_t text_hash(std::string_view s) {
+            const char *p = s.data();
+            std::size_t n = s.size();
 
-        Setting *setting;
+            std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+            std::uint64_t tail = 0;
 
-        parse_loc current_loc;
+            if (n > 8) {
+                const char *last = p + n - 8;
+                for (; p < last; p += 8) {
+                    h = (h ^ detail::load64_le(p)) * 0xff51afd7ed558ccdULL;
+                    h = (h << 31) | (h >> 33);
+                }
+                tail = detail::load64_le(last);
+            } else if (n >= 4) {
+                tail = (detail::load32_le(p) << 32) | detail::load32_le(p + n - 4);
+            } else if (n > 0) {
+                tail = detail::byte(p, 0) << 16 | detail::byte(p, int(n / 2)) << 8 |
+                    detail::byte(p, int(n - 1));
+            }
 
-        error_list errors;
+            return mix(h ^ tail);
+        }
 
-        Parser(std::string_view _src, Setting *s) : src{_src}, setting{s},
-            current_loc{_src, 0, 0} {}
+        std::uint64_t float_bits(double d) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &d, sizeof bits);
+            return bits;
+        }
+    }
 
-        /***********************************************************
-         * Error utilities
-         ***********************************************************/
+    void Setting::hashes_stale() {
+        hashed_.store(false, std::memory_order_relaxed);
+        tree_state::get(tree_).hash_epoch.fetch_add(1);
+    }
 
-        void record_error(const std::string &msg, const parse_loc &l) {
-            errors.add(msg, l);
+    std::uint64_t Setting::content_hash() const {
+        switch (type_) {
+            case setting_type::INTEGER : return mix(mix(1) ^ std::uint64_t(integer_));
+            case setting_type::FLOAT :   return mix(mix(2) ^ float_bits(float_));
+            case setting_type::BOOL :    return mix(bool_ ? 3 : 4);
+            case setting_type::STRING :  return mix(mix(5) ^ text_hash(string_value()));
+            default : break;
         }
 
-        void record_error(const std::string & msg) {
-            record_error(msg, current_loc);
-        }
-
-        /***********************************************************
-         * Input utilities
-         ***********************************************************/
-
-        inline void consume(int count) {
-            // note : others are responsible for line number
-            current_loc.offset += count;
-            current_loc.sv.remove_prefix(count);
-        }
-
-        inline bool eoi() { return current_loc.sv.size() == 0; }
-
-        inline char peek() { if (!eoi()) { return current_loc.sv[0]; }
-            else { return '\x00'; } }
-
-        inline char peek(int pos) { return current_loc.sv[pos]; }
-
-        inline bool valid_pos(int pos) {
-            return (pos >= 0 and (unsigned)pos < current_loc.sv.size()); 
-        }
-
-
-        inline bool check_string(std::string_view o) {
-            return current_loc.sv.compare(0, o.size(), o) == 0;
-        }
-        
-        inline bool match_string(std::string_view o) {
-            bool matched = check_string(o);
-            if (matched) consume(o.size());
-            return matched;
-        }
-
-        /****************************************************************
-        * SKIP Processing
-        ****************************************************************/
-        bool skip() {
-
-            //
-            // States for the state machine
-            //
-            enum SKIP_STATE { skNormal, skLine, skBlock };
-
-            SKIP_STATE state = skNormal;
-
-            //
-            // we'll be using this a lot.
-            // So abbreviate it with a reference.
-            //
-            auto &cl = current_loc;
-
-            //
-            // When we enter a comment, we'll record where it started.
-            // If, at the end, we're still looking for comment terminator,
-            // we can use this location to put out an error message.
-            //
-            parse_loc comment_loc;
-
-            bool skipping = true;
-            int line_count = 0;
-            while (skipping and not eoi()) {
-
-                //std::cout << "Loop top pos = " << cl.offset <<
-                //    " state = " << state <<
-                //    " char = '" << peek() << "'\n";
-                switch (state) {
-                    case skNormal : // Normal state
-                        if (peek(0) == '\n') {
-                            line_count += 1;
-                            consume(1);
-                        } else if (std::isspace(peek(0))) {
-                            consume(1);
-                        } else if (peek(0) == '#') {
-                            //std::cout << "--- Saw hash comment start\n";
-                            comment_loc = cl;
-                            consume(2);
-                            state = skLine;
-                        } else if (check_string("//")) {
-                            //std::cout << "--- Saw line comment start\n";
-                            comment_loc = cl;
-                            consume(2);
-                            state = skLine;
-                        } else if (check_string("/*")) {
-                            //std::cout << "--- Saw block comment start\n";
-                            comment_loc = cl;
-                            consume(2);
-                            state = skBlock;
-                        } else {
-                            skipping = false;
-                        }
-                        break;
-                    case skLine: // Line comment
-                        if (peek(0) == '\n') {
-                            //std::cout << "--- line comment end\n";
-                            state = skNormal;
-                            line_count += 1;
-                        }
-                        consume(1);
-                        break;
-                    case skBlock: // Block comment
-                        if (match_string("*/")) {
-                            //std::cout << "--- block comment end\n";
-                            state = skNormal;
-                        } else {
-                            if (peek(0) == '\n') {
-                                line_count += 1;
-                            }
-                            consume(1);
-                        }
-                        break;
-                }
-            }
-
-            if (state != skNormal) {
-                record_error("Unterminated comment starting here", comment_loc);
-                return false;
-            }
+        touch();
+        auto *r = rep();
 
-            current_loc.line += line_count;
+        std::uint64_t epoch = tree_state::get(tree_).hash_epoch.load(std::memory_order_acquire);
+        if (r and r->hash_epoch.load(std::memory_order_acquire) == epoch) {
+            return r->hash.load(std::memory_order_relaxed);
+        }
 
-            return true;
+        // Any number of threads may be reading the tree, so the caches
+        // are atomics. They all work out the same answer.
+        auto child_hash = [](const Setting &c) {
+            auto h = c.content_hash();
+            c.hashed_.store(true, std::memory_order_relaxed);
+            return h;
         };
 
-        bool match_char(int pos, char c) {
-            return (valid_pos(pos) and peek(pos) == c);
+        std::uint64_t h;
+        int n = r ? int(r->children.size()) : 0;
+        if (is_group()) {
+            // the order of the keys doesn't matter.
+            std::uint64_t sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += mix(text_hash(index()->key(i)) ^ child_hash(r->children[std::size_t(i)]));
+            }
+            h = mix(mix(6) ^ sum);
+        } else {
+            h = mix(is_list() ? 7 : 8);
+            for (int i = 0; i < n; ++i) {
+                h = mix(h ^ child_hash(r->children[std::size_t(i)]));
+            }
         }
+        h = mix(h ^ std::uint64_t(n));
 
-        bool match_char(char c) {
-            return peek() == c;
+        if (r) {
+            r->hash.store(h, std::memory_order_relaxed);
+            r->hash_epoch.store(epoch, std::memory_order_release);
+            hashed_.store(true, std::memory_order_relaxed);
         }
 
-        bool match_chars(int pos, const char * c) {
-            if (!valid_pos(pos)) return false;
-            char t  = peek(pos);
+        return h;
+    }
 
-            while (*c) {
-                if (*c == t) return true;
-                ++c;
-            }
+    bool Setting::operator==(const Setting &o) const {
+        if (this == &o) return true;
+        if (type_ != o.type_) return false;
 
-            return false;
+        switch (type_) {
+            case setting_type::INTEGER : return integer_ == o.integer_;
+            case setting_type::FLOAT :   return float_bits(float_) == float_bits(o.float_);
+            case setting_type::BOOL :    return bool_ == o.bool_;
+            case setting_type::STRING :  return string_value() == o.string_value();
+            default : break;
         }
 
-        //##############   match_bool_value  #################
+        if (content_hash() != o.content_hash()) return false;
+
+        int n = count();
+        if (n != o.count()) return false;
+        if (n == 0) return true;
 
-        std::optional<bool> match_bool_value() {
-            // if there aren't enough chars then short circuit
-            if (!valid_pos(4)) {
-                return std::nullopt;
+        auto &mine = composite_->children;
+        auto &theirs = o.composite_->children;
+        for (int i = 0; i < n; ++i) {
+            int j = i;
+            if (is_group()) {
+                j = o.find_child(index()->key(i));
+                if (j < 0) return false;
             }
+            if (mine[std::size_t(i)] != theirs[std::size_t(j)]) return false;
+        }
 
-            int pos = 0;
-            if (match_chars(pos, "Ff")) {
-                pos += 1;
-                if (! match_chars(pos, "Aa")) return std::nullopt;
-                pos += 1;
-                if (! match_chars(pos, "Ll")) return std::nullopt;
-                pos += 1;
-                if (! match_chars(pos, "Ss")) return std::nullopt;
-                pos += 1;
-                if (! match_chars(pos, "Ee")) return std::nullopt;
-                pos += 1;
-                // must be at end of word
-                if (valid_pos(pos) and std::isalnum(peek(pos))) return std::nullopt;
-
-                consume(pos);
-                return false;
+        return true;
+    }
 
-            } else if (match_chars(pos, "Tt")) {
-                pos += 1;
-                if (! match_chars(pos, "Rr")) return std::nullopt;
-                pos += 1;
-                if (! match_chars(pos, "Uu")) return std::nullopt;
-                pos += 1;
-                if (! match_chars(pos, "Ee")) return std::nullopt;
-                pos += 1;
-                // must be at end of word
-                if (valid_pos(pos) and std::isalnum(peek(pos))) return std::nullopt;
-
-                consume(pos);
-                return true;
-            }
+    bool Config::parse_file(const std::string &file_name) {
+        mapped_file file{file_name};
 
-            return std::nullopt;
-
-        }
-
-        //##############   match_integer_value  #################
-        // handles both base 10 and hex
-        std::optional<long> match_integer_value() {
-            if (match_string("0x") or match_string("0X")) {
-                // integer in hex format - from_chars doesn't like the 0x prefix
-                // can't be anything else so commit.
-                long seen_num;
-                auto [ ptr, ec] = std::from_chars(current_loc.sv.data()+2,
-                        current_loc.sv.data()+current_loc.sv.size(), seen_num, 16);
-                if (ec == std::errc()) {
-                    int pos = ptr-current_loc.sv.data();
-                    if (valid_pos(pos) and std::isalnum(*ptr)) {
-                        // End of the number wasn't at a word boundary.
-                        record_error("Hex prefix, but invalid hex number followed");
-                        return std::nullopt;
-                    }
-                    consume(pos);
-                    return seen_num;
-                } else {
-                    record_error("Hex prefix, but invalid hex number followed");
-                    return std::nullopt;
-                }
+        if (not file.is_open()) {
+            return open_failed(file_name);
+        }
 
-            } else if (match_chars(0, "+-0123456789")) {
-                // either a base-10 integer or float.
-
-                int copy_size = std::min(current_loc.sv.size(), size_t(100));
-                std::string subject(std::string(current_loc.sv.substr(0, copy_size)));
-
-                try {
-                    size_t pos = 0;
-                    long seen_num = std::stol(subject, &pos);
-
-                    if (valid_pos(pos) and (std::isalnum(peek(pos)) or match_char(pos, '.'))) {
-                        // must be at a word boundary.
-                        return std::nullopt;
-                    } else {
-                        consume(pos);
-                        return seen_num;
-                    }
-                } catch(std::exception &e) {
-                    return std::nullopt;
-                }
+        // The parser reads straight out of the mapping. Nothing it keeps
+        // after do_parse() looks at the source text, so it's fine for the
+        // mapping to go away when we return.
+        return parse_with_schema(file.view(), schema_.get(), file_name);
+    }
 
-                return std::nullopt;
+    bool Config::parse_file_lazy(const std::string &file_name) {
+        auto file = std::make_shared<mapped_file>(file_name);
 
-            }
+        if (not file->is_open()) {
+            return open_failed(file_name);
+        }
 
-            return std::nullopt;
+        // The schema is checked as the parse goes, and included settings
+        // have no text to come back to, so both need it all parsed now.
+        if (schema_ or may_include(file->view())) {
+            return parse_with_schema(file->view(), schema_.get(), file_name);
         }
 
-        //##############   match_double_value  #################
-        
-        std::optional<double>  match_double_value() {
+        Setting &root = new_tree();
+        source_ = file;
+        parser_ = parse_top_level(file->view(), &root, arena_ ? nullptr : source_);
 
-            if (match_chars(0, "+-0123456789")) {
-                // either a base-10 integer or float.
+        return parser_->errors.empty();
+    }
 
-                int copy_size = std::min(current_loc.sv.size(), size_t(100));
-                std::string subject(std::string(current_loc.sv.substr(0, copy_size)));
+    bool Config::parse_lazy(std::string input) {
+        if (schema_ or may_include(input)) return parse(input);
 
-                try {
-                    size_t pos = 0;
-                    double seen_num = std::stod(subject, &pos);
-                    if (valid_pos(pos) and std::isalnum(peek(pos))) {
-                        return std::nullopt;
-                    } else {
-                        consume(pos);
-                        return seen_num;
-                    }
-                } catch(std::exception &e) {
-                    return std::nullopt;
-                }
+        auto text = std::make_shared<const std::string>(std::move(input));
 
-                return std::nullopt;
-            }
+        Setting &root = new_tree();
+        source_ = text;
+        parser_ = parse_top_level(*text, &root, arena_ ? nullptr : source_);
 
-            return std::nullopt;
-        }
-        
-        //##############   match_string_value  ###############
-
-        std::optional<std::string> match_string_value() {
-            if (!match_char('"')) return std::nullopt;
-
-            // consume the opening quotes
-            consume(1);
-            std::stringstream buf{};
-
-            bool stop = false;
-            while(not stop and not eoi()) {
-                char c = peek();
-                switch (c) {
-                    case '\0' :
-                        //must be eoi;
-                        stop = true;
-                        break;
-                    case '\\' :
-                        if (match_chars(1, "\\fnrtx\"")) {
-                            switch(peek(1)) {
-                            case 'f' :
-                                buf << '\f';
-                                consume(2);
-                                break;
-                            case 'n' :
-                                buf << '\n';
-                                consume(2);
-                                break;
-                            case '"' :
-                                buf << '"';
-                                consume(2);
-                                break;
-                            case 'r' :
-                                buf << '\r';
-                                consume(2);
-                                break;
-                            case '\\' :
-                                buf << '\\';
-                                consume(2);
-                                break;
-                            case 't' :
-                                buf << '\t';
-                                consume(2);
-                                break;
-                            case 'x' :
-                                if (match_chars(2, "0123456789abcdefABCDEF") and
-                                        match_chars(3, "0123456789abcdefABCDEF")) {
-                                    char x = (peek(2) - '0') * 16 + (peek(3) - '0');
-                                    buf << x;
-                                    consume(4);
-                                } else {
-                                    record_error("Bad hex escape in string");
-                                    consume(2); // just to keep us going
-                                }
-                                break;
-                            }
-                        } else {
-                            record_error("Unrecognized escape sequence in string");
-                            consume(1);
-                        }
-                    case '\n' :
-                        record_error("Unterminated string");
-                        return std::nullopt;
-                        break;
-                    case '"' :
-                        stop = true;
-                        consume(1);
-                        break;
-                    default:
-                        buf << c;
-                        // this will be slow - rethink.
-                        consume(1);
-                        break;
-                    }
-                if (stop) {
-                    skip();
-                    if (match_char('"')) {
-                        stop = false;
-                        consume(1);
-                    }
-                }
-            }
+        return parser_->errors.empty();
+    }
 
-            return buf.str();
+    bool Config::validate_all() {
+        if (not parser_) return true;
 
+        validate_tree(*cfg_, parser_->errors);
+
+        return parser_->errors.empty();
+    }
+
+    bool Config::parse_file_parallel(const std::string &file_name, unsigned threads) {
+        mapped_file file{file_name};
+
+        if (not file.is_open()) {
+            return open_failed(file_name);
         }
-        //##############   match_scalar_value  ###############
 
-        bool match_scalar_value(Setting *parent) {
+        if (schema_ or may_include(file.view())) {
+            return parse_with_schema(file.view(), schema_.get(), file_name);
+        }
 
-            auto bv = match_bool_value();
-            if (bv) {
-                parent->set_value(*bv);
-                return true;
-            }
-            
-            auto lv = match_integer_value();
-            if (lv) {
-                parent->set_value(*lv);
-                return true;
-            }
+        return parse_parallel(file.view(), threads);
+    }
 
-            auto dv = match_double_value();
-            if (dv) {
-                parent->set_value(*dv);
-                return true;
-            }
+    bool Config::parse_parallel(std::string_view input, unsigned threads) {
+        // the schema is checked by the one parser, in order.
+        if (schema_ or may_include(input)) return parse(input);
 
-            auto sv = match_string_value();
-            if (sv) {
-                parent->set_value(*sv);
-                return true;
-            }
+        work_pool pool{threads};
+        if (pool.size() < 2) {
+            return parse(input);
+        }
 
+        //
+        // The structural pre-scan is a lazy parse of the top level. That
+        // does the top level scalars and duplicate checks, and finds where
+        // each group, list and array starts and ends. Those are then
+        // parsed completely on the pool. The tree is already in source
+        // order, so there is nothing to merge.
+        //
+        // Any error at all and we parse again serially, so the errors
+        // (which depend on where the parse gave up) are exactly the same.
+        //
+        Setting &root = new_tree();
+        parser_ = parse_top_level(input, &root, nullptr);
+
+        if (not parser_->errors.empty()) {
+            return parse(input);
+        }
 
-            return false;
+        std::vector<Setting *> pieces;
+        for (auto &child : root) {
+            if (child.is_composite()) pieces.push_back(&child);
         }
 
-        //##############   match_name #######################
+        // each thread gets its own part of the arena.
+        if (arena_) arena_->add_lanes(pool.size());
 
-        std::optional<std::string> match_name() {
+        std::vector<error_list> errs(pieces.size());
+        std::atomic<bool> failed{false};
 
-            int pos = 0;
-            if (peek(pos) == '*' or std::isalpha(peek(pos))) {
-                pos += 1;
-            } else {
-                return std::nullopt;
+        pool.run(pieces.size(), [&](std::size_t i) {
+            if (failed.load(std::memory_order_relaxed)) return;
+            if (not expand_lazy(*pieces[i], errs[i], true)) {
+                failed.store(true, std::memory_order_relaxed);
             }
+        });
 
-            while (valid_pos(pos)) {
-                if ( peek(pos) == '*' or peek(pos) == '_' or
-                        std::isalnum(peek(pos))) {
-                    pos += 1;
-                } else break;
-            }
+        if (failed) {
+            return parse(input);
+        }
 
+        return true;
+    }
 
-            auto retval = current_loc.sv.substr(0, pos);
-            consume(pos);
+    bool Config::parse_json_file(const std::string &file_name) {
+        mapped_file file{file_name};
 
-            return std::string(retval);
+        if (not file.is_open()) {
+            return open_failed(file_name);
         }
 
-        //##############   parse_list     ##############
-        bool parse_list(Setting* setting) {
-            skip();
-            while(1) {
-                if (peek() == ')') {
-                    return true;
-                }
-                Setting *child = setting->create_child();
-                if (!parse_setting_value(child)) {
-                    return false;
-                }
-                skip();
-                if (match_chars(0, ";,")) {
-                    consume(1);
-                    skip();
-                }
-            }
+        return parse_json(file.view());
+    }
 
-            // Never should get here. At some point parse_setting_value()
-            // will fail and we'll exit inside the loop
-            return false;
-        }
+    bool Config::parse_json(std::string_view input) {
+        // parser_ just keeps the errors.
+        parser_ = new Parser("", &new_tree());
 
-        //##############   parse_array    ##############
-        bool parse_array(Setting * setting) {
+        if (schema_) return schema_->parse_json(input, *cfg_, fail_fast_, parser_->errors);
 
-            // For the first one, it can be anything
-            do {
-                auto bv = match_bool_value();
-                if (bv) {
-                    setting->add_child(*bv);
-                    break;
-                }
-                
-                auto lv = match_integer_value();
-                if (lv) {
-                    setting->add_child(*lv);
-                    break;
-                }
+        TreeBuilder builder{cfg_.get()};
+        JsonEventParser<TreeBuilder> json{input, builder};
+        bool ok = json.do_parse();
 
-                auto dv = match_double_value();
-                if (dv) {
-                    setting->add_child(*dv);
-                    break;
-                }
+        parser_->errors.errors.splice(parser_->errors.errors.end(), json.errors.errors);
+        return ok;
+    }
 
-                auto sv = match_string_value();
-                if (sv) {
-                    setting->add_child(*sv);
-                    break;
-                }
-            } while(false);
+    bool Config::open_failed(const std::string &file_name) {
+        return failed("Could not open file "s + file_name);
+    }
 
+    bool Config::failed(const std::string &message) {
+        parser_ = new Parser("", &new_tree());
+        parser_->record_error(message);
 
-            while (1) {
-                skip();
-                if (match_chars(0, ";,")) {
-                    consume(1);
-                    skip();
-                }
-                if (setting->array_type() == ST::BOOL) {
-                    auto bv = match_bool_value();
-                    if (bv) {
-                        setting->add_child(*bv);
-                    } else {
-                        break;
-                    }
-
-                } else if (setting->array_type() == ST::INTEGER) {
-                    auto lv = match_integer_value();
-                    if (lv) {
-                        setting->add_child(*lv);
-                    } else {
-                        break;
-                    }
-
-                } else if (setting->array_type() == ST::FLOAT) {
-                    auto dv = match_double_value();
-                    if (dv) {
-                        setting->add_child(*dv);
-                    } else {
-                        break;
-                    }
-                } else if (setting->array_type() == ST::STRING) {
-
-                    auto sv = match_string_value();
-                    if (sv) {
-                        setting->add_child(*sv);
-                    } else {
-                        break;
-                    }
-                } else {
-                    throw std::runtime_error("Unexpected array_type");
-                }
-            }
+        return false;
+    }
 
-            Setting tester{};
+    bool Config::write_file(const std::string &file_name, text_style style) {
+        if (frozen_ or not cfg_ or not validate_all()) return false;
 
-            if (match_scalar_value(&tester)) {
-                record_error("All values in an array must be the same scalar type");
-                return false;
-            }
+        try {
+            return write_text_file(*cfg_, file_name, style);
+        } catch (std::exception &) {
+            return false;
+        }
+    }
 
-            return true;
+    bool Config::write_json_file(const std::string &file_name, text_style style) {
+        if (frozen_ or not cfg_ or not validate_all()) return false;
 
+        try {
+            return Configinator5000::write_json_file(*cfg_, file_name, style);
+        } catch (std::exception &) {
+            return false;
         }
+    }
 
-        //##############   parse_setting_value ##############
+    bool Config::write_snapshot(const std::string &file_name) {
+        std::string image;
 
-        bool parse_setting_value(Setting * setting, bool record_failure=true) {
-            if (peek() == '{') {
-                consume(1);
-                skip();
-                setting->make_group();
-                parse_group(setting);
-                skip();
-                if (peek(0) != '}') {
-                    record_error("Didn't find close of setting group");
-                    return false;
-                }
-                consume(1);
-            } else if (peek() == '(') {
-                consume(1);
-                skip();
-                setting->make_list();
-                parse_list(setting);
-                skip();
-                if (peek() != ')') {
-                    record_error("Didn't find close of setting list");
-                    return false;
-                }
-                consume(1);
-            } else if (peek() == '[') {
-                consume(1);
-                skip();
-                setting->make_array();
-                parse_array(setting);
-                skip();
-                if (peek() != ']') {
-                    record_error("Didn't find close of value array");
-                    return false;
-                }
-                consume(1);
-            } else if (! match_scalar_value(setting)) {
-                if (record_failure) record_error("Expecting a value");
+        if (frozen_) {
+            image = std::string(frozen_->block);
+        } else {
+            if (not cfg_ or not validate_all()) return false;
+
+            try {
+                image = make_snapshot(*cfg_);
+            } catch (std::exception &) {
                 return false;
             }
+        }
 
-            return true;
+        // Readers may have the old one mapped. Renaming over it leaves
+        // them with what they had rather than a file changing under them.
+        file_replacement file{file_name};
+        return file.write(image) and file.commit();
+    }
+
+    bool Config::open_snapshot(const std::string &file_name) {
+        auto image = std::make_shared<frozen_image>();
+
+        // looked at here and there, not front to back.
+        image->file = mapped_file{file_name, false};
+        if (not image->file.is_open()) {
+            return open_failed(file_name);
         }
-        //##############   setting ##########################
 
-        bool parse_setting(Setting * parent) {
+        try {
+            image->attach(image->file.data(), image->file.size());
+        } catch (std::runtime_error &e) {
+            return failed(file_name + " : " + e.what());
+        }
 
-            auto name = match_name();
-            if ( ! name ) {
-                return false;
-            }
+        parser_ = new Parser("", &new_tree());
+        frozen_ = std::move(image);
 
-            skip();
+        return true;
+    }
 
-            if (not match_chars(0, ":=")) {
-                record_error("Expecting : or = after setting name");
-                return false;
-            }
-            consume(1);
+    bool Config::freeze() {
+        if (frozen_) return true;
+        if (not cfg_ or not validate_all()) return false;
 
-            auto new_setting = parent->create_child(*name);
+        auto image = std::make_shared<frozen_image>();
+        try {
+            image->buffer = make_snapshot(*cfg_);
+        } catch (std::exception &) {
+            return false;
+        }
+        image->attach(image->buffer.data(), image->buffer.size());
 
-            if (!new_setting) {
-                record_error("Setting named "s + *name + " already defined in this context");
-                return false;
-            }
+        parser_ = new Parser("", &new_tree());
+        frozen_ = std::move(image);
 
-            skip();
+        return true;
+    }
 
-            return parse_setting_value(new_setting);
-            
+    FrozenSetting Config::get_frozen() const {
+        if (not frozen_) {
+            throw std::runtime_error("No snapshot is open");
         }
 
-        //##############   parse_group #####################
+        return FrozenSetting(frozen_.get(), 0);
+    }
 
-        bool parse_group(Setting * parent) {
-            bool at_least_one = false;
-            while (1) {
-                if (!parse_setting(parent)) break;
-                at_least_one = true;
+    bool Config::parse_with_schema(std::string_view input, const Schema *schema,
+            const std::string &file_name) {
 
-                if (match_chars(0, ";,")) {
-                    consume(1);
-                }
-                skip();
-            }
+        parser_ = new Parser(input, &new_tree());
+
+        // Everything the @includes bring in, loaded before the parse.
+        include_map includes;
+        const include_map *loaded = load_includes(input, file_name, include_cache_.get(), includes) ?
+            &includes : nullptr;
 
-            return at_least_one;
+        if (not schema) {
+            parser_->includes = loaded;
+            bool ok = parser_->do_parse();
+            parser_->includes = nullptr;
+            return ok;
         }
 
-        //##############   do_parse  #####################
-        
-        bool do_parse() {
+        // The schema has its own handler for the parser, which builds the
+        // tree too. parser_ just keeps the errors.
+        return schema->parse(input, *cfg_, fail_fast_, parser_->errors, loaded);
+    }
 
-            skip();
+    bool Config::set_schema(std::string_view schema) {
+        auto compiled = std::make_shared<Schema>();
 
-            parse_group(setting);
+        error_list errs;
+        if (not compiled->load(schema, errs)) {
+            return schema_failed(errs);
+        }
 
-            if (! eoi()) {
-                record_error("Not at end of input!");
-                return false;
-            }
+        delete schema_errors_;
+        schema_errors_ = nullptr;
 
-            return errors.empty();
-        }
+        schema_ = std::move(compiled);
+        return true;
+    }
 
-    };
+    bool Config::set_schema_file(const std::string &file_name) {
+        mapped_file file{file_name};
 
-    bool Config::parse_with_schema(const std::string &input, const SchemaNode *schema){
+        if (not file.is_open()) {
+            error_list errs;
+            errs.add("Could not open file "s + file_name, parse_loc{});
+            return schema_failed(errs);
+        }
 
-        cfg_.reset(new Setting(ST::GROUP));
+        return set_schema(file.view());
+    }
 
-        if (parser_) delete parser_;
-        parser_ = new Parser(input, cfg_.get());
+    bool Config::schema_failed(error_list &errs) {
+        if (not schema_errors_) schema_errors_ = new error_list();
+        schema_errors_->errors.clear();
+        schema_errors_->errors.splice(schema_errors_->errors.end(), errs.errors);
 
-        return parser_->do_parse();
+        return false;
     }
 
     std::ostream &Config::stream_errors(std::ostream &strm) {
-        strm << parser_->errors;
+        if (schema_errors_) {
+            strm << *schema_errors_;
+        } else if (parser_) {
+            strm << parser_->errors;
+        }
 
         return strm;
     }
 
+    Config::Config(tree_memory where) {
+        if (where == tree_memory::arena) {
+            arena_ = new tree_arena();
+        }
+    }
+
+    key_handle Config::key(std::string_view name) {
+        if (not keys_) keys_ = new key_table();
+
+        return key_handle{keys_, keys_->intern(name)};
+    }
+
+    namespace {
+        std::atomic<std::uint64_t> next_generation{1};
+    }
+
+    void Config::tree_changed() {
+        generation_ = next_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Setting &Config::new_tree() {
+        if (parser_) delete parser_;
+        parser_ = nullptr;
+
+        delete schema_errors_;
+        schema_errors_ = nullptr;
+
+        cfg_.reset();
+        source_.reset();
+        frozen_.reset();
+
+        if (arena_) {
+            // O(1) (well, O(blocks)) no matter how big the old tree was.
+            arena_->release();
+
+            void *mem = arena_->allocate(sizeof(Setting), alignof(Setting));
+            cfg_ = decltype(cfg_){new (mem) Setting(ST::GROUP, arena_),
+                tree_deleter{true}};
+        } else {
+            cfg_ = decltype(cfg_){new Setting(ST::GROUP)};
+        }
+
+        // The key_table carries on from one tree to the next, so
+        // key_handles stay good.
+        if (not keys_) keys_ = new key_table();
+        cfg_->group_composite().group.use_keys(keys_);
+
+        // The number carries on too. Nothing has looked into the new tree.
+        if (not tree_id_) tree_id_ = tree_state::acquire();
+        cfg_->tree_ = tree_id_;
+        tree_state::get(tree_id_).watched.store(false, std::memory_order_relaxed);
+
+        tree_changed();
+
+        return *cfg_;
+    }
+
     Config::~Config() {
         if (parser_) delete parser_;
+        delete schema_errors_;
+
+        // the tree has to go before the arena it is in.
+        cfg_.reset();
+        bool in_arena = (arena_ != nullptr);
+        if (arena_) delete arena_;
+
+        if (keys_) {
+            if (in_arena) {
+                // Groups in the arena never let go of the table, but they
+                // are all gone now.
+                delete keys_;
+            } else {
+                // groups moved out of the tree may still be using it.
+                keys_->release();
+            }
+        }
+
+        if (tree_id_) tree_state::release(tree_id_);
     }
 
 } // end namespace Configinator5000
@@ -1,60 +1,339 @@
+#pragma once
+
 // Grammar is here : https://hyperrealm.github.io/libconfig/libconfig_manual.html#Configuration-File-Grammar
 //
 
+#include <atomic>
 #include <memory>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <map>
+#include <memory_resource>
 #include <vector>
 #include <exception>
 #include <sstream>
 #include <fstream>
+#include <iterator>
 #include <functional>
+#include <utility>
 
 #include <type_traits>
 
+#include <group_index.hpp>
+#include <tree_state.hpp>
+
 using namespace std::literals::string_literals;
 
 namespace Configinator5000 {
 
-    // These make up the schema tree
-    // that is consulted for the rules
-    class SchemaNode {
-    };
+    // The rules a config must follow (see schema.hpp).
+    class Schema;
+
+    // Parsed @include files (see include.hpp).
+    class include_cache;
+
+    struct lazy_source;
+    struct error_list;
+    struct frozen_image;
+    class FrozenSetting;
 
     // These make up the Config Tree that
     // we give to the user.
+    //
+    // All the memory for a Setting (strings, keys, children) comes from the
+    // memory_resource it was made with, and children use their parent's.
+    // By default that is the normal heap.
+    //
+    // A Setting is kept small since a tree is mostly Settings: the type,
+    // the memory_resource and one word of value. Scalars live in that word
+    // (a string is a pointer to a counted block) and composites point to
+    // a composite_rep with the children, which isn't made until the first
+    // child is added.
     class Setting {
+        friend struct TreeBuilder;
+        friend class Config;
+        friend class Path;
+        friend class schema_builder;
+        friend bool expand_lazy(Setting &, error_list &, bool);
+
     public :
-        enum class setting_type { STRING, BOOL, INTEGER, FLOAT, GROUP, LIST, ARRAY };
+        enum class setting_type : std::uint8_t { STRING, BOOL, INTEGER, FLOAT, GROUP, LIST, ARRAY };
+
+        // makes Setting allocator aware, so std::pmr containers hand it
+        // their resource.
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
 
     private :
 
+        // Everything a group, list or array needs.
+        struct composite_rep {
+            // container for the composite types
+            std::pmr::vector<Setting> children;
+
+            // Arrays must all be the same type. Set when the first child is added to the array.
+            setting_type array_type = setting_type::BOOL;
+
+            // Set for composites of a lazily parsed Config that haven't been
+            // parsed yet. Anything that looks at the children parses them first.
+            std::shared_ptr<lazy_source> lazy;
+
+            // The content_hash(), good while the tree's hash_epoch (see
+            // tree_state) is still hash_epoch. A new rep has nothing cached.
+            std::atomic<std::uint64_t> hash{0};
+            std::atomic<std::uint64_t> hash_epoch{0};
+
+            explicit composite_rep(const allocator_type &a) : children{a} {}
+
+            composite_rep(const composite_rep &o, const allocator_type &a) :
+                children{o.children, a}, array_type{o.array_type}, lazy{o.lazy} {}
+        };
+
+        // Groups also need to find children by name.
+        struct group_rep : composite_rep {
+            // Key number N is children[N].
+            group_index group;
+
+            explicit group_rep(const allocator_type &a) : composite_rep{a}, group{a} {}
+
+            group_rep(const group_rep &o, const allocator_type &a) :
+                composite_rep{o, a}, group{o.group, a} {}
+        };
+
+        // A string value : the length, then the characters and a '\0'.
+        struct string_rep {
+            std::size_t size;
+
+            const char *chars() const { return reinterpret_cast<const char *>(this + 1); }
+            char *chars() { return reinterpret_cast<char *>(this + 1); }
+        };
+
+        std::pmr::memory_resource *resource_;
+
+        // which one is good depends on type_. The pointers may be null
+        // (the empty string, a composite with no children).
+        union {
+            long integer_;
+            double float_;
+            bool bool_;
+            string_rep *string_;
+            composite_rep *composite_;
+        };
+
         setting_type type_;
 
-        // scalar containers (maybe change to std::variant?)
-        long integer_;
-        double float_;
-        bool bool_;
-        std::string string_;
+        // Set once this Setting has gone into a cached hash (its own or
+        // one above it). Changing it after that makes every cached hash in
+        // its tree stale, since there is no way back up to the ones above.
+        mutable std::atomic<bool> hashed_{false};
+
+        // The tree this Setting is in (see tree_state.hpp). Everything
+        // under a Setting is always in the same one.
+        std::uint32_t tree_ = 0;
+
+        // Called before anything about the Setting changes.
+        void changing() {
+            if (hashed_.load(std::memory_order_relaxed)) hashes_stale();
+        }
+
+        // Called before children are added, or the value replaced, either
+        // of which can move or free the Settings under this one.
+        void reshaping() {
+            auto &tree = tree_state::get(tree_);
+            if (tree.watched.load(std::memory_order_relaxed)) {
+                tree.shape.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Bring a new child (and everything under it) into our tree.
+        Setting &adopt(Setting &child) {
+            if (child.tree_ != tree_) child.join_tree(tree_);
+            return child;
+        }
+
+        void join_tree(std::uint32_t tree) {
+            tree_ = tree;
+            if (auto *r = rep()) {
+                // cached against the other tree's hash_epoch.
+                r->hash_epoch.store(0, std::memory_order_relaxed);
+                for (auto &child : r->children) child.join_tree(tree);
+            }
+        }
+
+        void hashes_stale();
+
+        // set the value word to the "empty" value for type_
+        void zero_value() {
+            switch (type_) {
+                case setting_type::STRING : string_ = nullptr; break;
+                case setting_type::BOOL :   bool_ = false; break;
+                case setting_type::FLOAT :  float_ = 0.0; break;
+                case setting_type::INTEGER : integer_ = 0; break;
+                default :                   composite_ = nullptr; break;
+            }
+        }
+
+        string_rep *make_string(std::string_view s) const {
+            if (s.empty()) return nullptr;
+
+            void *mem = resource_->allocate(sizeof(string_rep) + s.size() + 1, alignof(string_rep));
+            auto *rep = new (mem) string_rep{s.size()};
+            s.copy(rep->chars(), s.size());
+            rep->chars()[s.size()] = '\0';
+            return rep;
+        }
+
+        std::string_view string_value() const {
+            if (not string_) return {};
+            return std::string_view(string_->chars(), string_->size);
+        }
+
+        // The composite_rep, or null for scalars and empty composites.
+        composite_rep *rep() const {
+            return is_composite() ? composite_ : nullptr;
+        }
+
+        // The composite_rep, made if need be.
+        composite_rep &composite() {
+            if (not composite_) {
+                if (is_group()) {
+                    void *mem = resource_->allocate(sizeof(group_rep), alignof(group_rep));
+                    composite_ = new (mem) group_rep(allocator_type(resource_));
+                } else {
+                    void *mem = resource_->allocate(sizeof(composite_rep), alignof(composite_rep));
+                    composite_ = new (mem) composite_rep(allocator_type(resource_));
+                }
+            }
+            return *composite_;
+        }
+
+        // Same for groups.
+        group_rep &group_composite() {
+            return static_cast<group_rep &>(composite());
+        }
 
+        // The key lookup of a group, or null for anything else (or an
+        // empty group).
+        const group_index *index() const {
+            if (not is_group() or not composite_) return nullptr;
+            return &static_cast<const group_rep *>(composite_)->group;
+        }
 
-        // container for the composite types
-        std::vector<Setting> children_;
+        // Copy the value of o into this (which holds nothing).
+        void copy_value(const Setting &o) {
+            type_ = o.type_;
+            if (o.is_string()) {
+                string_ = make_string(o.string_value());
+            } else if (o.is_composite()) {
+                composite_ = nullptr;
+                if (o.composite_ and o.is_group()) {
+                    void *mem = resource_->allocate(sizeof(group_rep), alignof(group_rep));
+                    composite_ = new (mem) group_rep(static_cast<const group_rep &>(*o.composite_),
+                            allocator_type(resource_));
+                } else if (o.composite_) {
+                    void *mem = resource_->allocate(sizeof(composite_rep), alignof(composite_rep));
+                    composite_ = new (mem) composite_rep(*o.composite_, allocator_type(resource_));
+                }
+            } else {
+                copy_word(o);
+            }
+        }
 
-        // lookup for groups. Allows at(std::string) to be O(1)
-        std::map<std::string, int> group_;
+        // copy the scalar in the value word, whichever it is.
+        void copy_word(const Setting &o) {
+            switch (o.type_) {
+                case setting_type::BOOL :  bool_ = o.bool_; break;
+                case setting_type::FLOAT : float_ = o.float_; break;
+                default :                  integer_ = o.integer_; break;
+            }
+        }
 
-        // Arrays must all be the same type. Set when the first child is added to the array.
-        setting_type array_type_ = setting_type::BOOL;
+        // Take the value of o into this (which holds nothing). Only if
+        // both use the same memory_resource.
+        void steal_value(Setting &o) noexcept {
+            type_ = o.type_;
+            // a composite_rep brings its cached hash along.
+            hashed_.store(o.hashed_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            if (o.is_string()) {
+                string_ = o.string_;
+                o.string_ = nullptr;
+            } else if (o.is_composite()) {
+                composite_ = o.composite_;
+                o.composite_ = nullptr;
+            } else {
+                copy_word(o);
+            }
+        }
 
+        // Free the string or composite_rep (if any). Leaves type_ alone.
         void clear_subobjects() {
-            children_.clear();
-            group_.clear();
-            string_.clear();
+            if (is_string() and string_) {
+                resource_->deallocate(string_, sizeof(string_rep) + string_->size + 1, alignof(string_rep));
+            } else if (is_group() and composite_) {
+                auto *g = static_cast<group_rep *>(composite_);
+                g->~group_rep();
+                resource_->deallocate(g, sizeof(group_rep), alignof(group_rep));
+            } else if (is_composite() and composite_) {
+                composite_->~composite_rep();
+                resource_->deallocate(composite_, sizeof(composite_rep), alignof(composite_rep));
+            }
+            zero_value();
+        }
+
+        void become(setting_type t) {
+            reshaping();
+            clear_subobjects();
+            type_ = t;
+            zero_value();
+        }
+
+        // Groups added to a group share its key_table (if it has one).
+        Setting &inherit_keys(Setting &child, group_rep &parent) {
+            if (child.is_group() and parent.group.keys()) {
+                child.group_composite().group.use_keys(parent.group.keys());
+            }
+            return child;
+        }
+
+        // The number of the child named key, or -1. Only for groups.
+        template<class K>
+        int find_child(const K &key) const {
+            touch();
+            auto *idx = index();
+            return idx ? idx->find(key) : -1;
+        }
+
+        template<class K>
+        Setting &at_key(const K &key) {
+            if (!is_group()) {
+                throw std::runtime_error("at(string) called on a non-group");
+            }
+
+            int idx = find_child(key);
+            if (idx < 0) {
+                std::string_view name;
+                if constexpr (std::is_same_v<K, key_handle>) {
+                    name = key.name();
+                } else {
+                    name = key;
+                }
+                throw std::runtime_error("at(string) : key "s + std::string(name) + 
+                        " does not exist in the group");
+            }
+
+            return composite_->children[idx];
+        }
+
+        // Parse the children of a lazy Setting. Throws if they are bad.
+        void expand() const;
+
+        void touch() const {
+            auto *r = rep();
+            if (r and r->lazy) expand();
         }
 
         template<class T>
-        setting_type deduce_scalar_type(T v) {
+        setting_type deduce_scalar_type(const T &) {
             if constexpr (std::is_same_v<T, bool>) {
                 return setting_type::BOOL;
             } else if constexpr (std::is_convertible_v<std::string, T>) {
@@ -80,14 +359,78 @@ namespace Configinator5000 {
         
 
     public :
-        Setting(setting_type t = setting_type::BOOL) : type_{t} {}
+        Setting(setting_type t = setting_type::BOOL, const allocator_type &a = {}) :
+            resource_{a.resource()}, type_{t} { zero_value(); }
+
+        Setting(bool b, const allocator_type &a = {}) :
+            resource_{a.resource()}, bool_(b), type_(setting_type::BOOL) {}
+        Setting(int i, const allocator_type &a = {}) :
+            resource_{a.resource()}, integer_(i), type_(setting_type::INTEGER) {}
+        Setting(long l, const allocator_type &a = {}) :
+            resource_{a.resource()}, integer_(l), type_(setting_type::INTEGER) {}
+        Setting(double f, const allocator_type &a = {}) :
+            resource_{a.resource()}, float_(f), type_(setting_type::FLOAT) {}
+        Setting(const std::string &s, const allocator_type &a = {}) :
+            Setting(std::string_view(s), a) {}
+        Setting(std::string_view s, const allocator_type &a = {}) :
+            resource_{a.resource()}, string_{nullptr}, type_(setting_type::STRING) {
+            string_ = make_string(s);
+        }
+        Setting(const char * c, const allocator_type &a = {}) :
+            Setting(std::string_view(c), a) {}
+
+        // Like the std::pmr containers, a plain copy uses the default
+        // memory_resource and a move keeps the one it had.
+        Setting(const Setting &o) : Setting(o, allocator_type{}) {}
 
-        Setting(bool b) : type_(setting_type::BOOL), bool_(b) {}
-        Setting(int i) : type_(setting_type::INTEGER), integer_(i) {}
-        Setting(long l) : type_(setting_type::INTEGER), integer_(l) {}
-        Setting(double f) :  type_(setting_type::FLOAT), float_(f) {}
-        Setting(std::string s) : type_(setting_type::STRING), string_(s) {}
-        Setting(const char * c) : type_(setting_type::STRING), string_(c) {}
+        Setting(Setting &&o) noexcept : resource_{o.resource_}, tree_{o.tree_} {
+            steal_value(o);
+        }
+
+        // Copy or move into a different memory_resource.
+        Setting(const Setting &o, const allocator_type &a) : resource_{a.resource()} {
+            copy_value(o);
+        }
+
+        Setting(Setting &&o, const allocator_type &a) : resource_{a.resource()} {
+            if (resource_ == o.resource_ or resource_->is_equal(*o.resource_)) {
+                tree_ = o.tree_;
+                steal_value(o);
+            } else {
+                copy_value(o);
+            }
+        }
+
+        Setting &operator=(const Setting &o) {
+            if (this != &o) {
+                changing();
+                // copy first - o might be one of our children.
+                Setting tmp{o, get_allocator()};
+                become(setting_type::BOOL);
+                steal_value(tmp);
+                if (tmp.tree_ != tree_) join_tree(tree_);
+            }
+            return *this;
+        }
+
+        Setting &operator=(Setting &&o) {
+            if (this != &o) {
+                changing();
+                Setting tmp{std::move(o), get_allocator()};
+                become(setting_type::BOOL);
+                steal_value(tmp);
+                if (tmp.tree_ != tree_) join_tree(tree_);
+            }
+            return *this;
+        }
+
+        ~Setting() {
+            clear_subobjects();
+        }
+
+        allocator_type get_allocator() const {
+            return allocator_type(resource_);
+        }
 
         class group_iterator;
         class group_enumerator {
@@ -95,34 +438,41 @@ namespace Configinator5000 {
             friend class group_iterator;
             Setting &parent_;
 
-            group_enumerator(Setting &p) : parent_{p} {}
+            // key numbers in key order
+            std::vector<int> order_;
+
+            group_enumerator(Setting &p) : parent_{p}, order_{p.index()->sorted()} {}
 
             public:
 
             group_iterator& begin() {
-                return *(new group_iterator{parent_, parent_.group_.begin()});
+                return *(new group_iterator{*this, 0});
             }
 
             group_iterator& end() {
-                return *(new group_iterator(parent_, parent_.group_.end()));
+                return *(new group_iterator(*this, order_.size()));
             }
         };
 
         class group_iterator {
             friend class group_enumerator;
-            Setting& parent_;
-            std::map<std::string, int>::iterator it_;
+            group_enumerator &owner_;
+            std::size_t pos_;
             std::pair<std::string, Setting &> *output_ = nullptr;
 
-            group_iterator(Setting &p, std::map<std::string, int>::iterator i) :
-                parent_(p), it_(i) {
-
-                    if (it_ != parent_.group_.end()) {
-                        output_ = new std::pair<std::string, Setting &>(it_->first, 
-                                std::ref(parent_.children_.at(it_->second)));
-                    }
+            group_iterator(group_enumerator &o, std::size_t pos) :
+                owner_(o), pos_(pos) {
+                    make_output();
                 }
 
+            void make_output() {
+                if (pos_ < owner_.order_.size()) {
+                    int idx = owner_.order_[pos_];
+                    auto &rep = static_cast<group_rep &>(*owner_.parent_.composite_);
+                    output_ = new std::pair<std::string, Setting &>(std::string(rep.group.key(idx)),
+                            std::ref(rep.children.at(idx)));
+                }
+            }
 
             public:
                 ~group_iterator() {
@@ -138,24 +488,21 @@ namespace Configinator5000 {
                 }
 
                 group_iterator& operator++() {
-                    ++it_;
+                    ++pos_;
                     if (output_) {
                         delete output_;
                         output_ = nullptr;
                     }
 
-                    if (it_ != parent_.group_.end()) {
-                        output_ = new std::pair<std::string, Setting &>(it_->first, 
-                                std::ref(parent_.children_.at(it_->second)));
-                    }
+                    make_output();
                     return *this;
                 }
 
                 bool operator==(const group_iterator *o) const {
-                    return (it_ == o->it_);
+                    return (pos_ == o->pos_);
                 }
                 bool operator==(const group_iterator &o) const {
-                    return (it_ == o.it_);
+                    return (pos_ == o.pos_);
                 }
         };
 
@@ -163,63 +510,64 @@ namespace Configinator5000 {
             if (!is_group()) {
                 throw std::runtime_error("Can only enumerate groups");
             }
+            touch();
+            composite();
 
             return *(new group_enumerator(*this));
         }
 
         Setting & set_value(bool b) {
+            changing();
             if (!is_boolean()) {
-                clear_subobjects();
-                type_ = setting_type::BOOL;
+                become(setting_type::BOOL);
             }
             bool_ = b;
             return *this;
         }
 
         Setting & set_value(int i) {
+            changing();
             if (!is_integer()) {
-                clear_subobjects();
-                type_ = setting_type::INTEGER;
+                become(setting_type::INTEGER);
             }
             integer_ = i;
             return *this;
         }
 
         Setting & set_value(long i) {
+            changing();
             if (!is_integer()) {
-                clear_subobjects();
-                type_ = setting_type::INTEGER;
+                become(setting_type::INTEGER);
             }
             integer_ = i;
             return *this;
         }
         
         Setting & set_value(double f) {
+            changing();
             if (!is_float()) {
-                clear_subobjects();
-                type_ = setting_type::FLOAT;
+                become(setting_type::FLOAT);
             }
             float_ = f;
             return *this;
         }
 
 
-        Setting & set_value(const std::string s) {
-            if (!is_string()) {
-                clear_subobjects();
-                type_ = setting_type::STRING;
-            }
-            string_ = s;
+        Setting & set_value(const std::string &s) {
+            return set_value(std::string_view(s));
+        }
+
+        Setting & set_value(std::string_view s) {
+            changing();
+            // s might be our own string, so copy before letting go.
+            string_rep *n = make_string(s);
+            become(setting_type::STRING);
+            string_ = n;
             return *this;
         }
 
         Setting & set_value(const char *c) {
-            if (!is_string()) {
-                clear_subobjects();
-                type_ = setting_type::STRING;
-            }
-            string_ = c;
-            return *this;
+            return set_value(std::string_view(c));
         }
 
         bool is_boolean() const { return (type_ == setting_type::BOOL); }
@@ -236,33 +584,35 @@ namespace Configinator5000 {
 
         void make_list() {
             if (!is_list()) {
-                clear_subobjects();
-                type_ = setting_type::LIST;
+                changing();
+                become(setting_type::LIST);
             }
         }
 
         void make_group() {
             if (!is_group()) {
-                clear_subobjects();
-                type_ = setting_type::GROUP;
+                changing();
+                become(setting_type::GROUP);
             }
         }
 
         void make_array() {
             if (! is_array()) {
-                clear_subobjects();
-                type_ = setting_type::ARRAY;
+                changing();
+                become(setting_type::ARRAY);
             }
         }
 
-        bool exists(const std::string child) const {
+        bool exists(std::string_view child) const {
             if (! is_group()) return false;
 
-            auto const &iter = group_.find(child);
-            if (iter == group_.end()) 
-                return false;
-            else
-                return true;
+            return find_child(child) >= 0;
+        }
+
+        bool exists(const key_handle &child) const {
+            if (! is_group()) return false;
+
+            return find_child(child) >= 0;
         }
 
         template<class T> T get() const {
@@ -288,7 +638,11 @@ namespace Configinator5000 {
                 }
             } else if constexpr (std::is_convertible_v<std::string, T>) {
                 if (is_string()) {
-                    return T(string_);
+                    if constexpr (std::is_constructible_v<T, std::string_view>) {
+                        return T(string_value());
+                    } else {
+                        return T(std::string(string_value()));
+                    }
                 } else {
                     throw std::runtime_error("Bad type conversion\n");
                 }
@@ -301,23 +655,27 @@ namespace Configinator5000 {
         
         template<class T>
         Setting &add_child(T v) {
+            touch();
+            changing();
+            reshaping();
 
             if (is_group()) {
                 throw std::runtime_error("Group children must have names");
 
             } else if (is_array()) {
                 setting_type target_type = deduce_scalar_type(v);
-                if (children_.size() > 0) {
-                    if (array_type_ != target_type) {
+                auto &c = composite();
+                if (c.children.size() > 0) {
+                    if (c.array_type != target_type) {
                         throw std::runtime_error("All children of arrays must be the same type");
                     }
                 } else {
-                    array_type_ = target_type;
+                    c.array_type = target_type;
                 }
-                return children_.emplace_back(v);
+                return adopt(c.children.emplace_back(std::move(v)));
 
             } else if (is_list()) {
-                return children_.emplace_back(v);
+                return adopt(composite().children.emplace_back(std::move(v)));
 
             } else {
                 throw std::runtime_error("Setting must be composite to add child");
@@ -325,61 +683,69 @@ namespace Configinator5000 {
         }
 
         Setting &add_child(setting_type t) {
+            touch();
+            changing();
+            reshaping();
             if (is_group()) {
                 throw std::runtime_error("Group children must have names");
 
             } else if (is_list()) {
-                return children_.emplace_back(t);
+                return adopt(composite().children.emplace_back(t));
 
             } else if (is_array()) {
                 if (is_composite_type(t)) {
                     throw std::runtime_error("Arrays may only have scalar children");
                 }
 
-                if (children_.size() > 0) {
-                    if (array_type_ != t) {
+                auto &c = composite();
+                if (c.children.size() > 0) {
+                    if (c.array_type != t) {
                         throw std::runtime_error("All children of arrays must be the same type");
                     }
                 } else {
-                    array_type_ = t;
+                    c.array_type = t;
                 }
-                return children_.emplace_back(t);
+                return adopt(c.children.emplace_back(t));
             } else {
                 throw std::runtime_error("Setting must be composite to add child");
             }
         }
         
         template<class T>
-        Setting &add_child( const std::string &name, T v) {
+        Setting &add_child(std::string_view name, T v) {
+            touch();
+            changing();
+            reshaping();
 
             if (!is_group()) {
                 throw std::runtime_error("Only group children may have names");
             }
 
-            auto [ _, done ] = group_.try_emplace(name, group_.size());
-
-            if (done) {
+            auto &c = group_composite();
+            if (c.group.insert(name)) {
                 // It didn't exists before
-                return children_.emplace_back(v);
+                return adopt(c.children.emplace_back(std::move(v)));
             } else {
-                throw std::runtime_error("Child with given key "s + name + " already exists");
+                throw std::runtime_error("Child with given key "s + std::string(name) + " already exists");
 
             }
         }
 
-        Setting &add_child( const std::string &name, setting_type t) {
+        Setting &add_child(std::string_view name, setting_type t) {
+            touch();
+            changing();
+            reshaping();
 
             if (!is_group()) {
                 throw std::runtime_error("Only group children may have names");
             }
 
-            auto [ _, done ] = group_.try_emplace(name, group_.size());
-
-            if (done) {
+            auto &c = group_composite();
+            if (c.group.insert(name)) {
                 // It didn't exists before
-                return children_.emplace_back(t);
+                return adopt(inherit_keys(c.children.emplace_back(t), c));
             } else {
-                throw std::runtime_error("Child with given key "s + name + " already exists");
+                throw std::runtime_error("Child with given key "s + std::string(name) + " already exists");
 
             }
         }
@@ -387,23 +753,27 @@ namespace Configinator5000 {
         // ==== NON EXCEPTION VARIANTS
         template<class T>
         Setting* try_add_child(T v) {
+            touch();
+            changing();
+            reshaping();
 
             if (is_group()) {
                 return nullptr;
 
             } else if (is_array()) {
                 setting_type target_type = deduce_scalar_type(v);
-                if (children_.size() > 0) {
-                    if (array_type_ != target_type) {
+                auto &c = composite();
+                if (c.children.size() > 0) {
+                    if (c.array_type != target_type) {
                         return nullptr;
                     }
                 } else {
-                    array_type_ = target_type;
+                    c.array_type = target_type;
                 }
-                return &(children_.emplace_back(v));
+                return &(adopt(c.children.emplace_back(std::move(v))));
 
             } else if (is_list()) {
-                return &(children_.emplace_back(v));
+                return &(adopt(composite().children.emplace_back(std::move(v))));
 
             } else {
                 return nullptr;
@@ -411,59 +781,67 @@ namespace Configinator5000 {
         }
 
         Setting* try_add_child(setting_type t) {
+            touch();
+            changing();
+            reshaping();
             if (is_group()) {
                 return nullptr;
 
             } else if (is_list()) {
-                return &(children_.emplace_back(t));
+                return &(adopt(composite().children.emplace_back(t)));
 
             } else if (is_array()) {
                 if (is_composite_type(t)) {
                     return nullptr;
                 }
 
-                if (children_.size() > 0) {
-                    if (array_type_ != t) {
+                auto &c = composite();
+                if (c.children.size() > 0) {
+                    if (c.array_type != t) {
                         return nullptr;
                     }
                 } else {
-                    array_type_ = t;
+                    c.array_type = t;
                 }
-                return &(children_.emplace_back(t));
+                return &(adopt(c.children.emplace_back(t)));
             } else {
                 return nullptr;
             }
         }
 
         template<class T>
-        Setting* try_add_child( const std::string &name, T v) {
+        Setting* try_add_child(std::string_view name, T v) {
+            touch();
+            changing();
+            reshaping();
 
             if (!is_group()) {
                 return nullptr;
             }
 
-            auto [ _, done ] = group_.try_emplace(name, group_.size());
-
-            if (done) {
+            auto &c = group_composite();
+            if (c.group.insert(name)) {
                 // It didn't exists before
-                return &(children_.emplace_back(v));
+                return &(adopt(c.children.emplace_back(std::move(v))));
             } else {
                 return nullptr;
 
             }
         }
 
-        Setting* try_add_child( const std::string &name, setting_type t) {
+        Setting* try_add_child(std::string_view name, setting_type t) {
+            touch();
+            changing();
+            reshaping();
 
             if (!is_group()) {
                 return nullptr;
             }
 
-            auto [ _, done ] = group_.try_emplace(name, group_.size());
-
-            if (done) {
+            auto &c = group_composite();
+            if (c.group.insert(name)) {
                 // It didn't exists before
-                return &(children_.emplace_back(t));
+                return &adopt(inherit_keys(c.children.emplace_back(t), c));
             } else {
                 return nullptr;
 
@@ -474,13 +852,15 @@ namespace Configinator5000 {
             if (is_scalar()) {
                 return 0;
             }
+            touch();
 
-            return int(children_.size());
+            return composite_ ? int(composite_->children.size()) : 0;
         }
 
         setting_type array_type() const {
             if (is_array()) {
-                return array_type_;
+                touch();
+                return composite_ ? composite_->array_type : setting_type::BOOL;
             }
 
             throw std::runtime_error("Setting is not an array");
@@ -490,47 +870,93 @@ namespace Configinator5000 {
             if (! is_composite()) {
                 throw std::runtime_error("at(int) called on a non-composite");
             }
+            touch();
+
+            int size = count();
 
             // negative indecies count from the end
             //   0    1   2
             //   -    -   -
             //  -3   -2  -1
-            if (idx >= int(children_.size()) or idx < -int(children_.size())) {
+            if (idx >= size or idx < -size) {
                 throw std::runtime_error("at(int) called with index out of range");
             }
 
             if (idx < 0) {
-                idx += int(children_.size());
+                idx += size;
             }
 
-            return children_.at(idx);
+            return composite_->children[idx];
         }
 
-        Setting &at(const std::string& name) {
+        // The key of child idx of a group - the name to go with at(idx).
+        // Good until the group gets another child.
+        std::string_view name_at(int idx) const {
             if (!is_group()) {
-                throw std::runtime_error("at(string) called on a non-group");
+                throw std::runtime_error("name_at(int) called on a non-group");
             }
+            touch();
 
-            auto iter = group_.find(name);
-            if (iter == group_.end()) {
-                throw std::runtime_error("at(string) : key "s + name + 
-                        " does not exist in the group");
+            int size = count();
+            if (idx >= size or idx < -size) {
+                throw std::runtime_error("name_at(int) called with index out of range");
             }
 
-            return children_.at(iter->second);
+            if (idx < 0) {
+                idx += size;
+            }
+
+            return index()->key(idx);
         }
 
+        Setting &at(std::string_view name) {
+            return at_key(name);
+        }
 
-        auto begin() {
-            return children_.begin();
+        // Same as at(name), but without looking at the string when the
+        // key came from this group's Config.
+        Setting &at(const key_handle &key) {
+            return at_key(key);
         }
 
-        auto end() {
-            return children_.end();
+        // The child with the key (hashed ahead of time, maybe by the
+        // compiler), or null if there isn't one or this isn't a group.
+        Setting *find(const hashed_key &key) {
+            if (! is_group()) return nullptr;
+
+            int idx = find_child(key);
+            return (idx < 0) ? nullptr : &composite_->children[idx];
         }
 
+
+        Setting *begin() {
+            touch();
+            auto *r = rep();
+            return r ? r->children.data() : nullptr;
+        }
+
+        Setting *end() {
+            touch();
+            auto *r = rep();
+            return r ? r->children.data() + r->children.size() : nullptr;
+        }
+
+        // A 64 bit hash of the type and value, and for a composite of
+        // everything under it; the same for equal Settings in any process
+        // on any machine. The order of a group's keys doesn't count, the
+        // order of list and array items does. A composite's is worked out
+        // the first time it is asked for and kept until something in the
+        // tree changes.
+        std::uint64_t content_hash() const;
+
+        // Same type and value all the way down (floats by their bits), as
+        // for content_hash(). Differing hashes answer straight away;
+        // otherwise the trees are compared to be sure.
+        bool operator==(const Setting &o) const;
+        bool operator!=(const Setting &o) const { return not (*this == o); }
+
         //used by the parser. Probably will go away
-        Setting * create_child(const std::string &name) {
+        Setting * create_child(std::string_view name) {
             return try_add_child(name, setting_type::BOOL);
         }
 
@@ -543,39 +969,261 @@ namespace Configinator5000 {
     };
 
     class Parser;
+    class tree_arena;
+
+    // Where a Config keeps its settings tree.
+    enum class tree_memory {
+        // the normal heap. Every string, key and child list is its own
+        // allocation.
+        heap,
+        // an arena owned by the Config. The whole tree is in a few large
+        // blocks and is freed all at once, without visiting the nodes. The
+        // Settings mustn't be used once the Config is gone or parses again.
+        arena
+    };
+
+    // How write_file() (and to_text() in writer.hpp) lay out the text.
+    enum class text_style {
+        // as small as it can be: no spaces or newlines.
+        compact,
+        // a setting per line, indented two spaces for each group.
+        pretty
+    };
 
     class Config {
-        std::unique_ptr<SchemaNode>schema_tree_;
-        std::unique_ptr<Setting>cfg_;
+        // checked by parse() and parse_file(). Shared, since it is only
+        // read.
+        std::shared_ptr<const Schema> schema_;
+        bool fail_fast_ = false;
+
+        // where included files are kept, if anywhere.
+        std::shared_ptr<include_cache> include_cache_;
+
+        // can't use unique_ptr with incomplete types.
+        tree_arena *arena_ = nullptr;
+
+        // Trees in the arena are never destroyed, just released.
+        struct tree_deleter {
+            bool in_arena;
+            tree_deleter() : in_arena{false} {}
+            explicit tree_deleter(bool a) : in_arena{a} {}
+            void operator()(Setting *s) const {
+                if (not in_arena) delete s;
+            }
+        };
+        std::unique_ptr<Setting, tree_deleter>cfg_;
+
+        // The text of a lazy parse, when the tree is in the arena (where
+        // it can't hold on to it itself).
+        std::shared_ptr<const void> source_;
 
         // can't use unique_ptr with incomplete types.
         Parser* parser_ = nullptr;
+
+        // What was wrong with the schema from the last set_schema() (or
+        // set_schema_file()), if it was bad. Reported by stream_errors()
+        // in place of the parse errors until the next parse, so the tree
+        // from that is left alone.
+        error_list *schema_errors_ = nullptr;
+
+        // Group keys for every tree this Config parses. Reference counted,
+        // since groups moved out of the tree keep using it.
+        key_table *keys_ = nullptr;
+
+        // see generation()
+        std::uint64_t generation_ = 0;
+
+        // the tree number (see tree_state.hpp) of every tree this Config
+        // makes, once it has made one.
+        std::uint32_t tree_id_ = 0;
+
+        // an open (or frozen) snapshot
+        std::shared_ptr<frozen_image> frozen_;
     public :
-        bool parse_file(std::string file_name) {
-            std::ifstream strm{file_name};
-            return parse(strm);
-        }
+        Config() = default;
+        explicit Config(tree_memory where);
+
+        Config(const Config &) = delete;
+        Config &operator=(const Config &) = delete;
+
+        // Maps the file and parses it in place. The mapping is released
+        // before this returns. @include "file" brings in the settings in
+        // another file (see include.hpp); it is relative to the directory
+        // of file_name here, and to the current directory for parse().
+        bool parse_file(const std::string &file_name);
+
         bool parse(std::ifstream &strm) {
-            // too many copies, but shouldn't matter much.
-            std::stringstream buffer;
-            buffer << strm.rdbuf();
-            return parse(buffer.str());
+            std::string buffer{std::istreambuf_iterator<char>(strm),
+                std::istreambuf_iterator<char>()};
+            return parse(buffer);
         }
 
-        bool parse(const std::string &input) {
-            return parse_with_schema(input, schema_tree_.get());
+        bool parse(std::string_view input) {
+            return parse_with_schema(input, schema_.get());
         }
 
+        // Check what parse(), parse_file() and parse(std::ifstream &)
+        // read against a schema (see the README for the format) from now
+        // on. Each Setting is checked as it is parsed, and problems are
+        // reported with the parse errors, one for each, with its line.
+        // Returns false if the schema itself is bad; what is wrong with
+        // it is then in stream_errors() (until the next parse), and the
+        // schema from before (if any) is still used. The settings tree
+        // isn't touched either way.
+        bool set_schema(std::string_view schema);
+        bool set_schema_file(const std::string &file_name);
+
+        // Stop parsing at the first thing that doesn't match the schema,
+        // rather than reporting them all. The tree is left as far as the
+        // parse got.
+        void set_fail_fast(bool on) { fail_fast_ = on; }
+
+        // Keep the files brought in with @include in this cache, which
+        // other Configs can share. Without one (or with null), they are
+        // parsed each time.
+        void set_include_cache(std::shared_ptr<include_cache> cache) {
+            include_cache_ = std::move(cache);
+        }
+
+        // Lazy versions of the above. Only the top level is parsed now;
+        // the brackets of each group, list and array are matched up, but
+        // what is inside is parsed the first time it is used. Errors in
+        // there show up as exceptions from the Setting at that point (or
+        // from validate_all()). The Config keeps the file mapped (or its own
+        // copy of `input`) for as long as any of it might still be needed.
+        // With a schema set, or for a config with an @include in it, these
+        // are just parse_file() and parse(), so the schema is checked.
+        bool parse_file_lazy(const std::string &file_name);
+        bool parse_lazy(std::string input);
+
+        // Parse everything a lazy parse put off, and record any errors
+        // found. Returns true if the whole config is good.
+        bool validate_all();
+
+        // Parse the top level settings on several threads (0 means one
+        // per core). The result, including any errors, is the same as
+        // parse(). Worth it for big configs made of many top level groups,
+        // lists or arrays. With a schema set, or for a config with an
+        // @include in it, the config is parsed (and checked) on one thread,
+        // though what it includes is still loaded on several.
+        bool parse_file_parallel(const std::string &file_name, unsigned threads = 0);
+        bool parse_parallel(std::string_view input, unsigned threads = 0);
+
+        // Parse JSON (see json.hpp for how it maps onto settings) rather
+        // than libconfig text, checked against the schema if there is
+        // one. Errors are reported the same way.
+        bool parse_json_file(const std::string &file_name);
+        bool parse_json(std::string_view input);
+
         Setting& get_settings() const {
             return *cfg_;
         }
 
+        // Save the settings tree (or the open snapshot) as a binary
+        // snapshot, which open_snapshot() can use without parsing. The
+        // file is replaced in one go, so processes opening it never see
+        // half of one. Returns false if the file couldn't be written or
+        // (for a lazy parse) part of the tree couldn't be parsed.
+        bool write_snapshot(const std::string &file_name);
+
+        // Save the settings tree as libconfig text, which parses back to
+        // an equal tree. The file is replaced in one go, as for
+        // write_snapshot(). Returns false if the file couldn't be
+        // written, a key or float can't be written as text (see
+        // writer.hpp), part of a lazy parse couldn't be parsed, or the
+        // settings are in a snapshot.
+        bool write_file(const std::string &file_name, text_style style = text_style::pretty);
+
+        // write_file(), but JSON. Any key can be written.
+        bool write_json_file(const std::string &file_name, text_style style = text_style::pretty);
+
+        // Map a snapshot and use it where it lies; only the header is
+        // read now. The settings are then in get_frozen() (read-only)
+        // rather than get_settings(), which is left empty.
+        bool open_snapshot(const std::string &file_name);
+
+        // Turn the settings tree into a snapshot in memory, for reading
+        // only. Lookups in it touch far less memory than in the tree. The
+        // settings are then in get_frozen(), as after open_snapshot().
+        // Returns false if part of a lazy parse couldn't be parsed.
+        bool freeze();
+
+        // The root of the open (or frozen) snapshot. Throws if there isn't
+        // one. Good until the Config parses or opens something else.
+        FrozenSetting get_frozen() const;
+
+        // Intern a key ahead of time. Setting::at() and exists() with the
+        // handle skip hashing the string for groups this Config parsed,
+        // including ones from later parses. Good for as long as the Config.
+        key_handle key(std::string_view name);
+
+        // A number for the current tree, different for every tree any
+        // Config makes (0 means there isn't one yet). Path::resolve() uses
+        // it (and notices Settings being added or replaced) to know when
+        // its answer is stale. tree_changed() gives the tree a new number
+        // anyway, so any other answers cached for it are thrown away.
+        std::uint64_t generation() const { return generation_; }
+        void tree_changed();
+
         std::ostream &stream_errors(std::ostream& strm);
 
         ~Config();
 
     private:
-        bool parse_with_schema(const std::string &input, const SchemaNode *schema);
+        // file_name is where input came from (empty if it didn't), which
+        // @include names are relative to.
+        bool parse_with_schema(std::string_view input, const Schema *schema,
+                const std::string &file_name = std::string{});
+
+        // Throw away the current tree (and parser) and start a new, empty
+        // one.
+        Setting &new_tree();
+
+        // Set things up to report that the file couldn't be read.
+        bool open_failed(const std::string &file_name);
+
+        // Start an empty tree with message as the only error.
+        bool failed(const std::string &message);
+
+        // Report the problems with a schema (leaving errs empty).
+        bool schema_failed(error_list &errs);
+    };
+
+    struct stream_state;
+
+    // Push style parser for input that shows up a piece at a time (pipes,
+    // sockets, files too big to keep in memory). Hand it chunks of any size
+    // with feed() and call finish() at the end of the input. Tokens may be
+    // split across chunks anywhere. Only the unfinished tail of the input is
+    // buffered; everything else goes straight into the Setting tree.
+    class StreamingParser {
+        std::unique_ptr<Setting>cfg_;
+
+        // can't use unique_ptr with incomplete types.
+        stream_state *state_ = nullptr;
+
+    public :
+        StreamingParser();
+        ~StreamingParser();
+
+        StreamingParser(const StreamingParser &) = delete;
+        StreamingParser &operator=(const StreamingParser &) = delete;
+
+        // Returns false once an error has been seen. Anything fed after
+        // that is ignored.
+        bool feed(std::string_view chunk);
+
+        // No more input. Returns true if the whole document was good.
+        bool finish();
+
+        // Number of bytes consumed so far.
+        std::uint64_t offset() const;
+
+        Setting& get_settings() const {
+            return *cfg_;
+        }
+
+        std::ostream &stream_errors(std::ostream& strm);
     };
 
 
@@ -0,0 +1,118 @@
+#include <diff.hpp>
+
+#include <algorithm>
+
+namespace Configinator5000 {
+
+    namespace {
+
+        using change_type = setting_change::change_type;
+
+        enum class kind { scalar, group, list, array };
+
+        kind kind_of(Setting &s) {
+            if (s.is_group()) return kind::group;
+            if (s.is_list()) return kind::list;
+            if (s.is_array()) return kind::array;
+            return kind::scalar;
+        }
+
+        class differ {
+            std::vector<setting_change> changes_;
+            std::string path_;
+
+        public :
+            std::vector<setting_change> run(Setting &before, Setting &after) {
+                compare(before, after);
+                return std::move(changes_);
+            }
+
+        private :
+            void record(change_type type, Setting *before, Setting *after) {
+                changes_.push_back(setting_change{type, path_, before, after});
+            }
+
+            void compare(Setting &a, Setting &b) {
+                if (a.content_hash() == b.content_hash()) return;
+
+                kind k = kind_of(a);
+                if (k != kind_of(b) or k == kind::scalar) {
+                    record(change_type::changed, &a, &b);
+                    return;
+                }
+
+                std::size_t length = path_.size();
+
+                if (k == kind::group) {
+                    for (int i = 0; i < b.count(); ++i) {
+                        auto name = b.name_at(i);
+                        enter(name);
+                        if (i < a.count() and a.name_at(i) == name) {
+                            // the keys are usually still in the same order.
+                            compare(a.at(i), b.at(i));
+                        } else if (a.exists(name)) {
+                            compare(a.at(name), b.at(i));
+                        } else {
+                            record(change_type::added, nullptr, &b.at(i));
+                        }
+                        path_.resize(length);
+                    }
+
+                    for (int i = 0; i < a.count(); ++i) {
+                        auto name = a.name_at(i);
+                        if (not b.exists(name)) {
+                            enter(name);
+                            record(change_type::removed, &a.at(i), nullptr);
+                            path_.resize(length);
+                        }
+                    }
+                } else {
+                    int common = std::min(a.count(), b.count());
+
+                    for (int i = 0; i < common; ++i) {
+                        enter(i);
+                        compare(a.at(i), b.at(i));
+                        path_.resize(length);
+                    }
+                    for (int i = common; i < a.count(); ++i) {
+                        enter(i);
+                        record(change_type::removed, &a.at(i), nullptr);
+                        path_.resize(length);
+                    }
+                    for (int i = common; i < b.count(); ++i) {
+                        enter(i);
+                        record(change_type::added, nullptr, &b.at(i));
+                        path_.resize(length);
+                    }
+                }
+            }
+
+            void enter(std::string_view name) {
+                if (not path_.empty()) path_ += '.';
+                path_ += name;
+            }
+
+            void enter(int idx) {
+                path_ += '[';
+                path_ += std::to_string(idx);
+                path_ += ']';
+            }
+        };
+    }
+
+    std::vector<setting_change> diff(Setting &before, Setting &after) {
+        return differ().run(before, after);
+    }
+
+    bool path_overlaps(std::string_view path, std::string_view prefix) {
+        auto under = [](std::string_view longer, std::string_view shorter) {
+            if (longer.substr(0, shorter.size()) != shorter) return false;
+            if (shorter.empty() or longer.size() == shorter.size()) return true;
+            char next = longer[shorter.size()];
+            return next == '.' or next == '[';
+        };
+
+        return under(path, prefix) or under(prefix, path);
+    }
+
+} // end namespace Configinator5000
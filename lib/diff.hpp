@@ -0,0 +1,45 @@
+#pragma once
+
+#include <configinator5000.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What changed between two settings trees.
+//
+// The comparison only goes down into subtrees whose content_hash()es
+// differ. Those are kept with the trees, so once a tree has been hashed
+// (by an earlier diff, say) a one line change in a big config is found by
+// following one chain of hashes, not by comparing everything.
+
+namespace Configinator5000 {
+
+    struct setting_change {
+        enum class change_type { added, removed, changed };
+
+        change_type type;
+
+        // Where, in the form Path takes ("midi.devices[3].in"). Empty for
+        // the root.
+        std::string path;
+
+        // null for added and removed respectively.
+        Setting *before;
+        Setting *after;
+    };
+
+    //
+    // The changes that turn before into after. Each is the highest
+    // Setting that differs, so a group with a changed scalar in it shows
+    // up as a change to the scalar, while a scalar replaced by a group
+    // is a change to the whole thing. The order of a group's keys doesn't
+    // matter; list and array items are compared by position.
+    //
+    std::vector<setting_change> diff(Setting &before, Setting &after);
+
+    // Is the change at path of interest to someone watching prefix? That
+    // is, is one of them under (or the same as) the other.
+    bool path_overlaps(std::string_view path, std::string_view prefix);
+
+} // end namespace Configinator5000
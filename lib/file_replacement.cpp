@@ -0,0 +1,104 @@
+#include <file_replacement.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define C5K_HAVE_OPEN 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Configinator5000 {
+
+    namespace {
+        // Different for every call in this process, and (mostly) from
+        // other processes. Opening with O_EXCL takes care of the rest.
+        std::string unique_suffix() {
+            static std::atomic<std::uint64_t> count{0};
+
+            std::uint64_t h = std::uint64_t(
+                    std::chrono::steady_clock::now().time_since_epoch().count());
+#ifdef C5K_HAVE_OPEN
+            h ^= std::uint64_t(::getpid()) << 40;
+#endif
+            h ^= count.fetch_add(1) * 0x9e3779b97f4a7c15ULL;
+
+            static const char digits[] = "0123456789abcdefghijklmnopqrstuv";
+            std::string retval = ".";
+            for (int i = 0; i < 12; ++i, h >>= 5) retval += digits[h & 31];
+            return retval + ".tmp";
+        }
+    }
+
+    file_replacement::file_replacement(const std::string &file_name) : file_name_{file_name} {
+        for (int tries = 0; tries < 100; ++tries) {
+            temp_name_ = file_name + unique_suffix();
+#ifdef C5K_HAVE_OPEN
+            // not mkstemp(), which would make it 0600 rather than what
+            // the umask says.
+            fd_ = ::open(temp_name_.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+            if (fd_ >= 0 or errno != EEXIST) break;
+#else
+            strm_ = std::fopen(temp_name_.c_str(), "wbx");
+            if (strm_) break;
+#endif
+        }
+        if (not is_open()) temp_name_.clear();
+    }
+
+    file_replacement::~file_replacement() {
+        close();
+        if (not temp_name_.empty()) std::remove(temp_name_.c_str());
+    }
+
+    void file_replacement::close() {
+#ifdef C5K_HAVE_OPEN
+        if (fd_ >= 0) ::close(fd_);
+#else
+        if (strm_) std::fclose(static_cast<std::FILE *>(strm_));
+#endif
+        fd_ = -1;
+        strm_ = nullptr;
+    }
+
+    bool file_replacement::write(std::string_view text) {
+#ifdef C5K_HAVE_OPEN
+        while (fd_ >= 0 and not text.empty()) {
+            auto n = ::write(fd_, text.data(), text.size());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            text.remove_prefix(std::size_t(n));
+        }
+        return fd_ >= 0;
+#else
+        return strm_ and std::fwrite(text.data(), 1, text.size(),
+                static_cast<std::FILE *>(strm_)) == text.size();
+#endif
+    }
+
+    bool file_replacement::commit() {
+        if (not is_open()) return false;
+
+#ifdef C5K_HAVE_OPEN
+        bool ok = (::close(fd_) == 0);
+#else
+        bool ok = (std::fclose(static_cast<std::FILE *>(strm_)) == 0);
+#endif
+        fd_ = -1;
+        strm_ = nullptr;
+
+        if (not ok or std::rename(temp_name_.c_str(), file_name_.c_str()) != 0) {
+            return false;
+        }
+
+        temp_name_.clear();
+        return true;
+    }
+
+} // end namespace Configinator5000
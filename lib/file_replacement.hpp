@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace Configinator5000 {
+
+    // A new version of a file. It is written under a name of its own in
+    // the same directory, made for this writer alone, and renamed over the
+    // file by commit(). Anyone opening the file gets the old one or the
+    // new one, never half of one, and any number of writers (threads or
+    // processes) can be replacing the same file at once; the last to
+    // commit wins.
+    class file_replacement {
+        std::string file_name_;
+        std::string temp_name_;
+
+        // an fd, or a FILE * where there is no open().
+        int fd_ = -1;
+        void *strm_ = nullptr;
+
+        void close();
+
+    public :
+        explicit file_replacement(const std::string &file_name);
+
+        file_replacement(const file_replacement &) = delete;
+        file_replacement &operator=(const file_replacement &) = delete;
+
+        // Removes what was written, unless it was committed.
+        ~file_replacement();
+
+        // false if there was nowhere to write.
+        bool is_open() const { return fd_ >= 0 or strm_; }
+
+        bool write(std::string_view text);
+
+        // Put it in place of the file. Returns false (and removes what was
+        // written) if it couldn't be finished or renamed.
+        bool commit();
+    };
+
+} // end namespace Configinator5000
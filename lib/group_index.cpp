@@ -0,0 +1,194 @@
+#include <group_index.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define C5K_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Configinator5000 {
+
+    namespace {
+
+        inline int ctz(std::uint32_t m) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctz(m);
+#else
+            int n = 0;
+            while (not (m & 1)) { m >>= 1; ++n; }
+            return n;
+#endif
+        }
+    }
+
+    group_index::group_index(const allocator_type &a) :
+        hashes_{a}, slots_{a}, keys_{a}, chars_{a} {}
+
+    group_index::group_index(const group_index &o, const allocator_type &a) :
+        hashes_{a}, slots_{a}, keys_{a}, chars_{a} {
+
+        if (not o.table_) {
+            hashes_ = o.hashes_;
+            slots_ = o.slots_;
+            keys_ = o.keys_;
+            chars_ = o.chars_;
+            return;
+        }
+
+        hashes_.reserve(o.hashes_.size());
+        keys_.reserve(o.hashes_.size());
+        for (int i = 0; i < o.size(); ++i) {
+            insert(o.key(i));
+        }
+    }
+
+    group_index::~group_index() {
+        if (table_) table_->release();
+    }
+
+    void group_index::use_keys(key_table *table) {
+        if (not empty()) {
+            throw std::logic_error("group_index::use_keys on a group with keys");
+        }
+        if (table_) table_->release();
+        table_ = table;
+        if (table_) table_->retain();
+    }
+
+    int group_index::find(std::string_view key) const {
+        if (hashes_.empty()) return -1;
+
+        return find(hashed_key{key, key_hash(key)});
+    }
+
+    int group_index::find(const hashed_key &key) const {
+        if (hashes_.empty()) return -1;
+
+        if (table_) {
+            // not in the table means not in any group using it.
+            const key_entry *e = table_->find(key);
+            return e ? find_hash(id_hash(e->id), key.name) : -1;
+        }
+
+        return find_hash(key.hash, key.name);
+    }
+
+    int group_index::find(const key_handle &key) const {
+        if (table_ and key.table_ == table_) {
+            if (hashes_.empty()) return -1;
+            return find_hash(id_hash(key.entry_->id), std::string_view{});
+        }
+
+        return find(key.name());
+    }
+
+    int group_index::find_hash(std::uint32_t h, std::string_view key) const {
+        return slots_.empty() ? find_small(h, key) : find_large(h, key);
+    }
+
+    int group_index::find_small(std::uint32_t h, std::string_view key) const {
+        const std::uint32_t *hashes = hashes_.data();
+        int count = size();
+        int i = 0;
+
+#if defined(C5K_HAVE_SSE2)
+        __m128i want = _mm_set1_epi32(int(h));
+        for (; i + 4 <= count; i += 4) {
+            __m128i got = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hashes + i));
+            auto mask = std::uint32_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(got, want))));
+            while (mask) {
+                int idx = i + ctz(mask);
+                if (same_key(idx, key)) return idx;
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            if (hashes[i] == h and same_key(i, key)) return i;
+        }
+
+        return -1;
+    }
+
+    int group_index::find_large(std::uint32_t h, std::string_view key) const {
+        std::size_t mask = slots_.size() - 1;
+
+        for (std::size_t pos = h & mask; ; pos = (pos + 1) & mask) {
+            std::uint32_t slot = slots_[pos];
+            if (slot == 0) return -1;
+
+            int idx = int(slot - 1);
+            if (hashes_[std::size_t(idx)] == h and same_key(idx, key)) return idx;
+        }
+    }
+
+    bool group_index::insert(std::string_view key) {
+        if (table_) {
+            const key_entry *e = table_->intern(key);
+            std::uint32_t h = id_hash(e->id);
+            if (find_hash(h, key) >= 0) return false;
+
+            key_ref k;
+            k.entry = e;
+            keys_.push_back(k);
+            add_key(h);
+            return true;
+        }
+
+        std::uint32_t h = key_hash(key);
+        if (find_hash(h, key) >= 0) return false;
+
+        if (chars_.size() + key.size() > UINT32_MAX) {
+            throw std::length_error("group keys too long");
+        }
+
+        auto offset = std::uint32_t(chars_.size());
+        chars_.insert(chars_.end(), key.begin(), key.end());
+        key_ref k;
+        k.own = {offset, std::uint32_t(key.size())};
+        keys_.push_back(k);
+        add_key(h);
+
+        return true;
+    }
+
+    void group_index::add_key(std::uint32_t h) {
+        hashes_.push_back(h);
+
+        int idx = size() - 1;
+        if (not slots_.empty()) {
+            if (hashes_.size() * 2 > slots_.size()) {
+                rebuild_slots(slots_.size() * 2);
+            } else {
+                add_slot(h, idx);
+            }
+        } else if (size() > small_limit) {
+            rebuild_slots(std::size_t(small_limit) * 4);
+        }
+    }
+
+    void group_index::add_slot(std::uint32_t h, int idx) {
+        std::size_t mask = slots_.size() - 1;
+        std::size_t pos = h & mask;
+        while (slots_[pos] != 0) pos = (pos + 1) & mask;
+        slots_[pos] = std::uint32_t(idx + 1);
+    }
+
+    void group_index::rebuild_slots(std::size_t capacity) {
+        slots_.assign(capacity, 0);
+        for (int i = 0; i < size(); ++i) add_slot(hashes_[std::size_t(i)], i);
+    }
+
+    std::vector<int> group_index::sorted() const {
+        std::vector<int> retval(hashes_.size());
+        std::iota(retval.begin(), retval.end(), 0);
+        std::sort(retval.begin(), retval.end(),
+                [this](int a, int b) { return key(a) < key(b); });
+        return retval;
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <key_table.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// The key lookup for a group. Keys are numbered in the order they were
+// added, which is also where the matching child sits in the group's
+// list of children.
+//
+// The keys themselves are either kept by the group, all sharing one
+// character buffer, or (for groups a Config parsed) live in the Config's
+// key_table and the group just points at them. Either way a group costs
+// a handful of allocations however many keys it has.
+//
+// Every key has a 32 bit hash. Small groups (the usual case) are searched
+// linearly by comparing hashes, several at a time where the CPU allows.
+// Past `small_limit` keys an open addressing table of key numbers is
+// built on top of the same arrays. For interned keys the "hash" is made
+// from the key's number in the key_table, so two keys have the same one
+// only if they are the same key and there are no strings to compare.
+
+namespace Configinator5000 {
+
+    class group_index {
+    public :
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        // Groups with no more keys than this don't get a hash table.
+        static constexpr int small_limit = 16;
+
+        explicit group_index(const allocator_type &a = {});
+
+        // copy into a (possibly) different memory_resource. The copy
+        // keeps its own keys, so it doesn't depend on o's key_table.
+        group_index(const group_index &o, const allocator_type &a);
+
+        group_index(const group_index &) = delete;
+        group_index &operator=(const group_index &) = delete;
+
+        ~group_index();
+
+        // Keep keys in `table` from now on. Only allowed while empty.
+        void use_keys(key_table *table);
+
+        // The key_table in use, if any.
+        key_table *keys() const { return table_; }
+
+        int size() const { return int(hashes_.size()); }
+        bool empty() const { return hashes_.empty(); }
+
+        // The number of key, or -1 if it isn't there.
+        int find(std::string_view key) const;
+        int find(const key_handle &key) const;
+        int find(const hashed_key &key) const;
+
+        // Add key as number size(). Returns false (and changes nothing)
+        // if it is already there.
+        bool insert(std::string_view key);
+
+        // Key number idx. Only good until the next insert.
+        std::string_view key(int idx) const {
+            auto const &k = keys_[std::size_t(idx)];
+            if (table_) return k.entry->name();
+            return std::string_view(chars_.data() + k.own.offset, k.own.size);
+        }
+
+        // The key_table entry of key number idx. Only for groups that use
+        // a key_table.
+        const key_entry *entry(int idx) const { return keys_[std::size_t(idx)].entry; }
+
+        // The key numbers, sorted by key.
+        std::vector<int> sorted() const;
+
+        allocator_type get_allocator() const { return hashes_.get_allocator(); }
+
+    private :
+        // A key we keep ourselves, or one in table_.
+        union key_ref {
+            struct {
+                std::uint32_t offset;
+                std::uint32_t size;
+            } own;
+            const key_entry *entry;
+        };
+
+        // one per key, in insertion order.
+        std::pmr::vector<std::uint32_t> hashes_;
+
+        // Open addressing table of key number + 1 (0 is empty). Size is a
+        // power of two, at most half full. Empty for small groups.
+        std::pmr::vector<std::uint32_t> slots_;
+
+        key_table *table_ = nullptr;
+
+        // one per key, in insertion order.
+        std::pmr::vector<key_ref> keys_;
+
+        // the text of all the keys we keep ourselves, back to back.
+        std::pmr::vector<char> chars_;
+
+        static std::uint32_t id_hash(std::uint32_t id) {
+            // odd multiplier, so no two ids get the same hash.
+            return id * 0x9e3779b1u;
+        }
+
+        bool same_key(int idx, std::string_view key) const {
+            // hashes are unique for interned keys.
+            if (table_) return true;
+
+            auto const &k = keys_[std::size_t(idx)].own;
+            return k.size == key.size() and
+                std::string_view(chars_.data() + k.offset, k.size) == key;
+        }
+
+        int find_hash(std::uint32_t h, std::string_view key) const;
+        int find_small(std::uint32_t h, std::string_view key) const;
+        int find_large(std::uint32_t h, std::string_view key) const;
+
+        void add_key(std::uint32_t h);
+        void add_slot(std::uint32_t h, int idx);
+        void rebuild_slots(std::size_t capacity);
+    };
+
+} // end namespace Configinator5000
@@ -0,0 +1,486 @@
+#include <include.hpp>
+#include <mapped_file.hpp>
+#include <work_pool.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define C5K_HAVE_STAT 1
+#include <climits>
+#include <cstdlib>
+#include <sys/stat.h>
+#else
+#include <fstream>
+#endif
+
+namespace Configinator5000 {
+
+    namespace {
+
+        // Fill in the size and modification time of s.path. False if
+        // there is no such file.
+        bool stamp_file(file_stamp &s) {
+#ifdef C5K_HAVE_STAT
+            struct stat st;
+            if (::stat(s.path.c_str(), &st) != 0 or not S_ISREG(st.st_mode)) return false;
+
+            s.size = std::uint64_t(st.st_size);
+#ifdef __APPLE__
+            s.mtime = std::int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+            s.mtime = std::int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+            return true;
+#else
+            // only the size to go on.
+            std::ifstream strm{s.path, std::ios::binary | std::ios::ate};
+            if (not strm) return false;
+
+            s.size = std::uint64_t(strm.tellg());
+            s.mtime = 0;
+            return true;
+#endif
+        }
+
+        // The one name for a file, whichever way it was reached.
+        std::string full_path(const std::string &path) {
+#ifdef C5K_HAVE_STAT
+            char buf[PATH_MAX];
+            if (::realpath(path.c_str(), buf)) return buf;
+#endif
+            return path;
+        }
+
+        // Where the names in file_name are relative to.
+        std::string directory_of(const std::string &file_name) {
+            auto slash = file_name.rfind('/');
+            return (slash == std::string::npos) ? std::string{} : file_name.substr(0, slash + 1);
+        }
+
+        std::string resolve(const std::string &name, const std::string &directory) {
+            if (name.empty() or name[0] == '/') return name;
+            return directory + name;
+        }
+
+        /*******************************************************
+         * Finding the @include directives
+         *******************************************************/
+
+        // Past white space and comments, as the parser's skip() goes.
+        const char *skip_gap(const char *p, const char *end) {
+            long lines = 0;
+            while (true) {
+                p = scan::skip_blanks(p, end, lines);
+                if (p == end) return p;
+
+                bool two = (p + 1 < end);
+                if (*p == '#' or (two and p[0] == '/' and p[1] == '/')) {
+                    p = scan::find_newline(p + 1, end);
+                } else if (two and p[0] == '/' and p[1] == '*') {
+                    p = scan::find_block_end(p + 2, end, lines);
+                    p = (p == end) ? end : p + 2;
+                } else {
+                    return p;
+                }
+            }
+        }
+
+        // The names the @include directives in text give, decoded as the
+        // parser would. Strings and comments are stepped over, so an
+        // "@include" in one of those doesn't count.
+        std::vector<std::string> find_includes(std::string_view text) {
+            std::vector<std::string> names;
+            if (not may_include(text)) return names;
+
+            const char *p = text.data();
+            const char *end = p + text.size();
+            long lines = 0;
+
+            while (p < end) {
+                auto *at = static_cast<const char *>(std::memchr(p, '@', std::size_t(end - p)));
+                if (not at) break;
+
+                // Anything before the '@' that starts a string or a
+                // comment has to be stepped over first.
+                const char *q = scan::find_structural(p, at, lines);
+                if (q == at) {
+                    p = at + 1;
+                    if (std::size_t(end - at) < 8 or std::memcmp(at, "@include", 8) != 0) continue;
+                    if (at + 8 < end and (std::isalnum(static_cast<unsigned char>(at[8])) or at[8] == '_')) {
+                        continue;
+                    }
+
+                    p = skip_gap(at + 8, end);
+                    std::string name;
+                    bool ok = (p < end and *p == '"');
+                    while (ok) {
+                        // adjacent strings are joined, as for values.
+                        auto lit = lexer::scan_string(p, end, name);
+                        p += lit.length;
+                        ok = lit.ok;
+                        if (not ok) break;
+                        p = skip_gap(p, end);
+                        if (p == end or *p != '"') break;
+                    }
+                    if (ok) names.push_back(std::move(name));
+                    continue;
+                }
+
+                bool two = (q + 1 < end);
+                if (*q == '"') {
+                    // step over the string.
+                    p = q + 1;
+                    while (true) {
+                        p = scan::find_string_special(p, end);
+                        if (p == end) break;
+                        if (*p == '"') {
+                            ++p;
+                            break;
+                        }
+                        p = (*p == '\\' and p + 1 < end) ? p + 2 : p + 1;
+                    }
+                } else if (*q == '#' or (*q == '/' and two and q[1] == '/')) {
+                    p = scan::find_newline(q + 1, end);
+                } else if (*q == '/' and two and q[1] == '*') {
+                    p = scan::find_block_end(q + 2, end, lines);
+                    p = (p == end) ? end : p + 2;
+                } else {
+                    p = q + 1;
+                }
+            }
+
+            return names;
+        }
+
+        /*******************************************************
+         * Loading
+         *******************************************************/
+
+        std::shared_ptr<included_file> failed(std::string message) {
+            auto file = std::make_shared<included_file>();
+            file->error = std::move(message);
+            return file;
+        }
+
+        struct include_node {
+            // as it was given (after resolving), for messages.
+            std::string name;
+
+            // path is the full path.
+            file_stamp stamp;
+
+            // once loaded (or found in the cache).
+            std::shared_ptr<included_file> file;
+
+            mapped_file text;
+
+            // the @include names in it, which node each is, and whether it
+            // goes back to a file that led here.
+            std::vector<std::string> names;
+            std::vector<std::size_t> to;
+            std::vector<bool> cycle;
+
+            enum class visit { no, on_path, done };
+            visit state = visit::no;
+
+            // how many levels of includes to parse under it.
+            int level = 0;
+        };
+
+        class include_loader {
+            // a deque so nodes stay put as more are added.
+            std::deque<include_node> nodes_;
+            std::unordered_map<std::string, std::size_t> by_path_;
+            std::vector<std::vector<std::size_t>> levels_;
+
+            include_cache *cache_;
+            unsigned threads_;
+            std::unique_ptr<work_pool> pool_;
+
+            template<class F>
+            void each(const std::vector<std::size_t> &batch, F &&f) {
+                if (batch.size() == 1) {
+                    f(batch[0]);
+                } else if (batch.size() > 1) {
+                    if (not pool_) pool_ = std::make_unique<work_pool>(threads_);
+                    pool_->run(batch.size(), [&](std::size_t i) { f(batch[i]); });
+                }
+            }
+
+            // Give each @include in node n the node of its file.
+            std::vector<std::size_t> link(std::size_t n) {
+                std::vector<std::size_t> added;
+                std::string directory = directory_of(nodes_[n].name);
+
+                for (auto &name : nodes_[n].names) {
+                    std::string path = resolve(name, directory);
+                    std::string full = full_path(path);
+
+                    auto found = by_path_.find(full);
+                    if (found == by_path_.end()) {
+                        found = by_path_.emplace(full, nodes_.size()).first;
+                        auto &node = nodes_.emplace_back();
+                        node.name = std::move(path);
+                        node.stamp.path = std::move(full);
+                        added.push_back(found->second);
+                    }
+                    nodes_[n].to.push_back(found->second);
+                    nodes_[n].cycle.push_back(false);
+                }
+                return added;
+            }
+
+            // Read the file (unless the cache has it) and find its includes.
+            void read(include_node &node) {
+                if (not stamp_file(node.stamp)) {
+                    node.file = failed("Could not open file " + node.name);
+                    return;
+                }
+                if (cache_ and (node.file = cache_->find(node.stamp.path))) return;
+
+                node.text = mapped_file{node.name};
+                if (not node.text.is_open()) {
+                    node.file = failed("Could not open file " + node.name);
+                    return;
+                }
+                node.names = find_includes(node.text.view());
+            }
+
+            // Mark the includes that make cycles, and put every file to be
+            // parsed on the level after everything it includes.
+            void order(std::size_t n) {
+                auto &node = nodes_[n];
+                node.state = include_node::visit::on_path;
+
+                int level = 0;
+                for (std::size_t i = 0; i < node.to.size(); ++i) {
+                    auto &next = nodes_[node.to[i]];
+                    if (next.state == include_node::visit::on_path) {
+                        node.cycle[i] = true;
+                        continue;
+                    }
+                    if (next.file) continue;
+
+                    if (next.state == include_node::visit::no) order(node.to[i]);
+                    level = std::max(level, next.level + 1);
+                }
+
+                node.state = include_node::visit::done;
+                node.level = level;
+                if (n != 0) {
+                    if (levels_.size() <= std::size_t(level)) levels_.resize(std::size_t(level) + 1);
+                    levels_[std::size_t(level)].push_back(n);
+                }
+            }
+
+            include_map map_of(const include_node &node) {
+                include_map retval;
+                for (std::size_t i = 0; i < node.to.size(); ++i) {
+                    auto &next = nodes_[node.to[i]];
+                    retval[node.names[i]] = node.cycle[i] ?
+                        failed("Include cycle through " + next.name) : next.file;
+                }
+                return retval;
+            }
+
+            std::shared_ptr<included_file> parse(include_node &node) {
+                auto file = std::make_shared<included_file>();
+
+                file->depends.push_back(node.stamp);
+                for (std::size_t i = 0; i < node.to.size(); ++i) {
+                    auto &next = nodes_[node.to[i]];
+                    if (node.cycle[i]) {
+                        file->depends.push_back(next.stamp);
+                    } else {
+                        file->depends.insert(file->depends.end(),
+                                next.file->depends.begin(), next.file->depends.end());
+                    }
+                }
+                auto by_path = [](const file_stamp &a, const file_stamp &b) { return a.path < b.path; };
+                std::sort(file->depends.begin(), file->depends.end(), by_path);
+                file->depends.erase(std::unique(file->depends.begin(), file->depends.end()),
+                        file->depends.end());
+
+                include_map includes = map_of(node);
+                TreeBuilder builder{&file->settings};
+                EventParser<TreeBuilder> parser{node.text.view(), builder};
+                parser.includes = &includes;
+
+                if (not parser.do_parse()) {
+                    // The first error says what is wrong; "line N : ..."
+                    std::ostringstream strm;
+                    strm << parser.errors.errors.front();
+                    std::string first = strm.str();
+                    first.pop_back();
+                    file->error = "In file " + node.name + ", " + first;
+                }
+                return file;
+            }
+
+        public :
+            include_loader(include_cache *cache, unsigned threads) :
+                cache_{cache}, threads_{threads} {}
+
+            bool load(std::string_view text, const std::string &file_name, include_map &includes) {
+                auto &root = nodes_.emplace_back();
+                root.names = find_includes(text);
+                if (root.names.empty()) return false;
+
+                root.name = file_name;
+                if (not file_name.empty()) {
+                    root.stamp.path = full_path(file_name);
+                    by_path_.emplace(root.stamp.path, 0);
+                    stamp_file(root.stamp);
+                }
+
+                // find everything, a level at a time.
+                std::vector<std::size_t> level = link(0);
+                while (not level.empty()) {
+                    each(level, [this](std::size_t n) {
+                        try {
+                            read(nodes_[n]);
+                        } catch (std::exception &e) {
+                            nodes_[n].file = failed(e.what());
+                        }
+                    });
+
+                    std::vector<std::size_t> next;
+                    for (auto n : level) {
+                        if (nodes_[n].file) continue;
+                        auto added = link(n);
+                        next.insert(next.end(), added.begin(), added.end());
+                    }
+                    level = std::move(next);
+                }
+
+                // then parse, leaves first.
+                order(0);
+                for (auto &batch : levels_) {
+                    each(batch, [this](std::size_t n) {
+                        auto &node = nodes_[n];
+                        try {
+                            auto parse_it = [this, &node]() { return parse(node); };
+                            node.file = cache_ ? cache_->get(node.stamp.path, parse_it) : parse_it();
+                        } catch (std::exception &e) {
+                            node.file = failed(e.what());
+                        }
+                    });
+                }
+
+                includes = map_of(root);
+                return true;
+            }
+        };
+    }
+
+    /***************************************************************
+     * include_cache
+     ***************************************************************/
+
+    bool unchanged(const std::vector<file_stamp> &depends) {
+        for (auto &was : depends) {
+            file_stamp now{was.path};
+            if (not stamp_file(now) or not (now == was)) return false;
+        }
+        return true;
+    }
+
+    void include_cache::forget(const std::string &path, std::uint64_t id) {
+        std::lock_guard<std::mutex> guard{lock_};
+        auto found = files_.find(path);
+        if (found != files_.end() and found->second.id == id) files_.erase(found);
+    }
+
+    std::shared_ptr<included_file> include_cache::find(const std::string &path) {
+        std::unique_lock<std::mutex> guard{lock_};
+        auto found = files_.find(path);
+        if (found == files_.end()) return nullptr;
+        entry e = found->second;
+        guard.unlock();
+
+        auto file = e.file.get();
+        if (not file->error.empty()) return nullptr;
+        if (unchanged(file->depends)) return file;
+
+        forget(path, e.id);
+        return nullptr;
+    }
+
+    std::shared_ptr<included_file> include_cache::get(const std::string &path,
+            const std::function<std::shared_ptr<included_file>()> &load) {
+        while (true) {
+            std::unique_lock<std::mutex> guard{lock_};
+
+            auto found = files_.find(path);
+            if (found != files_.end()) {
+                entry e = found->second;
+                guard.unlock();
+
+                auto file = e.file.get();
+                if (not file->error.empty() or unchanged(file->depends)) return file;
+
+                // out of date; load it again.
+                forget(path, e.id);
+                continue;
+            }
+
+            std::promise<std::shared_ptr<included_file>> loading;
+            std::uint64_t id = next_id_++;
+            files_.emplace(path, entry{loading.get_future().share(), id});
+            guard.unlock();
+
+            std::shared_ptr<included_file> file;
+            try {
+                file = load();
+            } catch (...) {
+                loading.set_exception(std::current_exception());
+                forget(path, id);
+                throw;
+            }
+            loading.set_value(file);
+
+            // failures aren't kept; the next one to ask tries again.
+            if (not file->error.empty()) forget(path, id);
+            return file;
+        }
+    }
+
+    std::size_t include_cache::size() {
+        std::lock_guard<std::mutex> guard{lock_};
+        return files_.size();
+    }
+
+    void include_cache::clear() {
+        std::lock_guard<std::mutex> guard{lock_};
+        files_.clear();
+    }
+
+    std::size_t include_cache::prune() {
+        std::lock_guard<std::mutex> guard{lock_};
+        std::size_t dropped = 0;
+        for (auto iter = files_.begin(); iter != files_.end(); ) {
+            // ones still loading are left to their loaders.
+            auto &future = iter->second.file;
+            if (future.wait_for(std::chrono::seconds{0}) == std::future_status::ready and
+                    not unchanged(future.get()->depends)) {
+                iter = files_.erase(iter);
+                ++dropped;
+            } else {
+                ++iter;
+            }
+        }
+        return dropped;
+    }
+
+    bool load_includes(std::string_view text, const std::string &file_name,
+            include_cache *cache, include_map &includes, unsigned threads) {
+        return include_loader{cache, threads}.load(text, file_name, includes);
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,92 @@
+#pragma once
+
+// @include "file" for Config.
+//
+// A name that doesn't start with '/' is taken relative to the directory
+// of the file it is in (or the current directory, for text that isn't
+// from a file). A file may only be brought in where a setting could go;
+// its settings then go where the @include is.
+//
+// Before the parse proper, everything a config includes (and everything
+// that includes, and so on) is found and loaded. The files are found a
+// level at a time, and the files of a level are read (and searched for
+// their own includes) on a work_pool together. A file that includes one
+// of the files that led to it is a cycle, and is an error. The files are
+// then parsed leaves first, again a level at a time on the pool, each
+// into a tree of its own. The parse proper sends the settings of an
+// included tree to its handler as if they had been in the text, so a
+// schema checks them like the rest.
+//
+// Parsed files go in an include_cache, when the Config is given one,
+// which any number of Configs can share. A file is only parsed again if
+// it (or anything it includes) has changed size or modification time. A
+// file being parsed for one Config is waited for by any other that wants
+// it, rather than parsed twice.
+
+#include <parser.hpp>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Configinator5000 {
+
+    // Included files, parsed, by their full paths.
+    class include_cache {
+        struct entry {
+            std::shared_future<std::shared_ptr<included_file>> file;
+            std::uint64_t id;
+        };
+
+        std::mutex lock_;
+        std::unordered_map<std::string, entry> files_;
+        std::uint64_t next_id_ = 0;
+
+        // Drop the entry, if it is still the one with the id.
+        void forget(const std::string &path, std::uint64_t id);
+
+    public :
+        // The file (by its full path) if it is here and nothing it was
+        // loaded from has changed, waiting for it if it is being loaded.
+        // Otherwise null.
+        std::shared_ptr<included_file> find(const std::string &path);
+
+        // The same, but load() the file if there isn't a good one, and
+        // keep it if it loaded without an error. Anyone else wanting the
+        // file meanwhile waits for it (and gets the error, if it has one).
+        std::shared_ptr<included_file> get(const std::string &path,
+                const std::function<std::shared_ptr<included_file>()> &load);
+
+        std::size_t size();
+        void clear();
+
+        // Drop the files that have changed (or that something they
+        // include has) since they were loaded, which would be loaded
+        // again anyway. Returns how many went. Files nobody asks for
+        // again otherwise stay until clear().
+        std::size_t prune();
+    };
+
+    // Whether the files in depends are all still as they were.
+    bool unchanged(const std::vector<file_stamp> &depends);
+
+    //
+    // Load what the @include directives in text (the contents of
+    // file_name, which may be empty) need into includes, using the cache
+    // if there is one. Returns false if there are no @include directives,
+    // which is quick to find out. Problems with the files are left in
+    // them for the parse to report.
+    //
+    bool load_includes(std::string_view text, const std::string &file_name,
+            include_cache *cache, include_map &includes, unsigned threads = 0);
+
+    // Might text have an @include in it? Only looks for the word.
+    inline bool may_include(std::string_view text) {
+        return text.find("@include") != std::string_view::npos;
+    }
+
+} // end namespace Configinator5000
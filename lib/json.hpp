@@ -0,0 +1,530 @@
+#pragma once
+
+// JSON in, through the same events as the libconfig parser (parser.hpp).
+//
+// The document must be one object; its members are the root group's, so
+// there is no begin_group()/end_group() for it, just as with libconfig
+// text. Objects are groups. Numbers go through lexer::scan_number, like
+// the libconfig parser's, and are ints unless they have a '.' or an
+// exponent. Strings without escapes are handed out as views of the
+// input.
+//
+// JSON has one kind of array where libconfig has two. An array whose
+// elements are all scalars of one type is sent as begin_array(), and an
+// empty one too; anything else is a list. Ints and floats together make
+// a list, so each keeps its type. Deciding means a quick look along the
+// array first, which only checks the first byte of each element.
+//
+// null has nothing to be, so it is an error. So are numbers JSON doesn't
+// have: the libconfig only bits of number syntax (hex, a leading '+', an
+// L suffix), a leading 0 with more digits after it, and a '.' without a
+// digit on each side of it. So are raw newlines in strings. Text passed
+// to skipped() is JSON.
+
+#include <parser.hpp>
+
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Configinator5000 {
+
+    template<class Handler>
+    struct JsonEventParser {
+
+        std::string_view src;
+
+        Handler &handler;
+
+        parse_loc current_loc;
+
+        error_list errors;
+
+        // set when the handler asked us to stop.
+        bool stopped = false;
+
+        // Decoded keys and string values that couldn't be handed out as a
+        // view of src. Apart, since a key is still needed while its value
+        // is sent.
+        std::string key_buf;
+        std::string string_buf;
+
+        JsonEventParser(std::string_view _src, Handler &h) : src{_src}, handler{h},
+            current_loc{_src, 0, 0} {}
+
+        /***********************************************************
+         * Error and input utilities
+         ***********************************************************/
+
+        void record_error(const std::string &msg, const parse_loc &l) {
+            errors.add(msg, l);
+        }
+
+        void record_error(const std::string & msg) {
+            record_error(msg, current_loc);
+        }
+
+        const char *here() const { return current_loc.sv.data(); }
+        const char *end() const { return current_loc.sv.data() + current_loc.sv.size(); }
+
+        void consume(std::size_t count) {
+            current_loc.offset += count;
+            current_loc.sv.remove_prefix(count);
+        }
+
+        void consume_to(const char *p) { consume(std::size_t(p - here())); }
+
+        bool eoi() const { return current_loc.sv.empty(); }
+
+        char peek() const { return eoi() ? '\x00' : current_loc.sv[0]; }
+
+        // No comments in JSON, just white space.
+        void skip() {
+            long lines = 0;
+            consume_to(scan::skip_blanks(here(), end(), lines));
+            current_loc.line += lines;
+        }
+
+        bool handled(event_action action, const parse_loc &loc) {
+            if (action != event_action::stop) return true;
+
+            stopped = true;
+            if (not handler.failure().empty()) {
+                record_error(handler.failure(), loc);
+            }
+            return false;
+        }
+
+        bool skip_composite() {
+            auto extent = lexer::skip_composite(here(), end());
+
+            auto start = current_loc;
+            consume(extent.length);
+            current_loc.line += extent.lines;
+
+            if (not extent.ok) {
+                record_error(extent.message, start);
+                return false;
+            }
+
+            handler.skipped(start.sv.substr(0, extent.length), start);
+            return true;
+        }
+
+        /***********************************************************
+         * Scalars
+         ***********************************************************/
+
+        static int hex_digit(char c) {
+            if (c >= '0' and c <= '9') return c - '0';
+            if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' and c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // The four hex digits of a \u escape at p, or -1.
+        static long hex4(const char *p, const char *end) {
+            if (end - p < 4) return -1;
+            long v = 0;
+            for (int i = 0; i < 4; ++i) {
+                int d = hex_digit(p[i]);
+                if (d < 0) return -1;
+                v = v * 16 + d;
+            }
+            return v;
+        }
+
+        static void put_utf8(std::string &out, unsigned long cp) {
+            if (cp < 0x80) {
+                out += char(cp);
+            } else if (cp < 0x800) {
+                out += char(0xc0 | (cp >> 6));
+                out += char(0x80 | (cp & 0x3f));
+            } else if (cp < 0x10000) {
+                out += char(0xe0 | (cp >> 12));
+                out += char(0x80 | ((cp >> 6) & 0x3f));
+                out += char(0x80 | (cp & 0x3f));
+            } else {
+                out += char(0xf0 | (cp >> 18));
+                out += char(0x80 | ((cp >> 12) & 0x3f));
+                out += char(0x80 | ((cp >> 6) & 0x3f));
+                out += char(0x80 | (cp & 0x3f));
+            }
+        }
+
+        // The string starting at the '"'. The view is into src or buf.
+        std::optional<std::string_view> match_string(std::string &buf) {
+            const char *start = here() + 1;
+            const char *last = end();
+
+            // Fast path - no escapes, so it is just a piece of the source.
+            const char *p = scan::find_string_special(start, last);
+            if (p < last and *p == '"') {
+                std::string_view text(start, std::size_t(p - start));
+                consume_to(p + 1);
+                return text;
+            }
+
+            buf.assign(start, std::size_t(p - start));
+            while (true) {
+                if (p == last or *p == '\n') {
+                    record_error("Unterminated string");
+                    return std::nullopt;
+                }
+                if (*p == '"') break;
+
+                // an escape
+                const char *esc = p;
+                char c = (p + 1 < last) ? p[1] : '\x00';
+                p += 2;
+                switch (c) {
+                    case '"' :  buf += '"'; break;
+                    case '\\' : buf += '\\'; break;
+                    case '/' :  buf += '/'; break;
+                    case 'b' :  buf += '\b'; break;
+                    case 'f' :  buf += '\f'; break;
+                    case 'n' :  buf += '\n'; break;
+                    case 'r' :  buf += '\r'; break;
+                    case 't' :  buf += '\t'; break;
+                    case 'u' : {
+                        long cp = hex4(p, last);
+                        if (cp >= 0) p += 4;
+                        if (cp >= 0xd800 and cp < 0xdc00) {
+                            // a surrogate pair
+                            long low = (last - p >= 6 and p[0] == '\\' and p[1] == 'u') ?
+                                hex4(p + 2, last) : -1;
+                            if (low >= 0xdc00 and low < 0xe000) {
+                                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                                p += 6;
+                            } else {
+                                cp = -1;
+                            }
+                        } else if (cp >= 0xdc00 and cp < 0xe000) {
+                            cp = -1;
+                        }
+                        if (cp < 0) {
+                            consume_to(esc);
+                            record_error("Bad \\u escape in string");
+                            return std::nullopt;
+                        }
+                        put_utf8(buf, static_cast<unsigned long>(cp));
+                        break;
+                    }
+                    default :
+                        consume_to(esc);
+                        record_error("Unrecognized escape sequence in string");
+                        return std::nullopt;
+                }
+
+                const char *run = p;
+                p = scan::find_string_special(p, last);
+                buf.append(run, std::size_t(p - run));
+            }
+
+            consume_to(p + 1);
+            return std::string_view(buf);
+        }
+
+        // true or false, as a whole word.
+        std::optional<bool> match_bool() {
+            auto word = [this](std::string_view w) {
+                auto &sv = current_loc.sv;
+                if (sv.compare(0, w.size(), w) != 0) return false;
+                if (sv.size() > w.size()) {
+                    auto c = static_cast<unsigned char>(sv[w.size()]);
+                    if (std::isalnum(c) or c == '_') return false;
+                }
+                consume(w.size());
+                return true;
+            };
+
+            if (word("true")) return true;
+            if (word("false")) return false;
+            return std::nullopt;
+        }
+
+        // Whether [p, end) is a number as JSON has them:
+        // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+        static bool json_number(const char *p, const char *end) {
+            auto digits = [&]() {
+                const char *start = p;
+                while (p < end and *p >= '0' and *p <= '9') ++p;
+                return p > start;
+            };
+
+            if (p < end and *p == '-') ++p;
+            if (p < end and *p == '0') {
+                ++p;
+            } else if (not digits()) {
+                return false;
+            }
+            if (p < end and *p == '.') {
+                ++p;
+                if (not digits()) return false;
+            }
+            if (p < end and (*p == 'e' or *p == 'E')) {
+                ++p;
+                if (p < end and (*p == '+' or *p == '-')) ++p;
+                if (not digits()) return false;
+            }
+            return p == end;
+        }
+
+        // A number, checked for what JSON doesn't allow, but not yet
+        // consumed.
+        lexer::number scan_number() {
+            auto nv = lexer::scan_number(here(), end());
+            if ((nv.is_integer() or nv.is_floating()) and
+                    not json_number(here(), here() + nv.length)) {
+                nv.type = lexer::number::kind::error;
+                nv.message = "Malformed number";
+            }
+            return nv;
+        }
+
+        bool match_number(std::string_view name) {
+            auto loc = current_loc;
+            auto nv = scan_number();
+            if (nv.is_error()) {
+                record_error(nv.message);
+                return false;
+            } else if (not nv.found()) {
+                record_error("Expecting a value");
+                return false;
+            }
+
+            consume(nv.length);
+            if (nv.is_floating()) {
+                return handled(handler.on_float(name, nv.floating), loc);
+            } else {
+                return handled(handler.on_integer(name, nv.integer), loc);
+            }
+        }
+
+        /***********************************************************
+         * Arrays
+         ***********************************************************/
+
+        // What the array at the '[' should be: ST::ARRAY if it is empty,
+        // the type of its elements if they are all one scalar type, and
+        // ST::LIST otherwise (or if it is malformed, which the parse
+        // proper will report).
+        ST array_kind() const {
+            const char *p = here() + 1;
+            const char *last = end();
+            long lines = 0;
+
+            ST kind = ST::ARRAY;
+            p = scan::skip_blanks(p, last, lines);
+            if (p < last and *p == ']') return kind;
+
+            while (p < last) {
+                ST type;
+                char c = *p;
+                if (c == '"') {
+                    type = ST::STRING;
+                    ++p;
+                    while (true) {
+                        p = scan::find_string_special(p, last);
+                        if (p == last or *p == '\n') return ST::LIST;
+                        if (*p == '"') break;
+                        if (last - p < 2) return ST::LIST;
+                        p += 2;
+                    }
+                    ++p;
+                } else if (c == 't' or c == 'f') {
+                    type = ST::BOOL;
+                    while (p < last and std::isalpha(static_cast<unsigned char>(*p))) ++p;
+                } else if (c == '-' or (c >= '0' and c <= '9')) {
+                    type = ST::INTEGER;
+                    for (; p < last; ++p) {
+                        c = *p;
+                        if (c == '.' or c == 'e' or c == 'E') {
+                            type = ST::FLOAT;
+                        } else if (not ((c >= '0' and c <= '9') or c == '-' or c == '+')) {
+                            break;
+                        }
+                    }
+                } else {
+                    return ST::LIST;
+                }
+
+                if (kind != ST::ARRAY and kind != type) return ST::LIST;
+                kind = type;
+
+                p = scan::skip_blanks(p, last, lines);
+                if (p < last and *p == ']') return kind;
+                if (p == last or *p != ',') return ST::LIST;
+                p = scan::skip_blanks(p + 1, last, lines);
+            }
+
+            return ST::LIST;
+        }
+
+        // Everything after the '['.
+        bool parse_array_body() {
+            skip();
+            if (peek() == ']') {
+                consume(1);
+                return true;
+            }
+
+            while (true) {
+                if (not parse_value({})) return false;
+
+                skip();
+                if (peek() == ',') {
+                    consume(1);
+                    skip();
+                } else if (peek() == ']') {
+                    consume(1);
+                    return true;
+                } else {
+                    record_error("Didn't find close of array");
+                    return false;
+                }
+            }
+        }
+
+        /***********************************************************
+         * Objects and values
+         ***********************************************************/
+
+        // Everything after the '{'.
+        bool parse_object_body() {
+            skip();
+            if (peek() == '}') {
+                consume(1);
+                return true;
+            }
+
+            while (true) {
+                if (peek() != '"') {
+                    record_error("Expecting a key");
+                    return false;
+                }
+                auto key = match_string(key_buf);
+                if (not key) return false;
+
+                skip();
+                if (peek() != ':') {
+                    record_error("Expecting : after key");
+                    return false;
+                }
+                consume(1);
+                skip();
+
+                if (not parse_value(*key)) return false;
+
+                skip();
+                if (peek() == ',') {
+                    consume(1);
+                    skip();
+                } else if (peek() == '}') {
+                    consume(1);
+                    return true;
+                } else {
+                    record_error("Didn't find close of object");
+                    return false;
+                }
+            }
+        }
+
+        bool parse_value(std::string_view name) {
+            auto loc = current_loc;
+
+            switch (peek()) {
+                case '{' : {
+                    auto action = handler.begin_group(name);
+                    if (action == event_action::skip) return skip_composite();
+                    if (not handled(action, loc)) return false;
+                    consume(1);
+                    if (not parse_object_body()) return false;
+                    return handled(handler.end_group(), loc);
+                }
+
+                case '[' : {
+                    bool list = (array_kind() == ST::LIST);
+                    auto action = list ? handler.begin_list(name) : handler.begin_array(name);
+                    if (action == event_action::skip) return skip_composite();
+                    if (not handled(action, loc)) return false;
+                    consume(1);
+                    if (not parse_array_body()) return false;
+                    return handled(list ? handler.end_list() : handler.end_array(), loc);
+                }
+
+                case '"' : {
+                    auto sv = match_string(string_buf);
+                    if (not sv) return false;
+                    return handled(handler.on_string(name, *sv), loc);
+                }
+
+                case 'n' :
+                    if (current_loc.sv.compare(0, 4, "null") == 0) {
+                        record_error("null can't be a setting");
+                        return false;
+                    }
+                    break;
+
+                case 't' :
+                case 'f' :
+                    if (auto bv = match_bool()) {
+                        return handled(handler.on_bool(name, *bv), loc);
+                    }
+                    break;
+
+                default :
+                    if (peek() == '-' or (peek() >= '0' and peek() <= '9')) {
+                        return match_number(name);
+                    }
+                    break;
+            }
+
+            record_error("Expecting a value");
+            return false;
+        }
+
+        //##############   do_parse  #####################
+
+        bool do_parse() {
+            skip();
+
+            if (peek() != '{') {
+                record_error("Expecting an object");
+                return false;
+            }
+            consume(1);
+
+            parse_object_body();
+
+            if (stopped) {
+                return errors.empty();
+            }
+            if (not errors.empty()) {
+                return false;
+            }
+
+            skip();
+            if (! eoi()) {
+                record_error("Not at end of input!");
+                return false;
+            }
+
+            return true;
+        }
+    };
+
+    //
+    // parse_events(), but the input is JSON.
+    //
+    template<class Handler>
+    bool parse_json_events(std::string_view input, Handler &handler, std::ostream *errs = nullptr) {
+        JsonEventParser<Handler> parser{input, handler};
+        bool retval = parser.do_parse();
+        if (errs) *errs << parser.errors;
+        return retval;
+    }
+
+} // end namespace Configinator5000
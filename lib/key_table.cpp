@@ -0,0 +1,81 @@
+#include <key_table.hpp>
+
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+namespace Configinator5000 {
+
+    key_table::~key_table() = default;
+
+    void key_table::release() const {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    const key_entry *key_table::find(const hashed_key &key) const {
+        const index *idx = current_.load(std::memory_order_acquire);
+        if (not idx) return nullptr;
+
+        std::uint32_t h = key.hash;
+        std::string_view name = key.name;
+
+        for (std::size_t pos = h & idx->mask; ; pos = (pos + 1) & idx->mask) {
+            const key_entry *e = idx->slots[pos].load(std::memory_order_acquire);
+            if (not e) return nullptr;
+            if (e->hash == h and e->name() == name) return e;
+        }
+    }
+
+    const key_entry *key_table::intern(std::string_view name) {
+        // nearly always there already.
+        if (auto *e = find(name)) return e;
+
+        std::lock_guard<std::mutex> guard{lock_};
+
+        // someone else may have beaten us to it.
+        if (auto *e = find(name)) return e;
+
+        if (entries_.size() >= std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("too many keys");
+        }
+
+        void *mem = text_.allocate(sizeof(key_entry) + name.size(), alignof(key_entry));
+        auto *e = new (mem) key_entry{std::uint32_t(entries_.size()),
+            key_hash(name), std::uint32_t(name.size())};
+        if (not name.empty()) {
+            std::memcpy(reinterpret_cast<char *>(e + 1), name.data(), name.size());
+        }
+        entries_.push_back(e);
+
+        const index *idx = current_.load(std::memory_order_relaxed);
+        if (not idx or entries_.size() * 2 > idx->mask + 1) {
+            // readers carry on with the old one until this is published.
+            std::size_t capacity = idx ? (idx->mask + 1) * 2 : 64;
+            auto grown = std::make_unique<index>();
+            grown->mask = capacity - 1;
+            grown->slots = std::make_unique<std::atomic<const key_entry *>[]>(capacity);
+            for (std::size_t i = 0; i < capacity; ++i) {
+                grown->slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+            for (auto *old : entries_) add_to(*grown, old);
+
+            current_.store(grown.get(), std::memory_order_release);
+            indexes_.push_back(std::move(grown));
+        } else {
+            add_to(*idx, e);
+        }
+
+        count_.store(entries_.size(), std::memory_order_release);
+        return e;
+    }
+
+    void key_table::add_to(const index &idx, const key_entry *e) {
+        std::size_t pos = e->hash & idx.mask;
+        while (idx.slots[pos].load(std::memory_order_relaxed)) pos = (pos + 1) & idx.mask;
+        idx.slots[pos].store(e, std::memory_order_release);
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Interned group keys. A Config keeps one of these and the groups it
+// parses refer to their keys by number, so a key that shows up in a
+// thousand groups is only stored once, and looking up a key_handle is a
+// compare of numbers.
+//
+// Lookups don't take a lock, so any number of threads can read while
+// one (at a time) adds keys. Keys are never removed.
+
+namespace Configinator5000 {
+
+    //
+    // The hash used for group keys. Keys are short, so eight bytes at a
+    // time and a single mix at the end is plenty. The last (partial) word
+    // is read as overlapping loads rather than byte by byte; the length is
+    // in the seed, so the overlap doesn't make different keys the same.
+    //
+    // constexpr so paths written in the source can be hashed by the
+    // compiler. The loads are spelled out a byte at a time (little endian
+    // everywhere) for that; compilers turn them back into plain loads.
+    //
+    namespace detail {
+        constexpr std::uint64_t byte(const char *p, int i) {
+            return std::uint64_t(static_cast<unsigned char>(p[i]));
+        }
+
+        constexpr std::uint64_t load32_le(const char *p) {
+            return byte(p, 0) | byte(p, 1) << 8 | byte(p, 2) << 16 | byte(p, 3) << 24;
+        }
+
+        constexpr std::uint64_t load64_le(const char *p) {
+            return load32_le(p) | load32_le(p + 4) << 32;
+        }
+    }
+
+    constexpr std::uint32_t key_hash(std::string_view key) {
+        const char *p = key.data();
+        std::size_t n = key.size();
+
+        std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+        std::uint64_t tail = 0;
+
+        if (n > 8) {
+            const char *last = p + n - 8;
+            for (; p < last; p += 8) {
+                h = (h ^ detail::load64_le(p)) * 0xff51afd7ed558ccdULL;
+                h = (h << 31) | (h >> 33);
+            }
+            tail = detail::load64_le(last);
+        } else if (n >= 4) {
+            tail = (detail::load32_le(p) << 32) | detail::load32_le(p + n - 4);
+        } else if (n > 0) {
+            tail = detail::byte(p, 0) << 16 | detail::byte(p, int(n / 2)) << 8 |
+                detail::byte(p, int(n - 1));
+        }
+
+        h = (h ^ tail) * 0xff51afd7ed558ccdULL;
+
+        h ^= h >> 32;
+        h *= 0xd6e8feb86659fd93ULL;
+        h ^= h >> 32;
+        return std::uint32_t(h);
+    }
+
+    // A key and its key_hash(), worked out ahead of time.
+    struct hashed_key {
+        std::string_view name;
+        std::uint32_t hash;
+    };
+
+    struct key_entry {
+        std::uint32_t id;
+        std::uint32_t hash;
+        std::uint32_t size;
+
+        std::string_view name() const {
+            return std::string_view(reinterpret_cast<const char *>(this + 1), size);
+        }
+    };
+
+    class key_table {
+    public :
+        key_table() = default;
+        ~key_table();
+
+        key_table(const key_table &) = delete;
+        key_table &operator=(const key_table &) = delete;
+
+        // The entry for name, or null if it has never been interned.
+        const key_entry *find(std::string_view name) const {
+            return find(hashed_key{name, key_hash(name)});
+        }
+        const key_entry *find(const hashed_key &key) const;
+
+        // The entry for name, adding it if need be.
+        const key_entry *intern(std::string_view name);
+
+        std::size_t size() const { return count_.load(std::memory_order_acquire); }
+
+        // Groups that use the table hold a reference to it. The table is
+        // deleted when the last one is released.
+        void retain() const { refs_.fetch_add(1, std::memory_order_relaxed); }
+        void release() const;
+
+    private :
+        // open addressing, never more than half full.
+        struct index {
+            std::size_t mask;
+            std::unique_ptr<std::atomic<const key_entry *>[]> slots;
+        };
+
+        std::atomic<const index *> current_{nullptr};
+        std::atomic<std::size_t> count_{0};
+
+        // the owner's reference
+        mutable std::atomic<long> refs_{1};
+
+        // Everything below is only touched with lock_ held.
+        std::mutex lock_;
+
+        // Old indexes are kept until the table goes away since a reader
+        // may still be looking at one.
+        std::vector<std::unique_ptr<index>> indexes_;
+        std::vector<const key_entry *> entries_;
+        std::pmr::monotonic_buffer_resource text_;
+
+        void add_to(const index &idx, const key_entry *e);
+    };
+
+    //
+    // A key that has been interned ahead of time with Config::key().
+    // Good for as long as the Config is.
+    //
+    class key_handle {
+        friend class group_index;
+
+        const key_table *table_;
+        const key_entry *entry_;
+
+    public :
+        key_handle(const key_table *t, const key_entry *e) : table_{t}, entry_{e} {}
+
+        std::string_view name() const { return entry_->name(); }
+    };
+
+} // end namespace Configinator5000
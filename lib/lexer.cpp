@@ -0,0 +1,326 @@
+#include <lexer.hpp>
+#include <scan.hpp>
+
+#include <charconv>
+#include <system_error>
+
+namespace Configinator5000::lexer {
+
+    namespace {
+
+        // Locale independent versions of the <cctype> tests we need.
+        inline bool is_digit(char c) { return c >= '0' and c <= '9'; }
+
+        inline bool is_word(char c) {
+            return is_digit(c) or (c >= 'a' and c <= 'z') or
+                (c >= 'A' and c <= 'Z') or c == '_';
+        }
+
+        inline number make_error(const char *start, const char *p,
+                const char *end, const char *message) {
+            // take the rest of the word with us so the error covers all of it.
+            while (p < end and (is_word(*p) or *p == '.')) ++p;
+
+            number n;
+            n.type = number::kind::error;
+            n.length = std::size_t(p - start);
+            n.message = message;
+            return n;
+        }
+
+        inline int hex_value(char c) {
+            if (is_digit(c)) return c - '0';
+            if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' and c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // libconfig allows L and LL on integers to mark them as 64 bit.
+        // We only have the one integer type, so just step over it.
+        inline const char *skip_long_suffix(const char *p, const char *end) {
+            if (p < end and *p == 'L') {
+                ++p;
+                if (p < end and *p == 'L') ++p;
+            }
+            return p;
+        }
+    }
+
+    number scan_number(const char *p, const char *end) {
+        number n;
+
+        auto at = [end](const char *q) { return (q < end) ? *q : '\0'; };
+
+        //
+        // Hex - can't be anything else so commit.
+        //
+        if (at(p) == '0' and (at(p + 1) == 'x' or at(p + 1) == 'X')) {
+            const char *digits = p + 2;
+
+            // Parse as unsigned so that bit masks like 0xFFFFFFFFFFFFFFFF
+            // keep their bit pattern.
+            unsigned long value = 0;
+            auto [ ptr, ec ] = std::from_chars(digits, end, value, 16);
+
+            if (ptr == digits) {
+                return make_error(p, digits, end, "Hex prefix, but invalid hex number followed");
+            }
+            if (ec == std::errc::result_out_of_range) {
+                return make_error(p, ptr, end, "Hex value out of range");
+            }
+
+            ptr = skip_long_suffix(ptr, end);
+            if (ptr < end and (is_word(*ptr) or *ptr == '.')) {
+                return make_error(p, ptr, end, "Hex prefix, but invalid hex number followed");
+            }
+
+            n.type = number::kind::integer;
+            n.integer = static_cast<long>(value);
+            n.length = std::size_t(ptr - p);
+            return n;
+        }
+
+        //
+        // Decimal integer or float. Work out which (and where it ends)
+        // before converting anything.
+        //
+        const char *q = p;
+        if (at(q) == '+' or at(q) == '-') ++q;
+
+        const char *int_start = q;
+        while (q < end and is_digit(*q)) ++q;
+        bool has_int_digits = (q != int_start);
+
+        bool is_float = false;
+        if (at(q) == '.') {
+            const char *frac_start = q + 1;
+            const char *f = frac_start;
+            while (f < end and is_digit(*f)) ++f;
+
+            if (not has_int_digits and f == frac_start) {
+                // just a lone "." (or "+.")
+                return n;
+            }
+            is_float = true;
+            q = f;
+        } else if (not has_int_digits) {
+            return n;
+        }
+
+        bool negative_exponent = false;
+        if (at(q) == 'e' or at(q) == 'E') {
+            const char *e = q + 1;
+            if (at(e) == '+' or at(e) == '-') {
+                negative_exponent = (*e == '-');
+                ++e;
+            }
+
+            const char *exp_start = e;
+            while (e < end and is_digit(*e)) ++e;
+            if (e == exp_start) {
+                return make_error(p, e, end, "Malformed exponent in number");
+            }
+
+            is_float = true;
+            q = e;
+        }
+
+        const char *num_end = q;
+        if (not is_float) q = skip_long_suffix(q, end);
+
+        // must be at a word boundary.
+        if (q < end and (is_word(*q) or *q == '.')) {
+            return make_error(p, q, end, "Malformed number");
+        }
+
+        // from_chars doesn't want a leading '+'
+        const char *conv = (*p == '+') ? p + 1 : p;
+
+        if (is_float) {
+            double value = 0.0;
+            auto [ ptr, ec ] = std::from_chars(conv, num_end, value);
+
+            if (ec == std::errc::result_out_of_range) {
+                if (not negative_exponent) {
+                    return make_error(p, q, end, "Float value out of range");
+                }
+                // underflow is just a (very) small number
+                value = (*p == '-') ? -0.0 : 0.0;
+            } else if (ec != std::errc() or ptr != num_end) {
+                return make_error(p, q, end, "Malformed number");
+            }
+
+            n.type = number::kind::floating;
+            n.floating = value;
+        } else {
+            long value = 0;
+            auto [ ptr, ec ] = std::from_chars(conv, num_end, value);
+
+            if (ec == std::errc::result_out_of_range) {
+                return make_error(p, q, end, "Integer value out of range");
+            } else if (ec != std::errc() or ptr != num_end) {
+                return make_error(p, q, end, "Malformed number");
+            }
+
+            n.type = number::kind::integer;
+            n.integer = value;
+        }
+
+        n.length = std::size_t(q - p);
+        return n;
+    }
+
+    string_literal scan_string(const char *p, const char *end, std::string &out) {
+        // opening quote
+        auto retval = scan_string_body(p + 1, end, out);
+        retval.length += 1;
+        return retval;
+    }
+
+    string_literal scan_string_body(const char *p, const char *end, std::string &out) {
+        string_literal retval;
+
+        const char *start = p;
+
+        while (true) {
+            const char *special = scan::find_string_special(p, end);
+
+            // everything up to here is plain text.
+            if (special != p) out.append(p, std::size_t(special - p));
+            p = special;
+
+            if (p == end or *p == '\n') {
+                retval.message = "Unterminated string";
+                retval.truncated = (p == end);
+                break;
+            }
+
+            if (*p == '"') {
+                retval.ok = true;
+                ++p;
+                break;
+            }
+
+            // escape
+            if (p + 1 == end) {
+                retval.message = "Unterminated string";
+                retval.truncated = true;
+                break;
+            }
+
+            switch (p[1]) {
+                case 'f' : out += '\f'; p += 2; continue;
+                case 'n' : out += '\n'; p += 2; continue;
+                case 'r' : out += '\r'; p += 2; continue;
+                case 't' : out += '\t'; p += 2; continue;
+                case '"' : out += '"'; p += 2; continue;
+                case '\\' : out += '\\'; p += 2; continue;
+                case 'x' : {
+                    if (p + 3 >= end) {
+                        retval.message = "Bad hex escape in string";
+                        retval.truncated = true;
+                        break;
+                    }
+                    int hi = hex_value(p[2]);
+                    int lo = hex_value(p[3]);
+                    if (hi < 0 or lo < 0) {
+                        retval.message = "Bad hex escape in string";
+                        break;
+                    }
+                    out += char(hi * 16 + lo);
+                    p += 4;
+                    continue;
+                }
+                default :
+                    retval.message = "Unrecognized escape sequence in string";
+                    break;
+            }
+            break;
+        }
+
+        retval.length = std::size_t(p - start);
+        return retval;
+    }
+
+    composite_extent skip_composite(const char *p, const char *end) {
+        composite_extent retval;
+
+        const char *start = p;
+
+        // closers we are waiting for. Only allocates past 15 levels.
+        std::string expected;
+
+        auto close_error = [](char closer) {
+            switch (closer) {
+                case '}' : return "Didn't find close of setting group";
+                case ')' : return "Didn't find close of setting list";
+                default :  return "Didn't find close of value array";
+            }
+        };
+
+        while (true) {
+            p = scan::find_structural(p, end, retval.lines);
+            if (p == end) {
+                retval.message = close_error(expected.empty() ? '}' : expected.front());
+                break;
+            }
+
+            char c = *p;
+            if (c == '{' or c == '(' or c == '[') {
+                expected += (c == '{') ? '}' : (c == '(') ? ')' : ']';
+                ++p;
+
+            } else if (c == '}' or c == ')' or c == ']') {
+                if (expected.empty() or expected.back() != c) {
+                    retval.message = expected.empty() ? "Unexpected close bracket" :
+                        close_error(expected.back());
+                    break;
+                }
+                expected.pop_back();
+                ++p;
+                if (expected.empty()) {
+                    retval.ok = true;
+                    break;
+                }
+
+            } else if (c == '"') {
+                ++p;
+                while (true) {
+                    p = scan::find_string_special(p, end);
+                    if (p == end or *p == '\n') {
+                        retval.message = "Unterminated string";
+                        break;
+                    }
+                    if (*p == '"') {
+                        ++p;
+                        break;
+                    }
+                    // escape - step over both characters
+                    p += (p + 1 < end) ? 2 : 1;
+                }
+                if (retval.message) break;
+
+            } else if (c == '#' or (c == '/' and p + 1 < end and p[1] == '/')) {
+                // leave the newline so find_structural counts it.
+                p = scan::find_newline(p + 1, end);
+
+            } else if (c == '/' and p + 1 < end and p[1] == '*') {
+                const char *close = scan::find_block_end(p + 2, end, retval.lines);
+                if (close == end) {
+                    retval.message = "Unterminated comment starting here";
+                    p = end;
+                    break;
+                }
+                p = close + 2;
+
+            } else {
+                // a '/' all by itself
+                ++p;
+            }
+        }
+
+        retval.length = std::size_t(p - start);
+        return retval;
+    }
+
+} // end namespace Configinator5000::lexer
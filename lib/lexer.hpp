@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Token level scanners shared by the parsers. These work on raw [p, end)
+// ranges and never throw. They don't allocate, apart from appending to a
+// caller supplied string and tracking very deeply nested brackets.
+
+namespace Configinator5000::lexer {
+
+    //
+    // Result of scanning a numeric literal.
+    //
+    struct number {
+        enum class kind { none, integer, floating, error };
+
+        kind type = kind::none;
+
+        long integer = 0;
+        double floating = 0.0;
+
+        // how many bytes the literal used (including any error).
+        std::size_t length = 0;
+
+        // set when type == kind::error
+        const char *message = nullptr;
+
+        bool is_integer() const { return type == kind::integer; }
+        bool is_floating() const { return type == kind::floating; }
+        bool is_error() const { return type == kind::error; }
+        bool found() const { return type != kind::none; }
+    };
+
+    //
+    // Scan a numeric literal (decimal integer, hex integer or float) in a
+    // single pass. Returns kind::none if p doesn't start a number at all, so
+    // the caller can go on to try something else. Anything that starts
+    // like a number but isn't a valid one (overflow, junk right after the
+    // digits, a dangling exponent) is kind::error.
+    //
+    number scan_number(const char *p, const char *end);
+
+    //
+    // Result of scanning one quoted string literal.
+    //
+    struct string_literal {
+        bool ok = false;
+
+        // bytes used, including both quotes. On error, how far we got.
+        std::size_t length = 0;
+
+        // set when not ok
+        const char *message = nullptr;
+
+        // not ok only because the input ran out (possibly in the middle of
+        // an escape). Everything before `length` has been decoded, so a
+        // caller with more input on the way can pick up from there with
+        // scan_string_body.
+        bool truncated = false;
+    };
+
+    //
+    // Scan the quoted string literal starting at p (which must point at
+    // the opening '"') and append its decoded contents to `out`. Runs of
+    // plain characters are found in bulk and appended in one go, so a
+    // literal without escapes costs exactly one append.
+    //
+    // Only handles a single literal. Joining adjacent literals is up to
+    // the caller since it needs to skip comments between them.
+    //
+    string_literal scan_string(const char *p, const char *end, std::string &out);
+
+    //
+    // Same as scan_string, but p points somewhere after the opening quote.
+    // The length doesn't include an opening quote.
+    //
+    string_literal scan_string_body(const char *p, const char *end, std::string &out);
+
+    //
+    // Result of stepping over a whole group, list or array.
+    //
+    struct composite_extent {
+        bool ok = false;
+
+        // bytes used, including both brackets. On error, how far we got.
+        std::size_t length = 0;
+
+        // newlines inside
+        long lines = 0;
+
+        // set when not ok
+        const char *message = nullptr;
+    };
+
+    //
+    // Find the end of the group, list or array whose opening bracket is at
+    // p, without parsing what's inside. Strings and comments are stepped
+    // over so brackets inside them don't count. Only the brackets are
+    // checked - anything else wrong inside is left for a real parse to find.
+    //
+    composite_extent skip_composite(const char *p, const char *end);
+
+} // end namespace Configinator5000::lexer
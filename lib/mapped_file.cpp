@@ -0,0 +1,105 @@
+#include <mapped_file.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define C5K_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Configinator5000 {
+
+    mapped_file::mapped_file(const std::string &file_name, bool sequential) {
+#ifdef C5K_HAVE_MMAP
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 and S_ISREG(st.st_mode)) {
+            open_ = true;
+            size_ = std::size_t(st.st_size);
+
+            if (size_ == 0) {
+                // mmap refuses zero length mappings.
+                ::close(fd);
+                return;
+            }
+
+            void *addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                ::close(fd);
+                data_ = static_cast<const char *>(addr);
+                mapped_ = true;
+
+                if (sequential and size_ >= sequential_hint_size) {
+                    // We read front to back exactly once. Let the kernel read
+                    // ahead aggressively and drop pages behind us.
+                    ::madvise(addr, size_, MADV_SEQUENTIAL);
+                }
+                return;
+            }
+
+            // fall through to the buffered read.
+            open_ = false;
+            size_ = 0;
+        }
+
+        ::close(fd);
+#endif
+        std::ifstream strm{file_name, std::ios::binary};
+        if (not strm) return;
+
+        buffer_.assign(std::istreambuf_iterator<char>(strm),
+                std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        open_ = true;
+    }
+
+    mapped_file::mapped_file(mapped_file &&o) noexcept {
+        *this = std::move(o);
+    }
+
+    mapped_file &mapped_file::operator=(mapped_file &&o) noexcept {
+        if (this == &o) return *this;
+
+        release();
+
+        mapped_ = o.mapped_;
+        open_ = o.open_;
+        size_ = o.size_;
+
+        if (mapped_) {
+            data_ = o.data_;
+        } else {
+            buffer_ = std::move(o.buffer_);
+            data_ = buffer_.data();
+        }
+
+        o.data_ = nullptr;
+        o.size_ = 0;
+        o.mapped_ = false;
+        o.open_ = false;
+
+        return *this;
+    }
+
+    void mapped_file::release() {
+#ifdef C5K_HAVE_MMAP
+        if (mapped_) {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+#endif
+        buffer_.clear();
+        data_ = nullptr;
+        size_ = 0;
+        mapped_ = false;
+        open_ = false;
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace Configinator5000 {
+
+    // Read-only view of the entire contents of a file.
+    //
+    // Regular files are mmap'ed so the parser can work directly on the page
+    // cache with no intermediate copies. Anything that can't be mapped (pipes,
+    // character devices, platforms without mmap) is read into an owned buffer
+    // instead, so callers never need to care which one they got.
+    //
+    // The contents are only valid as long as the mapped_file lives.
+    class mapped_file {
+        const char *data_ = nullptr;
+        std::size_t size_ = 0;
+        bool mapped_ = false;
+        bool open_ = false;
+
+        // used when the file could not be mapped.
+        std::string buffer_;
+
+        void release();
+
+    public :
+        // Files at least this big get sequential read-ahead hints (unless
+        // they are going to be read here and there, rather than front to
+        // back).
+        static constexpr std::size_t sequential_hint_size = 1024 * 1024;
+
+        mapped_file() = default;
+        explicit mapped_file(const std::string &file_name, bool sequential = true);
+
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        mapped_file(mapped_file &&o) noexcept;
+        mapped_file &operator=(mapped_file &&o) noexcept;
+
+        ~mapped_file() { release(); }
+
+        bool is_open() const { return open_; }
+        bool is_mapped() const { return mapped_; }
+
+        std::size_t size() const { return size_; }
+        const char *data() const { return data_; }
+
+        std::string_view view() const { return std::string_view(data_, size_); }
+    };
+
+} // end namespace Configinator5000
@@ -0,0 +1,1041 @@
+#pragma once
+
+// Grammar is here : https://hyperrealm.github.io/libconfig/libconfig_manual.html#Configuration-File-Grammar
+//
+// The recursive descent parser.
+//
+// EventParser reports what it finds to a handler through callbacks
+// (begin_group, on_integer, ...) rather than building anything itself.
+// The handler is a template parameter so the callbacks can be inlined.
+// Config's Parser is just an EventParser feeding a TreeBuilder.
+
+#include <configinator5000.hpp>
+#include <scan.hpp>
+#include <lexer.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ostream>
+
+
+namespace Configinator5000 {
+
+    using ST = Setting::setting_type;
+
+    struct parse_loc {
+        std::string_view sv;
+        // 64 bit so that inputs over 2GB work.
+        std::uint64_t offset = 0;
+        long line = 0;
+    };
+
+    struct error_info {
+        std::string message;
+        parse_loc loc;
+
+        error_info() = default;
+        error_info(const std::string &mesg, const parse_loc &l) :
+            message{mesg}, loc{l} {}
+
+        friend std::ostream & operator<<(std::ostream &strm, const error_info& ei) {
+            strm << "line " << ei.loc.line << " : " << ei.message << "\n";
+            return strm;
+        }
+    };
+
+    struct error_list {
+        std::string_view src;
+        std::list<error_info> errors;
+
+        int count() const {
+            return static_cast<int>(errors.size());
+        }
+
+        bool empty() const { return errors.empty(); }
+
+        void add(const std::string &mesg, const parse_loc &l) {
+            errors.emplace_back(mesg, l);
+        }
+
+        friend std::ostream & operator<<(std::ostream &strm, const error_list & el){
+            for (auto &e : el.errors) {
+                strm << e;
+            }
+            return strm;
+        }
+    };
+
+    /***************************************************************
+     * Event interface
+     ***************************************************************/
+
+    // What a handler wants the parser to do after a callback.
+    enum class event_action {
+        proceed,
+        // only meaningful from begin_*() : step over the contents without
+        // any events. The matching end_*() isn't called either.
+        skip,
+        // stop parsing right away.
+        stop
+    };
+
+    //
+    // Base for event handlers. Supplies do nothing versions of every
+    // callback so a handler only needs the ones it cares about. A handler
+    // doesn't have to derive from this, but then it has to supply all of
+    // them (including failure()).
+    //
+    // `name` is the key for members of a group and empty for elements of
+    // lists and arrays. String views are only valid during the callback.
+    //
+    // The root of the document is an implicit group - there is no
+    // begin_group()/end_group() for it.
+    //
+    class event_handler {
+        std::string failure_;
+
+    public :
+        event_action begin_group(std::string_view) { return event_action::proceed; }
+        event_action end_group() { return event_action::proceed; }
+
+        event_action begin_list(std::string_view) { return event_action::proceed; }
+        event_action end_list() { return event_action::proceed; }
+
+        event_action begin_array(std::string_view) { return event_action::proceed; }
+        event_action end_array() { return event_action::proceed; }
+
+        event_action on_bool(std::string_view, bool) { return event_action::proceed; }
+        event_action on_integer(std::string_view, long) { return event_action::proceed; }
+        event_action on_float(std::string_view, double) { return event_action::proceed; }
+        event_action on_string(std::string_view, std::string_view) { return event_action::proceed; }
+
+        // Called after a skip with the text that was stepped over (brackets
+        // included) and where it started.
+        void skipped(std::string_view, const parse_loc &) {}
+
+        // Return this from a callback to make the parse fail with `msg` as
+        // the error. Returning a plain event_action::stop ends the parse
+        // without an error.
+        event_action fail(std::string msg) {
+            failure_ = std::move(msg);
+            return event_action::stop;
+        }
+
+        const std::string &failure() const { return failure_; }
+    };
+
+    /***************************************************************
+     * Includes
+     ***************************************************************/
+
+    // A file as it was when it was read, to tell if it has changed since.
+    struct file_stamp {
+        std::string path;
+        std::int64_t mtime = 0;
+        std::uint64_t size = 0;
+
+        bool operator==(const file_stamp &o) const {
+            return mtime == o.mtime and size == o.size and path == o.path;
+        }
+    };
+
+    // A file brought in by @include, parsed, with its own includes in it.
+    // Nothing changes it once it is loaded, so any number of parsers (on
+    // any number of threads) can share it.
+    struct included_file {
+        Setting settings{ST::GROUP};
+
+        // Why it couldn't be loaded (the whole error message), or empty.
+        std::string error;
+
+        // It and everything it includes, as they were when it was read.
+        std::vector<file_stamp> depends;
+    };
+
+    // What each @include in a file brings in, by the name it was given.
+    using include_map = std::unordered_map<std::string, std::shared_ptr<included_file>>;
+
+    template<class Handler>
+    struct EventParser {
+
+        std::string_view src;
+
+        Handler &handler;
+
+        parse_loc current_loc;
+
+        error_list errors;
+
+        // set when the handler asked us to stop.
+        bool stopped = false;
+
+        // decoded strings that couldn't be handed out as a view of src.
+        std::string string_buf;
+
+        // The files the @include directives in src name, loaded ahead of
+        // time (include.hpp). Without them, @include is an error.
+        const include_map *includes = nullptr;
+
+        EventParser(std::string_view _src, Handler &h) : src{_src}, handler{h},
+            current_loc{_src, 0, 0} {}
+
+        // Start somewhere other than the top of the input. Used when
+        // parsing a piece of a larger document.
+        EventParser(std::string_view _src, Handler &h, std::uint64_t offset, long line) :
+            src{_src}, handler{h}, current_loc{_src, offset, line} {}
+
+        /***********************************************************
+         * Error utilities
+         ***********************************************************/
+
+        void record_error(const std::string &msg, const parse_loc &l) {
+            errors.add(msg, l);
+        }
+
+        void record_error(const std::string & msg) {
+            record_error(msg, current_loc);
+        }
+
+        /***********************************************************
+         * Input utilities
+         ***********************************************************/
+
+        inline void consume(std::size_t count) {
+            // note : others are responsible for line number
+            current_loc.offset += count;
+            current_loc.sv.remove_prefix(count);
+        }
+
+        inline bool eoi() { return current_loc.sv.size() == 0; }
+
+        inline char peek() { if (!eoi()) { return current_loc.sv[0]; }
+            else { return '\x00'; } }
+
+        inline char peek(int pos) { return current_loc.sv[pos]; }
+
+        inline bool valid_pos(int pos) {
+            return (pos >= 0 and (unsigned)pos < current_loc.sv.size()); 
+        }
+
+
+        inline bool check_string(std::string_view o) {
+            return current_loc.sv.compare(0, o.size(), o) == 0;
+        }
+        
+        inline bool match_string(std::string_view o) {
+            bool matched = check_string(o);
+            if (matched) consume(o.size());
+            return matched;
+        }
+
+        /****************************************************************
+        * SKIP Processing
+        ****************************************************************/
+        bool skip() {
+
+            //
+            // we'll be using this a lot.
+            // So abbreviate it with a reference.
+            //
+            auto &cl = current_loc;
+
+            const char *start = cl.sv.data();
+            const char *end = start + cl.sv.size();
+            const char *p = start;
+
+            long line_count = 0;
+
+            while (true) {
+                p = scan::skip_blanks(p, end, line_count);
+                if (p == end) break;
+
+                bool two = (p + 1 < end);
+
+                if (*p == '#' or (two and p[0] == '/' and p[1] == '/')) {
+                    // Line comment. Leave the newline for skip_blanks
+                    // so it gets counted. A comment at the very end of the
+                    // input doesn't need one.
+                    p = scan::find_newline(p + 1, end);
+
+                } else if (two and p[0] == '/' and p[1] == '*') {
+                    //
+                    // When we enter a comment, we'll record where it started.
+                    // If we don't find the terminator, we can use this
+                    // location to put out an error message.
+                    //
+                    parse_loc comment_loc{cl.sv.substr(p - start),
+                        cl.offset + std::uint64_t(p - start), cl.line + line_count};
+
+                    p = scan::find_block_end(p + 2, end, line_count);
+                    if (p == end) {
+                        consume(std::size_t(end - start));
+                        record_error("Unterminated comment starting here", comment_loc);
+                        return false;
+                    }
+                    p += 2;
+
+                } else {
+                    break;
+                }
+            }
+
+            consume(std::size_t(p - start));
+            current_loc.line += line_count;
+
+            return true;
+        };
+
+        bool match_char(int pos, char c) {
+            return (valid_pos(pos) and peek(pos) == c);
+        }
+
+        bool match_char(char c) {
+            return peek() == c;
+        }
+
+        bool match_chars(int pos, const char * c) {
+            if (!valid_pos(pos)) return false;
+            char t  = peek(pos);
+
+            while (*c) {
+                if (*c == t) return true;
+                ++c;
+            }
+
+            return false;
+        }
+
+        //##############   match_bool_value  #################
+
+        std::optional<bool> match_bool_value() {
+            // if there aren't enough chars then short circuit
+            if (!valid_pos(3)) {
+                return std::nullopt;
+            }
+
+            int pos = 0;
+            if (match_chars(pos, "Ff")) {
+                pos += 1;
+                if (! match_chars(pos, "Aa")) return std::nullopt;
+                pos += 1;
+                if (! match_chars(pos, "Ll")) return std::nullopt;
+                pos += 1;
+                if (! match_chars(pos, "Ss")) return std::nullopt;
+                pos += 1;
+                if (! match_chars(pos, "Ee")) return std::nullopt;
+                pos += 1;
+                // must be at end of word
+                if (valid_pos(pos) and std::isalnum(peek(pos))) return std::nullopt;
+
+                consume(pos);
+                return false;
+
+            } else if (match_chars(pos, "Tt")) {
+                pos += 1;
+                if (! match_chars(pos, "Rr")) return std::nullopt;
+                pos += 1;
+                if (! match_chars(pos, "Uu")) return std::nullopt;
+                pos += 1;
+                if (! match_chars(pos, "Ee")) return std::nullopt;
+                pos += 1;
+                // must be at end of word
+                if (valid_pos(pos) and std::isalnum(peek(pos))) return std::nullopt;
+
+                consume(pos);
+                return true;
+            }
+
+            return std::nullopt;
+
+        }
+
+        //##############   match_number_value  #################
+        // Integers (base 10 and hex) and floats in one pass. Doesn't consume
+        // anything - the caller decides if the kind of number is acceptable.
+        lexer::number scan_number_value() {
+            return lexer::scan_number(current_loc.sv.data(),
+                    current_loc.sv.data() + current_loc.sv.size());
+        }
+
+        //##############   match_string_value  ###############
+        // The view is either into src or string_buf, so it is only good
+        // until the next string is matched.
+
+        std::optional<std::string_view> match_string_value() {
+            if (!match_char('"')) return std::nullopt;
+
+            const char *start = current_loc.sv.data();
+            const char *end = start + current_loc.sv.size();
+
+            // Fast path - no escapes and nothing joined on, so the value is
+            // just a piece of the source.
+            const char *special = scan::find_string_special(start + 1, end);
+            if (special < end and *special == '"') {
+                std::string_view text(start + 1, std::size_t(special - start - 1));
+                consume(std::size_t(special + 1 - start));
+                skip();
+                if (not match_char('"')) return text;
+
+                string_buf.assign(text);
+            } else {
+                string_buf.clear();
+            }
+
+            while (true) {
+                auto lit = lexer::scan_string(current_loc.sv.data(),
+                        current_loc.sv.data() + current_loc.sv.size(), string_buf);
+                consume(lit.length);
+
+                if (not lit.ok) {
+                    record_error(lit.message);
+                    return std::nullopt;
+                }
+
+                // adjacent literals are joined together
+                skip();
+                if (not match_char('"')) break;
+            }
+
+            return std::string_view(string_buf);
+
+        }
+
+        //##############   handler results  ###############
+        // false if we need to stop.
+
+        bool handled(event_action action, const parse_loc &loc) {
+            if (action != event_action::stop) return true;
+
+            stopped = true;
+            if (not handler.failure().empty()) {
+                record_error(handler.failure(), loc);
+            }
+            return false;
+        }
+
+        //##############   match_scalar_value  ###############
+
+        bool match_scalar_value(std::string_view name) {
+
+            auto loc = current_loc;
+
+            auto bv = match_bool_value();
+            if (bv) {
+                return handled(handler.on_bool(name, *bv), loc);
+            }
+
+            auto nv = scan_number_value();
+            if (nv.is_integer()) {
+                consume(nv.length);
+                return handled(handler.on_integer(name, nv.integer), loc);
+            } else if (nv.is_floating()) {
+                consume(nv.length);
+                return handled(handler.on_float(name, nv.floating), loc);
+            } else if (nv.is_error()) {
+                record_error(nv.message);
+                return false;
+            }
+
+            auto sv = match_string_value();
+            if (sv) {
+                return handled(handler.on_string(name, *sv), loc);
+            }
+
+
+            return false;
+        }
+
+        //##############   match_name #######################
+
+        std::optional<std::string_view> match_name() {
+
+            int pos = 0;
+            if (valid_pos(pos) and (peek(pos) == '*' or std::isalpha(peek(pos)))) {
+                pos += 1;
+            } else {
+                return std::nullopt;
+            }
+
+            while (valid_pos(pos)) {
+                if ( peek(pos) == '*' or peek(pos) == '_' or
+                        std::isalnum(peek(pos))) {
+                    pos += 1;
+                } else break;
+            }
+
+
+            auto retval = current_loc.sv.substr(0, pos);
+            consume(pos);
+
+            return retval;
+        }
+
+        //##############   skip_composite ##################
+        // The handler doesn't want this group/list/array. Step over it
+        // without looking inside.
+        bool skip_composite() {
+            auto extent = lexer::skip_composite(current_loc.sv.data(),
+                    current_loc.sv.data() + current_loc.sv.size());
+
+            auto start = current_loc;
+            consume(extent.length);
+            current_loc.line += extent.lines;
+
+            if (not extent.ok) {
+                record_error(extent.message, start);
+                return false;
+            }
+
+            handler.skipped(start.sv.substr(0, extent.length), start);
+            return true;
+        }
+
+        //##############   parse_list     ##############
+        bool parse_list() {
+            skip();
+            while(1) {
+                if (peek() == ')') {
+                    return true;
+                }
+                if (!parse_setting_value(std::string_view{})) {
+                    return false;
+                }
+                skip();
+                if (match_chars(0, ";,")) {
+                    consume(1);
+                    skip();
+                }
+            }
+
+            // Never should get here. At some point parse_setting_value()
+            // will fail and we'll exit inside the loop
+            return false;
+        }
+
+        //##############   parse_array    ##############
+
+        // Is there a scalar of any kind next? Used to tell a badly typed
+        // array element from the end of the array.
+        bool scalar_follows() {
+            if (match_char('"')) return true;
+            if (scan_number_value().found()) return true;
+
+            auto save = current_loc;
+            bool retval = match_bool_value().has_value();
+            current_loc = save;
+
+            return retval;
+        }
+
+        bool parse_array() {
+
+            // For the first one, it can be anything
+            ST array_type;
+            auto loc = current_loc;
+
+            if (auto bv = match_bool_value()) {
+                array_type = ST::BOOL;
+                if (not handled(handler.on_bool({}, *bv), loc)) return false;
+            } else if (auto nv = scan_number_value(); nv.found()) {
+                if (nv.is_error()) {
+                    record_error(nv.message);
+                    return false;
+                }
+                consume(nv.length);
+                if (nv.is_integer()) {
+                    array_type = ST::INTEGER;
+                    if (not handled(handler.on_integer({}, nv.integer), loc)) return false;
+                } else {
+                    array_type = ST::FLOAT;
+                    if (not handled(handler.on_float({}, nv.floating), loc)) return false;
+                }
+            } else if (auto sv = match_string_value()) {
+                array_type = ST::STRING;
+                if (not handled(handler.on_string({}, *sv), loc)) return false;
+            } else {
+                // empty
+                return true;
+            }
+
+
+            while (1) {
+                skip();
+                if (match_chars(0, ";,")) {
+                    consume(1);
+                    skip();
+                }
+
+                loc = current_loc;
+
+                if (array_type == ST::BOOL) {
+                    auto bv = match_bool_value();
+                    if (bv) {
+                        if (not handled(handler.on_bool({}, *bv), loc)) return false;
+                    } else {
+                        break;
+                    }
+
+                } else if (array_type == ST::INTEGER or array_type == ST::FLOAT) {
+                    auto nv = scan_number_value();
+                    if (nv.is_error()) {
+                        record_error(nv.message);
+                        return false;
+                    } else if (nv.is_integer()) {
+                        consume(nv.length);
+                        bool ok;
+                        if (array_type == ST::INTEGER) {
+                            ok = handled(handler.on_integer({}, nv.integer), loc);
+                        } else {
+                            // integers are fine in a float array.
+                            ok = handled(handler.on_float({}, double(nv.integer)), loc);
+                        }
+                        if (not ok) return false;
+                    } else if (nv.is_floating() and array_type == ST::FLOAT) {
+                        consume(nv.length);
+                        if (not handled(handler.on_float({}, nv.floating), loc)) return false;
+                    } else {
+                        break;
+                    }
+
+                } else {
+
+                    auto sv = match_string_value();
+                    if (sv) {
+                        if (not handled(handler.on_string({}, *sv), loc)) return false;
+                    } else {
+                        break;
+                    }
+                }
+            }
+
+            if (scalar_follows()) {
+                record_error("All values in an array must be the same scalar type");
+                return false;
+            }
+
+            return true;
+
+        }
+
+        //##############   parse_composite_body ##############
+        // Everything from the opening bracket to the closing one. The
+        // begin_*() event has already been sent.
+
+        bool parse_composite_body() {
+            char closer;
+            const char *close_error;
+
+            switch (peek()) {
+                case '{' :
+                    closer = '}';
+                    close_error = "Didn't find close of setting group";
+                    break;
+                case '(' :
+                    closer = ')';
+                    close_error = "Didn't find close of setting list";
+                    break;
+                default :
+                    closer = ']';
+                    close_error = "Didn't find close of value array";
+                    break;
+            }
+
+            consume(1);
+            skip();
+            if (closer == '}') {
+                parse_group();
+            } else if (closer == ')') {
+                parse_list();
+            } else {
+                parse_array();
+            }
+            if (stopped) return false;
+            skip();
+            if (peek() != closer) {
+                record_error(close_error);
+                return false;
+            }
+            consume(1);
+            return true;
+        }
+
+        //##############   parse_setting_value ##############
+
+        bool parse_setting_value(std::string_view name, bool record_failure=true) {
+            auto loc = current_loc;
+
+            if (peek() == '{') {
+                auto action = handler.begin_group(name);
+                if (action == event_action::skip) return skip_composite();
+                if (not handled(action, loc)) return false;
+                if (not parse_composite_body()) return false;
+                return handled(handler.end_group(), loc);
+
+            } else if (peek() == '(') {
+                auto action = handler.begin_list(name);
+                if (action == event_action::skip) return skip_composite();
+                if (not handled(action, loc)) return false;
+                if (not parse_composite_body()) return false;
+                return handled(handler.end_list(), loc);
+
+            } else if (peek() == '[') {
+                auto action = handler.begin_array(name);
+                if (action == event_action::skip) return skip_composite();
+                if (not handled(action, loc)) return false;
+                if (not parse_composite_body()) return false;
+                return handled(handler.end_array(), loc);
+
+            } else {
+                auto error_count = errors.count();
+                if (! match_scalar_value(name)) {
+                    // don't pile on if the scalar already said what was wrong.
+                    if (record_failure and not stopped and error_count == errors.count()) {
+                        record_error("Expecting a value");
+                    }
+                    return false;
+                }
+            }
+
+            return true;
+        }
+        //##############   setting ##########################
+
+        bool parse_setting() {
+
+            auto name = match_name();
+            if ( ! name ) {
+                return false;
+            }
+
+            skip();
+
+            if (not match_chars(0, ":=")) {
+                record_error("Expecting : or = after setting name");
+                return false;
+            }
+            consume(1);
+
+            skip();
+
+            return parse_setting_value(*name);
+            
+        }
+
+        //##############   parse_include ###################
+        // @include "file" where a setting could go. The settings in the
+        // file are sent as if they were here, from the tree loaded for it
+        // rather than its text, all with the line of the @include. A file
+        // that couldn't be loaded is an error, but the parse goes on.
+
+        bool replay_value(std::string_view name, Setting &s, const parse_loc &loc) {
+            if (s.is_integer()) return handled(handler.on_integer(name, s.get<long>()), loc);
+            if (s.is_float()) return handled(handler.on_float(name, s.get<double>()), loc);
+            if (s.is_boolean()) return handled(handler.on_bool(name, s.get<bool>()), loc);
+            if (s.is_string()) {
+                return handled(handler.on_string(name, s.get<std::string_view>()), loc);
+            }
+
+            event_action action = s.is_group() ? handler.begin_group(name) :
+                s.is_list() ? handler.begin_list(name) : handler.begin_array(name);
+            if (action == event_action::skip) {
+                // there is no text to give it.
+                handler.skipped(std::string_view{}, loc);
+                return true;
+            }
+            if (not handled(action, loc)) return false;
+
+            for (int i = 0; i < s.count(); ++i) {
+                std::string_view child = s.is_group() ? s.name_at(i) : std::string_view{};
+                if (not replay_value(child, s.at(i), loc)) return false;
+            }
+
+            action = s.is_group() ? handler.end_group() :
+                s.is_list() ? handler.end_list() : handler.end_array();
+            return handled(action, loc);
+        }
+
+        bool parse_include() {
+            auto loc = current_loc;
+
+            bool word_ends = not (valid_pos(8) and (std::isalnum(peek(8)) or peek(8) == '_'));
+            if (not check_string("@include") or not word_ends) {
+                record_error("Expecting @include");
+                return false;
+            }
+            consume(8);
+            skip();
+
+            auto error_count = errors.count();
+            auto file_name = match_string_value();
+            if (not file_name) {
+                if (error_count == errors.count()) {
+                    record_error("Expecting a file name after @include");
+                }
+                return false;
+            }
+
+            if (not includes) {
+                record_error("@include isn't supported here", loc);
+                return false;
+            }
+
+            auto found = includes->find(std::string(*file_name));
+            if (found == includes->end()) {
+                record_error("Could not open file "s + std::string(*file_name), loc);
+                return true;
+            }
+
+            auto &file = *found->second;
+            if (not file.error.empty()) {
+                record_error(file.error, loc);
+                return true;
+            }
+
+            // handlers that ask where the parse is (for lines) get the
+            // @include.
+            auto resume = current_loc;
+            current_loc = loc;
+
+            Setting &top = file.settings;
+            bool ok = true;
+            for (int i = 0; ok and i < top.count(); ++i) {
+                ok = replay_value(top.name_at(i), top.at(i), loc);
+            }
+
+            current_loc = resume;
+            return ok;
+        }
+
+        //##############   parse_group #####################
+
+        bool parse_group() {
+            bool at_least_one = false;
+            while (1) {
+                if (match_char('@')) {
+                    if (not parse_include()) break;
+                } else if (!parse_setting()) {
+                    break;
+                }
+                at_least_one = true;
+
+                // libconfig allows "a = 1 ;"
+                skip();
+                if (match_chars(0, ";,")) {
+                    consume(1);
+                    skip();
+                }
+            }
+
+            return at_least_one;
+        }
+
+        //##############   do_parse  #####################
+        
+        bool do_parse() {
+
+            skip();
+
+            parse_group();
+
+            if (stopped) {
+                return errors.empty();
+            }
+
+            if (! eoi()) {
+                record_error("Not at end of input!");
+                return false;
+            }
+
+            return errors.empty();
+        }
+
+        //##############   do_parse_composite  #############
+        // The input is exactly one group, list or array (as handed to
+        // skipped()). Its contents are reported without a begin_*()/end_*()
+        // around them.
+
+        bool do_parse_composite() {
+            if (not parse_composite_body()) {
+                return errors.empty();
+            }
+
+            if (! eoi()) {
+                record_error("Not at end of input!");
+                return false;
+            }
+
+            return errors.empty();
+        }
+
+    };
+
+    //
+    // Parse `input`, reporting what is found to `handler`. Errors (if any)
+    // are written to `errs`.
+    //
+    template<class Handler>
+    bool parse_events(std::string_view input, Handler &handler, std::ostream *errs = nullptr) {
+        EventParser<Handler> parser{input, handler};
+        bool retval = parser.do_parse();
+        if (errs) *errs << parser.errors;
+        return retval;
+    }
+
+    /***************************************************************
+     * Tree building
+     ***************************************************************/
+
+    //
+    // A group, list or array of a lazily parsed Config that hasn't been
+    // looked at yet. Just where its text is.
+    //
+    struct lazy_source {
+        // keeps the text alive (a mapped_file or a std::string).
+        std::shared_ptr<const void> owner;
+
+        std::string_view text;
+        parse_loc loc;
+
+        // where its groups keep their keys.
+        key_table *keys;
+    };
+
+    //
+    // The handler that turns events into a Setting tree.
+    //
+    struct TreeBuilder : event_handler {
+        std::vector<Setting *> stack;
+
+        // When set, groups, lists and arrays are skipped and left for
+        // expand_lazy() to fill in later. lazy_owner keeps the text alive
+        // until then (it can be empty if the caller takes care of that).
+        bool lazy = false;
+        std::shared_ptr<const void> lazy_owner;
+        Setting *lazy_target = nullptr;
+
+        // New groups keep their keys here. Starts out as the root's.
+        key_table *keys = nullptr;
+
+        // When set, the line each new Setting starts on goes on the end,
+        // so lines[k] is for the k'th Setting under the root in preorder.
+        // `where` is the parser's position.
+        std::vector<long> *lines = nullptr;
+        const parse_loc *where = nullptr;
+
+        explicit TreeBuilder(Setting *root) : stack{root} {
+            if (auto *idx = root->index()) keys = idx->keys();
+        }
+
+        Setting *new_child(std::string_view name) {
+            if (lines) lines->push_back(where->line);
+
+            Setting *parent = stack.back();
+            if (parent->is_group()) {
+                Setting *child = parent->create_child(name);
+                if (not child) {
+                    fail("Setting named "s + std::string(name) + " already defined in this context");
+                }
+                return child;
+            }
+            return parent->create_child();
+        }
+
+        template<class T>
+        event_action scalar(std::string_view name, T &&v) {
+            Setting *parent = stack.back();
+            if (parent->is_array()) {
+                if (lines) lines->push_back(where->line);
+                // The parser has already made sure the types agree.
+                parent->add_child(std::forward<T>(v));
+                return event_action::proceed;
+            }
+
+            Setting *child = new_child(name);
+            if (not child) return event_action::stop;
+            child->set_value(std::forward<T>(v));
+            return event_action::proceed;
+        }
+
+        event_action on_bool(std::string_view name, bool v) { return scalar(name, v); }
+        event_action on_integer(std::string_view name, long v) { return scalar(name, v); }
+        event_action on_float(std::string_view name, double v) { return scalar(name, v); }
+        event_action on_string(std::string_view name, std::string_view v) {
+            return scalar(name, v);
+        }
+
+        event_action begin_group(std::string_view name) {
+            Setting *child = new_child(name);
+            if (not child) return event_action::stop;
+            child->make_group();
+            if (keys) child->group_composite().group.use_keys(keys);
+            if (lazy) {
+                lazy_target = child;
+                return event_action::skip;
+            }
+            stack.push_back(child);
+            return event_action::proceed;
+        }
+
+        event_action begin_list(std::string_view name) {
+            Setting *child = new_child(name);
+            if (not child) return event_action::stop;
+            child->make_list();
+            if (lazy) {
+                lazy_target = child;
+                return event_action::skip;
+            }
+            stack.push_back(child);
+            return event_action::proceed;
+        }
+
+        event_action begin_array(std::string_view name) {
+            Setting *child = new_child(name);
+            if (not child) return event_action::stop;
+            child->make_array();
+            if (lazy) {
+                lazy_target = child;
+                return event_action::skip;
+            }
+            stack.push_back(child);
+            return event_action::proceed;
+        }
+
+        event_action end_group() { stack.pop_back(); return event_action::proceed; }
+        event_action end_list() { stack.pop_back(); return event_action::proceed; }
+        event_action end_array() { stack.pop_back(); return event_action::proceed; }
+
+        void skipped(std::string_view text, const parse_loc &loc) {
+            // from the tree's memory_resource, like everything else in it.
+            lazy_target->composite().lazy = std::allocate_shared<lazy_source>(
+                    lazy_target->get_allocator(), lazy_source{lazy_owner, text, loc, keys});
+        }
+    };
+
+    //
+    // Parse a lazy Setting's text into it. Its own groups, lists and
+    // arrays are left lazy unless `all_levels` is set. On failure the
+    // Setting is left as it was and the problems are added to `errs`.
+    // Returns true for Settings that aren't lazy.
+    //
+    bool expand_lazy(Setting &target, error_list &errs, bool all_levels = false);
+
+    //
+    // The parser Config uses.
+    //
+    struct Parser : TreeBuilder, EventParser<TreeBuilder> {
+        Parser(std::string_view _src, Setting *s) :
+            TreeBuilder{s}, EventParser<TreeBuilder>{_src, *this} {
+            where = &current_loc;
+        }
+
+        using EventParser<TreeBuilder>::skip;
+    };
+
+} // end namespace Configinator5000
@@ -0,0 +1,119 @@
+#include <path.hpp>
+
+namespace Configinator5000 {
+
+    Path::Path(std::string_view text) : text_{text} {
+        parse();
+    }
+
+    Path::Path(const path_literal &p) : text_{p.text()} {
+        // the compiler already split it up and hashed the keys; they just
+        // have to point into our copy of the text.
+        const char *literal = p.text().data();
+        steps_.assign(&p[0], &p[0] + p.size());
+        for (auto &step : steps_) {
+            if (step.is_index) continue;
+            auto offset = std::size_t(step.key.name.data() - literal);
+            step.key.name = std::string_view(text_.data() + offset, step.key.name.size());
+        }
+    }
+
+    Path::Path(const Path &o) :
+        text_{o.text_}, generation_{o.generation_}, shape_{o.shape_}, cached_{o.cached_} {
+        parse();
+    }
+
+    Path::Path(Path &&o) noexcept {
+        *this = std::move(o);
+    }
+
+    Path &Path::operator=(const Path &o) {
+        if (this != &o) {
+            text_ = o.text_;
+            parse();
+            generation_ = o.generation_;
+            shape_ = o.shape_;
+            cached_ = o.cached_;
+        }
+        return *this;
+    }
+
+    Path &Path::operator=(Path &&o) noexcept {
+        if (this != &o) {
+            const char *old = o.text_.data();
+            text_ = std::move(o.text_);
+            steps_ = std::move(o.steps_);
+            generation_ = o.generation_;
+            shape_ = o.shape_;
+            cached_ = o.cached_;
+
+            // a short string's text is copied rather than moved, so the
+            // keys have to follow it.
+            for (auto &step : steps_) {
+                if (step.is_index) continue;
+                auto offset = std::size_t(step.key.name.data() - old);
+                step.key.name = std::string_view(text_.data() + offset, step.key.name.size());
+            }
+
+            o.text_.clear();
+            o.steps_.clear();
+        }
+        return *this;
+    }
+
+    void Path::parse() {
+        auto counted = detail::parse_path(text_, nullptr);
+        if (counted.error) {
+            throw std::runtime_error("Bad path \"" + text_ + "\" at character " +
+                    std::to_string(counted.error_at) + " : " + counted.error);
+        }
+
+        steps_.resize(counted.steps);
+        detail::parse_path(text_, steps_.data());
+    }
+
+    Setting *Path::find(Setting &root) const {
+        Setting *here = &root;
+
+        for (auto const &step : steps_) {
+            if (step.is_index) {
+                if (not here->is_composite()) return nullptr;
+
+                int size = here->count();
+                int idx = step.index;
+                if (idx >= size or idx < -size) return nullptr;
+                if (idx < 0) idx += size;
+
+                here = &here->composite_->children[std::size_t(idx)];
+            } else {
+                if (not here->is_group()) return nullptr;
+
+                int idx = here->find_child(step.key);
+                if (idx < 0) return nullptr;
+
+                here = &here->composite_->children[std::size_t(idx)];
+            }
+        }
+
+        return here;
+    }
+
+    Setting *Path::resolve(Config &cfg) {
+        auto generation = cfg.generation();
+        if (generation == 0) return nullptr;
+
+        // Once watched, anything that could move the Settings in the tree
+        // moves the shape on.
+        Setting &root = cfg.get_settings();
+        auto &tree = tree_state::get(root.tree_);
+        if (generation != generation_ or tree.shape.load(std::memory_order_relaxed) != shape_) {
+            tree.watched.store(true, std::memory_order_relaxed);
+            shape_ = tree.shape.load(std::memory_order_relaxed);
+            cached_ = find(root);
+            generation_ = generation;
+        }
+
+        return cached_;
+    }
+
+} // end namespace Configinator5000
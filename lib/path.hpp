@@ -0,0 +1,200 @@
+#pragma once
+
+#include <configinator5000.hpp>
+#include <key_table.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Paths to a Setting deep in a tree, like "midi.devices[3].in". Group
+// keys are separated by '.', and indexes (into lists, arrays or groups)
+// are in brackets; negative ones count from the end, as for at(int).
+// "a.[3]" is the same as "a[3]". The empty path is the root.
+//
+// A path is split up and its keys hashed once, when it is made. Going
+// down the tree with it after that never allocates or hashes a string.
+// Paths written in the source with the _path suffix are split up and
+// hashed by the compiler:
+//
+//     using namespace Configinator5000::literals;
+//     constexpr auto in = "midi.devices[3].in"_path;
+
+namespace Configinator5000 {
+
+    struct path_step {
+        // for group steps
+        hashed_key key{};
+
+        // for index steps
+        int index = 0;
+        bool is_index = false;
+    };
+
+    namespace detail {
+
+        struct path_parse {
+            std::size_t steps = 0;
+
+            // set if the path is bad
+            const char *error = nullptr;
+            std::size_t error_at = 0;
+        };
+
+        constexpr bool is_digit(char c) { return c >= '0' and c <= '9'; }
+
+        //
+        // Split text into steps. Writes them to out (if not null), which
+        // must have room for all of them; call with null first to count.
+        //
+        constexpr path_parse parse_path(std::string_view text, path_step *out) {
+            path_parse retval;
+            std::size_t pos = 0;
+            std::size_t end = text.size();
+
+            auto fail = [&retval](const char *message, std::size_t at) {
+                retval.error = message;
+                retval.error_at = at;
+                return retval;
+            };
+
+            while (pos < end) {
+                path_step step;
+
+                if (text[pos] == '[') {
+                    ++pos;
+                    bool negative = (pos < end and text[pos] == '-');
+                    if (negative) ++pos;
+
+                    if (pos == end or not is_digit(text[pos])) {
+                        return fail("Expecting an index", pos);
+                    }
+
+                    long value = 0;
+                    while (pos < end and is_digit(text[pos])) {
+                        value = value * 10 + (text[pos] - '0');
+                        if (value > 0x7fffffffL) return fail("Index out of range", pos);
+                        ++pos;
+                    }
+
+                    if (pos == end or text[pos] != ']') {
+                        return fail("Expecting ']'", pos);
+                    }
+                    ++pos;
+
+                    step.is_index = true;
+                    step.index = int(negative ? -value : value);
+
+                } else {
+                    std::size_t start = pos;
+                    while (pos < end and text[pos] != '.' and text[pos] != '[') {
+                        if (text[pos] == ']') return fail("Unexpected ']'", pos);
+                        ++pos;
+                    }
+                    if (pos == start) return fail("Expecting a name", pos);
+
+                    auto name = text.substr(start, pos - start);
+                    step.key = hashed_key{name, key_hash(name)};
+                }
+
+                if (out) out[retval.steps] = step;
+                retval.steps += 1;
+
+                if (pos == end) break;
+
+                if (text[pos] == '.') {
+                    ++pos;
+                    if (pos == end) return fail("Expecting a name", pos);
+                } else if (text[pos] != '[') {
+                    return fail("Expecting '.' or '['", pos);
+                }
+            }
+
+            return retval;
+        }
+    }
+
+    //
+    // A path made at compile time. Use the _path suffix to make one.
+    //
+    class path_literal {
+    public :
+        static constexpr std::size_t max_steps = 16;
+
+        constexpr explicit path_literal(std::string_view text) : text_{text} {
+            auto counted = detail::parse_path(text, nullptr);
+            if (counted.error) {
+                // at compile time, this is a compile error.
+                throw std::runtime_error(counted.error);
+            }
+            if (counted.steps > max_steps) {
+                throw std::runtime_error("Path has too many steps");
+            }
+            count_ = detail::parse_path(text, steps_.data()).steps;
+        }
+
+        constexpr std::string_view text() const { return text_; }
+        constexpr std::size_t size() const { return count_; }
+        constexpr const path_step &operator[](std::size_t i) const { return steps_[i]; }
+
+    private :
+        std::string_view text_;
+        std::array<path_step, max_steps> steps_{};
+        std::size_t count_ = 0;
+    };
+
+    namespace literals {
+        constexpr path_literal operator""_path(const char *text, std::size_t size) {
+            return path_literal{std::string_view(text, size)};
+        }
+    }
+
+    //
+    // A path ready to use against any tree, plus the answer from the last
+    // time it was used on a Config.
+    //
+    class Path {
+    public :
+        // Throws std::runtime_error if text isn't a good path.
+        explicit Path(std::string_view text);
+        Path(const path_literal &p);
+
+        Path(const Path &o);
+        Path(Path &&o) noexcept;
+        Path &operator=(const Path &o);
+        Path &operator=(Path &&o) noexcept;
+
+        // The Setting this path leads to from root, or null if there
+        // isn't one.
+        Setting *find(Setting &root) const;
+
+        // Same, from the root of cfg. The answer is kept until cfg gets
+        // a new tree (see Config::generation()) or Settings are added to
+        // it or replaced, so using a Path over and over again on the same
+        // tree doesn't walk it each time. This changes the Path, so one
+        // thread at a time.
+        Setting *resolve(Config &cfg);
+
+        const std::string &str() const { return text_; }
+        std::size_t size() const { return steps_.size(); }
+
+    private :
+        std::string text_;
+
+        // keys point into text_
+        std::vector<path_step> steps_;
+
+        // Config::generation() of the tree cached_ is from (0 for none),
+        // and its tree_state::shape then.
+        std::uint64_t generation_ = 0;
+        std::uint64_t shape_ = 0;
+        Setting *cached_ = nullptr;
+
+        void parse();
+    };
+
+} // end namespace Configinator5000
@@ -0,0 +1,433 @@
+#include <scan.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define C5K_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(C5K_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define C5K_HAVE_AVX2 1
+#include <immintrin.h>
+#define C5K_TARGET_AVX2 __attribute__((target("avx2,popcnt,bmi")))
+#endif
+
+namespace Configinator5000::scan {
+
+    namespace {
+
+        inline bool is_blank(char c) {
+            // \t \n \v \f \r are contiguous
+            return c == ' ' or (unsigned char)(c - '\t') <= ('\r' - '\t');
+        }
+
+        inline int ctz(std::uint32_t m) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctz(m);
+#else
+            int n = 0;
+            while (not (m & 1)) { m >>= 1; ++n; }
+            return n;
+#endif
+        }
+
+        inline int popcount(std::uint32_t m) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_popcount(m);
+#else
+            int n = 0;
+            while (m) { m &= m - 1; ++n; }
+            return n;
+#endif
+        }
+
+        // bits of m that are below bit idx
+        inline std::uint32_t below(std::uint32_t m, int idx) {
+            return m & ((std::uint32_t(1) << idx) - 1);
+        }
+
+        /************************************************************
+         * Scalar
+         ************************************************************/
+
+        const char *skip_blanks_scalar(const char *p, const char *end, long &lines) {
+            while (p < end and is_blank(*p)) {
+                if (*p == '\n') lines += 1;
+                ++p;
+            }
+            return p;
+        }
+
+        const char *find_newline_scalar(const char *p, const char *end) {
+            auto *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            return nl ? nl : end;
+        }
+
+        const char *find_block_end_scalar(const char *p, const char *end, long &lines) {
+            while (p < end) {
+                if (*p == '*' and p + 1 < end and p[1] == '/') return p;
+                if (*p == '\n') lines += 1;
+                ++p;
+            }
+            return end;
+        }
+
+        const char *find_string_special_scalar(const char *p, const char *end) {
+            while (p < end and *p != '"' and *p != '\\' and *p != '\n') ++p;
+            return p;
+        }
+
+        inline bool is_structural(char c) {
+            switch (c) {
+                case '{' : case '}' : case '(' : case ')' : case '[' : case ']' :
+                case '"' : case '/' : case '#' :
+                    return true;
+                default :
+                    return false;
+            }
+        }
+
+        const char *find_structural_scalar(const char *p, const char *end, long &lines) {
+            while (p < end and not is_structural(*p)) {
+                if (*p == '\n') lines += 1;
+                ++p;
+            }
+            return p;
+        }
+
+        /************************************************************
+         * SSE2
+         ************************************************************/
+#ifdef C5K_HAVE_SSE2
+
+        inline std::uint32_t blank_mask_sse2(__m128i v) {
+            // (c - '\t') <= 4 unsigned  <=> min(c - '\t', 4) == c - '\t'
+            __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+            __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+            __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+            return std::uint32_t(_mm_movemask_epi8(_mm_or_si128(ctrl, space)));
+        }
+
+        inline std::uint32_t char_mask_sse2(__m128i v, char c) {
+            return std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+        }
+
+        const char *skip_blanks_sse2(const char *p, const char *end, long &lines) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                std::uint32_t other = ~blank_mask_sse2(v) & 0xFFFF;
+                std::uint32_t nl = char_mask_sse2(v, '\n');
+                if (other) {
+                    int idx = ctz(other);
+                    lines += popcount(below(nl, idx));
+                    return p + idx;
+                }
+                lines += popcount(nl);
+                p += 16;
+            }
+            return skip_blanks_scalar(p, end, lines);
+        }
+
+        const char *find_newline_sse2(const char *p, const char *end) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                std::uint32_t nl = char_mask_sse2(v, '\n');
+                if (nl) return p + ctz(nl);
+                p += 16;
+            }
+            return find_newline_scalar(p, end);
+        }
+
+        const char *find_block_end_sse2(const char *p, const char *end, long &lines) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                std::uint32_t star = char_mask_sse2(v, '*');
+                std::uint32_t nl = char_mask_sse2(v, '\n');
+                while (star) {
+                    int idx = ctz(star);
+                    if (p + idx + 1 < end and p[idx + 1] == '/') {
+                        lines += popcount(below(nl, idx));
+                        return p + idx;
+                    }
+                    star &= star - 1;
+                }
+                lines += popcount(nl);
+                p += 16;
+            }
+            return find_block_end_scalar(p, end, lines);
+        }
+
+        const char *find_string_special_sse2(const char *p, const char *end) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                std::uint32_t special = char_mask_sse2(v, '"') |
+                    char_mask_sse2(v, '\\') | char_mask_sse2(v, '\n');
+                if (special) return p + ctz(special);
+                p += 16;
+            }
+            return find_string_special_scalar(p, end);
+        }
+
+        inline std::uint32_t structural_mask_sse2(__m128i v) {
+            // '[' and '{' differ only in the 0x20 bit, as do ']' and '}', so
+            // setting that bit lets one compare catch both.
+            __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+            __m128i m = _mm_or_si128(
+                    _mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                    _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('(')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(')')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('#')));
+            return std::uint32_t(_mm_movemask_epi8(m));
+        }
+
+        const char *find_structural_sse2(const char *p, const char *end, long &lines) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                std::uint32_t found = structural_mask_sse2(v);
+                std::uint32_t nl = char_mask_sse2(v, '\n');
+                if (found) {
+                    int idx = ctz(found);
+                    lines += popcount(below(nl, idx));
+                    return p + idx;
+                }
+                lines += popcount(nl);
+                p += 16;
+            }
+            return find_structural_scalar(p, end, lines);
+        }
+#endif
+
+        /************************************************************
+         * AVX2
+         ************************************************************/
+#ifdef C5K_HAVE_AVX2
+
+        C5K_TARGET_AVX2
+        inline std::uint32_t blank_mask_avx2(__m256i v) {
+            __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+            __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+            __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+            return std::uint32_t(_mm256_movemask_epi8(_mm256_or_si256(ctrl, space)));
+        }
+
+        C5K_TARGET_AVX2
+        inline std::uint32_t char_mask_avx2(__m256i v, char c) {
+            return std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+        }
+
+        C5K_TARGET_AVX2
+        const char *skip_blanks_avx2(const char *p, const char *end, long &lines) {
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                std::uint32_t other = ~blank_mask_avx2(v);
+                std::uint32_t nl = char_mask_avx2(v, '\n');
+                if (other) {
+                    int idx = ctz(other);
+                    lines += popcount(below(nl, idx));
+                    return p + idx;
+                }
+                lines += popcount(nl);
+                p += 32;
+            }
+            return skip_blanks_sse2(p, end, lines);
+        }
+
+        C5K_TARGET_AVX2
+        const char *find_newline_avx2(const char *p, const char *end) {
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                std::uint32_t nl = char_mask_avx2(v, '\n');
+                if (nl) return p + ctz(nl);
+                p += 32;
+            }
+            return find_newline_sse2(p, end);
+        }
+
+        C5K_TARGET_AVX2
+        const char *find_block_end_avx2(const char *p, const char *end, long &lines) {
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                std::uint32_t star = char_mask_avx2(v, '*');
+                std::uint32_t nl = char_mask_avx2(v, '\n');
+                while (star) {
+                    int idx = ctz(star);
+                    if (p + idx + 1 < end and p[idx + 1] == '/') {
+                        lines += popcount(below(nl, idx));
+                        return p + idx;
+                    }
+                    star &= star - 1;
+                }
+                lines += popcount(nl);
+                p += 32;
+            }
+            return find_block_end_sse2(p, end, lines);
+        }
+
+        C5K_TARGET_AVX2
+        const char *find_string_special_avx2(const char *p, const char *end) {
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                std::uint32_t special = char_mask_avx2(v, '"') |
+                    char_mask_avx2(v, '\\') | char_mask_avx2(v, '\n');
+                if (special) return p + ctz(special);
+                p += 32;
+            }
+            return find_string_special_sse2(p, end);
+        }
+
+        C5K_TARGET_AVX2
+        inline std::uint32_t structural_mask_avx2(__m256i v) {
+            __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+            __m256i m = _mm256_or_si256(
+                    _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                    _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(')')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('#')));
+            return std::uint32_t(_mm256_movemask_epi8(m));
+        }
+
+        C5K_TARGET_AVX2
+        const char *find_structural_avx2(const char *p, const char *end, long &lines) {
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                std::uint32_t found = structural_mask_avx2(v);
+                std::uint32_t nl = char_mask_avx2(v, '\n');
+                if (found) {
+                    int idx = ctz(found);
+                    lines += popcount(below(nl, idx));
+                    return p + idx;
+                }
+                lines += popcount(nl);
+                p += 32;
+            }
+            return find_structural_sse2(p, end, lines);
+        }
+#endif
+
+        /************************************************************
+         * Dispatch
+         ************************************************************/
+
+        struct dispatch_table {
+            isa which;
+            const char *(*skip_blanks)(const char *, const char *, long &);
+            const char *(*find_newline)(const char *, const char *);
+            const char *(*find_block_end)(const char *, const char *, long &);
+            const char *(*find_string_special)(const char *, const char *);
+            const char *(*find_structural)(const char *, const char *, long &);
+        };
+
+        constexpr dispatch_table scalar_table {
+            isa::scalar, skip_blanks_scalar, find_newline_scalar, find_block_end_scalar,
+            find_string_special_scalar, find_structural_scalar
+        };
+
+#ifdef C5K_HAVE_SSE2
+        constexpr dispatch_table sse2_table {
+            isa::sse2, skip_blanks_sse2, find_newline_sse2, find_block_end_sse2,
+            find_string_special_sse2, find_structural_sse2
+        };
+#endif
+
+#ifdef C5K_HAVE_AVX2
+        constexpr dispatch_table avx2_table {
+            isa::avx2, skip_blanks_avx2, find_newline_avx2, find_block_end_avx2,
+            find_string_special_avx2, find_structural_avx2
+        };
+#endif
+
+        bool cpu_supports(isa target) {
+            switch (target) {
+                case isa::scalar :
+                    return true;
+                case isa::sse2 :
+#ifdef C5K_HAVE_SSE2
+                    return true;
+#else
+                    return false;
+#endif
+                case isa::avx2 :
+#ifdef C5K_HAVE_AVX2
+                    // everything C5K_TARGET_AVX2 lets the compiler use.
+                    return __builtin_cpu_supports("avx2") and
+                        __builtin_cpu_supports("popcnt") and __builtin_cpu_supports("bmi");
+#else
+                    return false;
+#endif
+            }
+            return false;
+        }
+
+        const dispatch_table *table_for(isa target) {
+            switch (target) {
+#ifdef C5K_HAVE_AVX2
+                case isa::avx2 : return &avx2_table;
+#endif
+#ifdef C5K_HAVE_SSE2
+                case isa::sse2 : return &sse2_table;
+#endif
+                default : return &scalar_table;
+            }
+        }
+
+        const dispatch_table *best_table() {
+            for (auto target : { isa::avx2, isa::sse2 }) {
+                if (cpu_supports(target)) return table_for(target);
+            }
+            return &scalar_table;
+        }
+
+        // force_isa() can change it while other threads scan. The tables
+        // are constants, so relaxed loads see all of them.
+        std::atomic<const dispatch_table *> &active() {
+            static std::atomic<const dispatch_table *> table{best_table()};
+            return table;
+        }
+
+        const dispatch_table *current() {
+            return active().load(std::memory_order_relaxed);
+        }
+
+    } // end anonymous namespace
+
+    isa active_isa() {
+        return current()->which;
+    }
+
+    bool force_isa(isa target) {
+        if (not cpu_supports(target)) return false;
+        active().store(table_for(target), std::memory_order_relaxed);
+        return true;
+    }
+
+    const char *skip_blanks(const char *p, const char *end, long &lines) {
+        return current()->skip_blanks(p, end, lines);
+    }
+
+    const char *find_newline(const char *p, const char *end) {
+        return current()->find_newline(p, end);
+    }
+
+    const char *find_block_end(const char *p, const char *end, long &lines) {
+        return current()->find_block_end(p, end, lines);
+    }
+
+    const char *find_string_special(const char *p, const char *end) {
+        return current()->find_string_special(p, end);
+    }
+
+    const char *find_structural(const char *p, const char *end, long &lines) {
+        return current()->find_structural(p, end, lines);
+    }
+
+} // end namespace Configinator5000::scan
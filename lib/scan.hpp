@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+// Bulk character scanning used by the parser.
+//
+// Each routine has a scalar version plus SSE2 and AVX2 versions on x86.
+// The best one the CPU supports is picked the first time any of them is
+// called. All of them work on [p, end) and never read outside of it.
+
+namespace Configinator5000::scan {
+
+    enum class isa { scalar, sse2, avx2 };
+
+    // The instruction set the scanners are currently using.
+    isa active_isa();
+
+    // Switch to a particular implementation. Returns false (and changes
+    // nothing) if the CPU or the build doesn't support it (avx2 also
+    // needs POPCNT and BMI1). Meant for tests and benchmarks, but other
+    // threads can be scanning meanwhile; a call already under way
+    // finishes with the one it started with.
+    bool force_isa(isa target);
+
+    // Returns the first byte that isn't white space (' ', \t, \n, \v, \f, \r)
+    // or end. Adds the number of newlines passed over to `lines`.
+    const char *skip_blanks(const char *p, const char *end, long &lines);
+
+    // Returns the first '\n' or end.
+    const char *find_newline(const char *p, const char *end);
+
+    // Returns the start of the first "*/" or end. Adds the number of
+    // newlines passed over to `lines`.
+    const char *find_block_end(const char *p, const char *end, long &lines);
+
+    // Returns the first byte that needs attention inside a quoted string
+    // ('"', '\\' or '\n') or end.
+    const char *find_string_special(const char *p, const char *end);
+
+    // Returns the first byte that matters for finding the shape of the
+    // input ('{', '}', '(', ')', '[', ']', '"', '/', '#') or end. Adds the
+    // number of newlines passed over to `lines`.
+    const char *find_structural(const char *p, const char *end, long &lines);
+
+} // end namespace Configinator5000::scan
@@ -0,0 +1,517 @@
+#include <schema.hpp>
+#include <parser.hpp>
+#include <json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <type_traits>
+
+namespace Configinator5000 {
+
+    namespace {
+        using ST = Setting::setting_type;
+
+        // by setting_type
+        const char *type_name[] = {"string", "bool", "int", "float", "group", "list", "array"};
+
+        std::string lower(std::string_view s) {
+            std::string retval{s};
+            for (auto &c : retval) c = char(std::tolower(static_cast<unsigned char>(c)));
+            return retval;
+        }
+
+        std::string join(const std::string &where, std::string_view key) {
+            return where.empty() ? std::string(key) : where + "." + std::string(key);
+        }
+    }
+
+    //
+    // Turns the parsed schema into Schema's tables.
+    //
+    class schema_compiler {
+        Schema &s_;
+        error_list &errs_;
+
+        std::unordered_map<const Setting *, long> lines_;
+        std::unordered_map<std::string, std::uint32_t> numbers_;
+
+        using node = Schema::node;
+
+    public :
+        schema_compiler(Schema &s, error_list &errs) : s_{s}, errs_{errs} {}
+
+        bool run(Setting &root, const std::vector<long> &lines) {
+            std::size_t next = 0;
+            number_lines(root, lines, next);
+
+            auto before = errs_.count();
+
+            s_.nodes_.assign(1, node{});
+            s_.nodes_[0].types = Schema::type_bit(ST::GROUP);
+            s_.nodes_[0].open = false;
+            keys_of(0, root, "");
+
+            finish();
+
+            return errs_.count() == before;
+        }
+
+    private :
+        void number_lines(Setting &s, const std::vector<long> &lines, std::size_t &next) {
+            if (not s.is_composite()) return;
+            for (auto &child : s) {
+                lines_[&child] = next < lines.size() ? lines[next] : 0;
+                ++next;
+                number_lines(child, lines, next);
+            }
+        }
+
+        void error(const Setting &where, const std::string &message) {
+            auto found = lines_.find(&where);
+            errs_.add(message, parse_loc{{}, 0, found == lines_.end() ? 0 : found->second});
+        }
+
+        std::uint32_t number(std::string_view key) {
+            auto [at, added] = numbers_.try_emplace(std::string(key), std::uint32_t(s_.key_names_.size()));
+            if (added) s_.key_names_.emplace_back(key);
+            return at->second;
+        }
+
+        // The entries of owner, one for each key in keys ("key*" is the
+        // one for any other key).
+        void keys_of(std::uint32_t owner, Setting &keys, const std::string &where) {
+            std::vector<std::pair<std::string_view, Setting *>> named;
+            for (int i = 0; i < keys.count(); ++i) {
+                auto key = keys.name_at(i);
+                if (key == "key*") {
+                    any_key(owner, keys.at(i), where);
+                } else {
+                    named.emplace_back(key, &keys.at(i));
+                }
+            }
+
+            auto first = std::uint32_t(s_.entries_.size());
+            auto words = std::uint32_t((named.size() + 63) / 64);
+            {
+                auto &n = s_.nodes_[owner];
+                n.first_entry = first;
+                n.entry_count = std::uint32_t(named.size());
+                n.first_word = std::uint32_t(s_.required_.size());
+            }
+            s_.required_.resize(s_.required_.size() + words, 0);
+
+            // all of them first, so the node's entries are together.
+            for (auto const &[key, spec] : named) {
+                s_.entries_.push_back(Schema::entry{number(key), owner, 0});
+            }
+
+            for (std::size_t j = 0; j < named.size(); ++j) {
+                auto n = compile(*named[j].second, join(where, named[j].first));
+                s_.entries_[first + j].node = n;
+                if (s_.nodes_[n].required) {
+                    s_.required_[s_.nodes_[owner].first_word + j / 64] |= std::uint64_t(1) << (j % 64);
+                }
+            }
+        }
+
+        void any_key(std::uint32_t owner, Setting &spec, const std::string &where) {
+            auto name = join(where, "key*");
+            if (s_.nodes_[owner].any_key >= 0) {
+                error(spec, name + " is given twice");
+                return;
+            }
+
+            auto n = compile(spec, name);
+            if (s_.nodes_[n].required) error(spec, name + " can't be required");
+
+            s_.nodes_[owner].any_key = std::int32_t(n);
+        }
+
+        std::uint32_t compile(Setting &spec, const std::string &where) {
+            node n;
+            Setting *keys = nullptr;
+            Setting *any = nullptr;
+
+            if (not spec.is_group()) {
+                error(spec, "The schema for " + where + " must be a group");
+            } else {
+                for (int i = 0; i < spec.count(); ++i) {
+                    auto field = spec.name_at(i);
+                    auto &value = spec.at(i);
+
+                    if (field == "type") {
+                        n.types = types(value, where);
+                    } else if (field == "required") {
+                        n.required = required(value, where);
+                    } else if (field == "keys") {
+                        if (value.is_group()) {
+                            keys = &value;
+                        } else {
+                            error(value, "keys for " + where + " must be a group");
+                        }
+                    } else if (field == "key*") {
+                        any = &value;
+                    } else {
+                        error(value, "Unknown schema field "s + std::string(field) + " for " + where);
+                    }
+                }
+            }
+
+            if ((keys or any) and not (n.types & Schema::type_bit(ST::GROUP))) {
+                error(spec, where + " has keys but can't be a group");
+            }
+
+            auto idx = std::uint32_t(s_.nodes_.size());
+            s_.nodes_.push_back(n);
+
+            if (keys or any) {
+                s_.nodes_[idx].open = false;
+                if (keys) keys_of(idx, *keys, where);
+                if (any) any_key(idx, *any, where);
+            }
+
+            return idx;
+        }
+
+        std::uint8_t types(Setting &value, const std::string &where) {
+            auto one = [&](Setting &name) -> std::uint8_t {
+                if (name.is_string()) {
+                    auto t = lower(name.get<std::string_view>());
+                    // a whole number is an int, but will do for a float.
+                    if (t == "float") return Schema::type_bit(ST::FLOAT) | Schema::type_bit(ST::INTEGER);
+                    if (t == "int" or t == "integer") return Schema::type_bit(ST::INTEGER);
+                    if (t == "bool" or t == "boolean") return Schema::type_bit(ST::BOOL);
+                    for (unsigned i = 0; i < 7; ++i) {
+                        if (t == type_name[i]) return std::uint8_t(1u << i);
+                    }
+                    error(name, "Unknown type \"" + std::string(name.get<std::string_view>()) +
+                            "\" for " + where);
+                } else {
+                    error(name, "type for " + where + " must be a string or a list of them");
+                }
+                return Schema::any_type;
+            };
+
+            if (value.is_list() or value.is_array()) {
+                std::uint8_t retval = 0;
+                for (auto &name : value) retval |= one(name);
+                return retval ? retval : Schema::any_type;
+            }
+
+            return one(value);
+        }
+
+        bool required(Setting &value, const std::string &where) {
+            if (value.is_boolean()) return value.get<bool>();
+
+            if (value.is_string()) {
+                auto r = lower(value.get<std::string_view>());
+                if (r == "yes") return true;
+                if (r == "no") return false;
+            }
+
+            error(value, "required for " + where + " must be \"yes\" or \"no\"");
+            return false;
+        }
+
+        // The entries for each key, now that they are all there.
+        void finish() {
+            auto keys = s_.key_names_.size();
+
+            s_.by_key_start_.assign(keys + 1, 0);
+            for (auto const &e : s_.entries_) ++s_.by_key_start_[e.key + 1];
+            for (std::size_t k = 0; k < keys; ++k) s_.by_key_start_[k + 1] += s_.by_key_start_[k];
+
+            s_.by_key_.resize(s_.entries_.size());
+            auto next = s_.by_key_start_;
+            for (std::uint32_t i = 0; i < s_.entries_.size(); ++i) {
+                s_.by_key_[next[s_.entries_[i].key]++] = i;
+            }
+
+            // key_names_ won't move from here on.
+            for (std::uint32_t k = 0; k < keys; ++k) s_.key_numbers_.emplace(s_.key_names_[k], k);
+        }
+    };
+
+    //
+    // Builds the tree like TreeBuilder, checking each Setting as it is
+    // added. Every group, list and array being parsed has a frame with the
+    // node its members are checked against (-1 when they aren't).
+    //
+    class schema_builder : public TreeBuilder {
+        const Schema &s_;
+        bool fail_fast_;
+
+        struct frame {
+            std::int32_t node;
+            // where it started, for what it is missing.
+            long line;
+            // its bits in seen_.
+            std::uint32_t seen;
+        };
+        std::vector<frame> frames_;
+
+        // which entries each group on the way down has seen.
+        std::vector<std::uint64_t> seen_;
+
+        // keys of the checked groups on the way down, for messages.
+        std::vector<std::string_view> path_;
+
+        // by_id_[id] is the key number of the key_table entry id, -1 if
+        // the schema doesn't have it, or `unknown` until it is looked up.
+        static constexpr std::int32_t unknown = -2;
+        const key_table *table_;
+        std::vector<std::int32_t> by_id_;
+
+    public :
+        // the parser's, so problems and parse errors are in the order
+        // they were found.
+        error_list *errs = nullptr;
+
+        // how many problems have been reported.
+        int problems = 0;
+
+        schema_builder(Setting *root, const Schema &s, bool fail_fast) :
+            TreeBuilder{root}, s_{s}, fail_fast_{fail_fast}, table_{keys} {
+            open(0, 0);
+        }
+
+        template<class T>
+        event_action checked(std::string_view name, T &&v, ST type) {
+            auto action = TreeBuilder::scalar(name, std::forward<T>(v));
+            if (action != event_action::proceed) return action;
+            std::int32_t n;
+            return admit(*stack.back(), type, n);
+        }
+
+        event_action on_bool(std::string_view name, bool v) {
+            return checked(name, v, ST::BOOL);
+        }
+        event_action on_integer(std::string_view name, long v) {
+            return checked(name, v, ST::INTEGER);
+        }
+        event_action on_float(std::string_view name, double v) {
+            return checked(name, v, ST::FLOAT);
+        }
+        event_action on_string(std::string_view name, std::string_view v) {
+            return checked(name, v, ST::STRING);
+        }
+
+        event_action begin_group(std::string_view name) {
+            auto action = TreeBuilder::begin_group(name);
+            if (action != event_action::proceed) return action;
+            return begin(ST::GROUP);
+        }
+        event_action begin_list(std::string_view name) {
+            auto action = TreeBuilder::begin_list(name);
+            if (action != event_action::proceed) return action;
+            return begin(ST::LIST);
+        }
+        event_action begin_array(std::string_view name) {
+            auto action = TreeBuilder::begin_array(name);
+            if (action != event_action::proceed) return action;
+            return begin(ST::ARRAY);
+        }
+
+        event_action end_group() { TreeBuilder::end_group(); return close(); }
+        event_action end_list() { TreeBuilder::end_list(); return close(); }
+        event_action end_array() { TreeBuilder::end_array(); return close(); }
+
+        // The top level, once all of it has been parsed. What it is
+        // missing is reported at line.
+        void finish(long line) {
+            frames_.back().line = line;
+            fail_fast_ = false;
+            close();
+        }
+
+    private :
+        std::int32_t lookup(std::string_view key) const {
+            auto found = s_.key_numbers_.find(key);
+            return found == s_.key_numbers_.end() ? -1 : std::int32_t(found->second);
+        }
+
+        std::int32_t key_number(const group_index &idx, int i) {
+            if (not table_ or idx.keys() != table_) {
+                // a group that keeps its own keys.
+                return lookup(idx.key(i));
+            }
+
+            auto id = idx.entry(i)->id;
+            if (id >= by_id_.size()) by_id_.resize(id + 1, unknown);
+            if (by_id_[id] == unknown) by_id_[id] = lookup(idx.key(i));
+            return by_id_[id];
+        }
+
+        std::string path() const {
+            std::string retval;
+            for (auto key : path_) {
+                if (not retval.empty()) retval += '.';
+                retval += key;
+            }
+            return retval;
+        }
+
+        event_action report(long line, const std::string &message) {
+            ++problems;
+            if (fail_fast_) return fail(message);
+            errs->add(message, parse_loc{{}, 0, line});
+            return event_action::proceed;
+        }
+
+        void open(std::int32_t n, long line) {
+            auto at = std::uint32_t(seen_.size());
+            if (n >= 0) seen_.resize(at + (s_.nodes_[std::size_t(n)].entry_count + 63) / 64, 0);
+            frames_.push_back(frame{n, line, at});
+        }
+
+        // Check the Setting just added to parent. n is set to the node for
+        // what is in it, if that needs checking.
+        event_action admit(Setting &parent, ST type, std::int32_t &n) {
+            n = -1;
+            auto const &f = frames_.back();
+            if (f.node < 0) return event_action::proceed;
+
+            auto const &nd = s_.nodes_[std::size_t(f.node)];
+            auto *idx = parent.index();
+            int i = idx->size() - 1;
+
+            auto k = key_number(*idx, i);
+            auto e = k >= 0 ? s_.find_entry(std::uint32_t(f.node), std::uint32_t(k)) : -1;
+
+            std::int32_t child;
+            if (e >= 0) {
+                auto j = std::uint32_t(e) - nd.first_entry;
+                seen_[f.seen + j / 64] |= std::uint64_t(1) << (j % 64);
+                child = std::int32_t(s_.entries_[std::size_t(e)].node);
+            } else if (nd.any_key >= 0) {
+                child = nd.any_key;
+            } else {
+                path_.push_back(idx->key(i));
+                auto action = report(where->line, "Setting " + path() + " is not in the schema");
+                path_.pop_back();
+                return action;
+            }
+
+            auto const &cn = s_.nodes_[std::size_t(child)];
+            if (not (cn.types & Schema::type_bit(type))) {
+                path_.push_back(idx->key(i));
+                auto action = report(where->line, "Setting " + path() + " has type " +
+                        type_name[unsigned(type)] + ", but the schema wants " + Schema::type_names(cn.types));
+                path_.pop_back();
+                return action;
+            }
+
+            if (type == ST::GROUP and not cn.open) {
+                n = child;
+                path_.push_back(idx->key(i));
+            }
+            return event_action::proceed;
+        }
+
+        event_action begin(ST type) {
+            std::int32_t n;
+            auto action = admit(*stack[stack.size() - 2], type, n);
+            open(n, where->line);
+            return action;
+        }
+
+        // What the group that just ended is missing.
+        event_action close() {
+            auto f = frames_.back();
+            frames_.pop_back();
+            if (f.node < 0) return event_action::proceed;
+
+            auto const &nd = s_.nodes_[std::size_t(f.node)];
+            auto action = event_action::proceed;
+            auto words = (nd.entry_count + 63) / 64;
+            for (std::uint32_t w = 0; w < words; ++w) {
+                auto missing = s_.required_[nd.first_word + w] & ~seen_[f.seen + w];
+                for (std::uint32_t b = 0; missing; ++b, missing >>= 1) {
+                    if (not (missing & 1)) continue;
+                    auto const &ent = s_.entries_[nd.first_entry + w * 64 + b];
+                    action = report(f.line, (path_.empty() ? "The top level"s : "Group " + path()) +
+                            " is missing required setting " + s_.key_names_[ent.key]);
+                    if (action == event_action::stop) return action;
+                }
+            }
+
+            seen_.resize(f.seen);
+            if (not path_.empty()) path_.pop_back();
+            return action;
+        }
+    };
+
+    std::string Schema::type_names(std::uint8_t types) {
+        std::string retval;
+        for (unsigned t = 0; t < 7; ++t) {
+            if (not (types & (1u << t))) continue;
+            if (not retval.empty()) retval += " or ";
+            retval += type_name[t];
+        }
+        return retval;
+    }
+
+    std::vector<Schema::key_info> Schema::keys(std::uint32_t n) const {
+        std::vector<key_info> retval;
+        auto const &nd = nodes_[n];
+        for (auto i = nd.first_entry; i < nd.first_entry + nd.entry_count; ++i) {
+            retval.push_back(key_info{key_names_[entries_[i].key], entries_[i].node});
+        }
+        return retval;
+    }
+
+    bool Schema::load(std::string_view text, error_list &errs) {
+        Setting root{ST::GROUP};
+        std::vector<long> lines;
+
+        Parser parser{text, &root};
+        parser.lines = &lines;
+        if (not parser.do_parse()) {
+            errs.errors.splice(errs.errors.end(), parser.errors.errors);
+            return false;
+        }
+
+        *this = Schema{};
+        return schema_compiler{*this, errs}.run(root, lines);
+    }
+
+    namespace {
+        // Reader is the libconfig or the JSON event parser.
+        template<template<class> class Reader>
+        bool parse_checked(const Schema &schema, std::string_view input, Setting &root,
+                bool fail_fast, error_list &errs, const include_map *includes = nullptr) {
+            schema_builder builder{&root, schema, fail_fast};
+            Reader<schema_builder> parser{input, builder};
+            builder.where = &parser.current_loc;
+            builder.errs = &parser.errors;
+
+            // JSON has no @include.
+            if constexpr (std::is_same_v<Reader<schema_builder>, EventParser<schema_builder>>) {
+                parser.includes = includes;
+            }
+
+            bool ok = parser.do_parse();
+
+            // The top level is only done if the parse got to the end.
+            if (not parser.stopped and parser.errors.count() == builder.problems) {
+                builder.finish(parser.current_loc.line);
+                ok = builder.problems == 0;
+            }
+
+            errs.errors.splice(errs.errors.end(), parser.errors.errors);
+            return ok;
+        }
+    }
+
+    bool Schema::parse(std::string_view input, Setting &root, bool fail_fast,
+            error_list &errs, const include_map *includes) const {
+        return parse_checked<EventParser>(*this, input, root, fail_fast, errs, includes);
+    }
+
+    bool Schema::parse_json(std::string_view input, Setting &root, bool fail_fast,
+            error_list &errs) const {
+        return parse_checked<JsonEventParser>(*this, input, root, fail_fast, errs);
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <configinator5000.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Schemas, compiled to tables.
+//
+// A schema (see the README for the format) is turned into a flat array of
+// nodes, one per entry. A config is checked while it is parsed: each
+// Setting is looked up as the parser hands it over, against the node of
+// the group it is in, so there is no second walk over the tree and a
+// problem can stop the parse right where it is. The allowed types of each
+// entry are a bit mask.
+//
+// Every distinct key in the schema is given a number, and the keys a
+// group may have are found by that number. The number comes from an array
+// indexed by the key's number in the Config's key_table (filled in the
+// first time each key is seen), so known keys are never compared as
+// strings. The required keys of each group are a bitset; a group's
+// children set bits in another as they are seen, and what is missing is
+// found a word at a time.
+
+namespace Configinator5000 {
+
+    struct error_list;
+    struct included_file;
+
+    // (as in parser.hpp)
+    using include_map = std::unordered_map<std::string, std::shared_ptr<included_file>>;
+
+    class Schema {
+    public :
+        // Compile the schema in text. If it is bad, what is wrong (and
+        // where) is added to errs and this returns false.
+        bool load(std::string_view text, error_list &errs);
+
+        // Parse input into root (an empty group), checking each Setting
+        // against the schema as it is added. Parse errors and problems go
+        // into errs, in the order they are found. With fail_fast, the
+        // parse stops at the first problem. Returns true if there were
+        // none. includes are what any @include directives bring in.
+        bool parse(std::string_view input, Setting &root, bool fail_fast,
+                error_list &errs, const include_map *includes = nullptr) const;
+
+        // The same, but the input is JSON (see json.hpp).
+        bool parse_json(std::string_view input, Setting &root, bool fail_fast,
+                error_list &errs) const;
+
+        //
+        // For tools that work from the schema itself (c5k-codegen). The
+        // entries are numbered as nodes; node 0 is the top level.
+        //
+        using setting_type = Setting::setting_type;
+
+        static constexpr std::uint8_t type_bit(setting_type t) {
+            return std::uint8_t(1u << unsigned(t));
+        }
+
+        static constexpr std::uint8_t any_type = 0x7f;
+
+        // "string", "int or float", ... for the types in a mask.
+        static std::string type_names(std::uint8_t types);
+
+        struct key_info {
+            std::string_view key;
+            std::uint32_t node;
+        };
+
+        std::uint8_t types(std::uint32_t n) const { return nodes_[n].types; }
+        bool required(std::uint32_t n) const { return nodes_[n].required; }
+
+        // true for a group the schema says nothing about the insides of.
+        bool open(std::uint32_t n) const { return nodes_[n].open; }
+
+        // The keys of node n, in the order the schema gives them.
+        std::vector<key_info> keys(std::uint32_t n) const;
+
+        // The node for keys of n that aren't in keys(n) (key*), or -1.
+        std::int32_t any_key(std::uint32_t n) const { return nodes_[n].any_key; }
+
+    private :
+
+        struct node {
+            // the types allowed, by type_bit().
+            std::uint8_t types = any_type;
+            bool required = false;
+
+            // A group with neither keys nor key* may have anything in it.
+            bool open = true;
+
+            // node for the keys not in its entries (key*), or -1.
+            std::int32_t any_key = -1;
+
+            // its keys are entries_[first_entry, first_entry + entry_count)
+            std::uint32_t first_entry = 0;
+            std::uint32_t entry_count = 0;
+
+            // bit j of required_[first_word ...] is set if entry j is required.
+            std::uint32_t first_word = 0;
+        };
+
+        struct entry {
+            std::uint32_t key;      // the key's number
+            std::uint32_t owner;    // the node it is a key of
+            std::uint32_t node;     // the node for its value
+        };
+
+        // node 0 is the top level.
+        std::vector<node> nodes_;
+        std::vector<entry> entries_;
+        std::vector<std::uint64_t> required_;
+
+        // by key number.
+        std::vector<std::string> key_names_;
+        std::unordered_map<std::string_view, std::uint32_t> key_numbers_;
+
+        // The entries for key number k are
+        // by_key_[by_key_start_[k] .. by_key_start_[k + 1]).
+        std::vector<std::uint32_t> by_key_start_;
+        std::vector<std::uint32_t> by_key_;
+
+        friend class schema_compiler;
+        friend class schema_builder;
+
+        // The entry number of key k in node n, or -1.
+        std::int32_t find_entry(std::uint32_t n, std::uint32_t k) const {
+            for (auto i = by_key_start_[k]; i < by_key_start_[k + 1]; ++i) {
+                if (entries_[by_key_[i]].owner == n) return std::int32_t(by_key_[i]);
+            }
+            return -1;
+        }
+    };
+
+} // end namespace Configinator5000
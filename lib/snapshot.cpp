@@ -0,0 +1,351 @@
+#include <snapshot.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Configinator5000 {
+
+    namespace sf = snapshot_format;
+
+    namespace {
+
+        [[noreturn]] void corrupt() {
+            throw std::runtime_error("Snapshot is corrupt");
+        }
+
+        // Does [offset, offset + count * size) fit in a block of total bytes?
+        bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t size,
+                std::uint64_t total) {
+            if (offset > total) return false;
+            return count <= (total - offset) / size;
+        }
+
+        // Lays the tree out breadth first, so each composite's children
+        // end up next to each other.
+        class snapshot_writer {
+            std::vector<sf::node> nodes_;
+            std::vector<Setting *> from_;
+            std::vector<std::uint32_t> keys_;
+            std::vector<sf::lookup> lookups_;
+            std::vector<sf::range> ranges_;
+            std::string strings_;
+            std::unordered_map<std::string_view, std::uint32_t> offsets_;
+
+            // string offsets that are already in keys_.
+            std::unordered_set<std::uint32_t> is_key_;
+
+        public :
+            std::string write(Setting &root) {
+                add_node(root, sf::no_key);
+
+                for (std::size_t i = 0; i < nodes_.size(); ++i) {
+                    Setting &s = *from_[i];
+                    if (s.is_composite()) add_children(i, s);
+                }
+
+                return assemble();
+            }
+
+        private :
+            std::uint32_t add_string(std::string_view s) {
+                auto found = offsets_.find(s);
+                if (found != offsets_.end()) return found->second;
+
+                if (strings_.size() + s.size() + 5 >= sf::no_key) {
+                    throw std::length_error("Too much text for a snapshot");
+                }
+
+                auto offset = std::uint32_t(strings_.size());
+                auto size = std::uint32_t(s.size());
+                strings_.append(reinterpret_cast<const char *>(&size), sizeof size);
+                strings_.append(s);
+                strings_.push_back('\0');
+
+                offsets_.emplace(s, offset);
+                return offset;
+            }
+
+            std::string_view stored(std::uint32_t offset) const {
+                std::uint32_t size;
+                std::memcpy(&size, strings_.data() + offset, sizeof size);
+                return std::string_view(strings_.data() + offset + sizeof size, size);
+            }
+
+            std::uint32_t add_key(std::string_view name) {
+                auto offset = add_string(name);
+                if (is_key_.insert(offset).second) keys_.push_back(offset);
+                return offset;
+            }
+
+            void add_node(Setting &s, std::uint32_t key) {
+                if (nodes_.size() >= std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::length_error("Too many settings for a snapshot");
+                }
+
+                sf::node n{};
+                n.key = key;
+
+                if (s.is_boolean()) {
+                    n.type = std::uint8_t(Setting::setting_type::BOOL);
+                    n.value = s.get<bool>() ? 1 : 0;
+                } else if (s.is_integer()) {
+                    n.type = std::uint8_t(Setting::setting_type::INTEGER);
+                    std::int64_t l = s.get<long>();
+                    std::memcpy(&n.value, &l, sizeof l);
+                } else if (s.is_float()) {
+                    n.type = std::uint8_t(Setting::setting_type::FLOAT);
+                    double d = s.get<double>();
+                    std::memcpy(&n.value, &d, sizeof d);
+                } else if (s.is_string()) {
+                    n.type = std::uint8_t(Setting::setting_type::STRING);
+                    n.value = add_string(s.get<std::string_view>());
+                } else if (s.is_group()) {
+                    n.type = std::uint8_t(Setting::setting_type::GROUP);
+                } else if (s.is_list()) {
+                    n.type = std::uint8_t(Setting::setting_type::LIST);
+                } else {
+                    n.type = std::uint8_t(Setting::setting_type::ARRAY);
+                    n.array_type = std::uint8_t(s.array_type());
+                }
+
+                nodes_.push_back(n);
+                from_.push_back(&s);
+            }
+
+            void add_children(std::size_t parent, Setting &s) {
+                auto first = std::uint32_t(nodes_.size());
+                bool group = s.is_group();
+                int k = 0;
+
+                for (auto &child : s) {
+                    add_node(child, group ? add_key(s.name_at(k)) : sf::no_key);
+                    ++k;
+                }
+
+                if (group and k > group_index::small_limit) {
+                    ranges_.push_back(sf::range{std::uint32_t(parent),
+                        std::uint32_t(lookups_.size())});
+                    auto start = lookups_.size();
+                    for (int i = 0; i < k; ++i) {
+                        lookups_.push_back(sf::lookup{nodes_[first + i].key, first + i});
+                    }
+                    std::sort(lookups_.begin() + start, lookups_.end(),
+                            [](const sf::lookup &a, const sf::lookup &b) {
+                                return a.key < b.key;
+                            });
+                    nodes_[parent].flags |= sf::has_lookups;
+                }
+
+                nodes_[parent].value = first | (std::uint64_t(k) << 32);
+            }
+
+            std::vector<std::uint32_t> key_slots() const {
+                std::size_t capacity = 8;
+                while (capacity < keys_.size() * 2) capacity *= 2;
+
+                std::vector<std::uint32_t> slots(capacity, 0);
+                for (auto offset : keys_) {
+                    std::size_t pos = key_hash(stored(offset)) & (capacity - 1);
+                    while (slots[pos]) pos = (pos + 1) & (capacity - 1);
+                    slots[pos] = offset + 1;
+                }
+                return slots;
+            }
+
+            std::string assemble() {
+                auto slots = key_slots();
+
+                sf::header h{};
+                std::memcpy(h.magic, sf::magic, sizeof h.magic);
+                h.version = sf::version;
+                h.byte_order = sf::byte_order;
+
+                h.node_count = nodes_.size();
+                h.nodes = sizeof h;
+                h.key_slots = slots.size();
+                h.keys = h.nodes + h.node_count * sizeof(sf::node);
+                h.lookup_count = lookups_.size();
+                h.lookups = h.keys + h.key_slots * sizeof(std::uint32_t);
+                h.range_count = ranges_.size();
+                h.ranges = h.lookups + h.lookup_count * sizeof(sf::lookup);
+                h.strings_size = strings_.size();
+                h.strings = h.ranges + h.range_count * sizeof(sf::range);
+                h.file_size = h.strings + h.strings_size;
+
+                std::string retval(h.file_size, '\0');
+                char *out = retval.data();
+                auto put = [out](std::uint64_t at, const void *from, std::size_t size) {
+                    if (size) std::memcpy(out + at, from, size);
+                };
+                put(0, &h, sizeof h);
+                put(h.nodes, nodes_.data(), nodes_.size() * sizeof(sf::node));
+                put(h.keys, slots.data(), slots.size() * sizeof(std::uint32_t));
+                put(h.lookups, lookups_.data(), lookups_.size() * sizeof(sf::lookup));
+                put(h.ranges, ranges_.data(), ranges_.size() * sizeof(sf::range));
+                put(h.strings, strings_.data(), strings_.size());
+
+                return retval;
+            }
+        };
+
+        template<class T>
+        const T *section(const char *data, std::uint64_t offset) {
+            // used in place, so they have to be aligned.
+            if (reinterpret_cast<std::uintptr_t>(data + offset) % alignof(T) != 0) corrupt();
+            return reinterpret_cast<const T *>(data + offset);
+        }
+    }
+
+    std::string make_snapshot(Setting &root) {
+        return snapshot_writer().write(root);
+    }
+
+    void frozen_image::attach(const char *data, std::size_t size) {
+        sf::header h;
+        if (size < sizeof h) throw std::runtime_error("Not a snapshot");
+        std::memcpy(&h, data, sizeof h);
+
+        if (std::memcmp(h.magic, sf::magic, sizeof h.magic) != 0) {
+            throw std::runtime_error("Not a snapshot");
+        }
+        if (h.byte_order != sf::byte_order) {
+            throw std::runtime_error("Snapshot was written with the other byte order");
+        }
+        if (h.version != sf::version) {
+            throw std::runtime_error("Snapshot version " + std::to_string(h.version) +
+                    " is not supported");
+        }
+
+        if (h.file_size != size or h.node_count == 0 or
+                h.node_count > std::numeric_limits<std::uint32_t>::max() or
+                h.key_slots == 0 or (h.key_slots & (h.key_slots - 1)) != 0 or
+                not fits(h.nodes, h.node_count, sizeof(sf::node), size) or
+                not fits(h.keys, h.key_slots, sizeof(std::uint32_t), size) or
+                not fits(h.lookups, h.lookup_count, sizeof(sf::lookup), size) or
+                not fits(h.ranges, h.range_count, sizeof(sf::range), size) or
+                not fits(h.strings, h.strings_size, 1, size)) {
+            corrupt();
+        }
+
+        nodes = section<sf::node>(data, h.nodes);
+        node_count = std::size_t(h.node_count);
+        keys = section<std::uint32_t>(data, h.keys);
+        key_slots = std::size_t(h.key_slots);
+        lookups = section<sf::lookup>(data, h.lookups);
+        lookup_count = std::size_t(h.lookup_count);
+        ranges = section<sf::range>(data, h.ranges);
+        range_count = std::size_t(h.range_count);
+        strings = data + h.strings;
+        strings_size = std::size_t(h.strings_size);
+        block = std::string_view(data, size);
+    }
+
+    std::string_view frozen_image::string(std::uint32_t offset) const {
+        std::uint32_t size;
+        if (not fits(offset, 1, sizeof size, strings_size)) corrupt();
+        std::memcpy(&size, strings + offset, sizeof size);
+
+        if (not fits(std::uint64_t(offset) + sizeof size, size, 1, strings_size)) corrupt();
+        return std::string_view(strings + offset + sizeof size, size);
+    }
+
+    std::uint32_t frozen_image::find_key(std::string_view name) const {
+        std::size_t mask = key_slots - 1;
+        std::size_t pos = key_hash(name) & mask;
+
+        // never full, but a bad file could be.
+        for (std::size_t tries = 0; tries < key_slots; ++tries, pos = (pos + 1) & mask) {
+            std::uint32_t slot = keys[pos];
+            if (slot == 0) break;
+            if (string(slot - 1) == name) return slot - 1;
+        }
+
+        return sf::no_key;
+    }
+
+    FrozenSetting FrozenSetting::at(int idx) const {
+        if (! is_composite()) {
+            throw std::runtime_error("at(int) called on a non-composite");
+        }
+
+        int size = count();
+        if (idx >= size or idx < -size) {
+            throw std::runtime_error("at(int) called with index out of range");
+        }
+
+        if (idx < 0) {
+            idx += size;
+        }
+
+        return FrozenSetting(image_, first_child() + std::uint32_t(idx));
+    }
+
+    FrozenSetting FrozenSetting::at(std::string_view name) const {
+        if (!is_group()) {
+            throw std::runtime_error("at(string) called on a non-group");
+        }
+
+        int idx = find_child(name);
+        if (idx < 0) {
+            throw std::runtime_error("at(string) : key "s + std::string(name) +
+                    " does not exist in the group");
+        }
+
+        return FrozenSetting(image_, first_child() + std::uint32_t(idx));
+    }
+
+    std::string_view FrozenSetting::name_at(int idx) const {
+        if (!is_group()) {
+            throw std::runtime_error("name_at(int) called on a non-group");
+        }
+
+        int size = count();
+        if (idx >= size or idx < -size) {
+            throw std::runtime_error("name_at(int) called with index out of range");
+        }
+
+        if (idx < 0) {
+            idx += size;
+        }
+
+        return image_->string(image_->at(first_child() + std::uint32_t(idx)).key);
+    }
+
+    int FrozenSetting::find_child(std::string_view key) const {
+        std::uint32_t k = image_->find_key(key);
+        if (k == sf::no_key) return -1;
+
+        std::uint32_t first = first_child();
+        std::uint32_t n = std::uint32_t(count());
+
+        if (not (node_->flags & sf::has_lookups)) {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                if (image_->at(first + i).key == k) return int(i);
+            }
+            return -1;
+        }
+
+        // find this group's lookups, then the key in them.
+        auto group = std::uint32_t(node_ - image_->nodes);
+        auto *ranges_end = image_->ranges + image_->range_count;
+        auto *r = std::lower_bound(image_->ranges, ranges_end, group,
+                [](const sf::range &r, std::uint32_t g) { return r.group < g; });
+        if (r == ranges_end or r->group != group or
+                not fits(r->start, n, 1, image_->lookup_count)) {
+            corrupt();
+        }
+
+        auto *begin = image_->lookups + r->start;
+        auto *end = begin + n;
+        auto *p = std::lower_bound(begin, end, k,
+                [](const sf::lookup &l, std::uint32_t k) { return l.key < k; });
+
+        if (p == end or p->key != k) return -1;
+        if (p->child - first >= n) corrupt();
+        return int(p->child - first);
+    }
+
+} // end namespace Configinator5000
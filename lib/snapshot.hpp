@@ -0,0 +1,276 @@
+#pragma once
+
+#include <configinator5000.hpp>
+#include <mapped_file.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Binary snapshots of a settings tree, for starting up without parsing.
+//
+// A snapshot is one flat block that is used where it lies (straight out
+// of a mapped file); opening one only checks the header. All links are
+// offsets, so it doesn't matter where it ends up in memory.
+//
+//     header
+//     nodes       one per Setting, breadth first, so the children of a
+//                 composite are next to each other. The root is node 0.
+//     keys        open addressing table (by key_hash()) of every group
+//                 key's string offset + 1.
+//     lookups     (key, child) pairs sorted by key, for each big group.
+//     ranges      where each big group's lookups start, sorted by group.
+//     strings     keys and string values, each a 32 bit length, the text
+//                 and a '\0'. Each distinct string is there once.
+//
+// Since each key is there once, a key is known by its string offset. To
+// find a child by name the name is looked up in `keys` once, and then
+// the children are compared by number, as for interned keys in a
+// group_index.
+//
+// Numbers are in the byte order of the machine that wrote the snapshot,
+// which is recorded in the header. Opening one from a machine with the
+// other byte order is refused rather than converted.
+
+namespace Configinator5000 {
+
+    namespace snapshot_format {
+
+        constexpr char magic[8] = {'C', '5', 'K', 'S', 'N', 'A', 'P', '\0'};
+        constexpr std::uint32_t version = 1;
+
+        // reads back as something else on a machine with the other order.
+        constexpr std::uint32_t byte_order = 0x01020304;
+
+        // the key of a Setting that isn't in a group.
+        constexpr std::uint32_t no_key = 0xffffffff;
+
+        // node flags
+        constexpr std::uint16_t has_lookups = 1;
+
+        struct header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint64_t file_size;
+
+            // section offsets are from the start of the file.
+            std::uint64_t node_count;
+            std::uint64_t nodes;
+            std::uint64_t key_slots;        // a power of two
+            std::uint64_t keys;
+            std::uint64_t lookup_count;
+            std::uint64_t lookups;
+            std::uint64_t range_count;
+            std::uint64_t ranges;
+            std::uint64_t strings_size;
+            std::uint64_t strings;
+        };
+
+        struct node {
+            std::uint8_t type;          // Setting::setting_type
+            std::uint8_t array_type;    // for arrays
+            std::uint16_t flags;
+            std::uint32_t key;          // string offset, or no_key
+
+            // A scalar's value (a string's is its offset). For a composite,
+            // the node number of the first child in the low half and the
+            // number of children in the high.
+            std::uint64_t value;
+        };
+
+        struct lookup {
+            std::uint32_t key;
+            std::uint32_t child;        // node number
+        };
+
+        struct range {
+            std::uint32_t group;        // node number
+            std::uint32_t start;        // first of its lookups
+        };
+
+        static_assert(sizeof(header) == 104);
+        static_assert(sizeof(node) == 16);
+        static_assert(sizeof(lookup) == 8);
+        static_assert(sizeof(range) == 8);
+    }
+
+    //
+    // An opened (or frozen) snapshot : where its sections are and what
+    // keeps them in memory.
+    //
+    struct frozen_image {
+        const snapshot_format::node *nodes = nullptr;
+        std::size_t node_count = 0;
+        const std::uint32_t *keys = nullptr;
+        std::size_t key_slots = 0;
+        const snapshot_format::lookup *lookups = nullptr;
+        std::size_t lookup_count = 0;
+        const snapshot_format::range *ranges = nullptr;
+        std::size_t range_count = 0;
+        const char *strings = nullptr;
+        std::size_t strings_size = 0;
+
+        // the whole snapshot
+        std::string_view block;
+
+        // one or the other holds the block.
+        mapped_file file;
+        std::string buffer;
+
+        // Throws std::runtime_error if the header doesn't make sense for
+        // a block of size bytes.
+        void attach(const char *data, std::size_t size);
+
+        const snapshot_format::node &at(std::size_t n) const {
+            if (n >= node_count) throw std::runtime_error("Snapshot is corrupt");
+            return nodes[n];
+        }
+
+        std::string_view string(std::uint32_t offset) const;
+
+        // The string offset of the key name, or no_key if no group has it.
+        std::uint32_t find_key(std::string_view name) const;
+    };
+
+    // The snapshot of the tree under root. Throws if part of a lazy tree
+    // can't be parsed.
+    std::string make_snapshot(Setting &root);
+
+    //
+    // A read-only Setting in a snapshot (or a frozen Config, which is the
+    // same thing in memory). It is only a pointer and a node, so pass it
+    // around by value. Good for as long as the Config keeps the snapshot
+    // (until it parses or opens something else, or is destroyed).
+    //
+    // The accessors are the same as Setting's, and throw the same way.
+    //
+    class FrozenSetting {
+    public :
+        using setting_type = Setting::setting_type;
+
+        FrozenSetting(const frozen_image *image, std::uint32_t n) :
+            image_{image}, node_{&image->at(n)} {}
+
+        bool is_boolean() const { return (type() == setting_type::BOOL); }
+        bool is_integer() const { return (type() == setting_type::INTEGER); }
+        bool is_float()   const { return (type() == setting_type::FLOAT); }
+        bool is_string()  const { return (type() == setting_type::STRING); }
+        bool is_group()   const { return (type() == setting_type::GROUP); }
+        bool is_list()    const { return (type() == setting_type::LIST); }
+        bool is_array()   const { return (type() == setting_type::ARRAY); }
+
+        bool is_numeric()   const { return (is_integer() || is_float()); }
+        bool is_composite() const { return (is_group() || is_list() || is_array()); }
+        bool is_scalar()    const { return (not is_composite()); }
+
+        template<class T> T get() const {
+            if constexpr (std::is_same_v<T, bool>) {
+                if (is_boolean()) {
+                    return T(node_->value != 0);
+                } else {
+                    throw std::runtime_error("Bad type conversion\n");
+                }
+            } else if constexpr (std::is_integral_v<T>) {
+                if (is_integer())
+                    return T(integer());
+                else
+                    throw std::runtime_error("Bad type conversion\n");
+
+            } else if constexpr(std::is_floating_point_v<T>) {
+                if (is_float()) {
+                    double d;
+                    std::memcpy(&d, &node_->value, sizeof d);
+                    return T(d);
+                } else if (is_integer()) {
+                    return T(integer());
+                } else {
+                    throw std::runtime_error("Bad type conversion\n");
+                }
+            } else if constexpr (std::is_convertible_v<std::string, T>) {
+                if (is_string()) {
+                    auto s = image_->string(std::uint32_t(node_->value));
+                    if constexpr (std::is_constructible_v<T, std::string_view>) {
+                        return T(s);
+                    } else {
+                        return T(std::string(s));
+                    }
+                } else {
+                    throw std::runtime_error("Bad type conversion\n");
+                }
+            } else {
+                throw std::runtime_error("Bad type conversion (not a scalar)\n");
+            }
+        }
+
+        int count() const { return is_composite() ? int(node_->value >> 32) : 0; }
+
+        setting_type array_type() const {
+            if (is_array()) return setting_type(node_->array_type);
+
+            throw std::runtime_error("Setting is not an array");
+        }
+
+        bool exists(std::string_view child) const {
+            if (! is_group()) return false;
+
+            return find_child(child) >= 0;
+        }
+
+        FrozenSetting at(int idx) const;
+        FrozenSetting at(std::string_view name) const;
+
+        // The key of child idx of a group.
+        std::string_view name_at(int idx) const;
+
+        class iterator {
+            const frozen_image *image_;
+            std::uint32_t n_;
+
+        public :
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = FrozenSetting;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = FrozenSetting;
+
+            iterator(const frozen_image *image, std::uint32_t n) : image_{image}, n_{n} {}
+
+            FrozenSetting operator*() const { return FrozenSetting(image_, n_); }
+            iterator &operator++() { ++n_; return *this; }
+            iterator operator++(int) { auto old = *this; ++n_; return old; }
+
+            bool operator==(const iterator &o) const { return n_ == o.n_; }
+            bool operator!=(const iterator &o) const { return n_ != o.n_; }
+        };
+
+        // The children, in the order they were added (as for Setting).
+        iterator begin() const { return iterator(image_, first_child()); }
+        iterator end() const { return iterator(image_, first_child() + std::uint32_t(count())); }
+
+    private :
+        const frozen_image *image_;
+        const snapshot_format::node *node_;
+
+        setting_type type() const { return setting_type(node_->type); }
+
+        long integer() const {
+            std::int64_t l;
+            std::memcpy(&l, &node_->value, sizeof l);
+            return long(l);
+        }
+
+        std::uint32_t first_child() const {
+            return is_composite() ? std::uint32_t(node_->value) : 0;
+        }
+
+        // The number of the child named key, or -1. Only for groups.
+        int find_child(std::string_view key) const;
+    };
+
+} // end namespace Configinator5000
@@ -0,0 +1,545 @@
+#include <configinator5000.hpp>
+#include <parser.hpp>
+
+#include <vector>
+
+namespace Configinator5000 {
+
+    namespace {
+        inline bool is_alpha(char c) {
+            return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z');
+        }
+
+        inline bool is_name_start(char c) {
+            return c == '*' or is_alpha(c);
+        }
+
+        inline bool is_name_char(char c) {
+            return c == '*' or c == '_' or is_alpha(c) or (c >= '0' and c <= '9');
+        }
+
+        inline bool is_punct(char c) {
+            switch (c) {
+                case '=' : case ':' : case ';' : case ',' :
+                case '{' : case '}' : case '(' : case ')' :
+                case '[' : case ']' :
+                    return true;
+                default :
+                    return false;
+            }
+        }
+
+        // case insensitive compare against a lower case word.
+        bool word_is(std::string_view w, std::string_view lower) {
+            if (w.size() != lower.size()) return false;
+            for (std::size_t i = 0; i < w.size(); ++i) {
+                char c = w[i];
+                if (c >= 'A' and c <= 'Z') c = char(c - 'A' + 'a');
+                if (c != lower[i]) return false;
+            }
+            return true;
+        }
+    }
+
+    //
+    // All the state the streaming parser carries between feed() calls.
+    //
+    // Tokenizing and parsing are separate here, unlike in Parser. The
+    // tokenizer stops (without consuming anything) when a token runs into
+    // the end of the input we have so far. The parser is a state machine
+    // with an explicit stack so it can stop between any two tokens. It
+    // builds the tree through the same TreeBuilder events as Parser.
+    //
+    struct stream_state {
+
+        enum class tok { need_more, eof, word, integer, floating, string, punct, error };
+
+        struct token {
+            tok type = tok::need_more;
+            char punct = '\0';
+            long integer = 0;
+            double floating = 0.0;
+            // word text, or the decoded string
+            std::string_view text;
+            const char *message = nullptr;
+            parse_loc loc;
+        };
+
+        enum class frame_kind { group, list, array };
+
+        // what a frame wants to see next.
+        enum class expect { item, separator, value, after_value };
+
+        struct frame {
+            frame_kind kind;
+            expect state;
+            // arrays only - the type of the first element.
+            ST array_type = ST::BOOL;
+            bool empty = true;
+        };
+
+        enum class skip_state { normal, line_comment, block_comment };
+
+        TreeBuilder builder;
+        std::vector<frame> stack;
+        error_list errors;
+
+        // input we've been given but haven't consumed yet.
+        std::string pending_input;
+
+        // where in the whole input we are.
+        std::uint64_t offset = 0;
+        long line = 0;
+
+        skip_state skipping = skip_state::normal;
+        parse_loc comment_loc;
+
+        // A string token split across chunks. Everything before the current
+        // position has already been decoded into string_token.
+        bool in_string = false;
+        std::string string_token;
+        parse_loc string_loc;
+
+        // The name of the group member we are about to create.
+        std::string pending_name;
+
+        // A string value isn't done until we see the next token, since
+        // adjacent literals are joined.
+        bool pending_string = false;
+        std::string string_value;
+        parse_loc string_value_loc;
+
+        bool failed = false;
+        bool finished = false;
+
+        explicit stream_state(Setting *r) : builder{r} {
+            stack.push_back({frame_kind::group, expect::item});
+        }
+
+        parse_loc here() const {
+            return parse_loc{std::string_view{}, offset, line};
+        }
+
+        void advance(const char *&p, const char *to) {
+            offset += std::uint64_t(to - p);
+            p = to;
+        }
+
+        void fail(const std::string &msg, const parse_loc &loc) {
+            errors.add(msg, loc);
+            failed = true;
+        }
+
+        // Pass on what the builder said. TreeBuilder only stops on errors.
+        bool handled(event_action action, const parse_loc &loc) {
+            if (action != event_action::stop) return true;
+            fail(builder.failure(), loc);
+            return false;
+        }
+
+        // name of the value that goes in the top frame.
+        std::string_view value_name() const {
+            return (stack.back().kind == frame_kind::group) ?
+                std::string_view(pending_name) : std::string_view{};
+        }
+
+        /*********************************************************
+         * Tokenizer
+         *********************************************************/
+
+        // Skip white space and comments. Returns false if we ran out of
+        // input first.
+        bool skip(const char *&p, const char *end, bool final) {
+            while (true) {
+                if (skipping == skip_state::line_comment) {
+                    // leave the newline for skip_blanks to count.
+                    advance(p, scan::find_newline(p, end));
+                    if (p == end) return false;
+                    skipping = skip_state::normal;
+
+                } else if (skipping == skip_state::block_comment) {
+                    const char *close = scan::find_block_end(p, end, line);
+                    if (close == end) {
+                        // a '*' at the very end might be half of the "*/"
+                        if (close > p and close[-1] == '*' and not final) --close;
+                        advance(p, close);
+                        if (final) {
+                            fail("Unterminated comment starting here", comment_loc);
+                        }
+                        return false;
+                    }
+                    advance(p, close + 2);
+                    skipping = skip_state::normal;
+                }
+
+                advance(p, scan::skip_blanks(p, end, line));
+                if (p == end) return false;
+
+                if (*p == '#') {
+                    comment_loc = here();
+                    skipping = skip_state::line_comment;
+                    advance(p, p + 1);
+                } else if (*p == '/') {
+                    if (p + 1 == end) {
+                        // can't tell yet. If this is the end, let the
+                        // tokenizer complain about the '/'.
+                        return final;
+                    }
+                    if (p[1] == '/') {
+                        comment_loc = here();
+                        skipping = skip_state::line_comment;
+                        advance(p, p + 2);
+                    } else if (p[1] == '*') {
+                        comment_loc = here();
+                        skipping = skip_state::block_comment;
+                        advance(p, p + 2);
+                    } else {
+                        return true;
+                    }
+                } else {
+                    return true;
+                }
+            }
+        }
+
+        tok finish_string(const char *&p, const char *end, bool final, token &t) {
+            auto lit = lexer::scan_string_body(p, end, string_token);
+
+            if (not lit.ok and lit.truncated and not final) {
+                // keep what we have decoded and carry on next time.
+                advance(p, p + lit.length);
+                in_string = true;
+                return tok::need_more;
+            }
+
+            advance(p, p + lit.length);
+            in_string = false;
+            t.loc = string_loc;
+
+            if (not lit.ok) {
+                t.message = lit.message;
+                return t.type = tok::error;
+            }
+
+            t.text = string_token;
+            return t.type = tok::string;
+        }
+
+        tok next_token(const char *&p, const char *end, bool final, token &t) {
+            if (in_string) {
+                return finish_string(p, end, final, t);
+            }
+
+            if (not skip(p, end, final)) {
+                // failed means an unterminated comment, already recorded.
+                if (failed or not final) return tok::need_more;
+                t.loc = here();
+                return t.type = tok::eof;
+            }
+
+            t.loc = here();
+            char c = *p;
+
+            if (is_punct(c)) {
+                t.punct = c;
+                advance(p, p + 1);
+                return t.type = tok::punct;
+            }
+
+            if (c == '"') {
+                string_token.clear();
+                string_loc = t.loc;
+                advance(p, p + 1);
+                return finish_string(p, end, final, t);
+            }
+
+            auto nv = lexer::scan_number(p, end);
+            if (nv.found()) {
+                // the number might keep going in the next chunk.
+                if (p + nv.length == end and not final) return tok::need_more;
+
+                advance(p, p + nv.length);
+                if (nv.is_integer()) {
+                    t.integer = nv.integer;
+                    return t.type = tok::integer;
+                } else if (nv.is_floating()) {
+                    t.floating = nv.floating;
+                    return t.type = tok::floating;
+                }
+                t.message = nv.message;
+                return t.type = tok::error;
+            }
+
+            if ((c == '+' or c == '-' or c == '.') and end - p < 3 and not final) {
+                // "+", "-." etc. could still become a number.
+                return tok::need_more;
+            }
+
+            if (is_name_start(c)) {
+                const char *q = p + 1;
+                while (q < end and is_name_char(*q)) ++q;
+                if (q == end and not final) return tok::need_more;
+
+                t.text = std::string_view(p, std::size_t(q - p));
+                advance(p, q);
+                return t.type = tok::word;
+            }
+
+            t.message = "Unexpected character";
+            return t.type = tok::error;
+        }
+
+        /*********************************************************
+         * Parser
+         *********************************************************/
+
+        bool commit_string() {
+            pending_string = false;
+            return handled(builder.on_string(value_name(), string_value), string_value_loc);
+        }
+
+        static const char *close_error(frame_kind k) {
+            switch (k) {
+                case frame_kind::group : return "Didn't find close of setting group";
+                case frame_kind::list :  return "Didn't find close of setting list";
+                default :                return "Didn't find close of value array";
+            }
+        }
+
+        // Start a group member or list element.
+        bool start_value(const token &t) {
+            auto name = value_name();
+            stack.back().state = expect::after_value;
+
+            switch (t.type) {
+                case tok::punct :
+                    if (t.punct == '{') {
+                        if (not handled(builder.begin_group(name), t.loc)) return false;
+                        stack.push_back({frame_kind::group, expect::item});
+                        return true;
+                    } else if (t.punct == '(') {
+                        if (not handled(builder.begin_list(name), t.loc)) return false;
+                        stack.push_back({frame_kind::list, expect::item});
+                        return true;
+                    } else if (t.punct == '[') {
+                        if (not handled(builder.begin_array(name), t.loc)) return false;
+                        stack.push_back({frame_kind::array, expect::item});
+                        return true;
+                    }
+                    break;
+                case tok::integer :
+                    return handled(builder.on_integer(name, t.integer), t.loc);
+                case tok::floating :
+                    return handled(builder.on_float(name, t.floating), t.loc);
+                case tok::string :
+                    pending_string = true;
+                    string_value.assign(t.text);
+                    string_value_loc = t.loc;
+                    return true;
+                case tok::word :
+                    if (word_is(t.text, "true")) {
+                        return handled(builder.on_bool(name, true), t.loc);
+                    } else if (word_is(t.text, "false")) {
+                        return handled(builder.on_bool(name, false), t.loc);
+                    }
+                    break;
+                default :
+                    break;
+            }
+
+            fail("Expecting a value", t.loc);
+            return false;
+        }
+
+        bool array_item(const token &t) {
+            auto &f = stack.back();
+
+            ST type;
+            switch (t.type) {
+                case tok::integer :  type = ST::INTEGER; break;
+                case tok::floating : type = ST::FLOAT; break;
+                case tok::string :   type = ST::STRING; break;
+                case tok::word :
+                    if (word_is(t.text, "true") or word_is(t.text, "false")) {
+                        type = ST::BOOL;
+                        break;
+                    }
+                    fail("Expecting a value", t.loc);
+                    return false;
+                default :
+                    fail(close_error(frame_kind::array), t.loc);
+                    return false;
+            }
+
+            if (f.empty) {
+                f.array_type = type;
+                f.empty = false;
+            } else if (f.array_type == ST::FLOAT and type == ST::INTEGER) {
+                // integers are fine in a float array.
+                type = ST::FLOAT;
+            } else if (f.array_type != type) {
+                fail("All values in an array must be the same scalar type", t.loc);
+                return false;
+            }
+
+            f.state = expect::after_value;
+            switch (type) {
+                case ST::INTEGER :
+                    return handled(builder.on_integer({}, t.integer), t.loc);
+                case ST::FLOAT :
+                    return handled(builder.on_float({},
+                                t.type == tok::floating ? t.floating : double(t.integer)), t.loc);
+                case ST::BOOL :
+                    return handled(builder.on_bool({}, word_is(t.text, "true")), t.loc);
+                default :
+                    // committed once we know no literal follows.
+                    pending_string = true;
+                    string_value.assign(t.text);
+                    string_value_loc = t.loc;
+                    return true;
+            }
+        }
+
+        bool handle(const token &t) {
+            if (t.type == tok::error) {
+                fail(t.message, t.loc);
+                return false;
+            }
+
+            if (pending_string) {
+                if (t.type == tok::string) {
+                    string_value.append(t.text);
+                    return true;
+                }
+                if (not commit_string()) return false;
+            }
+
+            auto &f = stack.back();
+
+            if (f.state == expect::after_value) {
+                f.state = expect::item;
+                if (t.type == tok::punct and (t.punct == ';' or t.punct == ',')) {
+                    return true;
+                }
+                // separators are optional.
+            }
+
+            switch (f.kind) {
+                case frame_kind::group :
+                    if (f.state == expect::item) {
+                        if (t.type == tok::word) {
+                            pending_name.assign(t.text);
+                            f.state = expect::separator;
+                            return true;
+                        }
+                        if (stack.size() > 1) {
+                            if (t.type == tok::punct and t.punct == '}') {
+                                stack.pop_back();
+                                return handled(builder.end_group(), t.loc);
+                            }
+                            fail(close_error(f.kind), t.loc);
+                            return false;
+                        }
+                        if (t.type == tok::eof) {
+                            return true;
+                        }
+                        fail("Not at end of input!", t.loc);
+                        return false;
+
+                    } else if (f.state == expect::separator) {
+                        if (t.type == tok::punct and (t.punct == ':' or t.punct == '=')) {
+                            f.state = expect::value;
+                            return true;
+                        }
+                        fail("Expecting : or = after setting name", t.loc);
+                        return false;
+
+                    } else {
+                        return start_value(t);
+                    }
+
+                case frame_kind::list :
+                    if (t.type == tok::punct and t.punct == ')') {
+                        stack.pop_back();
+                        return handled(builder.end_list(), t.loc);
+                    }
+                    if (t.type == tok::eof) {
+                        fail(close_error(f.kind), t.loc);
+                        return false;
+                    }
+                    return start_value(t);
+
+                case frame_kind::array :
+                    if (t.type == tok::punct and t.punct == ']') {
+                        stack.pop_back();
+                        return handled(builder.end_array(), t.loc);
+                    }
+                    return array_item(t);
+            }
+
+            return false;
+        }
+
+        // Work through as much of [begin, end) as we can. Returns the
+        // number of bytes used.
+        std::size_t process(const char *begin, const char *end, bool final) {
+            const char *p = begin;
+
+            while (not failed) {
+                token t;
+                if (next_token(p, end, final, t) == tok::need_more) break;
+                if (not handle(t)) break;
+                if (t.type == tok::eof) {
+                    finished = true;
+                    break;
+                }
+            }
+
+            return std::size_t(p - begin);
+        }
+
+        bool feed(std::string_view chunk, bool final) {
+            if (failed or finished) return not failed;
+
+            if (pending_input.empty()) {
+                // Common case - work straight out of the caller's buffer.
+                auto used = process(chunk.data(), chunk.data() + chunk.size(), final);
+                pending_input.assign(chunk.substr(used));
+            } else {
+                pending_input.append(chunk);
+                auto used = process(pending_input.data(),
+                        pending_input.data() + pending_input.size(), final);
+                pending_input.erase(0, used);
+            }
+
+            return not failed;
+        }
+    };
+
+    StreamingParser::StreamingParser() : cfg_{new Setting(ST::GROUP)} {
+        state_ = new stream_state(cfg_.get());
+    }
+
+    StreamingParser::~StreamingParser() {
+        if (state_) delete state_;
+    }
+
+    bool StreamingParser::feed(std::string_view chunk) {
+        return state_->feed(chunk, false);
+    }
+
+    bool StreamingParser::finish() {
+        return state_->feed(std::string_view{}, true) and state_->errors.empty();
+    }
+
+    std::uint64_t StreamingParser::offset() const {
+        return state_->offset;
+    }
+
+    std::ostream &StreamingParser::stream_errors(std::ostream &strm) {
+        strm << state_->errors;
+
+        return strm;
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,35 @@
+#include <tree_arena.hpp>
+#include <work_pool.hpp>
+
+namespace Configinator5000 {
+
+    tree_arena::tree_arena(std::size_t block_size) : block_size_{block_size} {
+        add_lanes(1);
+    }
+
+    void tree_arena::add_lanes(unsigned n) {
+        while (lanes_.size() < n) {
+            lanes_.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>(block_size_));
+        }
+    }
+
+    void tree_arena::release() {
+        for (auto &lane : lanes_) lane->release();
+    }
+
+    void *tree_arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+        unsigned lane = work_pool::current_worker();
+        if (lane >= lanes_.size()) lane = 0;
+
+        return lanes_[lane]->allocate(bytes, alignment);
+    }
+
+    void tree_arena::do_deallocate(void *, std::size_t, std::size_t) {
+        // everything goes at once in release()
+    }
+
+    bool tree_arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace Configinator5000 {
+
+    // Where a Config keeps its settings tree when asked to use an arena.
+    //
+    // Allocation is a pointer bump out of large blocks, deallocation does
+    // nothing, and release() gives back everything at once. So a tree in
+    // here can be thrown away without visiting any of its nodes.
+    //
+    // There is a separate lane (monotonic_buffer_resource) for each
+    // work_pool thread, so the parallel parse can allocate without
+    // locking. Which lane is used depends on the thread, not the caller.
+    class tree_arena : public std::pmr::memory_resource {
+        std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> lanes_;
+
+        // size of the first block of a new lane.
+        std::size_t block_size_;
+
+    public :
+        explicit tree_arena(std::size_t block_size = 64 * 1024);
+
+        // Make sure there are at least n lanes. Not safe while anything
+        // else is using the arena.
+        void add_lanes(unsigned n);
+
+        // Free everything. Nothing that was allocated may be used after.
+        void release();
+
+    protected :
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+    };
+
+} // end namespace Configinator5000
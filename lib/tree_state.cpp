@@ -0,0 +1,47 @@
+#include <tree_state.hpp>
+
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Configinator5000 {
+
+    namespace {
+        // constant initialized, so there even for Settings made before
+        // main().
+        tree_state first_chunk[tree_state::chunk_size];
+
+        std::mutex lock;
+        std::uint32_t next_id = 1;
+        std::vector<std::uint32_t> free_ids;
+    }
+
+    std::atomic<tree_state *> tree_state::chunks_[tree_state::max_chunks] = { first_chunk };
+
+    std::uint32_t tree_state::acquire() {
+        std::lock_guard<std::mutex> guard{lock};
+
+        if (not free_ids.empty()) {
+            auto id = free_ids.back();
+            free_ids.pop_back();
+            return id;
+        }
+
+        if (next_id == chunk_size * max_chunks) {
+            throw std::runtime_error("Too many Configs");
+        }
+
+        auto id = next_id++;
+        auto &chunk = chunks_[id / chunk_size];
+        if (not chunk.load(std::memory_order_relaxed)) {
+            chunk.store(new tree_state[chunk_size], std::memory_order_release);
+        }
+        return id;
+    }
+
+    void tree_state::release(std::uint32_t id) {
+        std::lock_guard<std::mutex> guard{lock};
+        free_ids.push_back(id);
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// What the Settings of one tree have in common. A Setting has no way up
+// to its parent, so each one carries the number of the tree it is in,
+// which children take from the Setting they are added to. Each Config
+// has a number of its own for its trees; number 0 is shared by all the
+// Settings that aren't in a Config.
+//
+// Numbers are reused once their Config is gone, but what they lead to
+// only ever moves on, so a Setting that outlived its Config (moved out
+// of the tree) can at worst make another tree's cached answers go stale
+// early.
+
+namespace Configinator5000 {
+
+    struct tree_state {
+        // Moves on when a Setting that went into a cached content_hash()
+        // changes, which makes all of the tree's cached hashes stale.
+        // Starts at 1, so a new composite has nothing cached.
+        std::atomic<std::uint64_t> hash_epoch{1};
+
+        // Moves on when Settings are added to the tree or replaced, which
+        // can move or free them, while watched is set (see Path).
+        std::atomic<std::uint64_t> shape{1};
+        std::atomic<bool> watched{false};
+
+        // The tree number, for a Config. Throws if there are none left.
+        static std::uint32_t acquire();
+        static void release(std::uint32_t id);
+
+        static tree_state &get(std::uint32_t id) {
+            return chunks_[id / chunk_size].load(std::memory_order_acquire)[id % chunk_size];
+        }
+
+        static constexpr std::uint32_t chunk_size = 1024;
+        static constexpr std::uint32_t max_chunks = 4096;
+
+    private :
+        // Made as they are needed and never freed, so get() doesn't lock.
+        // The first one is there from the start, for tree 0.
+        static std::atomic<tree_state *> chunks_[max_chunks];
+    };
+
+} // end namespace Configinator5000
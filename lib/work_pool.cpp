@@ -0,0 +1,133 @@
+#include <work_pool.hpp>
+
+namespace Configinator5000 {
+
+    namespace {
+        thread_local unsigned worker_index = 0;
+    }
+
+    unsigned work_pool::current_worker() {
+        return worker_index;
+    }
+
+    work_pool::work_pool(unsigned threads) {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+
+        for (unsigned i = 0; i < threads; ++i) {
+            queues_.push_back(std::make_unique<run_queue>());
+        }
+
+        // index 0 is the thread that calls run()
+        for (unsigned i = 1; i < threads; ++i) {
+            threads_.emplace_back(&work_pool::worker, this, i);
+        }
+    }
+
+    work_pool::~work_pool() {
+        {
+            std::lock_guard<std::mutex> guard{lock_};
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto &t : threads_) t.join();
+    }
+
+    void work_pool::run(std::size_t count, const std::function<void(std::size_t)> &task) {
+        if (count == 0) return;
+
+        unsigned n = size();
+
+        // hand out contiguous runs. Earlier threads get the extra ones.
+        std::size_t start = 0;
+        for (unsigned i = 0; i < n; ++i) {
+            std::size_t share = count / n + (i < count % n ? 1 : 0);
+            std::lock_guard<std::mutex> guard{queues_[i]->lock};
+            queues_[i]->next = start;
+            queues_[i]->end = start + share;
+            start += share;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard{lock_};
+            task_ = &task;
+            busy_ = n - 1;
+            generation_ += 1;
+        }
+        wake_.notify_all();
+
+        drain(0);
+
+        std::unique_lock<std::mutex> guard{lock_};
+        done_.wait(guard, [this]() { return busy_ == 0; });
+        task_ = nullptr;
+    }
+
+    void work_pool::worker(unsigned index) {
+        worker_index = index;
+        std::size_t seen = 0;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard{lock_};
+                wake_.wait(guard, [&]() { return stopping_ or generation_ != seen; });
+                if (stopping_) return;
+                seen = generation_;
+            }
+
+            drain(index);
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> guard{lock_};
+                busy_ -= 1;
+                last = (busy_ == 0);
+            }
+            if (last) done_.notify_one();
+        }
+    }
+
+    void work_pool::drain(unsigned index) {
+        std::size_t task;
+        while (take(index, task) or steal(index, task)) {
+            (*task_)(task);
+        }
+    }
+
+    bool work_pool::take(unsigned index, std::size_t &task) {
+        auto &q = *queues_[index];
+        std::lock_guard<std::mutex> guard{q.lock};
+        if (q.next == q.end) return false;
+        task = q.next++;
+        return true;
+    }
+
+    bool work_pool::steal(unsigned index, std::size_t &task) {
+        while (true) {
+            // pick the victim with the most left. Only a hint - it is
+            // checked again under its lock.
+            unsigned victim = index;
+            std::size_t most = 0;
+            for (unsigned i = 0; i < size(); ++i) {
+                if (i == index) continue;
+                auto &q = *queues_[i];
+                std::lock_guard<std::mutex> guard{q.lock};
+                if (q.end - q.next > most) {
+                    most = q.end - q.next;
+                    victim = i;
+                }
+            }
+            if (victim == index) return false;
+
+            auto &q = *queues_[victim];
+            std::lock_guard<std::mutex> guard{q.lock};
+            if (q.next != q.end) {
+                task = --q.end;
+                return true;
+            }
+            // someone beat us to it. Look again.
+        }
+    }
+
+} // end namespace Configinator5000
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Configinator5000 {
+
+    // A fixed set of worker threads for running a batch of independent
+    // tasks, numbered 0 .. count-1.
+    //
+    // Each thread starts with its own contiguous run of task numbers and
+    // works through it from the front. A thread that runs out steals from
+    // the back of whichever run has the most left, so a few big tasks don't
+    // leave the other threads idle.
+    //
+    // The thread calling run() does its share of the work, so a pool of size
+    // one doesn't start any threads at all.
+    class work_pool {
+        // one thread's share of the tasks that haven't been started yet.
+        struct run_queue {
+            std::mutex lock;
+            std::size_t next = 0;
+            std::size_t end = 0;
+        };
+
+        std::vector<std::thread> threads_;
+        std::vector<std::unique_ptr<run_queue>> queues_;
+
+        std::mutex lock_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+
+        // bumped for every run() so workers know there is something new.
+        std::size_t generation_ = 0;
+        unsigned busy_ = 0;
+        bool stopping_ = false;
+
+        const std::function<void(std::size_t)> *task_ = nullptr;
+
+        void worker(unsigned index);
+        void drain(unsigned index);
+        bool take(unsigned index, std::size_t &task);
+        bool steal(unsigned index, std::size_t &task);
+
+    public :
+        // 0 means one per hardware thread.
+        explicit work_pool(unsigned threads = 0);
+        ~work_pool();
+
+        work_pool(const work_pool &) = delete;
+        work_pool &operator=(const work_pool &) = delete;
+
+        unsigned size() const { return unsigned(queues_.size()); }
+
+        // Which of its pool's threads is running this. 0 for the thread
+        // that calls run() (and any thread that isn't part of a pool).
+        static unsigned current_worker();
+
+        // Call task(i) for each i in [0, count) and wait for them all.
+        // Tasks must not throw.
+        void run(std::size_t count, const std::function<void(std::size_t)> &task);
+    };
+
+} // end namespace Configinator5000
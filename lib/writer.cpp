@@ -0,0 +1,337 @@
+#include <writer.hpp>
+#include <file_replacement.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace Configinator5000 {
+
+    namespace {
+
+        // A writer with somewhere to put its text sends it on once it has
+        // this much.
+        constexpr std::size_t drain_size = 256 * 1024;
+
+        // A std::string used as a plain growable block: the bytes past
+        // size() are there already, so adding a few only has to check
+        // for room.
+        class text_buffer {
+            std::string block_;
+            std::size_t size_ = 0;
+
+            char *room(std::size_t n) {
+                if (block_.size() - size_ < n) {
+                    block_.resize(std::max(block_.size() * 2, size_ + n + 4096));
+                }
+                return block_.data() + size_;
+            }
+
+        public :
+            void operator+=(char c) {
+                *room(1) = c;
+                size_ += 1;
+            }
+
+            void operator+=(std::string_view text) { append(text.data(), text.size()); }
+
+            void append(const char *p, std::size_t n) {
+                // p may be null (an empty string)
+                if (n == 0) return;
+                std::memcpy(room(n), p, n);
+                size_ += n;
+            }
+
+            void append(std::size_t n, char c) {
+                std::memset(room(n), c, n);
+                size_ += n;
+            }
+
+            // f(p, end) writes straight into the buffer, no further than
+            // end, and returns where it stopped.
+            template<class F>
+            void put(std::size_t n, F &&f) {
+                char *p = room(n);
+                size_ = std::size_t(f(p, p + n) - block_.data());
+            }
+
+            std::size_t size() const { return size_; }
+            std::string_view view() const { return {block_.data(), size_}; }
+            void clear() { size_ = 0; }
+            void reserve(std::size_t n) { room(n); }
+
+            std::string take() {
+                block_.resize(size_);
+                size_ = 0;
+                return std::move(block_);
+            }
+        };
+
+        class text_writer {
+            text_buffer out_;
+            bool pretty_;
+
+            // JSON rather than libconfig.
+            bool json_;
+
+            // where full buffers go (null for to_text()). Returns false if
+            // they couldn't be written.
+            using drain_fn = bool (*)(void *, std::string_view);
+            drain_fn drain_ = nullptr;
+            void *drain_to_ = nullptr;
+            bool drained_ = true;
+
+        public :
+            text_writer(text_style style, bool json, drain_fn drain = nullptr, void *to = nullptr) :
+                pretty_{style == text_style::pretty}, json_{json}, drain_{drain}, drain_to_{to} {
+                if (drain_) out_.reserve(drain_size + 4096);
+            }
+
+            void document(Setting &root) {
+                if (not root.is_group()) {
+                    throw std::runtime_error("Only a group can be written as a config");
+                }
+
+                if (json_) {
+                    // the top level is an object like any other.
+                    value(root, 0);
+                    newline();
+                } else {
+                    members(root, 0);
+                }
+            }
+
+            std::string take() { return out_.take(); }
+
+            // Send the rest on. False if any of it couldn't be written.
+            bool finish() {
+                drain();
+                return drained_;
+            }
+
+        private :
+            void drain() {
+                if (drained_ and not drain_(drain_to_, out_.view())) drained_ = false;
+                out_.clear();
+            }
+
+            void maybe_drain() {
+                if (drain_ and out_.size() >= drain_size) drain();
+            }
+
+            void newline() {
+                if (pretty_) out_ += '\n';
+            }
+
+            void indent(int depth) {
+                if (pretty_) out_.append(std::size_t(depth) * 2, ' ');
+            }
+
+            void members(Setting &group, int depth) {
+                Setting *child = group.begin();
+                int count = group.count();
+                for (int i = 0; i < count; ++i) {
+                    indent(depth);
+                    if (json_) {
+                        string(group.name_at(i));
+                        out_ += pretty_ ? ": " : ":";
+                    } else {
+                        key(group.name_at(i));
+                        out_ += pretty_ ? " = " : "=";
+                    }
+                    value(child[i], depth);
+                    if (not json_) {
+                        out_ += ';';
+                    } else if (i + 1 < count) {
+                        out_ += ',';
+                    }
+                    newline();
+                    maybe_drain();
+                }
+            }
+
+            void value(Setting &s, int depth) {
+                if (s.is_integer()) {
+                    integer(s.get<long>());
+                } else if (s.is_float()) {
+                    floating(s.get<double>());
+                } else if (s.is_boolean()) {
+                    out_ += s.get<bool>() ? "true" : "false";
+                } else if (s.is_string()) {
+                    string(s.get<std::string_view>());
+                } else if (s.is_group()) {
+                    if (s.count() == 0) {
+                        out_ += "{}";
+                    } else {
+                        out_ += '{';
+                        newline();
+                        members(s, depth + 1);
+                        indent(depth);
+                        out_ += '}';
+                    }
+                } else if (s.is_list() and not json_) {
+                    elements(s, depth, '(', ')');
+                } else {
+                    elements(s, depth, '[', ']');
+                }
+            }
+
+            // Lists and arrays. Pretty, one with no groups or lists in it
+            // (but empty ones) goes on one line; otherwise each element
+            // gets a line.
+            void elements(Setting &s, int depth, char open, char close) {
+                Setting *child = s.begin();
+                int count = s.count();
+
+                out_ += open;
+                if (count == 0) {
+                    out_ += close;
+                    return;
+                }
+
+                bool one_line = true;
+                if (pretty_ and s.is_list()) {
+                    for (int i = 0; i < count; ++i) {
+                        if (child[i].is_group() or (child[i].is_list() and child[i].count() > 0)) {
+                            one_line = false;
+                            break;
+                        }
+                    }
+                }
+
+                if (one_line) {
+                    if (pretty_) out_ += ' ';
+                    for (int i = 0; i < count; ++i) {
+                        if (i > 0) out_ += pretty_ ? ", " : ",";
+                        value(child[i], depth);
+                        maybe_drain();
+                    }
+                    if (pretty_) out_ += ' ';
+                } else {
+                    out_ += '\n';
+                    for (int i = 0; i < count; ++i) {
+                        indent(depth + 1);
+                        value(child[i], depth + 1);
+                        if (i + 1 < count) out_ += ',';
+                        out_ += '\n';
+                        maybe_drain();
+                    }
+                    indent(depth);
+                }
+                out_ += close;
+            }
+
+            // What the parser takes as a name.
+            void key(std::string_view name) {
+                bool ok = not name.empty();
+                for (std::size_t i = 0; ok and i < name.size(); ++i) {
+                    auto c = static_cast<unsigned char>(name[i]);
+                    ok = (c == '*' or std::isalpha(c) or (i > 0 and (c == '_' or std::isdigit(c))));
+                }
+                if (not ok) {
+                    throw std::runtime_error("Can't write \"" + std::string(name) +
+                            "\" as a setting name");
+                }
+                out_ += name;
+            }
+
+            void integer(long v) {
+                out_.put(24, [v](char *p, char *end) { return std::to_chars(p, end, v).ptr; });
+            }
+
+            // The shortest text that reads back to v, with ".0" if it
+            // would otherwise read back as an int.
+            void floating(double v) {
+                if (not std::isfinite(v)) {
+                    throw std::runtime_error(std::isnan(v) ?
+                            "Can't write a NaN as text" : "Can't write an infinite float as text");
+                }
+
+                out_.put(32, [v](char *p, char *end) {
+                    char *last = std::to_chars(p, end - 2, v).ptr;
+                    if (std::find_if(p, last, [](char c) { return c == '.' or c == 'e'; }) == last) {
+                        *last++ = '.';
+                        *last++ = '0';
+                    }
+                    return last;
+                });
+            }
+
+            // JSON has \b and \u00NN rather than \xNN, and doesn't mind
+            // a raw DEL.
+            void string(std::string_view s) {
+                out_ += '"';
+
+                // plain characters go in a run at a time.
+                const char *run = s.data();
+                const char *end = run + s.size();
+                for (const char *p = run; p != end; ++p) {
+                    auto c = static_cast<unsigned char>(*p);
+                    if (c >= 0x20 and c != '"' and c != '\\' and (c != 0x7f or json_)) continue;
+
+                    out_.append(run, std::size_t(p - run));
+                    run = p + 1;
+                    switch (c) {
+                        case '"' :  out_ += "\\\""; break;
+                        case '\\' : out_ += "\\\\"; break;
+                        case '\n' : out_ += "\\n"; break;
+                        case '\r' : out_ += "\\r"; break;
+                        case '\t' : out_ += "\\t"; break;
+                        case '\f' : out_ += "\\f"; break;
+                        case '\b' : out_ += json_ ? "\\b" : "\\x08"; break;
+                        default : {
+                            const char *hex = "0123456789abcdef";
+                            out_ += json_ ? "\\u00" : "\\x";
+                            out_ += hex[c >> 4];
+                            out_ += hex[c & 0xf];
+                        }
+                    }
+                }
+                out_.append(run, std::size_t(end - run));
+
+                out_ += '"';
+            }
+        };
+
+        bool write_replacement(void *to, std::string_view text) {
+            return static_cast<file_replacement *>(to)->write(text);
+        }
+
+        bool write_file(Setting &root, const std::string &file_name, text_style style, bool json) {
+            // Readers (a ConfigStore, say) may be watching it, and others
+            // may be writing it too.
+            file_replacement file{file_name};
+            if (not file.is_open()) return false;
+
+            text_writer writer{style, json, &write_replacement, &file};
+            writer.document(root);
+            return writer.finish() and file.commit();
+        }
+    }
+
+    std::string to_text(Setting &root, text_style style) {
+        text_writer writer{style, false};
+        writer.document(root);
+        return writer.take();
+    }
+
+    bool write_text_file(Setting &root, const std::string &file_name, text_style style) {
+        return write_file(root, file_name, style, false);
+    }
+
+    std::string to_json(Setting &root, text_style style) {
+        text_writer writer{style, true};
+        writer.document(root);
+        return writer.take();
+    }
+
+    bool write_json_file(Setting &root, const std::string &file_name, text_style style) {
+        return write_file(root, file_name, style, true);
+    }
+
+} // end namespace Configinator5000
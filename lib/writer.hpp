@@ -0,0 +1,43 @@
+#pragma once
+
+#include <configinator5000.hpp>
+
+#include <string>
+
+// Settings trees back to libconfig text, or out as JSON.
+//
+// The text is put together in one buffer with std::to_chars, with no
+// iostreams. Writing to a file, the buffer goes out with write(2) each
+// time it fills, so a big tree never has all of its text in memory.
+//
+// Parsing the text gives an equal tree (operator==): strings are escaped
+// where they need it, and floats are written with the fewest digits that
+// read back to the same bits, with a ".0" added if they would otherwise
+// read back as ints. Only what libconfig text can hold can be written; a
+// key that isn't a valid setting name, or a float that is infinite or
+// NaN, throws std::runtime_error.
+//
+// JSON goes through the same writer. Groups become objects, and lists
+// and arrays both become JSON arrays; ints and floats stay apart, as
+// floats always have a '.' or an exponent. Any key can be written (it
+// is a JSON string), but not a NaN or an infinity.
+
+namespace Configinator5000 {
+
+    // The settings in the group root as a config file.
+    std::string to_text(Setting &root, text_style style = text_style::pretty);
+
+    // Write the settings in the group root to the file, replacing it in
+    // one go (through a temporary file and a rename). Returns false if
+    // the file couldn't be written.
+    bool write_text_file(Setting &root, const std::string &file_name,
+            text_style style = text_style::pretty);
+
+    // The settings in the group root as a JSON object.
+    std::string to_json(Setting &root, text_style style = text_style::pretty);
+
+    // write_text_file(), but JSON.
+    bool write_json_file(Setting &root, const std::string &file_name,
+            text_style style = text_style::pretty);
+
+} // end namespace Configinator5000
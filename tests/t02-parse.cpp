@@ -4,6 +4,8 @@
 #include <configinator5000.hpp>
 
 #include <string>
+#include <fstream>
+#include <cstdio>
 
 using namespace std::literals::string_literals;
 
@@ -222,3 +224,175 @@ TEST_CASE("errors") {
 
     CHECK(buf.str() == "line 0 : Expecting a value\nline 0 : Not at end of input!\n"s);
 }
+
+TEST_CASE("parse_file") {
+    Configinator5000::Config cfg;
+
+    std::string file_name = "t02-parse-file.cfg";
+    {
+        std::ofstream out{file_name};
+        out << "a = 1;\n";
+        // enough filler to go over the sequential read hint threshold.
+        for (int i = 0; i < 40000; ++i) {
+            out << "// padding comment to make the file bigger .......\n";
+        }
+        out << "b = \"two\";\n";
+    }
+
+    CHECK(cfg.parse_file(file_name));
+
+    auto & s = cfg.get_settings();
+    CHECK(s.count() == 2);
+    CHECK(s.at("a").get<int>() == 1);
+    CHECK(s.at("b").get<std::string>() == "two"s);
+
+    std::remove(file_name.c_str());
+
+    // empty files are fine, they just don't have anything in them.
+    { std::ofstream out{file_name}; }
+    CHECK(cfg.parse_file(file_name));
+    CHECK(cfg.get_settings().count() == 0);
+    std::remove(file_name.c_str());
+
+    CHECK_FALSE(cfg.parse_file("this-file-does-not-exist.cfg"));
+
+    std::stringstream buf{};
+    cfg.stream_errors(buf);
+    CHECK(buf.str() == "line 0 : Could not open file this-file-does-not-exist.cfg\n"s);
+}
+
+TEST_CASE("comments") {
+    Configinator5000::Config cfg;
+
+    std::string input = R"DELIM(
+# hash comment
+// line comment
+/* block
+   comment */ a = 1; /**/
+/*****/ b = 2; # trailing comment without a newline)DELIM"s;
+
+    CHECK(cfg.parse(input));
+    CHECK(cfg.get_settings().count() == 2);
+    CHECK(cfg.get_settings().at("b").get<int>() == 2);
+
+    // line numbers still count the newlines inside comments
+    input = R"DELIM(
+/* one
+two
+three */ a = $
+)DELIM"s;
+
+    CHECK_FALSE(cfg.parse(input));
+    std::stringstream buf{};
+    cfg.stream_errors(buf);
+    CHECK(buf.str() == "line 3 : Expecting a value\nline 3 : Not at end of input!\n"s);
+
+    input = R"DELIM(a = 1;
+  /* never closed
+  b = 2;
+)DELIM"s;
+
+    CHECK_FALSE(cfg.parse(input));
+    buf.str("");
+    cfg.stream_errors(buf);
+    CHECK(buf.str() == "line 1 : Unterminated comment starting here\n"s);
+}
+
+TEST_CASE("numbers") {
+    Configinator5000::Config cfg;
+
+    std::string input = R"DELIM(
+i1 = 42; i2 = -17; i3 = +5; i4 = 100L;
+h1 = 0x1F; h2 = 0XfF; h3 = 0xFFFFFFFFFFFFFFFF;
+f1 = 1.5; f2 = -2.; f3 = .25; f4 = 1e3; f5 = -2.5E-2; f6 = 1e-400;
+a1 = [ 1, 2, 3 ]; a2 = [ 1.0, 2, 3.5 ];
+)DELIM"s;
+
+    CHECK(cfg.parse(input));
+
+    auto & s = cfg.get_settings();
+    CHECK(s.at("i1").get<long>() == 42);
+    CHECK(s.at("i2").get<long>() == -17);
+    CHECK(s.at("i3").get<long>() == 5);
+    CHECK(s.at("i4").get<long>() == 100);
+    CHECK(s.at("h1").get<long>() == 31);
+    CHECK(s.at("h2").get<long>() == 255);
+    CHECK(s.at("h3").get<long>() == -1);
+    CHECK(s.at("f1").is_float());
+    CHECK(s.at("f1").get<double>() == 1.5);
+    CHECK(s.at("f2").get<double>() == -2.0);
+    CHECK(s.at("f3").get<double>() == 0.25);
+    CHECK(s.at("f4").is_float());
+    CHECK(s.at("f4").get<double>() == 1000.0);
+    CHECK(s.at("f5").get<double>() == -0.025);
+    CHECK(s.at("f6").get<double>() == 0.0);
+    CHECK(s.at("a1").array_type() == Configinator5000::Setting::setting_type::INTEGER);
+    CHECK(s.at("a2").array_type() == Configinator5000::Setting::setting_type::FLOAT);
+    CHECK(s.at("a2").at(1).get<double>() == 2.0);
+
+    auto error_for = [&cfg](const std::string &in) {
+        cfg.parse(in);
+        std::stringstream buf{};
+        cfg.stream_errors(buf);
+        return buf.str();
+    };
+
+    CHECK(error_for("a = 99999999999999999999;") ==
+            "line 0 : Integer value out of range\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = 0x1FFFFFFFFFFFFFFFF;") ==
+            "line 0 : Hex value out of range\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = 1e999;") ==
+            "line 0 : Float value out of range\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = 12abc;") ==
+            "line 0 : Malformed number\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = 1.2.3;") ==
+            "line 0 : Malformed number\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = 1e;") ==
+            "line 0 : Malformed exponent in number\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = 0xZZ;") ==
+            "line 0 : Hex prefix, but invalid hex number followed\nline 0 : Not at end of input!\n"s);
+
+    CHECK_FALSE(cfg.parse("a = [ 1, 2, 99999999999999999999 ];"));
+
+    // bool right at the end of the input
+    CHECK(cfg.parse("a = true"));
+    CHECK(cfg.get_settings().at("a").get<bool>());
+}
+
+TEST_CASE("string escapes") {
+    Configinator5000::Config cfg;
+
+    std::string input = R"DELIM(
+s1 = "tab\there\nnewline \"quoted\" back\\slash \x41\x4a\x6b";
+s2 = "one " /* comment between */ "two "
+     # and another
+     "three";
+s3 = "";
+s4 = "a long string without any escapes in it at all, long enough to need a heap buffer";
+)DELIM"s;
+
+    CHECK(cfg.parse(input));
+
+    auto & s = cfg.get_settings();
+    CHECK(s.at("s1").get<std::string>() == "tab\there\nnewline \"quoted\" back\\slash AJk"s);
+    CHECK(s.at("s2").get<std::string>() == "one two three"s);
+    CHECK(s.at("s3").get<std::string>() == ""s);
+    CHECK(s.at("s4").get<std::string>() ==
+            "a long string without any escapes in it at all, long enough to need a heap buffer"s);
+
+    auto error_for = [&cfg](const std::string &in) {
+        cfg.parse(in);
+        std::stringstream buf{};
+        cfg.stream_errors(buf);
+        return buf.str();
+    };
+
+    CHECK(error_for("a = \"abc\ndef\";") ==
+            "line 0 : Unterminated string\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = \"abc") ==
+            "line 0 : Unterminated string\n"s);
+    CHECK(error_for("a = \"\\q\";") ==
+            "line 0 : Unrecognized escape sequence in string\nline 0 : Not at end of input!\n"s);
+    CHECK(error_for("a = \"\\xZ1\";") ==
+            "line 0 : Bad hex escape in string\nline 0 : Not at end of input!\n"s);
+}
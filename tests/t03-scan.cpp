@@ -0,0 +1,159 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <scan.hpp>
+
+#include <atomic>
+#include <string>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace Configinator5000;
+
+namespace {
+    // Straight forward versions to check the others against.
+    const char *ref_skip_blanks(const char *p, const char *end, long &lines) {
+        while (p < end and (*p == ' ' or *p == '\t' or *p == '\n' or
+                    *p == '\r' or *p == '\v' or *p == '\f')) {
+            if (*p == '\n') lines += 1;
+            ++p;
+        }
+        return p;
+    }
+
+    const char *ref_find_newline(const char *p, const char *end) {
+        while (p < end and *p != '\n') ++p;
+        return p;
+    }
+
+    const char *ref_find_block_end(const char *p, const char *end, long &lines) {
+        while (p < end) {
+            if (p + 1 < end and p[0] == '*' and p[1] == '/') return p;
+            if (*p == '\n') lines += 1;
+            ++p;
+        }
+        return end;
+    }
+
+    const char *ref_find_string_special(const char *p, const char *end) {
+        while (p < end and *p != '"' and *p != '\\' and *p != '\n') ++p;
+        return p;
+    }
+
+    const char *ref_find_structural(const char *p, const char *end, long &lines) {
+        while (p < end) {
+            switch (*p) {
+                case '{' : case '}' : case '(' : case ')' : case '[' : case ']' :
+                case '"' : case '/' : case '#' :
+                    return p;
+                case '\n' :
+                    lines += 1;
+                    break;
+                default :
+                    break;
+            }
+            ++p;
+        }
+        return end;
+    }
+
+    std::vector<scan::isa> available() {
+        std::vector<scan::isa> retval;
+        for (auto target : { scan::isa::scalar, scan::isa::sse2, scan::isa::avx2 }) {
+            if (scan::force_isa(target)) retval.push_back(target);
+        }
+        return retval;
+    }
+}
+
+TEST_CASE("scanners agree") {
+    std::mt19937 gen{42};
+    // heavy on the interesting characters
+    const std::string alphabet = "   \t\n\r\v\f**//ab\n\"\\{}()[]#[{;";
+    std::uniform_int_distribution<int> pick(0, int(alphabet.size()) - 1);
+    std::uniform_int_distribution<int> len(0, 200);
+
+    auto isas = available();
+    CHECK(isas.size() >= 1);
+
+    for (int round = 0; round < 2000; ++round) {
+        std::string input;
+        int n = len(gen);
+        for (int i = 0; i < n; ++i) input += alphabet[pick(gen)];
+
+        const char *b = input.data();
+        const char *e = b + input.size();
+
+        for (int start = 0; start <= n; start += 7) {
+            long ref_lines = 0;
+            auto ref = ref_skip_blanks(b + start, e, ref_lines);
+            auto ref_nl = ref_find_newline(b + start, e);
+            long ref_block_lines = 0;
+            auto ref_block = ref_find_block_end(b + start, e, ref_block_lines);
+            auto ref_special = ref_find_string_special(b + start, e);
+            long ref_struct_lines = 0;
+            auto ref_struct = ref_find_structural(b + start, e, ref_struct_lines);
+
+            for (auto target : isas) {
+                scan::force_isa(target);
+
+                long lines = 0;
+                CHECK(scan::skip_blanks(b + start, e, lines) == ref);
+                CHECK(lines == ref_lines);
+
+                CHECK(scan::find_newline(b + start, e) == ref_nl);
+
+                long block_lines = 0;
+                CHECK(scan::find_block_end(b + start, e, block_lines) == ref_block);
+                CHECK(block_lines == ref_block_lines);
+
+                CHECK(scan::find_string_special(b + start, e) == ref_special);
+
+                long struct_lines = 0;
+                CHECK(scan::find_structural(b + start, e, struct_lines) == ref_struct);
+                CHECK(struct_lines == ref_struct_lines);
+            }
+        }
+    }
+}
+
+TEST_CASE("all blank") {
+    std::string input(1000, ' ');
+    input[10] = '\n';
+    input[500] = '\n';
+    input[999] = '\n';
+
+    for (auto target : available()) {
+        scan::force_isa(target);
+        long lines = 0;
+        CHECK(scan::skip_blanks(input.data(), input.data() + input.size(), lines) ==
+                input.data() + input.size());
+        CHECK(lines == 3);
+    }
+}
+
+TEST_CASE("switching while scanning") {
+    std::string input(5000, ' ');
+    for (std::size_t i = 0; i < input.size(); i += 100) input[i] = '\n';
+    input += "x";
+    const char *b = input.data();
+    const char *e = b + input.size();
+
+    auto isas = available();
+    std::atomic<bool> done{false};
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> scanners;
+    for (int t = 0; t < 2; ++t) {
+        scanners.emplace_back([&]() {
+            while (not done) {
+                long lines = 0;
+                if (scan::skip_blanks(b, e, lines) != e - 1 or lines != 50) ++wrong;
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i) scan::force_isa(isas[std::size_t(i) % isas.size()]);
+    done = true;
+    for (auto &t : scanners) t.join();
+    CHECK(wrong == 0);
+}
@@ -0,0 +1,97 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+
+#include <string>
+#include <sstream>
+
+using namespace std::literals::string_literals;
+
+namespace {
+    // feed the input `chunk` bytes at a time.
+    bool stream_parse(Configinator5000::StreamingParser &sp, const std::string &input,
+            std::size_t chunk) {
+        for (std::size_t pos = 0; pos < input.size(); pos += chunk) {
+            sp.feed(std::string_view(input).substr(pos, chunk));
+        }
+        return sp.finish();
+    }
+}
+
+TEST_CASE("same tree as Config") {
+    std::string input = R"DELIM(
+# hash comment
+port = 7777;
+name : "hel" /* join */ "lo\t\"world\"\x41";
+ratio = -12.5e-1, hex = 0x1F;
+flags = [ TRUE, false, true ];
+floats = [ 1.0, 2, 3.25 ];
+names = [ "a", "b" "c" ];
+// line comment
+nested = {
+    inner = { deep = ( 1, "two", { three = 3.0 }, [ 4, 5 ] ); };
+    empty_group = {};
+    empty_list = ();
+};
+spaced = 1 ; spaced_flag = true /* before the separator */ ;
+spaced_group = {} , spaced_string = "s"
+  ;
+last = "no newline at the end" )DELIM"s;
+
+    Configinator5000::Config cfg;
+    REQUIRE(cfg.parse(input));
+
+    for (std::size_t chunk = 1; chunk < 14; ++chunk) {
+        Configinator5000::StreamingParser sp;
+        CHECK(stream_parse(sp, input, chunk));
+        CHECK(cfg.get_settings() == sp.get_settings());
+        CHECK(sp.offset() == input.size());
+    }
+}
+
+TEST_CASE("long string across chunks") {
+    std::string body(100000, 'x');
+    body[5000] = '\\';
+    body[5001] = 'n';
+    std::string input = "s = \"" + body + "\";";
+
+    Configinator5000::StreamingParser sp;
+    CHECK(stream_parse(sp, input, 1000));
+
+    std::string expected(100000, 'x');
+    expected.replace(5000, 2, "\n");
+    CHECK(sp.get_settings().at("s").get<std::string>() == expected);
+}
+
+TEST_CASE("streaming errors") {
+    auto error_for = [](const std::string &input, std::size_t chunk) {
+        Configinator5000::StreamingParser sp;
+        stream_parse(sp, input, chunk);
+        std::stringstream buf{};
+        sp.stream_errors(buf);
+        return buf.str();
+    };
+
+    for (std::size_t chunk : { 1, 3, 100 }) {
+        CHECK(error_for("a = 1;\nb = $;", chunk) == "line 1 : Unexpected character\n"s);
+        CHECK(error_for("a = 1;\na = 2;", chunk) ==
+                "line 1 : Setting named a already defined in this context\n"s);
+        CHECK(error_for("a = {\n b = 1;\n", chunk) ==
+                "line 2 : Didn't find close of setting group\n"s);
+        CHECK(error_for("a = [ 1, \"x\" ];", chunk) ==
+                "line 0 : All values in an array must be the same scalar type\n"s);
+        CHECK(error_for("a = 1;\n/* open", chunk) ==
+                "line 1 : Unterminated comment starting here\n"s);
+        CHECK(error_for("a = \"abc", chunk) == "line 0 : Unterminated string\n"s);
+        CHECK(error_for("a 1", chunk) == "line 0 : Expecting : or = after setting name\n"s);
+        CHECK(error_for("a = 99999999999999999999;", chunk) ==
+                "line 0 : Integer value out of range\n"s);
+    }
+
+    // feeding after an error is ignored.
+    Configinator5000::StreamingParser sp;
+    CHECK_FALSE(sp.feed("a = ;"));
+    CHECK_FALSE(sp.feed("b = 2;"));
+    CHECK_FALSE(sp.finish());
+}
@@ -0,0 +1,177 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <parser.hpp>
+
+#include <string>
+#include <sstream>
+
+using namespace std::literals::string_literals;
+using namespace Configinator5000;
+
+namespace {
+    // Writes down every event as a line of text.
+    struct recorder : event_handler {
+        std::string log;
+
+        // composites with this name are skipped.
+        std::string skip_name;
+
+        // stop (or fail if message given) at the scalar with this name.
+        std::string stop_name;
+        std::string stop_message;
+
+        event_action composite(const char *what, std::string_view name) {
+            if (not skip_name.empty() and name == skip_name) {
+                log += "skip "s + what + " " + std::string(name) + "\n";
+                return event_action::skip;
+            }
+            log += "begin "s + what + " " + std::string(name) + "\n";
+            return event_action::proceed;
+        }
+
+        event_action scalar(std::string_view name, const std::string &value) {
+            log += std::string(name) + "=" + value + "\n";
+            if (not stop_name.empty() and name == stop_name) {
+                if (stop_message.empty()) return event_action::stop;
+                return fail(stop_message);
+            }
+            return event_action::proceed;
+        }
+
+        event_action begin_group(std::string_view name) { return composite("group", name); }
+        event_action begin_list(std::string_view name) { return composite("list", name); }
+        event_action begin_array(std::string_view name) { return composite("array", name); }
+
+        event_action end_group() { log += "end group\n"; return event_action::proceed; }
+        event_action end_list() { log += "end list\n"; return event_action::proceed; }
+        event_action end_array() { log += "end array\n"; return event_action::proceed; }
+
+        event_action on_bool(std::string_view name, bool v) {
+            return scalar(name, v ? "true" : "false");
+        }
+        event_action on_integer(std::string_view name, long v) {
+            return scalar(name, std::to_string(v));
+        }
+        event_action on_float(std::string_view name, double v) {
+            return scalar(name, "f" + std::to_string(v));
+        }
+        event_action on_string(std::string_view name, std::string_view v) {
+            return scalar(name, "'" + std::string(v) + "'");
+        }
+    };
+
+    const std::string input = R"(
+a = 1;
+b = { c = "x" "y"; d = [1.5, 2]; };
+e = ( true, "esc\n", { f = 0x10 } );
+g = 3.0;
+)";
+}
+
+TEST_CASE("event order") {
+    recorder r;
+    std::ostringstream errs;
+    REQUIRE(parse_events(input, r, &errs));
+    CHECK(errs.str() == "");
+
+    CHECK(r.log ==
+            "a=1\n"
+            "begin group b\n"
+            "c='xy'\n"
+            "begin array d\n"
+            "=f1.500000\n"
+            "=f2.000000\n"
+            "end array\n"
+            "end group\n"
+            "begin list e\n"
+            "=true\n"
+            "='esc\n'\n"
+            "begin group \n"
+            "f=16\n"
+            "end group\n"
+            "end list\n"
+            "g=f3.000000\n");
+}
+
+TEST_CASE("skip subtree") {
+    recorder r;
+    r.skip_name = "b";
+    REQUIRE(parse_events(input, r));
+    CHECK(r.log ==
+            "a=1\n"
+            "skip group b\n"
+            "begin list e\n"
+            "=true\n"
+            "='esc\n'\n"
+            "begin group \n"
+            "f=16\n"
+            "end group\n"
+            "end list\n"
+            "g=f3.000000\n");
+
+    SUBCASE("brackets in strings and comments") {
+        recorder r2;
+        r2.skip_name = "x";
+        REQUIRE(parse_events("x = { s = \"}\"; # }\n /* ) */ l = ( [ 1 ] ) }\ny = 2", r2));
+        CHECK(r2.log == "skip group x\ny=2\n");
+    }
+
+    SUBCASE("line numbers carry on after a skip") {
+        recorder r2;
+        r2.skip_name = "x";
+        std::ostringstream errs;
+        CHECK_FALSE(parse_events("x = {\n\n\n}\ny = ", r2, &errs));
+        CHECK(errs.str() == "line 4 : Expecting a value\n");
+    }
+
+    SUBCASE("unbalanced") {
+        recorder r2;
+        r2.skip_name = "x";
+        std::ostringstream errs;
+        CHECK_FALSE(parse_events("x = ( [ 1 ) ]", r2, &errs));
+        CHECK(errs.str() == "line 0 : Didn't find close of value array\nline 0 : Not at end of input!\n");
+    }
+}
+
+TEST_CASE("stop and fail") {
+    SUBCASE("stop") {
+        recorder r;
+        r.stop_name = "c";
+        std::ostringstream errs;
+        CHECK(parse_events(input, r, &errs));
+        CHECK(errs.str() == "");
+        CHECK(r.log == "a=1\nbegin group b\nc='xy'\n");
+    }
+
+    SUBCASE("fail") {
+        recorder r;
+        r.stop_name = "g";
+        r.stop_message = "g is not allowed";
+        std::ostringstream errs;
+        CHECK_FALSE(parse_events(input, r, &errs));
+        CHECK(errs.str() == "line 4 : g is not allowed\n");
+    }
+}
+
+TEST_CASE("tree builder") {
+    Setting root{ST::GROUP};
+    Parser p{input, &root};
+    REQUIRE(p.do_parse());
+
+    CHECK(root.at("a").get<long>() == 1);
+    CHECK(root.at("b").at("c").get<std::string>() == "xy");
+    CHECK(root.at("b").at("d").is_array());
+    CHECK(root.at("b").at("d").at(0).get<double>() == 1.5);
+    CHECK(root.at("e").count() == 3);
+    CHECK(root.at("e").at(2).at("f").get<long>() == 16);
+
+    SUBCASE("duplicates") {
+        Setting dup{ST::GROUP};
+        Parser p2{"a = 1; b = { x = 2; x = 3 }", &dup};
+        CHECK_FALSE(p2.do_parse());
+        std::ostringstream errs;
+        errs << p2.errors;
+        CHECK(errs.str() == "line 0 : Setting named x already defined in this context\n");
+    }
+}
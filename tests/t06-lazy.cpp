@@ -0,0 +1,128 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <sstream>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Setting;
+
+namespace {
+    const std::string input = R"DELIM(
+port = 7777;
+name : "hel" /* } join */ "lo";
+flags = [ TRUE, false, true ];
+floats = [ 1.0, 2, 3.25 ];
+# ) comment
+nested = {
+    inner = { deep = ( 1, "two}", { three = 3.0 }, [ 4, 5 ] ); };
+    empty_group = {};
+    empty_list = ();
+};
+last = "end" )DELIM"s;
+}
+
+TEST_CASE("same tree as a full parse") {
+    Configinator5000::Config full;
+    REQUIRE(full.parse(input));
+
+    Configinator5000::Config lazy;
+    REQUIRE(lazy.parse_lazy(input));
+    CHECK(full.get_settings() == lazy.get_settings());
+
+    Configinator5000::Config lazy2;
+    REQUIRE(lazy2.parse_lazy(input));
+    CHECK(lazy2.validate_all());
+    CHECK(lazy2.get_settings() == full.get_settings());
+}
+
+TEST_CASE("touching part of the tree") {
+    Configinator5000::Config cfg;
+    REQUIRE(cfg.parse_lazy(input));
+
+    auto &s = cfg.get_settings();
+    CHECK(s.at("port").get<int>() == 7777);
+
+    auto &nested = s.at("nested");
+    CHECK(nested.is_group());
+    CHECK(nested.at("inner").at("deep").at(1).get<std::string>() == "two}"s);
+    CHECK(nested.at("inner").at("deep").at(3).array_type() == Setting::setting_type::INTEGER);
+
+    int seen = 0;
+    for (auto &f : s.at("flags")) {
+        CHECK(f.is_boolean());
+        seen += 1;
+    }
+    CHECK(seen == 3);
+
+    // adding to a lazy composite keeps what was already there.
+    s.at("floats").add_child(4.5);
+    CHECK(s.at("floats").count() == 4);
+    CHECK(s.at("floats").at(0).get<double>() == 1.0);
+}
+
+TEST_CASE("errors in untouched subtrees") {
+    std::string bad = "a = 1;\n"
+        "good = { x = 1; };\n"
+        "bad = {\n"
+        "   x = 1;\n"
+        "   x = 2;\n"
+        "};\n"
+        "worse = ( 1, 2,\n"
+        "   nope );\n"
+        "b = 2;\n";
+
+    Configinator5000::Config cfg;
+    // only the brackets are checked up front.
+    REQUIRE(cfg.parse_lazy(bad));
+
+    auto &s = cfg.get_settings();
+    CHECK(s.at("b").get<int>() == 2);
+    CHECK(s.at("good").at("x").get<int>() == 1);
+
+    CHECK_THROWS(s.at("bad").at("x"));
+    // still bad the next time.
+    CHECK_THROWS(s.at("bad").count());
+
+    CHECK_FALSE(cfg.validate_all());
+    std::stringstream buf{};
+    cfg.stream_errors(buf);
+    CHECK(buf.str() ==
+            "line 4 : Setting named x already defined in this context\n"
+            "line 7 : Expecting a value\n"
+            "line 7 : Didn't find close of setting list\n"s);
+
+    SUBCASE("bracket errors are found up front") {
+        Configinator5000::Config cfg2;
+        CHECK_FALSE(cfg2.parse_lazy("a = { b = ( 1 };\n"));
+        std::stringstream buf2{};
+        cfg2.stream_errors(buf2);
+        CHECK(buf2.str() ==
+                "line 0 : Didn't find close of setting list\n"
+                "line 0 : Not at end of input!\n"s);
+    }
+}
+
+TEST_CASE("parse_file_lazy") {
+    std::string file_name = "t06-lazy-file.cfg";
+    {
+        std::ofstream out{file_name};
+        out << input;
+    }
+
+    Configinator5000::Config full;
+    REQUIRE(full.parse(input));
+
+    Configinator5000::Config cfg;
+    REQUIRE(cfg.parse_file_lazy(file_name));
+    std::remove(file_name.c_str());
+
+    // the mapping is still good after the file is gone.
+    CHECK(full.get_settings() == cfg.get_settings());
+
+    CHECK_FALSE(cfg.parse_file_lazy("this-file-does-not-exist.cfg"));
+}
@@ -0,0 +1,95 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <work_pool.hpp>
+
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <vector>
+
+using namespace std::literals::string_literals;
+
+namespace {
+    std::string make_config(int groups) {
+        std::string retval = "version = 3;\n";
+        for (int i = 0; i < groups; ++i) {
+            auto n = std::to_string(i);
+            retval += "tenant" + n + " = {\n"
+                "  id = " + n + ";\n"
+                "  name = \"t" + n + "\" /* comment } */;\n"
+                "  limits = [ 1.5, " + n + " ];\n"
+                "  routes = ( { port = " + n + "; }, \"x)\" );\n"
+                "};\n";
+            if (i % 7 == 0) retval += "list" + n + " = ( 1, 2, [ true ] );\n";
+        }
+        retval += "trailer = \"end\";\n";
+        return retval;
+    }
+
+    std::string errors_of(Configinator5000::Config &cfg) {
+        std::stringstream buf{};
+        cfg.stream_errors(buf);
+        return buf.str();
+    }
+}
+
+TEST_CASE("work_pool runs every task once") {
+    for (unsigned threads : { 1u, 2u, 3u, 8u }) {
+        Configinator5000::work_pool pool{threads};
+        CHECK(pool.size() == threads);
+
+        for (std::size_t count : { 0u, 1u, 5u, 1000u }) {
+            std::vector<std::atomic<int>> hits(count);
+            pool.run(count, [&](std::size_t i) {
+                // uneven work so that stealing happens.
+                volatile long spin = 0;
+                for (std::size_t j = 0; j < (i % 10) * 1000; ++j) spin = spin + 1;
+                hits[i].fetch_add(1);
+            });
+
+            bool all_once = true;
+            for (auto &h : hits) all_once = all_once and (h.load() == 1);
+            CHECK(all_once);
+        }
+    }
+}
+
+TEST_CASE("same tree as serial") {
+    auto input = make_config(500);
+
+    Configinator5000::Config serial;
+    REQUIRE(serial.parse(input));
+
+    for (unsigned threads : { 1u, 2u, 4u, 8u }) {
+        Configinator5000::Config cfg;
+        CHECK(cfg.parse_parallel(input, threads));
+        CHECK(serial.get_settings() == cfg.get_settings());
+    }
+}
+
+TEST_CASE("same errors as serial") {
+    auto good = make_config(50);
+
+    std::vector<std::string> bad_inputs = {
+        // duplicate inside a group
+        good + "dup = {\n a = 1;\n a = 2; };\n" + good.substr(13),
+        // duplicate at the top level
+        good + "tenant3 = 1;\n",
+        // bad value deep inside
+        good.substr(0, good.size() / 2) + "oops = { x = ( 1, ; ); };\n" + good.substr(good.size() / 2),
+        // brackets don't match
+        good + "broken = { a = ( 1 };\n",
+    };
+
+    for (auto &input : bad_inputs) {
+        Configinator5000::Config serial;
+        CHECK_FALSE(serial.parse(input));
+
+        Configinator5000::Config cfg;
+        CHECK_FALSE(cfg.parse_parallel(input, 4));
+        CHECK(errors_of(cfg) == errors_of(serial));
+        CHECK(errors_of(cfg) != "");
+    }
+}
@@ -0,0 +1,103 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+
+#include <memory_resource>
+#include <string>
+#include <sstream>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Setting;
+using Configinator5000::tree_memory;
+
+namespace {
+    // Counts what goes through it.
+    struct counting_resource : std::pmr::memory_resource {
+        int allocations = 0;
+        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource();
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            allocations += 1;
+            return upstream->allocate(bytes, alignment);
+        }
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+            upstream->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+            return this == &o;
+        }
+    };
+
+    std::string make_config(int groups) {
+        std::string retval;
+        for (int i = 0; i < groups; ++i) {
+            auto n = std::to_string(i);
+            retval += "group" + n + " = { name = \"a fairly long string so it isn't stored inline " + n +
+                "\"; values = [ 1, 2, 3 ]; list = ( \"x\", { deep = true; } ); };\n";
+        }
+        return retval;
+    }
+}
+
+TEST_CASE("arena trees match heap trees") {
+    auto input = make_config(200);
+
+    Configinator5000::Config heap;
+    REQUIRE(heap.parse(input));
+
+    Configinator5000::Config arena{tree_memory::arena};
+    REQUIRE(arena.parse(input));
+    CHECK(heap.get_settings() == arena.get_settings());
+
+    // parse again into the same arena.
+    REQUIRE(arena.parse("a = 1;"));
+    CHECK(arena.get_settings().count() == 1);
+    REQUIRE(arena.parse(input));
+    CHECK(heap.get_settings() == arena.get_settings());
+
+    Configinator5000::Config lazy{tree_memory::arena};
+    REQUIRE(lazy.parse_lazy(input));
+    CHECK(lazy.validate_all());
+    CHECK(heap.get_settings() == lazy.get_settings());
+
+    Configinator5000::Config parallel{tree_memory::arena};
+    REQUIRE(parallel.parse_parallel(input, 4));
+    CHECK(heap.get_settings() == parallel.get_settings());
+
+    // errors are the same too
+    Configinator5000::Config bad{tree_memory::arena};
+    CHECK_FALSE(bad.parse("a = 1;\nb = ;"));
+    std::stringstream buf{};
+    bad.stream_errors(buf);
+    CHECK(buf.str() == "line 1 : Expecting a value\nline 1 : Not at end of input!\n"s);
+}
+
+TEST_CASE("settings use their parent's resource") {
+    counting_resource counter;
+
+    Setting root{Setting::setting_type::GROUP, &counter};
+    CHECK(root.get_allocator().resource() == &counter);
+
+    auto &list = root.add_child("list", Setting::setting_type::LIST);
+    list.add_child("a string long enough to need its own allocation"s);
+    auto &group = list.add_child(Setting::setting_type::GROUP);
+    group.add_child("key with a long name, longer than fits inline", 1);
+
+    CHECK(list.get_allocator().resource() == &counter);
+    CHECK(list.at(0).get_allocator().resource() == &counter);
+    CHECK(group.get_allocator().resource() == &counter);
+    CHECK(counter.allocations > 0);
+
+    // a copy made the normal way goes on the default heap.
+    Setting copy{root};
+    CHECK(copy.get_allocator().resource() == std::pmr::get_default_resource());
+    CHECK(copy.at("list").at(0).get<std::string>() == "a string long enough to need its own allocation"s);
+
+    // unless asked otherwise
+    int before = counter.allocations;
+    Setting copy2{copy, &counter};
+    CHECK(copy2.get_allocator().resource() == &counter);
+    CHECK(copy2.at("list").at(1).at("key with a long name, longer than fits inline").get<int>() == 1);
+    CHECK(counter.allocations > before);
+}
@@ -0,0 +1,142 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Setting;
+using ST = Setting::setting_type;
+
+namespace {
+    // Counts what goes through it and what is still out.
+    struct counting_resource : std::pmr::memory_resource {
+        int allocations = 0;
+        long outstanding = 0;
+        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource();
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            allocations += 1;
+            outstanding += long(bytes);
+            return upstream->allocate(bytes, alignment);
+        }
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+            outstanding -= long(bytes);
+            upstream->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+            return this == &o;
+        }
+    };
+
+    void fill(Setting &g) {
+        g.add_child("name", "a string long enough not to fit anywhere small");
+        g.add_child("port", 80);
+        g.add_child("ratio", 0.5);
+        g.add_child("on", true);
+        auto &l = g.add_child("list", ST::LIST);
+        l.add_child("x");
+        l.add_child(ST::GROUP).add_child("deep", 3L);
+        g.add_child("empty", ST::ARRAY);
+    }
+
+    void check_filled(Setting &g) {
+        CHECK(g.count() == 6);
+        CHECK(g.at("name").get<std::string>() == "a string long enough not to fit anywhere small");
+        CHECK(g.at("port").get<int>() == 80);
+        CHECK(g.at("ratio").get<double>() == 0.5);
+        CHECK(g.at("on").get<bool>());
+        CHECK(g.at("list").at(0).get<std::string>() == "x");
+        CHECK(g.at("list").at(1).at("deep").get<long>() == 3);
+        CHECK(g.at("empty").count() == 0);
+    }
+}
+
+TEST_CASE("small nodes") {
+    // the type, the memory_resource and one word of value.
+    CHECK(sizeof(Setting) <= 3 * sizeof(void *));
+
+    counting_resource res;
+    {
+        Setting scalars{ST::LIST, &res};
+        scalars.add_child(1);
+        int before = res.allocations;
+
+        // scalars and empty composites don't allocate
+        Setting i{42, &res};
+        Setting f{1.5, &res};
+        Setting b{true, &res};
+        Setting e{""s, &res};
+        Setting g{ST::GROUP, &res};
+        CHECK(res.allocations == before);
+        CHECK(e.get<std::string>() == "");
+        CHECK(g.count() == 0);
+        CHECK_FALSE(g.exists("x"));
+        CHECK(g.begin() == g.end());
+    }
+    CHECK(res.outstanding == 0);
+}
+
+TEST_CASE("copy and move") {
+    counting_resource res;
+    {
+        Setting g{ST::GROUP, &res};
+        fill(g);
+
+        Setting copy{g};
+        check_filled(copy);
+        CHECK(copy.get_allocator().resource() == std::pmr::get_default_resource());
+
+        Setting moved{std::move(copy)};
+        check_filled(moved);
+
+        Setting there{g, &res};
+        check_filled(there);
+        CHECK(there.at("list").at(1).get_allocator().resource() == &res);
+
+        Setting assigned{ST::LIST, &res};
+        assigned = moved;
+        check_filled(assigned);
+        CHECK(assigned.get_allocator().resource() == &res);
+
+        // assign from one of our own children
+        assigned = assigned.at("list");
+        CHECK(assigned.is_list());
+        CHECK(assigned.at(1).at("deep").get<long>() == 3);
+
+        Setting other{ST::BOOL, &res};
+        other = std::move(g);
+        check_filled(other);
+    }
+    CHECK(res.outstanding == 0);
+}
+
+TEST_CASE("changing type gives the memory back") {
+    counting_resource res;
+    {
+        Setting s{ST::GROUP, &res};
+        fill(s);
+        CHECK(res.outstanding > 0);
+
+        s.set_value(7);
+        CHECK(res.outstanding == 0);
+        CHECK(s.get<int>() == 7);
+
+        s.set_value("some text that is not short"s);
+        CHECK(s.get<std::string>() == "some text that is not short");
+
+        // from our own value
+        s.set_value(s.get<std::string_view>().substr(5));
+        CHECK(s.get<std::string>() == "text that is not short");
+
+        s.make_array();
+        CHECK(res.outstanding == 0);
+        s.add_child(1.0);
+        CHECK(s.array_type() == ST::FLOAT);
+        CHECK_THROWS(s.add_child(1));
+    }
+    CHECK(res.outstanding == 0);
+}
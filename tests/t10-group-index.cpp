@@ -0,0 +1,123 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <group_index.hpp>
+#include <configinator5000.hpp>
+
+#include <algorithm>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+using namespace std::literals::string_literals;
+using Configinator5000::group_index;
+using Configinator5000::Setting;
+
+namespace {
+    std::vector<std::string> make_keys(int n) {
+        std::vector<std::string> retval;
+        for (int i = 0; i < n; ++i) {
+            // mix of lengths, including ones longer than a word
+            retval.push_back((i % 3 == 0 ? "a_rather_long_key_name_" : "k") + std::to_string(i));
+        }
+        return retval;
+    }
+}
+
+TEST_CASE("find and insert") {
+    // either side of the switch to a hash table.
+    for (int n : { 0, 1, 4, 5, group_index::small_limit, group_index::small_limit + 1, 1000 }) {
+        group_index idx;
+        auto keys = make_keys(n);
+        for (auto const &k : keys) CHECK(idx.insert(k));
+        CHECK(idx.size() == n);
+
+        for (int i = 0; i < n; ++i) {
+            CHECK(idx.find(keys[i]) == i);
+            CHECK(idx.key(i) == keys[i]);
+            // already there
+            CHECK_FALSE(idx.insert(keys[i]));
+        }
+        CHECK(idx.size() == n);
+
+        CHECK(idx.find("missing") == -1);
+        CHECK(idx.find("") == -1);
+        CHECK(idx.find("k") == -1);
+    }
+}
+
+TEST_CASE("odd keys") {
+    group_index idx;
+    CHECK(idx.insert(""));
+    CHECK(idx.insert("a"));
+    CHECK(idx.insert("a\0b"s));
+    CHECK(idx.insert("a\0c"s));
+    CHECK(idx.insert("12345678"));
+    CHECK(idx.insert("123456789"));
+
+    CHECK(idx.find("") == 0);
+    CHECK(idx.find("a\0c"s) == 3);
+    CHECK(idx.find("12345678") == 4);
+    CHECK(idx.find("1234567") == -1);
+    CHECK_FALSE(idx.insert(""));
+}
+
+TEST_CASE("sorted order") {
+    group_index idx;
+    auto keys = make_keys(100);
+    for (auto const &k : keys) idx.insert(k);
+
+    auto order = idx.sorted();
+    REQUIRE(order.size() == keys.size());
+
+    std::vector<std::string> got;
+    for (int i : order) got.emplace_back(idx.key(i));
+
+    auto want = keys;
+    std::sort(want.begin(), want.end());
+    CHECK(got == want);
+}
+
+TEST_CASE("copy to another resource") {
+    std::pmr::monotonic_buffer_resource pool;
+    group_index idx;
+    auto keys = make_keys(50);
+    for (auto const &k : keys) idx.insert(k);
+
+    group_index copy{idx, &pool};
+    CHECK(copy.get_allocator().resource() == &pool);
+    for (int i = 0; i < 50; ++i) CHECK(copy.find(keys[i]) == i);
+    CHECK(copy.insert("new one"));
+    CHECK(idx.find("new one") == -1);
+}
+
+TEST_CASE("settings by name and by position") {
+    Setting g{Setting::setting_type::GROUP};
+    auto keys = make_keys(40);
+    for (int i = 0; i < 40; ++i) g.add_child(keys[i], i);
+
+    for (int i = 0; i < 40; ++i) {
+        CHECK(g.at(keys[i]).get<int>() == i);
+        CHECK(g.name_at(i) == keys[i]);
+        CHECK(g.exists(keys[i]));
+    }
+    CHECK(g.name_at(-1) == keys.back());
+    CHECK_THROWS(g.name_at(40));
+    CHECK_FALSE(g.exists("nope"));
+    CHECK_THROWS(g.add_child(keys[7], 1));
+
+    // enumerate is still in key order
+    std::string last;
+    int seen = 0;
+    auto &e = g.enumerate();
+    for (auto &iter = e.begin(); not (iter == e.end()); ++iter) {
+        CHECK(last < iter->first);
+        CHECK(iter->second.get<int>() == g.at(iter->first).get<int>());
+        last = iter->first;
+        seen += 1;
+    }
+    CHECK(seen == 40);
+
+    Setting l{Setting::setting_type::LIST};
+    CHECK_THROWS(l.name_at(0));
+}
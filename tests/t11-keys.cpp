@@ -0,0 +1,146 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <key_table.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+using Configinator5000::Setting;
+using Configinator5000::tree_memory;
+
+namespace {
+    std::string make_config(int groups) {
+        std::string retval;
+        for (int i = 0; i < groups; ++i) {
+            retval += "device_" + std::to_string(i) +
+                " = { in = " + std::to_string(i) + "; osc = \"x\"; port = { address = 1; }; };\n";
+        }
+        return retval;
+    }
+
+    // The key text lives in the same place for every group.
+    bool keys_shared(Setting &root) {
+        const char *in = root.at(0).name_at(0).data();
+        for (auto &g : root) {
+            if (g.name_at(0).data() != in) return false;
+        }
+        return true;
+    }
+}
+
+TEST_CASE("key_table") {
+    auto *table = new Configinator5000::key_table();
+
+    auto *a = table->intern("port");
+    CHECK(table->intern("port") == a);
+    CHECK(table->find("port") == a);
+    CHECK(table->find("address") == nullptr);
+    CHECK(a->name() == "port");
+
+    auto *b = table->intern("address");
+    CHECK(b->id != a->id);
+    CHECK(table->size() == 2);
+
+    // through a couple of grows
+    for (int i = 0; i < 1000; ++i) table->intern("k" + std::to_string(i));
+    CHECK(table->size() == 1002);
+    CHECK(table->find("port") == a);
+    CHECK(table->find("k999")->name() == "k999");
+
+    table->release();
+}
+
+TEST_CASE("key_table from several threads") {
+    auto *table = new Configinator5000::key_table();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([table]() {
+            for (int i = 0; i < 2000; ++i) {
+                auto name = "key_" + std::to_string(i);
+                auto *e = table->intern(name);
+                if (e->name() != name) throw std::runtime_error("wrong key");
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    CHECK(table->size() == 2000);
+    table->release();
+}
+
+TEST_CASE("lookup by handle") {
+    Config cfg;
+    auto port = cfg.key("port");
+    auto in = cfg.key("in");
+    auto missing = cfg.key("missing");
+
+    REQUIRE(cfg.parse(make_config(40)));
+    auto &root = cfg.get_settings();
+
+    for (auto &dev : root) {
+        CHECK(dev.exists(in));
+        CHECK(&dev.at(in) == &dev.at("in"));
+        CHECK(dev.at(port).at("address").get<int>() == 1);
+        CHECK_FALSE(dev.exists(missing));
+        CHECK_THROWS(dev.at(missing));
+    }
+    CHECK(keys_shared(root));
+
+    SUBCASE("handles from somewhere else still work") {
+        Config other;
+        auto other_port = other.key("port");
+        CHECK(root.at("device_3").at(other_port).is_group());
+
+        Setting by_hand{Setting::setting_type::GROUP};
+        by_hand.add_child("port", 1);
+        CHECK(by_hand.at(port).get<int>() == 1);
+        CHECK_FALSE(by_hand.exists(in));
+    }
+
+    SUBCASE("new groups share the keys") {
+        auto &g = root.at("device_0").add_child("extra", Setting::setting_type::GROUP);
+        g.add_child("in", 5);
+        CHECK(g.name_at(0).data() == root.at("device_1").name_at(0).data());
+        CHECK(g.at(in).get<int>() == 5);
+    }
+
+    SUBCASE("handles carry on to the next parse") {
+        REQUIRE(cfg.parse("port = 7;"));
+        CHECK(cfg.get_settings().at(port).get<int>() == 7);
+    }
+}
+
+TEST_CASE("groups outliving the Config") {
+    Setting moved;
+    Setting copied;
+    {
+        Config cfg;
+        REQUIRE(cfg.parse(make_config(3)));
+        moved = std::move(cfg.get_settings().at("device_1"));
+        copied = cfg.get_settings().at("device_2");
+    }
+    CHECK(moved.at("in").get<int>() == 1);
+    CHECK(moved.name_at(1) == "osc");
+    CHECK(copied.at("port").at("address").get<int>() == 1);
+}
+
+TEST_CASE("lazy, parallel and arena trees") {
+    std::string input = make_config(50);
+
+    Config lazy;
+    REQUIRE(lazy.parse_lazy(input));
+    CHECK(keys_shared(lazy.get_settings()));
+    CHECK(lazy.get_settings().at("device_9").at(lazy.key("in")).get<int>() == 9);
+
+    Config parallel{tree_memory::arena};
+    REQUIRE(parallel.parse_parallel(input, 4));
+    CHECK(keys_shared(parallel.get_settings()));
+    CHECK(parallel.get_settings().at("device_7").at(parallel.key("port")).is_group());
+}
@@ -0,0 +1,180 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <path.hpp>
+
+#include <string>
+#include <utility>
+
+using namespace std::literals::string_literals;
+using namespace Configinator5000::literals;
+using Configinator5000::Config;
+using Configinator5000::Path;
+using Configinator5000::Setting;
+
+namespace {
+    const char *config_text =
+        "midi = {\n"
+        "  devices = ( { in = 1; name = \"a\"; }, { in = 2; name = \"b\"; } );\n"
+        "  ports = [ 10, 20, 30 ];\n"
+        "};\n"
+        "gain = 0.5;\n";
+
+    // checked by the compiler
+    constexpr auto second_in = "midi.devices[1].in"_path;
+    static_assert(second_in.size() == 4);
+    static_assert(second_in[2].is_index and second_in[2].index == 1);
+    static_assert(second_in[3].key.name == "in");
+    static_assert(second_in[3].key.hash == Configinator5000::key_hash("in"));
+}
+
+TEST_CASE("path parsing") {
+    CHECK(Path("").size() == 0);
+    CHECK(Path("gain").size() == 1);
+    CHECK(Path("midi.ports[-1]").size() == 3);
+    CHECK(Path("midi.ports.[2]").size() == 3);
+    CHECK(Path("a[1][2].b").size() == 4);
+    CHECK(Path("midi.devices[0]").str() == "midi.devices[0]");
+
+    CHECK_THROWS(Path("a."));
+    CHECK_THROWS(Path(".a"));
+    CHECK_THROWS(Path("a..b"));
+    CHECK_THROWS(Path("a[]"));
+    CHECK_THROWS(Path("a[x]"));
+    CHECK_THROWS(Path("a[1"));
+    CHECK_THROWS(Path("a[1]b"));
+    CHECK_THROWS(Path("a]"));
+    CHECK_THROWS(Path("a[99999999999]"));
+}
+
+TEST_CASE("path find") {
+    Config cfg;
+    REQUIRE(cfg.parse(config_text));
+    auto &root = cfg.get_settings();
+
+    CHECK(Path("").find(root) == &root);
+    CHECK(Path("gain").find(root) == &root.at("gain"));
+    CHECK(Path("midi.devices[1].in").find(root)->get<long>() == 2);
+    CHECK(Path("midi.devices[-2].name").find(root)->get<std::string>() == "a");
+    CHECK(Path("midi.ports[2]").find(root)->get<long>() == 30);
+    CHECK(Path("midi.ports.[0]").find(root)->get<long>() == 10);
+    CHECK(Path(second_in).find(root)->get<long>() == 2);
+
+    // misses are null, not exceptions.
+    CHECK(Path("nope").find(root) == nullptr);
+    CHECK(Path("midi.devices[2]").find(root) == nullptr);
+    CHECK(Path("midi.devices[-3]").find(root) == nullptr);
+    CHECK(Path("gain.x").find(root) == nullptr);
+    CHECK(Path("gain[0]").find(root) == nullptr);
+    // groups can be indexed, as with at(int).
+    CHECK(Path("midi[0]").find(root) == &root.at("midi").at("devices"));
+    CHECK(Path("midi.ports.x").find(root) == nullptr);
+
+    // trees that aren't from a Config.
+    Setting s{Setting::setting_type::GROUP};
+    s.add_child("x", Setting::setting_type::LIST).add_child(Setting::setting_type::INTEGER) = 4L;
+    CHECK(Path("x[0]").find(s)->get<long>() == 4);
+}
+
+TEST_CASE("path copy and move") {
+    Config cfg;
+    REQUIRE(cfg.parse(config_text));
+    auto &root = cfg.get_settings();
+
+    // short enough to be kept inside the string itself.
+    Path p{"midi.ports[1]"};
+    Path copy{p};
+    Path moved{std::move(p)};
+    CHECK(copy.find(root)->get<long>() == 20);
+    CHECK(moved.find(root)->get<long>() == 20);
+
+    Path long_one{"midi.devices[0].name.and.a.lot.more.to.make.it.long"};
+    Path assigned{"gain"};
+    assigned = long_one;
+    CHECK(assigned.size() == long_one.size());
+    assigned = Path("midi.devices[0].name");
+    CHECK(assigned.find(root)->get<std::string>() == "a");
+
+    // the steps of a literal are taken as they are, with the keys then in
+    // the Path's own text.
+    Path from_literal{second_in};
+    CHECK(from_literal.size() == second_in.size());
+    CHECK(from_literal.str() == "midi.devices[1].in");
+    Path moved_literal{std::move(from_literal)};
+    CHECK(moved_literal.find(root)->get<long>() == 2);
+}
+
+TEST_CASE("path resolve") {
+    Path p{"midi.devices[0].in"};
+
+    Config cfg;
+    CHECK(cfg.generation() == 0);
+    CHECK(p.resolve(cfg) == nullptr);
+
+    REQUIRE(cfg.parse(config_text));
+    auto first = cfg.generation();
+    CHECK(first != 0);
+
+    Setting *in = p.resolve(cfg);
+    REQUIRE(in != nullptr);
+    CHECK(in->get<long>() == 1);
+    CHECK(p.resolve(cfg) == in);
+
+    SUBCASE("edits") {
+        cfg.get_settings().at("midi").at("devices").at(0).at("in") = 5L;
+        CHECK(p.resolve(cfg)->get<long>() == 5);
+
+        cfg.tree_changed();
+        CHECK(cfg.generation() != first);
+        CHECK(p.resolve(cfg) == in);
+    }
+
+    SUBCASE("other configs") {
+        Config other;
+        REQUIRE(other.parse(config_text));
+        CHECK(other.generation() != cfg.generation());
+        CHECK(p.resolve(other) == p.find(other.get_settings()));
+        CHECK(p.resolve(other) != in);
+    }
+
+    SUBCASE("added settings") {
+        // more children can move the ones already there.
+        using ST = Setting::setting_type;
+        REQUIRE(cfg.parse("g = { a = 1; };"));
+        Path a{"g.a"};
+        REQUIRE(a.resolve(cfg) != nullptr);
+
+        auto &g = cfg.get_settings().at("g");
+        for (int i = 0; i < 100; ++i) g.add_child("x" + std::to_string(i), 2L);
+        CHECK(a.resolve(cfg) == &g.at("a"));
+        CHECK(a.resolve(cfg)->get<long>() == 1);
+
+        // a group from outside the tree, and then more under it.
+        Setting extra{ST::GROUP};
+        extra.add_child("b", ST::LIST).add_child(3L);
+        g.add_child("extra", std::move(extra));
+
+        Path b{"g.extra.b[0]"};
+        REQUIRE(b.resolve(cfg) != nullptr);
+        auto &list = g.at("extra").at("b");
+        for (int i = 0; i < 100; ++i) list.add_child(4L);
+        CHECK(b.resolve(cfg) == &list.at(0));
+        CHECK(b.resolve(cfg)->get<long>() == 3);
+
+        // replacing frees them.
+        g = Setting{ST::GROUP};
+        CHECK(a.resolve(cfg) == nullptr);
+        cfg.get_settings().at("g").add_child("a", 5L);
+        CHECK(a.resolve(cfg)->get<long>() == 5);
+    }
+
+    SUBCASE("new tree") {
+        REQUIRE(cfg.parse("midi = { devices = ( { in = 7; } ); };"));
+        CHECK(cfg.generation() != first);
+        CHECK(p.resolve(cfg)->get<long>() == 7);
+
+        REQUIRE(cfg.parse("midi = 1;"));
+        CHECK(p.resolve(cfg) == nullptr);
+    }
+}
@@ -0,0 +1,210 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <snapshot.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+using Configinator5000::FrozenSetting;
+using Configinator5000::Setting;
+
+namespace {
+    const char *config_text =
+        "name = \"mixer\";\n"
+        "empty = \"\";\n"
+        "on = true;\n"
+        "off = false;\n"
+        "gain = -0.25;\n"
+        "port = 9000;\n"
+        "big = 12345678901;\n"
+        "midi = {\n"
+        "  devices = ( { in = 1; name = \"a\"; }, { in = 2; name = \"b\"; } );\n"
+        "  ports = [ 10, 20, 30 ];\n"
+        "  nothing = ( );\n"
+        "  none = { };\n"
+        "};\n";
+
+    std::string read_file(const std::string &file_name) {
+        std::ifstream strm{file_name, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>(strm),
+            std::istreambuf_iterator<char>()};
+    }
+
+    void write_file(const std::string &file_name, const std::string &contents) {
+        std::ofstream strm{file_name, std::ios::binary};
+        strm << contents;
+    }
+
+    std::string errors(Config &cfg) {
+        std::stringstream buf;
+        cfg.stream_errors(buf);
+        return buf.str();
+    }
+}
+
+TEST_CASE("snapshot round trip") {
+    std::string file_name = "t13-snapshot.snap";
+
+    Config cfg;
+    REQUIRE(cfg.parse(config_text));
+    REQUIRE(cfg.write_snapshot(file_name));
+
+    Config snap;
+    REQUIRE(snap.open_snapshot(file_name));
+    CHECK(snap.get_settings().count() == 0);
+
+    FrozenSetting root = snap.get_frozen();
+    CHECK(root.is_group());
+    CHECK(root.count() == 8);
+
+    CHECK(root.at("name").get<std::string>() == "mixer");
+    CHECK(root.at("empty").get<std::string>() == "");
+    CHECK(root.at("on").get<bool>() == true);
+    CHECK(root.at("off").get<bool>() == false);
+    CHECK(root.at("gain").get<double>() == -0.25);
+    CHECK(root.at("port").get<int>() == 9000);
+    CHECK(root.at("port").get<double>() == 9000.0);
+    CHECK(root.at("big").get<long>() == 12345678901L);
+    CHECK_THROWS(root.at("name").get<long>());
+    CHECK_THROWS(root.at("port").get<std::string>());
+
+    auto midi = root.at("midi");
+    CHECK(midi.name_at(0) == "devices");
+    CHECK(midi.name_at(-1) == "none");
+    CHECK(midi.at("devices").is_list());
+    CHECK(midi.at("devices").at(-1).at("name").get<std::string>() == "b");
+    CHECK(midi.at("ports").is_array());
+    CHECK(midi.at("ports").array_type() == Setting::setting_type::INTEGER);
+    CHECK(midi.at("ports").at(2).get<long>() == 30);
+    CHECK(midi.at("nothing").count() == 0);
+    CHECK(midi.at("none").count() == 0);
+
+    CHECK(root.exists("midi"));
+    CHECK_FALSE(root.exists("nope"));
+    CHECK_FALSE(root.at("port").exists("nope"));
+    CHECK_THROWS(root.at("nope"));
+    CHECK_THROWS(midi.at("ports").at(3));
+    CHECK_THROWS(midi.at("ports").at("x"));
+
+    long sum = 0;
+    for (auto p : midi.at("ports")) sum += p.get<long>();
+    CHECK(sum == 60);
+
+    // parsing again lets go of the snapshot.
+    REQUIRE(snap.parse("a = 1;"));
+    CHECK_THROWS(snap.get_frozen());
+
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("snapshot big groups") {
+    std::string file_name = "t13-snapshot-big.snap";
+
+    std::string text;
+    for (int i = 0; i < 500; ++i) {
+        text += "key_" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+
+    Config cfg;
+    REQUIRE(cfg.parse(text));
+    REQUIRE(cfg.write_snapshot(file_name));
+
+    Config snap;
+    REQUIRE(snap.open_snapshot(file_name));
+    auto root = snap.get_frozen();
+
+    bool all_there = true;
+    for (int i = 0; i < 500; ++i) {
+        auto key = "key_" + std::to_string(i);
+        if (root.at(key).get<int>() != i or root.name_at(i) != key) all_there = false;
+    }
+    CHECK(all_there);
+    CHECK_FALSE(root.exists("key_500"));
+
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("snapshot from snapshot") {
+    std::string file_name = "t13-snapshot-a.snap";
+    std::string copy_name = "t13-snapshot-b.snap";
+
+    Config cfg;
+    REQUIRE(cfg.parse_lazy(config_text));
+    REQUIRE(cfg.write_snapshot(file_name));
+
+    Config snap;
+    REQUIRE(snap.open_snapshot(file_name));
+    REQUIRE(snap.write_snapshot(copy_name));
+    CHECK(read_file(file_name) == read_file(copy_name));
+
+    // a lazy tree with a mistake in it.
+    Config bad;
+    REQUIRE(bad.parse_lazy("a = { b = ; };"));
+    CHECK_FALSE(bad.write_snapshot(file_name));
+    CHECK(read_file(file_name) == read_file(copy_name));
+
+    std::remove(file_name.c_str());
+    std::remove(copy_name.c_str());
+}
+
+TEST_CASE("bad snapshots") {
+    std::string file_name = "t13-snapshot-bad.snap";
+
+    Config cfg;
+    CHECK_THROWS(cfg.get_frozen());
+
+    CHECK_FALSE(cfg.open_snapshot("this-file-does-not-exist.snap"));
+    CHECK(errors(cfg) == "line 0 : Could not open file this-file-does-not-exist.snap\n"s);
+
+    write_file(file_name, "a = 1;\n");
+    CHECK_FALSE(cfg.open_snapshot(file_name));
+    CHECK(errors(cfg) == "line 0 : "s + file_name + " : Not a snapshot\n");
+
+    REQUIRE(cfg.parse(config_text));
+    REQUIRE(cfg.write_snapshot(file_name));
+    std::string good = read_file(file_name);
+
+    SUBCASE("byte order") {
+        std::string swapped = good;
+        std::swap(swapped[12], swapped[15]);
+        std::swap(swapped[13], swapped[14]);
+        write_file(file_name, swapped);
+        CHECK_FALSE(cfg.open_snapshot(file_name));
+        CHECK(errors(cfg).find("other byte order") != std::string::npos);
+    }
+
+    SUBCASE("version") {
+        std::string newer = good;
+        newer[8] = char(newer[8] + 1);
+        write_file(file_name, newer);
+        CHECK_FALSE(cfg.open_snapshot(file_name));
+        CHECK(errors(cfg).find("not supported") != std::string::npos);
+    }
+
+    SUBCASE("truncated") {
+        write_file(file_name, good.substr(0, good.size() - 1));
+        CHECK_FALSE(cfg.open_snapshot(file_name));
+        CHECK(errors(cfg).find("corrupt") != std::string::npos);
+    }
+
+    SUBCASE("bad links") {
+        // point the root's children past the end (node 0 is after the
+        // 104 byte header).
+        std::string broken = good;
+        std::uint32_t far = 1000000;
+        std::memcpy(&broken[104 + 8], &far, sizeof far);
+        write_file(file_name, broken);
+        REQUIRE(cfg.open_snapshot(file_name));
+        CHECK_THROWS(cfg.get_frozen().at(0));
+        CHECK_THROWS(cfg.get_frozen().at("name"));
+    }
+
+    std::remove(file_name.c_str());
+}
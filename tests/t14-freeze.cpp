@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <snapshot.hpp>
+
+#include <cstdio>
+#include <string>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+using Configinator5000::FrozenSetting;
+using Configinator5000::Setting;
+using Configinator5000::tree_memory;
+
+namespace {
+    const char *config_text =
+        "name = \"mixer\";\n"
+        "gain = 0.5;\n"
+        "midi = {\n"
+        "  devices = ( { in = 1; name = \"a\"; }, { in = 2; name = \"b\"; } );\n"
+        "  ports = [ 10, 20, 30 ];\n"
+        "};\n";
+
+    // Is frozen the same as s, all the way down?
+    bool same(Setting &s, FrozenSetting frozen) {
+        if (s.is_group() != frozen.is_group() or s.is_list() != frozen.is_list() or
+                s.is_array() != frozen.is_array() or s.count() != frozen.count()) {
+            return false;
+        }
+
+        if (s.is_integer()) return frozen.is_integer() and s.get<long>() == frozen.get<long>();
+        if (s.is_float()) return frozen.is_float() and s.get<double>() == frozen.get<double>();
+        if (s.is_boolean()) return frozen.is_boolean() and s.get<bool>() == frozen.get<bool>();
+        if (s.is_string()) {
+            return frozen.is_string() and
+                s.get<std::string_view>() == frozen.get<std::string_view>();
+        }
+
+        for (int i = 0; i < s.count(); ++i) {
+            if (s.is_group() and s.name_at(i) != frozen.name_at(i)) return false;
+            if (not same(s.at(i), frozen.at(i))) return false;
+        }
+        return true;
+    }
+}
+
+TEST_CASE("freeze") {
+    Config original;
+    REQUIRE(original.parse(config_text));
+
+    Config cfg;
+    REQUIRE(cfg.parse(config_text));
+    REQUIRE(cfg.freeze());
+    CHECK(cfg.get_settings().count() == 0);
+
+    auto root = cfg.get_frozen();
+    CHECK(same(original.get_settings(), root));
+    CHECK(root.at("midi").at("devices").at(1).at("in").get<int>() == 2);
+
+    // iteration is in the order the children were added.
+    std::string names;
+    for (auto d : root.at("midi").at("devices")) names += d.at("name").get<std::string>();
+    CHECK(names == "ab");
+
+    // already frozen.
+    CHECK(cfg.freeze());
+    CHECK(cfg.get_frozen().count() == root.count());
+
+    SUBCASE("write what was frozen") {
+        std::string file_name = "t14-freeze.snap";
+        REQUIRE(cfg.write_snapshot(file_name));
+
+        Config snap;
+        REQUIRE(snap.open_snapshot(file_name));
+        CHECK(same(original.get_settings(), snap.get_frozen()));
+
+        std::remove(file_name.c_str());
+    }
+
+    SUBCASE("parse again") {
+        REQUIRE(cfg.parse("a = 1;"));
+        CHECK_THROWS(cfg.get_frozen());
+        CHECK(cfg.get_settings().at("a").get<int>() == 1);
+    }
+}
+
+TEST_CASE("freeze other trees") {
+    SUBCASE("lazy") {
+        Config cfg;
+        REQUIRE(cfg.parse_lazy(config_text));
+        REQUIRE(cfg.freeze());
+        CHECK(cfg.get_frozen().at("midi").at("ports").at(-1).get<int>() == 30);
+
+        Config bad;
+        REQUIRE(bad.parse_lazy("a = { b = ; };"));
+        CHECK_FALSE(bad.freeze());
+        CHECK_THROWS(bad.get_frozen());
+    }
+
+    SUBCASE("arena") {
+        Config cfg{tree_memory::arena};
+        REQUIRE(cfg.parse(config_text));
+        REQUIRE(cfg.freeze());
+        CHECK(cfg.get_frozen().at("name").get<std::string>() == "mixer");
+    }
+
+    SUBCASE("nothing parsed") {
+        Config cfg;
+        CHECK_FALSE(cfg.freeze());
+    }
+}
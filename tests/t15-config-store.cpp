@@ -0,0 +1,165 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <config_store.hpp>
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+using Configinator5000::ConfigHandle;
+using Configinator5000::ConfigStore;
+
+namespace {
+    std::string version(int v) {
+        return "version = " + std::to_string(v) + ";\n"
+            "check = { twice = " + std::to_string(v * 2) + "; name = \"v" +
+            std::to_string(v) + "\"; };\n";
+    }
+
+    int version_of(const ConfigHandle &h) {
+        return h->get_settings().at("version").get<int>();
+    }
+}
+
+TEST_CASE("config store") {
+    ConfigStore store;
+
+    CHECK_FALSE(store.read());
+
+    REQUIRE(store.reload(version(1)));
+    auto first = store.read();
+    REQUIRE(first);
+    CHECK(version_of(first) == 1);
+
+    // readers keep what they had.
+    REQUIRE(store.reload(version(2)));
+    CHECK(version_of(first) == 1);
+    CHECK(version_of(store.read()) == 2);
+    CHECK(store.retired() == 1);
+
+    first.release();
+    store.reclaim();
+    CHECK(store.retired() == 0);
+
+    SUBCASE("failed reload") {
+        CHECK_FALSE(store.reload("version = ;"));
+        CHECK(version_of(store.read()) == 2);
+
+        std::stringstream buf;
+        store.stream_errors(buf);
+        CHECK_FALSE(buf.str().empty());
+    }
+
+    SUBCASE("lazy configs are finished first") {
+        auto cfg = std::make_unique<Config>();
+        REQUIRE(cfg->parse_lazy(version(3)));
+        REQUIRE(store.publish(std::move(cfg)));
+        CHECK(store.read()->get_settings().at("check").at("twice").get<int>() == 6);
+
+        auto bad = std::make_unique<Config>();
+        REQUIRE(bad->parse_lazy("version = 4; check = { twice = ; };"));
+        CHECK_FALSE(store.publish(std::move(bad)));
+        CHECK(version_of(store.read()) == 3);
+    }
+
+    SUBCASE("lots of handles") {
+        std::vector<ConfigHandle> handles;
+        for (int i = 0; i < 100; ++i) handles.push_back(store.read());
+        int before = version_of(handles.front());
+
+        REQUIRE(store.reload(version(5)));
+        CHECK(store.retired() == 1);
+        CHECK(version_of(handles.back()) == before);
+
+        // moving doesn't let go.
+        ConfigHandle moved = std::move(handles.back());
+        handles.clear();
+        store.reclaim();
+        CHECK(store.retired() == 1);
+        CHECK(version_of(moved) == before);
+
+        moved = store.read();
+        store.reclaim();
+        CHECK(store.retired() == 0);
+        CHECK(version_of(moved) == 5);
+    }
+}
+
+TEST_CASE("config store threads") {
+    ConfigStore store;
+    REQUIRE(store.reload(version(0)));
+
+    std::atomic<bool> done{false};
+    std::atomic<long> reads{0};
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            int last = 0;
+            while (not done.load()) {
+                auto h = store.read();
+                auto &root = h->get_settings();
+                int v = root.at("version").get<int>();
+                if (root.at("check").at("twice").get<int>() != v * 2 or
+                        root.at("check").at("name").get<std::string>() != "v" + std::to_string(v) or
+                        v < last) {
+                    torn.fetch_add(1);
+                }
+                last = v;
+                reads.fetch_add(1);
+            }
+        });
+    }
+
+    for (int v = 1; v <= 300; ++v) {
+        REQUIRE(store.reload(version(v)));
+        if (v % 50 == 0) std::this_thread::yield();
+    }
+
+    done = true;
+    for (auto &t : readers) t.join();
+
+    CHECK(torn.load() == 0);
+    CHECK(reads.load() > 0);
+    CHECK(version_of(store.read()) == 300);
+
+    store.reclaim();
+    CHECK(store.retired() == 0);
+}
+
+TEST_CASE("config store publishers on several threads") {
+    ConfigStore store;
+    REQUIRE(store.reload(version(0)));
+
+    // state kept from the changes alone, as a subscriber would.
+    int seen = 0;
+    std::atomic<int> inside{0};
+    std::atomic<int> overlapped{0};
+    std::atomic<int> out_of_order{0};
+    store.subscribe("version", [&](const Configinator5000::setting_change &change) {
+        if (inside.fetch_add(1) != 0) overlapped.fetch_add(1);
+        if (change.before->get<int>() != seen) out_of_order.fetch_add(1);
+        seen = change.after->get<int>();
+        std::this_thread::yield();
+        inside.fetch_sub(1);
+    });
+
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 4; ++t) {
+        publishers.emplace_back([&, t]() {
+            for (int v = 1; v <= 100; ++v) store.reload(version(t * 1000 + v));
+        });
+    }
+    for (auto &t : publishers) t.join();
+
+    CHECK(overlapped.load() == 0);
+    CHECK(out_of_order.load() == 0);
+    CHECK(seen == version_of(store.read()));
+}
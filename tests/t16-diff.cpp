@@ -0,0 +1,140 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <config_store.hpp>
+#include <diff.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+using Configinator5000::ConfigStore;
+using Configinator5000::setting_change;
+
+namespace {
+    using change_type = setting_change::change_type;
+
+    const char *base =
+        "name = \"mixer\";\n"
+        "gain = 0.5;\n"
+        "midi = {\n"
+        "  devices = ( { in = 1; name = \"a\"; }, { in = 2; name = \"b\"; } );\n"
+        "  ports = [ 10, 20, 30 ];\n"
+        "};\n";
+
+    // "type path" for each change, to compare easily.
+    std::vector<std::string> changes(const char *before, const char *after) {
+        Config a, b;
+        REQUIRE(a.parse(before));
+        REQUIRE(b.parse(after));
+
+        std::vector<std::string> retval;
+        for (auto const &c : Configinator5000::diff(a.get_settings(), b.get_settings())) {
+            const char *type = c.type == change_type::added ? "added " :
+                c.type == change_type::removed ? "removed " : "changed ";
+            retval.push_back(type + c.path);
+        }
+        return retval;
+    }
+
+    using strings = std::vector<std::string>;
+}
+
+TEST_CASE("diff") {
+    CHECK(changes(base, base).empty());
+
+    // same settings, keys in another order, different layout.
+    CHECK(changes(base,
+        "midi = { ports = [ 10, 20, 30 ];\n"
+        "  devices = ( { name = \"a\"; in = 1; }, { in = 2; name = \"b\"; } ); };\n"
+        "gain = 0.5; name = \"mixer\";\n").empty());
+
+    std::string text = base;
+    auto edit = [&text](const std::string &from, const std::string &to) {
+        std::string retval = text;
+        retval.replace(retval.find(from), from.size(), to);
+        return retval;
+    };
+
+    CHECK(changes(base, edit("in = 2", "in = 3").c_str()) == strings{"changed midi.devices[1].in"});
+    CHECK(changes(base, edit("0.5", "0.75").c_str()) == strings{"changed gain"});
+    CHECK(changes(base, edit("0.5", "1").c_str()) == strings{"changed gain"});
+    CHECK(changes(base, edit("\"mixer\"", "\"mixes\"").c_str()) == strings{"changed name"});
+    CHECK(changes(base, edit("[ 10, 20, 30 ]", "( 10, 20, 30 )").c_str()) ==
+            strings{"changed midi.ports"});
+    CHECK(changes(base, edit("[ 10, 20, 30 ]", "[ 10, 20 ]").c_str()) ==
+            strings{"removed midi.ports[2]"});
+    strings grew{"changed midi.ports[1]", "added midi.ports[3]"};
+    CHECK(changes(base, edit("[ 10, 20, 30 ]", "[ 10, 25, 30, 40 ]").c_str()) == grew);
+    strings renamed{"added volume", "removed gain"};
+    CHECK(changes(base, edit("gain = 0.5;", "volume = 11;").c_str()) == renamed);
+    CHECK(changes(base, edit("name = \"a\"; }", "name = \"a\"; out = 4; }").c_str()) ==
+            strings{"added midi.devices[0].out"});
+
+    // the Settings are the ones in the trees.
+    Config a, b;
+    REQUIRE(a.parse(base));
+    REQUIRE(b.parse(edit("in = 2", "in = 3")));
+    auto found = Configinator5000::diff(a.get_settings(), b.get_settings());
+    REQUIRE(found.size() == 1);
+    CHECK(found[0].before->get<int>() == 2);
+    CHECK(found[0].after->get<int>() == 3);
+}
+
+TEST_CASE("path overlaps") {
+    using Configinator5000::path_overlaps;
+
+    CHECK(path_overlaps("midi.devices[1].in", ""));
+    CHECK(path_overlaps("midi.devices[1].in", "midi"));
+    CHECK(path_overlaps("midi.devices[1].in", "midi.devices"));
+    CHECK(path_overlaps("midi.devices[1].in", "midi.devices[1]"));
+    CHECK(path_overlaps("midi", "midi.devices[1]"));
+    CHECK_FALSE(path_overlaps("midi.devices[1].in", "midi.devices[0]"));
+    CHECK_FALSE(path_overlaps("midi.devices[1].in", "mid"));
+    CHECK_FALSE(path_overlaps("midi.ports", "midi.devices"));
+    CHECK_FALSE(path_overlaps("midi.devices[10]", "midi.devices[1]"));
+}
+
+TEST_CASE("subscribers") {
+    ConfigStore store;
+    REQUIRE(store.reload(base));
+
+    std::vector<std::string> midi, devices, gain, everything;
+    store.subscribe("midi", [&](const setting_change &c) { midi.push_back(c.path); });
+    int id = store.subscribe("midi.devices.[1]", [&](const setting_change &c) {
+        devices.push_back(c.path);
+    });
+    store.subscribe("gain", [&](const setting_change &c) {
+        gain.push_back(std::to_string(c.before->get<double>()) + " " +
+                std::to_string(c.after->get<double>()));
+    });
+    store.subscribe("", [&](const setting_change &c) { everything.push_back(c.path); });
+
+    CHECK_THROWS(store.subscribe("midi.", [](const setting_change &) {}));
+
+    std::string text = base;
+    text.replace(text.find("in = 2"), 6, "in = 5");
+    text.replace(text.find("0.5"), 3, "0.25");
+    REQUIRE(store.reload(text));
+
+    CHECK(midi == strings{"midi.devices[1].in"});
+    CHECK(devices == strings{"midi.devices[1].in"});
+    CHECK(gain == strings{"0.500000 0.250000"});
+    strings both{"gain", "midi.devices[1].in"};
+    CHECK(everything == both);
+
+    // nothing changed, nobody is told.
+    REQUIRE(store.reload(text));
+    CHECK(everything.size() == 2);
+
+    store.unsubscribe(id);
+    REQUIRE(store.reload(base));
+    CHECK(midi.size() == 2);
+    CHECK(devices.size() == 1);
+    CHECK(everything.size() == 4);
+
+    // a failed reload isn't a change.
+    CHECK_FALSE(store.reload("midi = ;"));
+    CHECK(everything.size() == 4);
+}
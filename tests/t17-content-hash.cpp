@@ -0,0 +1,261 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+using Configinator5000::Setting;
+
+namespace {
+    using st = Setting::setting_type;
+
+    const char *base =
+        "name = \"mixer\";\n"
+        "gain = 0.5;\n"
+        "midi = {\n"
+        "  devices = ( { in = 1; name = \"a\"; }, { in = 2; name = \"b\"; } );\n"
+        "  ports = [ 10, 20, 30 ];\n"
+        "};\n";
+
+    std::string edit(std::string text, const std::string &from, const std::string &to) {
+        text.replace(text.find(from), from.size(), to);
+        return text;
+    }
+}
+
+TEST_CASE("equal trees") {
+    Config a, b;
+    REQUIRE(a.parse(base));
+
+    // keys in another order, different layout.
+    REQUIRE(b.parse(
+        "midi = { ports = [ 10, 20, 30 ];\n"
+        "  devices = ( { name = \"a\"; in = 1; }, { in = 2; name = \"b\"; } ); };\n"
+        "gain = 0.5; name = \"mixer\";\n"));
+
+    CHECK(a.get_settings().content_hash() == b.get_settings().content_hash());
+    CHECK(a.get_settings() == b.get_settings());
+
+    // and the heap and the arena make no difference.
+    Config c{Configinator5000::tree_memory::arena};
+    REQUIRE(c.parse(base));
+    CHECK(c.get_settings() == a.get_settings());
+    CHECK(c.get_settings().content_hash() == a.get_settings().content_hash());
+}
+
+TEST_CASE("different trees") {
+    Config a;
+    REQUIRE(a.parse(base));
+    auto &root = a.get_settings();
+
+    std::vector<std::string> others{
+        edit(base, "in = 2", "in = 3"),
+        edit(base, "0.5", "0.25"),
+        edit(base, "\"mixer\"", "\"mixes\""),
+        edit(base, "[ 10, 20, 30 ]", "[ 30, 20, 10 ]"),
+        edit(base, "[ 10, 20, 30 ]", "( 10, 20, 30 )"),
+        edit(base, "[ 10, 20, 30 ]", "[ 10, 20 ]"),
+        edit(base, "gain = 0.5;", "volume = 0.5;"),
+        edit(base, "gain = 0.5;", ""),
+        edit(base, "in = 1;", "in = 1.0;"),
+        edit(base, "in = 1;", "in = true;"),
+    };
+
+    for (auto const &text : others) {
+        Config b;
+        REQUIRE(b.parse(text));
+        CHECK(root.content_hash() != b.get_settings().content_hash());
+        CHECK(root != b.get_settings());
+    }
+
+    // Empty composites of each kind.
+    Setting group{st::GROUP}, list{st::LIST}, array{st::ARRAY};
+    CHECK(group != list);
+    CHECK(list != array);
+    CHECK(group.content_hash() != list.content_hash());
+    CHECK(list.content_hash() != array.content_hash());
+    CHECK(group == Setting{st::GROUP});
+
+    // Scalars compare as values, floats by their bits.
+    CHECK(Setting(1) == Setting(1L));
+    CHECK(Setting(1) != Setting(1.0));
+    CHECK(Setting(0.0) != Setting(-0.0));
+    CHECK(Setting("a") == Setting("a"s));
+    CHECK(Setting("a").content_hash() == Setting("a"s).content_hash());
+}
+
+namespace {
+    // Two Configs with the same tree, both hashed.
+    struct two_trees {
+        Config a, b;
+        std::uint64_t before = 0;
+
+        two_trees() {
+            REQUIRE(a.parse(base));
+            REQUIRE(b.parse(base));
+            REQUIRE(a.get_settings() == b.get_settings());
+            before = a.get_settings().content_hash();
+        }
+    };
+}
+
+TEST_CASE("set_value deep down") {
+    two_trees t;
+    auto &root = t.a.get_settings();
+
+    root.at("midi").at("devices").at(1).at("in").set_value(3);
+    CHECK(root.content_hash() != t.before);
+    CHECK(root != t.b.get_settings());
+
+    root.at("midi").at("devices").at(1).at("in").set_value(2);
+    CHECK(root.content_hash() == t.before);
+    CHECK(root == t.b.get_settings());
+}
+
+TEST_CASE("add_child") {
+    two_trees t;
+    auto &root = t.a.get_settings();
+    auto &other = t.b.get_settings();
+
+    auto &ports = root.at("midi").at("ports");
+    auto ports_before = ports.content_hash();
+
+    ports.add_child(40);
+    CHECK(ports.content_hash() != ports_before);
+    CHECK(root.content_hash() != t.before);
+
+    root.at("midi").add_child("extra", st::GROUP).add_child("x", 1);
+    CHECK(root != other);
+    other.at("midi").add_child("extra", st::GROUP).add_child("x", 1);
+    other.at("midi").at("ports").add_child(40);
+    CHECK(root == other);
+    CHECK(root.content_hash() == other.content_hash());
+}
+
+TEST_CASE("a composite made into something else") {
+    two_trees t;
+    auto &root = t.a.get_settings();
+
+    root.at("midi").at("ports").set_value("none");
+    CHECK(root.content_hash() != t.before);
+
+    root.at("midi").at("devices").make_array();
+    auto after = root.content_hash();
+    root.at("midi").at("devices").add_child(1);
+    CHECK(root.content_hash() != after);
+}
+
+TEST_CASE("assignment") {
+    two_trees t;
+    auto &root = t.a.get_settings();
+
+    root.at("gain") = Setting(0.5);
+    CHECK(root.content_hash() == t.before);
+
+    root.at("gain") = t.b.get_settings().at("midi");
+    CHECK(root.content_hash() != t.before);
+
+    // the assigned copy is hashed afresh, then changed.
+    root.at("gain").at("ports").add_child(40);
+    auto changed = root.content_hash();
+    root.at("gain").at("ports").at(3).set_value(41);
+    CHECK(root.content_hash() != changed);
+}
+
+TEST_CASE("moved out") {
+    two_trees t;
+    Setting moved{std::move(t.a.get_settings().at("midi"))};
+    auto hash = moved.content_hash();
+
+    // the cached hash comes along, and still goes stale.
+    moved.at("ports").at(0).set_value(11);
+    CHECK(moved.content_hash() != hash);
+}
+
+TEST_CASE("moved to another tree") {
+    two_trees t;
+    auto &root = t.a.get_settings();
+    auto &other = t.b.get_settings();
+    CHECK(other.content_hash() == t.before);
+
+    // the hashes cached in a are no good against b's changes.
+    other.add_child("moved", std::move(root.at("midi")));
+    auto hash = other.content_hash();
+    other.at("moved").at("ports").at(0).set_value(11);
+    CHECK(other.content_hash() != hash);
+    CHECK(other.at("moved").content_hash() != other.at("midi").content_hash());
+}
+
+TEST_CASE("each tree has its own") {
+    using Configinator5000::tree_state;
+    two_trees t;
+    auto &epoch = tree_state::get(0).hash_epoch;
+
+    // Settings on their own share one, which changes to a Config's tree
+    // don't touch.
+    auto before = epoch.load();
+    t.a.get_settings().at("midi").at("ports").at(0).set_value(11);
+    CHECK(t.a.get_settings().content_hash() != t.before);
+    CHECK(epoch.load() == before);
+
+    // and the other way round.
+    Setting scratch{st::LIST};
+    scratch.add_child(1);
+    scratch.content_hash();
+    scratch.at(0).set_value(2);
+    CHECK(epoch.load() != before);
+    CHECK(t.b.get_settings().content_hash() == t.before);
+}
+
+TEST_CASE("copies") {
+    Config a;
+    REQUIRE(a.parse(base));
+    auto &root = a.get_settings();
+
+    auto hash = root.content_hash();
+    Setting copy{root};
+    CHECK(copy.content_hash() == hash);
+    CHECK(copy == root);
+
+    copy.at("midi").at("ports").at(0).set_value(11);
+    CHECK(copy != root);
+    CHECK(root.content_hash() == hash);
+}
+
+TEST_CASE("lazy trees") {
+    Config a, b;
+    REQUIRE(a.parse(base));
+    REQUIRE(b.parse_lazy(base));
+
+    CHECK(a.get_settings() == b.get_settings());
+
+    Config bad;
+    REQUIRE(bad.parse_lazy("midi = { ports = [ 1, \"x\" ]; };"));
+    CHECK_THROWS(bad.get_settings().content_hash());
+}
+
+TEST_CASE("readers on several threads") {
+    Config a, b;
+    REQUIRE(a.parse(base));
+    REQUIRE(b.parse(edit(base, "in = 2", "in = 3")));
+
+    std::vector<std::thread> threads;
+    std::vector<int> same(4, 0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                if (a.get_settings() == b.get_settings()) ++same[std::size_t(t)];
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    for (int s : same) CHECK(s == 0);
+}
@@ -0,0 +1,255 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace std::literals::string_literals;
+using Configinator5000::Config;
+
+namespace {
+    // the one in the README
+    const char *schema =
+        "//sample schema file\n"
+        "default_osc = { type : \"string\", required : \"no\" }\n"
+        "midi = { type : \"group\", required : \"yes\"\n"
+        "  key* = { type : \"group\",\n"
+        "    keys = {\n"
+        "      in : { type : \"String\", required : \"yes\" }\n"
+        "      osc : { type : \"string\", required : \"no\" }\n"
+        "    }\n"
+        "  }\n"
+        "}\n";
+
+    std::string errors(Config &cfg) {
+        std::ostringstream buf;
+        cfg.stream_errors(buf);
+        return buf.str();
+    }
+
+    // The errors from parsing text against schema.
+    std::string check(const char *text, const char *with = schema) {
+        Config cfg;
+        REQUIRE(cfg.set_schema(with));
+        if (cfg.parse(text)) return "";
+        return errors(cfg);
+    }
+}
+
+TEST_CASE("good configs") {
+    CHECK(check("midi = { keyboard = { in = \"usb1\"; osc = \"sine\"; }; };") == "");
+    CHECK(check(
+        "default_osc = \"square\";\n"
+        "midi = {\n"
+        "  keyboard = { in = \"usb1\"; };\n"
+        "  pads = { in = \"usb2\"; osc = \"noise\"; };\n"
+        "};\n") == "");
+    CHECK(check("midi = { };") == "");
+
+    // and the same Config parses again, against the same schema.
+    Config cfg;
+    REQUIRE(cfg.set_schema(schema));
+    CHECK(cfg.parse("midi = { a = { in = \"x\"; }; };"));
+    CHECK_FALSE(cfg.parse("midi = { a = { osc = \"x\"; }; };"));
+    CHECK(cfg.parse("midi = { b = { in = \"y\"; }; };"));
+}
+
+TEST_CASE("violations") {
+    CHECK(check("") == "line 0 : The top level is missing required setting midi\n");
+
+    CHECK(check(
+        "midi = {\n"
+        "  keyboard = { osc = \"sine\"; };\n"
+        "};\n") == "line 1 : Group midi.keyboard is missing required setting in\n");
+
+    CHECK(check(
+        "midi = {\n"
+        "  keyboard = { in = 1; };\n"
+        "};\n") == "line 1 : Setting midi.keyboard.in has type int, but the schema wants string\n");
+
+    CHECK(check(
+        "midi = {\n"
+        "  keyboard = { in = \"usb1\";\n"
+        "     out = \"usb2\"; };\n"
+        "};\n") == "line 2 : Setting midi.keyboard.out is not in the schema\n");
+
+    CHECK(check(
+        "midi = ( 1, 2 );\n") == "line 0 : Setting midi has type list, but the schema wants group\n");
+
+    // all of them, with their lines.
+    CHECK(check(
+        "volume = 11;\n"
+        "midi = {\n"
+        "  a = { in = \"x\"; };\n"
+        "  b = [ 1, 2 ];\n"
+        "  c = { osc = 3; };\n"
+        "};\n"
+        "default_osc = true;\n") ==
+        "line 0 : Setting volume is not in the schema\n"
+        "line 3 : Setting midi.b has type array, but the schema wants group\n"
+        "line 4 : Setting midi.c.osc has type int, but the schema wants string\n"
+        "line 4 : Group midi.c is missing required setting in\n"
+        "line 6 : Setting default_osc has type bool, but the schema wants string\n");
+
+    // problems and parse errors in the order they were found. What a
+    // group is missing isn't known if the parse never gets to its end.
+    CHECK(check("midi = { a = { in = ; }; };") ==
+            "line 0 : Expecting a value\n"
+            "line 0 : Didn't find close of setting group\n"
+            "line 0 : Didn't find close of setting group\n"
+            "line 0 : Not at end of input!\n");
+    CHECK(check("volume = 11;\nmidi = { a = { }; b = ; };") ==
+            "line 0 : Setting volume is not in the schema\n"
+            "line 1 : Group midi.a is missing required setting in\n"
+            "line 1 : Expecting a value\n"
+            "line 1 : Didn't find close of setting group\n"
+            "line 1 : Not at end of input!\n");
+}
+
+TEST_CASE("fail fast") {
+    auto first = [](const char *text, Config &cfg) {
+        REQUIRE(cfg.set_schema(schema));
+        cfg.set_fail_fast(true);
+        if (cfg.parse(text)) return ""s;
+        return errors(cfg);
+    };
+
+    Config cfg;
+    CHECK(first("midi = { a = { in = \"x\"; }; };", cfg) == "");
+
+    CHECK(first(
+        "midi = {\n"
+        "  a = { in = \"x\"; };\n"
+        "  b = { osc = 3; };\n"
+        "  c = { };\n"
+        "};\n"
+        "volume = 11;\n", cfg) == "line 2 : Setting midi.b.osc has type int, but the schema wants string\n");
+    // the tree is left as far as the parse got.
+    CHECK(cfg.get_settings().at("midi").exists("a"));
+    CHECK_FALSE(cfg.get_settings().at("midi").exists("c"));
+
+    CHECK(first("midi = {\n  a = { osc = \"x\"; };\n  b = 1;\n};\n", cfg) ==
+            "line 1 : Group midi.a is missing required setting in\n");
+    CHECK(first("", cfg) == "line 0 : The top level is missing required setting midi\n");
+
+    // a group of the wrong type is turned down before anything in it is
+    // parsed, bad or not.
+    CHECK(first("midi = [ 1, \"a\" ];", cfg) ==
+            "line 0 : Setting midi has type array, but the schema wants group\n");
+
+    // parse errors are as before.
+    CHECK(first("midi = { a = { in = ; }; };", cfg) ==
+            "line 0 : Expecting a value\n"
+            "line 0 : Didn't find close of setting group\n"
+            "line 0 : Didn't find close of setting group\n"
+            "line 0 : Not at end of input!\n");
+}
+
+TEST_CASE("types") {
+    const char *types =
+        "gain = { type = \"float\"; };\n"
+        "count = { type = \"int\"; };\n"
+        "flag = { type = \"bool\"; };\n"
+        "any = { required = false; };\n"
+        "either = { type = [ \"string\", \"list\" ]; };\n"
+        "open = { type = \"group\"; };\n";
+
+    CHECK(check("gain = 0.5;", types) == "");
+    CHECK(check("gain = 1;", types) == "");
+    CHECK(check("count = 1.5;", types) ==
+            "line 0 : Setting count has type float, but the schema wants int\n");
+    CHECK(check("flag = TRUE;", types) == "");
+    CHECK(check("any = ( 1, [ 2 ], { x = 3; } );", types) == "");
+    CHECK(check("either = \"a\"; either2 = 1;", types) ==
+            "line 0 : Setting either2 is not in the schema\n");
+    CHECK(check("either = ( 1 );", types) == "");
+    CHECK(check("either = 1;", types) ==
+            "line 0 : Setting either has type int, but the schema wants string or list\n");
+
+    // a group with no keys can have anything in it.
+    CHECK(check("open = { a = 1; b = { c = \"d\"; }; };", types) == "");
+}
+
+TEST_CASE("arena") {
+    Config cfg{Configinator5000::tree_memory::arena};
+    REQUIRE(cfg.set_schema(schema));
+    CHECK(cfg.parse("midi = { a = { in = \"x\"; }; };"));
+    CHECK_FALSE(cfg.parse("midi = { a = { }; };"));
+    CHECK(errors(cfg) == "line 0 : Group midi.a is missing required setting in\n");
+}
+
+TEST_CASE("lazy and parallel") {
+    const char *bad_config =
+        "midi = { a = { in = 1; }; };\n"
+        "other = { b = 2; };\n";
+
+    Config checked;
+    REQUIRE(checked.set_schema(schema));
+    CHECK_FALSE(checked.parse(bad_config));
+    auto expected = errors(checked);
+    CHECK(expected == "line 0 : Setting midi.a.in has type int, but the schema wants string\n"
+            "line 1 : Setting other is not in the schema\n");
+
+    CHECK_FALSE(checked.parse_lazy(bad_config));
+    CHECK(errors(checked) == expected);
+    CHECK_FALSE(checked.parse_parallel(bad_config, 4));
+    CHECK(errors(checked) == expected);
+
+    CHECK(checked.parse_lazy("midi = { a = { in = \"x\"; }; };"));
+    CHECK(checked.validate_all());
+    CHECK(checked.parse_parallel("midi = { a = { in = \"x\"; }; };", 4));
+}
+
+TEST_CASE("bad schemas") {
+    auto bad = [](const char *text) {
+        Config cfg;
+        CHECK_FALSE(cfg.set_schema(text));
+        return errors(cfg);
+    };
+
+    CHECK(bad("a = { type = \"strng\"; };") == "line 0 : Unknown type \"strng\" for a\n");
+    CHECK(bad("a = {\n type = 1; };") == "line 1 : type for a must be a string or a list of them\n");
+    CHECK(bad("a = { required = \"maybe\"; };") ==
+            "line 0 : required for a must be \"yes\" or \"no\"\n");
+    CHECK(bad("a = 1;") == "line 0 : The schema for a must be a group\n");
+    CHECK(bad("a = {\n  typo = 1; };") == "line 1 : Unknown schema field typo for a\n");
+    CHECK(bad("a = { type = \"int\"; keys = { b = { }; }; };") ==
+            "line 0 : a has keys but can't be a group\n");
+    CHECK(bad("a = { keys = 1; };") == "line 0 : keys for a must be a group\n");
+    CHECK(bad("a = { key* = { required = \"yes\"; }; };") == "line 0 : a.key* can't be required\n");
+    CHECK(bad("a = { key* = { }; keys = { key* = { }; }; };") == "line 0 : a.key* is given twice\n");
+    CHECK(bad("a = { type = ; };") == "line 0 : Expecting a value\n"
+            "line 0 : Didn't find close of setting group\nline 0 : Not at end of input!\n");
+
+    // every problem, not just the first
+    CHECK(bad("a = { type = \"x\"; };\nb = { required = 2; };\n") ==
+            "line 0 : Unknown type \"x\" for a\nline 1 : required for b must be \"yes\" or \"no\"\n");
+
+    // a bad schema leaves the old one in place.
+    Config cfg;
+    REQUIRE(cfg.set_schema(schema));
+    CHECK_FALSE(cfg.set_schema("a = 1;"));
+    CHECK_FALSE(cfg.parse("a = 1;"));
+    CHECK(errors(cfg) == "line 0 : Setting a is not in the schema\n"
+            "line 0 : The top level is missing required setting midi\n");
+
+    CHECK_FALSE(cfg.set_schema_file("this-file-does-not-exist.schema"));
+    CHECK(errors(cfg) == "line 0 : Could not open file this-file-does-not-exist.schema\n");
+
+    // and the settings already parsed.
+    REQUIRE(cfg.parse("midi = { a = { in = \"x\"; }; };"));
+    auto generation = cfg.generation();
+    CHECK_FALSE(cfg.set_schema("garbage"));
+    CHECK_FALSE(cfg.set_schema_file("this-file-does-not-exist.schema"));
+    CHECK(cfg.generation() == generation);
+    CHECK(cfg.get_settings().at("midi").at("a").at("in").get<std::string>() == "x");
+
+    // until the next good one, or the next parse.
+    REQUIRE(cfg.set_schema(schema));
+    CHECK(errors(cfg) == "");
+    CHECK_FALSE(cfg.set_schema("a = 1;"));
+    CHECK(cfg.parse("midi = { };"));
+    CHECK(errors(cfg) == "");
+}
@@ -0,0 +1,140 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+// made by c5k-codegen from t19-codegen.schema
+#include <synth.hpp>
+
+#include <configinator5000.hpp>
+#include <mapped_file.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace std::literals::string_literals;
+
+namespace {
+    const char *good =
+        "voices = 8;\n"
+        "gain = 0.5;\n"
+        "default = 3;\n"
+        "pitch = { bend = 2; wheel = true; };\n"
+        "tags = [ \"a\", \"b\" ];\n"
+        "midi = {\n"
+        "  keyboard = { in = \"usb1\"; osc = \"sine\"; };\n"
+        "  pads = { in = \"usb2\"; };\n"
+        "};\n"
+        "extra = { name = \"x\"; one = 1; two = 2; };\n";
+
+    // What parsing text gets wrong.
+    std::string errors(const char *text) {
+        t19::synth out;
+        std::ostringstream errs;
+        if (t19::parse(text, out, &errs)) return "";
+        return errs.str();
+    }
+
+    // The same, from a Config checking the schema.
+    std::string config_errors(const char *text) {
+        Configinator5000::mapped_file schema{T19_SCHEMA};
+        REQUIRE(schema.is_open());
+
+        Configinator5000::Config cfg;
+        REQUIRE(cfg.set_schema(schema.view()));
+        cfg.set_fail_fast(true);
+        if (cfg.parse(text)) return "";
+        std::ostringstream errs;
+        cfg.stream_errors(errs);
+        return errs.str();
+    }
+}
+
+TEST_CASE("values") {
+    t19::synth out;
+    REQUIRE(t19::parse(good, out));
+
+    CHECK(out.voices == 8);
+    CHECK(out.gain.value() == 0.5);
+    CHECK_FALSE(out.enabled.has_value());
+    CHECK_FALSE(out.default_osc.has_value());
+    CHECK(out.default_.value() == 3);
+
+    REQUIRE(out.pitch.has_value());
+    // an int is fine for a float.
+    CHECK(out.pitch->bend == 2.0);
+    CHECK(out.pitch->wheel.value());
+
+    CHECK(out.midi.size() == 2);
+    CHECK(out.midi.at("keyboard").in == "usb1");
+    CHECK(out.midi.at("keyboard").osc.value() == "sine");
+    CHECK(out.midi.at("pads").in == "usb2");
+    CHECK_FALSE(out.midi.at("pads").osc.has_value());
+
+    REQUIRE(out.extra.has_value());
+    CHECK(out.extra->name.value() == "x");
+    CHECK(out.extra->others.size() == 2);
+    CHECK(out.extra->others.at("two") == 2);
+
+    // parsing again starts from nothing.
+    REQUIRE(t19::parse("voices = 1; midi = { };", out));
+    CHECK(out.voices == 1);
+    CHECK(out.midi.empty());
+    CHECK_FALSE(out.gain.has_value());
+    CHECK_FALSE(out.pitch.has_value());
+}
+
+TEST_CASE("struct names that meet") {
+    t19::synth out;
+    REQUIRE(t19::parse("voices = 1; midi = { };\n"
+        "route = { main = { port = 80; }; entry = { path = \"/\"; }; spare = { weight = 2; }; };\n"
+        "route_main = { host = \"h\"; };\n", out));
+
+    REQUIRE(out.route.has_value());
+    CHECK(out.route->main.value().port.value() == 80);
+    CHECK(out.route->entry.value().path.value() == "/");
+    CHECK(out.route->others.at("spare").weight.value() == 2);
+    CHECK(out.route_main.value().host.value() == "h");
+}
+
+TEST_CASE("problems") {
+    std::string text;
+
+    text = "voices = 1;\nmidi = { a = { in = \"x\"; out = \"y\"; }; };";
+    CHECK(errors(text.c_str()) == "line 1 : Setting midi.a.out is not in the schema\n");
+
+    text = "voices = \"many\"; midi = { };";
+    CHECK(errors(text.c_str()) == "line 0 : Setting voices has type string, but the schema wants int\n");
+
+    text = "voices = 1;\nmidi = {\n  a = { osc = \"x\"; };\n};";
+    CHECK(errors(text.c_str()) == "line 2 : Group midi.a is missing required setting in\n");
+
+    text = "voices = 1;\n";
+    CHECK(errors(text.c_str()) == "line 1 : The top level is missing required setting midi\n");
+
+    text = "voices = 1; tags = 3; midi = { };";
+    CHECK(errors(text.c_str()) == "line 0 : Setting tags has type int, but the schema wants array\n");
+
+    text = "voices = 1; extra = { three = 3.5; }; midi = { };";
+    CHECK(errors(text.c_str()) == "line 0 : Setting extra.three has type float, but the schema wants int\n");
+
+    // the same as a Config with the schema says.
+    for (auto *bad : {
+            "voices = 1;\nmidi = { a = { in = \"x\"; out = \"y\"; }; };",
+            "voices = 1;\nmidi = {\n  a = { osc = \"x\"; };\n};",
+            "voices = 1; tags = 3; midi = { };",
+            "voices = 1; pitch = { wheel = 1; }; midi = { };",
+            "voices = 1; midi = { a = { in = \"x\"; }; a = { in = \"y\"; }; };",
+            "voices = 1;\n" }) {
+        CHECK(errors(bad) == config_errors(bad));
+    }
+
+    // and syntax errors are the parser's.
+    text = "voices = ; midi = { };";
+    CHECK(errors(text.c_str()) == "line 0 : Expecting a value\nline 0 : Not at end of input!\n");
+}
+
+TEST_CASE("files") {
+    t19::synth out;
+    std::ostringstream errs;
+    CHECK_FALSE(t19::parse_file("this-file-does-not-exist.cfg", out, &errs));
+    CHECK(errs.str() == "line 0 : Could not open file this-file-does-not-exist.cfg\n");
+}
@@ -0,0 +1,211 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <bind.hpp>
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Configinator5000;
+
+namespace t20 {
+    struct quota {
+        long cpu = 0;
+        int mem = 0;
+        std::optional<double> ratio;
+    };
+    C5K_BIND(quota, cpu, mem, ratio)
+
+    struct route {
+        std::string path;
+        long port = 0;
+        std::vector<long> weights;
+    };
+    C5K_BIND(route, path, port, weights)
+
+    struct tenant {
+        long id = 0;
+        std::string name;
+        bool active = false;
+        quota limits;
+        std::vector<route> routes;
+        std::optional<quota> burst;
+        std::vector<bool> flags;
+    };
+    C5K_BIND(tenant, id, name, active, limits, routes, burst, flags)
+
+    // keys that aren't the member names
+    struct server {
+        std::string host;
+        int port = 0;
+    };
+    constexpr auto c5k_fields(const server *) {
+        return std::make_tuple(make_field("host_name", &server::host),
+                make_field("listen", &server::port));
+    }
+
+    static_assert(std::get<0>(c5k_fields(static_cast<const server *>(nullptr))).key.hash ==
+            key_hash("host_name"));
+}
+
+namespace {
+    const char *text =
+        "id = 7;\n"
+        "name = \"seven\";\n"
+        "active = true;\n"
+        "extra = { a = 1; b = ( 2, 3 ); };\n"
+        "limits = { cpu = 100; mem = 2048; ratio = 1; };\n"
+        "routes = (\n"
+        "  { path = \"/a\"; port = 80; weights = [ 1, 2, 3 ]; },\n"
+        "  { path = \"/b\"; port = 81; }\n"
+        ");\n"
+        "flags = [ true, false, true ];\n";
+
+    void check_tenant(const t20::tenant &t) {
+        CHECK(t.id == 7);
+        CHECK(t.name == "seven");
+        CHECK(t.active);
+        CHECK(t.limits.cpu == 100);
+        CHECK(t.limits.mem == 2048);
+        REQUIRE(t.limits.ratio);
+        CHECK(*t.limits.ratio == 1.0);
+        REQUIRE(t.routes.size() == 2);
+        CHECK(t.routes[0].path == "/a");
+        CHECK(t.routes[0].port == 80);
+        CHECK((t.routes[0].weights == std::vector<long>{1, 2, 3}));
+        CHECK(t.routes[1].path == "/b");
+        CHECK(t.routes[1].weights.empty());
+        CHECK_FALSE(t.burst);
+        CHECK((t.flags == std::vector<bool>{true, false, true}));
+    }
+
+    // what bind() throws for text, or "".
+    std::string tree_error(const char *text) {
+        Config cfg;
+        REQUIRE(cfg.parse(text));
+        t20::tenant t;
+        try {
+            bind(cfg, t);
+        } catch (std::runtime_error &e) {
+            return e.what();
+        }
+        return "";
+    }
+
+    // what parse_into() writes for text, or "".
+    std::string event_error(const char *text) {
+        t20::tenant t;
+        std::ostringstream errs;
+        if (parse_into(text, t, &errs)) return "";
+        return errs.str();
+    }
+
+    const char *minimal = "id = 1; name = \"x\"; active = false; limits = { cpu = 1; mem = 2; };\n";
+}
+
+TEST_CASE("bind from a tree") {
+    Config cfg;
+    REQUIRE(cfg.parse(text));
+
+    t20::tenant t;
+    bind(cfg, t);
+    check_tenant(t);
+
+    // and again, from something with less in it.
+    REQUIRE(cfg.parse(minimal));
+    t.burst = t20::quota{};
+    bind(cfg.get_settings(), t);
+    CHECK(t.id == 1);
+    CHECK_FALSE(t.limits.ratio);
+    CHECK(t.routes.empty());
+    CHECK_FALSE(t.burst);
+    CHECK(t.flags.empty());
+
+    // a part of the tree
+    REQUIRE(cfg.parse("servers = { main = { host_name = \"example.com\"; listen = 8080; }; };"));
+    t20::server s;
+    bind(cfg.get_settings().at("servers").at("main"), s);
+    CHECK(s.host == "example.com");
+    CHECK(s.port == 8080);
+}
+
+TEST_CASE("bind from events") {
+    t20::tenant t;
+    CHECK(parse_into(text, t));
+    check_tenant(t);
+
+    t.burst = t20::quota{};
+    CHECK(parse_into(minimal, t));
+    CHECK(t.id == 1);
+    CHECK_FALSE(t.limits.ratio);
+    CHECK(t.routes.empty());
+    CHECK_FALSE(t.burst);
+
+    CHECK(parse_into(std::string(minimal) + "burst = { cpu = 5; mem = 6; ratio = 0.5; };", t));
+    REQUIRE(t.burst);
+    CHECK(t.burst->cpu == 5);
+    CHECK(*t.burst->ratio == 0.5);
+
+    t20::server s;
+    CHECK(parse_into("listen = 8080; host_name = \"example.com\";", s));
+    CHECK(s.host == "example.com");
+    CHECK(s.port == 8080);
+}
+
+TEST_CASE("problems") {
+    CHECK(tree_error("name = \"x\";") == "The top level is missing required setting id");
+    CHECK(event_error("name = \"x\";") == "line 0 : The top level is missing required setting id\n");
+
+    const char *no_mem = "id = 1; name = \"x\"; active = true;\nlimits = { cpu = 1; };\n";
+    CHECK(tree_error(no_mem) == "Group limits is missing required setting mem");
+    CHECK(event_error(no_mem) == "line 1 : Group limits is missing required setting mem\n");
+
+    const char *bad_id = "name = \"x\";\nid = \"7\";\n";
+    CHECK(tree_error(bad_id) == "Setting id has type string, but the struct wants int");
+    CHECK(event_error(bad_id) == "line 1 : Setting id has type string, but the struct wants int\n");
+
+    const char *float_mem = "id = 1; name = \"x\"; active = true;\nlimits = { cpu = 1; mem = 2.5; };\n";
+    CHECK(tree_error(float_mem) == "Setting limits.mem has type float, but the struct wants int");
+    CHECK(event_error(float_mem) == "line 1 : Setting limits.mem has type float, but the struct wants int\n");
+
+    const char *bad_port = "id = 1; name = \"x\"; active = true; limits = { cpu = 1; mem = 2; };\n"
+        "routes = ( { path = \"/\"; port = 1; },\n  { path = \"/\"; port = 2; weights = [ 1.5 ]; } );\n";
+    CHECK(tree_error(bad_port) ==
+            "Setting routes[1].weights[0] has type float, but the struct wants int");
+    CHECK(event_error(bad_port) ==
+            "line 2 : Setting routes[1].weights[0] has type float, but the struct wants int\n");
+
+    const char *group_routes = "id = 1; name = \"x\"; active = true; limits = { cpu = 1; mem = 2; };\n"
+        "routes = { a = 1; };\n";
+    CHECK(tree_error(group_routes) == "Setting routes has type group, but the struct wants list or array");
+    CHECK(event_error(group_routes) ==
+            "line 1 : Setting routes has type group, but the struct wants list or array\n");
+
+    const char *list_limits = "id = 1; name = \"x\"; active = true; limits = ( 1 );\n";
+    CHECK(tree_error(list_limits) == "Setting limits has type list, but the struct wants group");
+    CHECK(event_error(list_limits) == "line 0 : Setting limits has type list, but the struct wants group\n");
+
+    const char *int_flag = "id = 1; name = \"x\"; active = true; limits = { cpu = 1; mem = 2; };\n"
+        "flags = ( true, 1 );\n";
+    CHECK(tree_error(int_flag) == "Setting flags[1] has type int, but the struct wants bool");
+    CHECK(event_error(int_flag) == "line 1 : Setting flags[1] has type int, but the struct wants bool\n");
+
+    // a key given twice is an error, as it is for a Config.
+    const char *two_cpus = "id = 1; name = \"x\"; active = true;\n"
+        "limits = { cpu = 1; cpu = 2; mem = 2; };\n";
+    const char *two_routes = "id = 1; name = \"x\"; active = true; limits = { cpu = 1; mem = 2; };\n"
+        "routes = ( );\nflags = [ true ];\nroutes = ( { path = \"/\"; port = 1; } );\n";
+    for (auto *twice : { two_cpus, two_routes }) {
+        Config cfg;
+        CHECK_FALSE(cfg.parse(twice));
+        std::ostringstream errs;
+        cfg.stream_errors(errs);
+        CHECK(event_error(twice) == errs.str());
+    }
+    CHECK(event_error(two_cpus) == "line 1 : Setting named cpu already defined in this context\n");
+
+    // parse errors come from the parser, as usual.
+    CHECK(event_error("id = ;") == "line 0 : Expecting a value\nline 0 : Not at end of input!\n");
+}
@@ -0,0 +1,234 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <writer.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+
+using namespace Configinator5000;
+using ST = Setting::setting_type;
+
+namespace {
+    const char *sample =
+        "name = \"c5k\";\n"
+        "version = 3;\n"
+        "gain = 0.5;\n"
+        "debug = false;\n"
+        "empty = {};\n"
+        "server = {\n"
+        "  port = 8080;\n"
+        "  hosts = ( \"a\", \"b\" );\n"
+        "  weights = [ 1.0, 2.5 ];\n"
+        "  routes = (\n"
+        "    {\n"
+        "      path = \"/\";\n"
+        "    },\n"
+        "    ( 1, [] )\n"
+        "  );\n"
+        "};\n";
+
+    // parse(to_text(parse(text))) == parse(text), in both styles.
+    void round_trip(Setting &root) {
+        for (auto style : {text_style::pretty, text_style::compact}) {
+            auto text = to_text(root, style);
+            Config again;
+            REQUIRE(again.parse(text));
+            CHECK(again.get_settings() == root);
+            // and the text is stable from there.
+            CHECK(to_text(again.get_settings(), style) == text);
+        }
+    }
+
+    Setting random_tree(std::mt19937 &gen, int depth) {
+        std::uniform_int_distribution<int> pick(0, 6);
+        std::uniform_int_distribution<int> byte(1, 255);
+        std::uniform_int_distribution<long> any_long(std::numeric_limits<long>::min(),
+                std::numeric_limits<long>::max());
+        std::uniform_int_distribution<std::uint64_t> bits;
+
+        auto scalar = [&](int kind) -> Setting {
+            switch (kind) {
+                case 0 : return Setting(any_long(gen));
+                case 1 : {
+                    double d;
+                    do {
+                        auto b = bits(gen);
+                        std::memcpy(&d, &b, sizeof d);
+                    } while (not std::isfinite(d));
+                    return Setting(d);
+                }
+                case 2 : return Setting(bool(bits(gen) & 1));
+                default : {
+                    std::string s;
+                    for (int i = pick(gen); i > 0; --i) s += char(byte(gen));
+                    return Setting(s);
+                }
+            }
+        };
+
+        Setting group{ST::GROUP};
+        for (int i = 0, n = pick(gen); i < n; ++i) {
+            auto key = "k" + std::to_string(i);
+            int kind = (depth > 3) ? pick(gen) % 4 : pick(gen);
+            if (kind < 4) {
+                group.add_child(key, scalar(kind));
+            } else if (kind == 4) {
+                group.add_child(key, random_tree(gen, depth + 1));
+            } else if (kind == 5) {
+                auto &list = group.add_child(key, ST::LIST);
+                for (int j = pick(gen); j > 0; --j) {
+                    if (pick(gen) < 2) list.add_child(random_tree(gen, depth + 1));
+                    else list.add_child(scalar(pick(gen) % 4));
+                }
+            } else {
+                auto &array = group.add_child(key, ST::ARRAY);
+                int kind = pick(gen) % 4;
+                for (int j = pick(gen); j > 0; --j) array.add_child(scalar(kind));
+            }
+        }
+        return group;
+    }
+}
+
+TEST_CASE("pretty") {
+    Config cfg;
+    REQUIRE(cfg.parse(sample));
+    CHECK(to_text(cfg.get_settings()) == sample);
+    CHECK(to_text(cfg.get_settings(), text_style::compact) ==
+            "name=\"c5k\";version=3;gain=0.5;debug=false;empty={};server={port=8080;"
+            "hosts=(\"a\",\"b\");weights=[1.0,2.5];routes=({path=\"/\";},(1,[]));};");
+    round_trip(cfg.get_settings());
+
+    Setting empty{ST::GROUP};
+    CHECK(to_text(empty) == "");
+}
+
+TEST_CASE("scalars") {
+    Config cfg;
+    REQUIRE(cfg.parse(
+        "big = 9223372036854775807;\n"
+        "small = -9223372036854775808;\n"
+        "mask = 0xFFFFFFFFFFFFFFFF;\n"
+        "tenth = 0.1;\n"
+        "third = 0.333333333333333314829616256247390992939472198486328125;\n"
+        "whole = 2.0;\n"
+        "huge = 1e300;\n"
+        "tiny = 2.2250738585072014e-308;\n"
+        "denormal = 4.9406564584124654e-324;\n"
+        "minus_zero = -0.0;\n"
+        "escapes = \"tab\\there \\\"quoted\\\" back\\\\slash\\nnew\\rline\\f\\x01\\x7f\\xff\";\n"));
+    auto &root = cfg.get_settings();
+    round_trip(root);
+
+    auto text = to_text(root);
+    CHECK(text.find("mask = -1;") != std::string::npos);
+    CHECK(text.find("tenth = 0.1;") != std::string::npos);
+    CHECK(text.find("third = 0.3333333333333333;") != std::string::npos);
+    CHECK(text.find("whole = 2.0;") != std::string::npos);
+    CHECK(text.find("huge = 1e+300;") != std::string::npos);
+    CHECK(text.find("denormal = 5e-324;") != std::string::npos);
+    CHECK(text.find("minus_zero = -0.0;") != std::string::npos);
+    CHECK(text.find("escapes = \"tab\\there \\\"quoted\\\" back\\\\slash\\nnew\\rline\\f\\x01\\x7f\xff\";")
+            != std::string::npos);
+}
+
+TEST_CASE("random trees") {
+    std::mt19937 gen{21};
+    for (int i = 0; i < 200; ++i) {
+        auto tree = random_tree(gen, 0);
+        round_trip(tree);
+    }
+}
+
+TEST_CASE("can't be written") {
+    Setting root{ST::GROUP};
+    root.add_child("bad key", 1);
+    CHECK_THROWS(to_text(root));
+
+    Setting nan{ST::GROUP};
+    nan.add_child("x", std::nan(""));
+    CHECK_THROWS(to_text(nan));
+
+    Setting inf{ST::GROUP};
+    inf.add_child("x", std::numeric_limits<double>::infinity());
+    CHECK_THROWS(to_text(inf));
+
+    Setting list{ST::LIST};
+    CHECK_THROWS(to_text(list));
+}
+
+TEST_CASE("files") {
+    std::string file_name = "t21-writer.cfg";
+
+    Config cfg;
+    REQUIRE(cfg.parse(sample));
+    REQUIRE(cfg.write_file(file_name, text_style::compact));
+
+    Config again;
+    REQUIRE(again.parse_file(file_name));
+    CHECK(again.get_settings() == cfg.get_settings());
+
+    // big enough to go out in more than one write.
+    std::mt19937 gen{5000};
+    Setting big{ST::GROUP};
+    for (int i = 0; i < 200; ++i) big.add_child("t" + std::to_string(i), random_tree(gen, 0));
+    for (int i = 0; i < 20000; ++i) big.add_child("n" + std::to_string(i), "some text " + std::to_string(i));
+    REQUIRE(write_text_file(big, file_name));
+    REQUIRE(again.parse_file(file_name));
+    CHECK(again.get_settings() == big);
+
+    // a failed write leaves the old file.
+    Setting bad{ST::GROUP};
+    bad.add_child("x", std::nan(""));
+    CHECK_THROWS(write_text_file(bad, file_name));
+    CHECK_FALSE(again.write_file("no-such-directory/t21-writer.cfg"));
+    REQUIRE(again.parse_file(file_name));
+    CHECK(again.get_settings() == big);
+
+    // writers at once each write a file of their own and rename it, so
+    // the file is always all of one of theirs, and nothing is left over.
+    std::vector<Setting> versions;
+    for (int v = 0; v < 4; ++v) {
+        versions.emplace_back(ST::GROUP);
+        for (int i = 0; i < 5000; ++i) {
+            versions.back().add_child("n" + std::to_string(i), "version " + std::to_string(v));
+        }
+    }
+    std::vector<int> failures(versions.size(), 0);
+    std::vector<std::thread> writers;
+    for (std::size_t v = 0; v < versions.size(); ++v) {
+        writers.emplace_back([&, v]() {
+            for (int r = 0; r < 10; ++r) {
+                if (not write_text_file(versions[v], file_name)) ++failures[v];
+            }
+        });
+    }
+    for (auto &w : writers) w.join();
+    for (int f : failures) CHECK(f == 0);
+
+    REQUIRE(again.parse_file(file_name));
+    bool one_of_them = false;
+    for (auto &v : versions) one_of_them = one_of_them or (again.get_settings() == v);
+    CHECK(one_of_them);
+
+    int left_over = 0;
+    if (DIR *dir = ::opendir(".")) {
+        while (auto *entry = ::readdir(dir)) {
+            if (std::strncmp(entry->d_name, "t21-writer.cfg.", 15) == 0) ++left_over;
+        }
+        ::closedir(dir);
+    }
+    CHECK(left_over == 0);
+
+    std::remove(file_name.c_str());
+}
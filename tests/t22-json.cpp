@@ -0,0 +1,358 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <json.hpp>
+#include <writer.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace Configinator5000;
+using ST = Setting::setting_type;
+
+namespace {
+    const char *sample =
+        "name = \"c5k\";\n"
+        "version = 3;\n"
+        "gain = 0.5;\n"
+        "debug = false;\n"
+        "empty = {};\n"
+        "server = {\n"
+        "  port = 8080;\n"
+        "  hosts = [ \"a\", \"b\" ];\n"
+        "  weights = [ 1.0, 2.5 ];\n"
+        "  routes = (\n"
+        "    {\n"
+        "      path = \"/\";\n"
+        "    },\n"
+        "    ( 1, [] )\n"
+        "  );\n"
+        "};\n";
+
+    const char *sample_json =
+        "{\n"
+        "  \"name\": \"c5k\",\n"
+        "  \"version\": 3,\n"
+        "  \"gain\": 0.5,\n"
+        "  \"debug\": false,\n"
+        "  \"empty\": {},\n"
+        "  \"server\": {\n"
+        "    \"port\": 8080,\n"
+        "    \"hosts\": [ \"a\", \"b\" ],\n"
+        "    \"weights\": [ 1.0, 2.5 ],\n"
+        "    \"routes\": [\n"
+        "      {\n"
+        "        \"path\": \"/\"\n"
+        "      },\n"
+        "      [ 1, [] ]\n"
+        "    ]\n"
+        "  }\n"
+        "}\n";
+
+    std::string errors(Config &cfg) {
+        std::ostringstream strm;
+        cfg.stream_errors(strm);
+        return strm.str();
+    }
+
+    // Equal, but for lists and arrays, which JSON doesn't tell apart.
+    bool same(Setting &a, Setting &b) {
+        if (a.is_composite() != b.is_composite()) return false;
+        if (not a.is_composite()) return a == b;
+        if (a.is_group() != b.is_group() or a.count() != b.count()) return false;
+        for (int i = 0; i < a.count(); ++i) {
+            if (a.is_group() and a.name_at(i) != b.name_at(i)) return false;
+            if (not same(a.at(i), b.at(i))) return false;
+        }
+        return true;
+    }
+
+    void round_trip(Setting &root) {
+        for (auto style : {text_style::pretty, text_style::compact}) {
+            auto text = to_json(root, style);
+            Config again;
+            REQUIRE(again.parse_json(text));
+            CHECK(same(again.get_settings(), root));
+            CHECK(to_json(again.get_settings(), style) == text);
+        }
+    }
+
+    Setting random_tree(std::mt19937 &gen, int depth) {
+        std::uniform_int_distribution<int> pick(0, 6);
+        std::uniform_int_distribution<int> byte(1, 255);
+        std::uniform_int_distribution<long> any_long(std::numeric_limits<long>::min(),
+                std::numeric_limits<long>::max());
+        std::uniform_int_distribution<std::uint64_t> bits;
+
+        auto scalar = [&](int kind) -> Setting {
+            switch (kind) {
+                case 0 : return Setting(any_long(gen));
+                case 1 : {
+                    double d;
+                    do {
+                        auto b = bits(gen);
+                        std::memcpy(&d, &b, sizeof d);
+                    } while (not std::isfinite(d));
+                    return Setting(d);
+                }
+                case 2 : return Setting(bool(bits(gen) & 1));
+                default : {
+                    std::string s;
+                    for (int i = pick(gen); i > 0; --i) s += char(byte(gen));
+                    return Setting(s);
+                }
+            }
+        };
+
+        Setting group{ST::GROUP};
+        for (int i = 0, n = pick(gen); i < n; ++i) {
+            // any key at all.
+            std::string key;
+            for (int j = pick(gen); j >= 0; --j) key += char(byte(gen));
+            key += std::to_string(i);
+
+            int kind = (depth > 3) ? pick(gen) % 4 : pick(gen);
+            if (kind < 4) {
+                group.add_child(key, scalar(kind));
+            } else if (kind == 4) {
+                group.add_child(key, random_tree(gen, depth + 1));
+            } else if (kind == 5) {
+                auto &list = group.add_child(key, ST::LIST);
+                for (int j = pick(gen); j > 0; --j) {
+                    if (pick(gen) < 2) list.add_child(random_tree(gen, depth + 1));
+                    else list.add_child(scalar(pick(gen) % 4));
+                }
+            } else {
+                auto &array = group.add_child(key, ST::ARRAY);
+                int kind = pick(gen) % 4;
+                for (int j = pick(gen); j > 0; --j) array.add_child(scalar(kind));
+            }
+        }
+        return group;
+    }
+}
+
+TEST_CASE("writing") {
+    Config cfg;
+    REQUIRE(cfg.parse(sample));
+    CHECK(to_json(cfg.get_settings()) == sample_json);
+    CHECK(to_json(cfg.get_settings(), text_style::compact) ==
+            "{\"name\":\"c5k\",\"version\":3,\"gain\":0.5,\"debug\":false,\"empty\":{},"
+            "\"server\":{\"port\":8080,\"hosts\":[\"a\",\"b\"],\"weights\":[1.0,2.5],"
+            "\"routes\":[{\"path\":\"/\"},[1,[]]]}}");
+
+    Setting empty{ST::GROUP};
+    CHECK(to_json(empty) == "{}\n");
+    CHECK(to_json(empty, text_style::compact) == "{}");
+
+    Setting odd{ST::GROUP};
+    odd.add_child("bad key", "tab\there \"quoted\" back\\slash\nnew\rline\f\b\x01\x7f\xff");
+    odd.add_child("", 2.0);
+    CHECK(to_json(odd, text_style::compact) ==
+            "{\"bad key\":\"tab\\there \\\"quoted\\\" back\\\\slash\\nnew\\rline\\f\\b\\u0001\x7f\xff\","
+            "\"\":2.0}");
+
+    Setting nan{ST::GROUP};
+    nan.add_child("x", std::nan(""));
+    CHECK_THROWS(to_json(nan));
+}
+
+TEST_CASE("reading") {
+    Config cfg;
+    REQUIRE(cfg.parse_json(sample_json));
+
+    Config text;
+    REQUIRE(text.parse(sample));
+    CHECK(cfg.get_settings() == text.get_settings());
+
+    auto &root = cfg.get_settings();
+    CHECK(root.at("version").is_integer());
+    CHECK(root.at("gain").is_float());
+    CHECK(root.at("server").at("hosts").is_array());
+    CHECK(root.at("server").at("routes").is_list());
+    CHECK(root.at("server").at("routes").at(1).at(1).is_array());
+
+    REQUIRE(cfg.parse_json(
+        " { \"i\" : -12 , \"f\":1e3, \"g\" : -0.25E-2, \"t\":true,\"u\" : false,\n"
+        "   \"mixed\" : [1, 2.5, -3], \"strings\": [\"a\", \"\\\"b\\\"\"],\n"
+        "   \"list\": [1, \"a\", true], \"nested\": [[1], [2]],\n"
+        "   \"escapes\": \"\\/\\b\\f\\n\\r\\t\\u0041\\u00e9\\u20ac\\ud83d\\ude00\\u0000.\",\n"
+        "   \"big\": 9223372036854775807 }\n"));
+    auto &r = cfg.get_settings();
+    CHECK(r.at("i").get<long>() == -12);
+    CHECK(r.at("f").is_float());
+    CHECK(r.at("f").get<double>() == 1000.0);
+    CHECK(r.at("g").get<double>() == -0.0025);
+    CHECK(r.at("t").get<bool>());
+    CHECK_FALSE(r.at("u").get<bool>());
+    CHECK(r.at("mixed").is_list());
+    CHECK(r.at("mixed").at(0).is_integer());
+    CHECK(r.at("mixed").at(1).is_float());
+    CHECK(r.at("mixed").at(2).get<long>() == -3);
+    CHECK(r.at("strings").is_array());
+    CHECK(r.at("strings").at(1).get<std::string>() == "\"b\"");
+    CHECK(r.at("list").is_list());
+    CHECK(r.at("nested").is_list());
+    CHECK(r.at("nested").at(0).is_array());
+    CHECK(r.at("escapes").get<std::string>() ==
+            std::string("/\b\f\n\r\tA\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\0.", 18));
+    CHECK(r.at("big").get<long>() == std::numeric_limits<long>::max());
+
+    REQUIRE(cfg.parse_json("{}"));
+    CHECK(cfg.get_settings().count() == 0);
+}
+
+TEST_CASE("round trips") {
+    Config cfg;
+    REQUIRE(cfg.parse(
+        "big = 9223372036854775807;\n"
+        "small = -9223372036854775808;\n"
+        "tenth = 0.1;\n"
+        "whole = 2.0;\n"
+        "huge = 1e300;\n"
+        "denormal = 4.9406564584124654e-324;\n"
+        "minus_zero = -0.0;\n"
+        "floats = [ 1.0, 2.0 ];\n"));
+    round_trip(cfg.get_settings());
+
+    auto json = to_json(cfg.get_settings(), text_style::compact);
+    CHECK(json.find("\"whole\":2.0,") != std::string::npos);
+    CHECK(json.find("\"huge\":1e+300,") != std::string::npos);
+    CHECK(json.find("\"floats\":[1.0,2.0]") != std::string::npos);
+
+    Config again;
+    REQUIRE(again.parse_json(json));
+    CHECK(again.get_settings() == cfg.get_settings());
+
+    std::mt19937 gen{22};
+    for (int i = 0; i < 200; ++i) {
+        auto tree = random_tree(gen, 0);
+        round_trip(tree);
+    }
+}
+
+TEST_CASE("errors") {
+    auto fails = [](const char *json, const std::string &expected) {
+        Config cfg;
+        CHECK_FALSE(cfg.parse_json(json));
+        CHECK(errors(cfg) == expected);
+    };
+
+    fails("", "line 0 : Expecting an object\n");
+    fails("[1]", "line 0 : Expecting an object\n");
+    fails("{\n\"a\": 1,\n}", "line 2 : Expecting a key\n");
+    fails("{\"a\" 1}", "line 0 : Expecting : after key\n");
+    fails("{\"a\": 1 \"b\": 2}", "line 0 : Didn't find close of object\n");
+    fails("{\"a\": [1, 2}", "line 0 : Didn't find close of array\n");
+    fails("{\"a\": [1, \"b\"}", "line 0 : Didn't find close of array\n");
+    fails("{\"a\": nope}", "line 0 : Expecting a value\n");
+    fails("{\"a\": trueish}", "line 0 : Expecting a value\n");
+    fails("{\n\n\"a\": null}", "line 2 : null can't be a setting\n");
+    fails("{\"a\": 0x10}", "line 0 : Malformed number\n");
+    fails("{\"a\": 10L}", "line 0 : Malformed number\n");
+    fails("{\"a\": +1}", "line 0 : Expecting a value\n");
+    fails("{\"a\": 01}", "line 0 : Malformed number\n");
+    fails("{\"a\": -01.5}", "line 0 : Malformed number\n");
+    fails("{\"a\": -.5}", "line 0 : Malformed number\n");
+    fails("{\"a\": .5}", "line 0 : Expecting a value\n");
+    fails("{\"a\": [1.]}", "line 0 : Malformed number\n");
+    fails("{\"a\": 1.e5}", "line 0 : Malformed number\n");
+
+    // but these are all JSON.
+    Config cfg;
+    REQUIRE(cfg.parse_json("{\"a\": [0, -0, 0.5, -0.5e+1, 10E-1, 109]}"));
+    CHECK(cfg.get_settings().at("a").at(3).get<double>() == -5.0);
+    CHECK(cfg.get_settings().at("a").at(5).get<long>() == 109);
+    fails("{\"a\": 1e}", "line 0 : Malformed exponent in number\n");
+    fails("{\"a\": \"abc}", "line 0 : Unterminated string\n");
+    fails("{\"a\": \"a\nb\"}", "line 0 : Unterminated string\n");
+    fails("{\"a\": \"\\q\"}", "line 0 : Unrecognized escape sequence in string\n");
+    fails("{\"a\": \"\\u12\"}", "line 0 : Bad \\u escape in string\n");
+    fails("{\"a\": \"\\ud83d\"}", "line 0 : Bad \\u escape in string\n");
+    fails("{\"a\": \"\\ude00\"}", "line 0 : Bad \\u escape in string\n");
+    fails("{\"a\": 1}\n{}", "line 1 : Not at end of input!\n");
+    fails("{\"a\": 1,\n\"a\": 2}", "line 1 : Setting named a already defined in this context\n");
+}
+
+TEST_CASE("events") {
+    // any handler works with JSON too.
+    struct counter : event_handler {
+        int groups = 0, lists = 0, arrays = 0, scalars = 0;
+        std::string skipped_text;
+
+        event_action begin_group(std::string_view name) {
+            ++groups;
+            return (name == "skip") ? event_action::skip : event_action::proceed;
+        }
+        event_action begin_list(std::string_view) { ++lists; return event_action::proceed; }
+        event_action begin_array(std::string_view) { ++arrays; return event_action::proceed; }
+        event_action on_integer(std::string_view, long) { ++scalars; return event_action::proceed; }
+        event_action on_string(std::string_view, std::string_view v) {
+            ++scalars;
+            return (v == "stop") ? fail("stopped") : event_action::proceed;
+        }
+        void skipped(std::string_view text, const parse_loc &) { skipped_text = text; }
+    };
+
+    counter c;
+    CHECK(parse_json_events("{\"a\": [1, [2]], \"skip\": {\"x\": \"}\"}, \"b\": {\"c\": 3}}", c));
+    CHECK(c.groups == 2);
+    CHECK(c.lists == 1);
+    CHECK(c.arrays == 1);
+    CHECK(c.scalars == 3);
+    CHECK(c.skipped_text == "{\"x\": \"}\"}");
+
+    counter stop;
+    std::ostringstream errs;
+    CHECK_FALSE(parse_json_events("{\"a\": 1,\n \"b\": \"stop\", \"c\": 2}", stop, &errs));
+    CHECK(errs.str() == "line 1 : stopped\n");
+    CHECK(stop.scalars == 2);
+}
+
+TEST_CASE("schema") {
+    Config cfg;
+    REQUIRE(cfg.set_schema(
+        "port = { type : \"int\", required : \"yes\" }\n"
+        "name = { type : \"string\", required : \"no\" }\n"));
+
+    CHECK(cfg.parse_json("{\"port\": 80, \"name\": \"x\"}"));
+
+    CHECK_FALSE(cfg.parse_json("{\n\"port\": 80.5}"));
+    CHECK(errors(cfg) == "line 1 : Setting port has type float, but the schema wants int\n");
+
+    CHECK_FALSE(cfg.parse_json("{\"name\": \"x\"\n}"));
+    CHECK(errors(cfg) == "line 1 : The top level is missing required setting port\n");
+}
+
+TEST_CASE("files") {
+    std::string file_name = "t22-json.json";
+
+    Config cfg;
+    REQUIRE(cfg.parse(sample));
+    REQUIRE(cfg.write_json_file(file_name, text_style::compact));
+
+    Config again;
+    REQUIRE(again.parse_json_file(file_name));
+    CHECK(again.get_settings() == cfg.get_settings());
+
+    // big enough to go out in more than one write.
+    std::mt19937 gen{5000};
+    Setting big{ST::GROUP};
+    for (int i = 0; i < 200; ++i) big.add_child("t" + std::to_string(i), random_tree(gen, 0));
+    for (int i = 0; i < 20000; ++i) big.add_child("n" + std::to_string(i), "some text " + std::to_string(i));
+    REQUIRE(write_json_file(big, file_name));
+    REQUIRE(again.parse_json_file(file_name));
+    CHECK(same(again.get_settings(), big));
+
+    CHECK_FALSE(again.write_json_file("no-such-directory/t22-json.json"));
+    CHECK_FALSE(again.parse_json_file("no-such-file.json"));
+    CHECK(errors(again) == "line 0 : Could not open file no-such-file.json\n");
+
+    std::remove(file_name.c_str());
+}
@@ -0,0 +1,268 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <configinator5000.hpp>
+#include <include.hpp>
+#include <parser.hpp>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Configinator5000;
+
+namespace {
+    const std::string dir = "t23-include.d/";
+
+    // Files made by a test, removed at the end of it.
+    struct files {
+        std::vector<std::string> made;
+
+        files() {
+            ::mkdir(dir.c_str(), 0777);
+            ::mkdir((dir + "sub").c_str(), 0777);
+        }
+
+        ~files() {
+            for (auto &f : made) std::remove(f.c_str());
+            ::rmdir((dir + "sub").c_str());
+            ::rmdir(dir.c_str());
+        }
+
+        std::string operator()(const std::string &name, const std::string &text) {
+            std::string path = dir + name;
+            std::ofstream{path, std::ios::binary | std::ios::trunc} << text;
+            made.push_back(path);
+            return path;
+        }
+    };
+
+    std::string errors(Config &cfg) {
+        std::ostringstream strm;
+        cfg.stream_errors(strm);
+        return strm.str();
+    }
+
+    std::string full_path(const std::string &path) {
+        char buf[PATH_MAX];
+        return ::realpath(path.c_str(), buf) ? buf : path;
+    }
+
+    bool same_as(Config &cfg, const char *text) {
+        Config plain;
+        REQUIRE(plain.parse(text));
+        return cfg.get_settings() == plain.get_settings();
+    }
+}
+
+TEST_CASE("including") {
+    files make;
+    make("defaults.cfg", "port = 80;\nhosts = [ \"a\", \"b\" ];\n");
+    make("sub/limits.cfg", "# in sub/\n@include \"more.cfg\"\ncpu = 2;\n");
+    make("sub/more.cfg", "mem = 4.5;\n");
+    auto main = make("main.cfg",
+        "name = \"main\";\n"
+        "@include \"defaults.cfg\"\n"
+        "limits = {\n"
+        "  @include \"sub/limits.cfg\";\n"
+        "  extra = true;\n"
+        "};\n"
+        "s = \"@include \\\"nope.cfg\\\"\"; // @include \"nope.cfg\"\n"
+        "/* @include \"nope.cfg\" */\n");
+
+    auto cache = std::make_shared<include_cache>();
+
+    Config cfg;
+    cfg.set_include_cache(cache);
+    REQUIRE(cfg.parse_file(main));
+    CHECK(same_as(cfg,
+        "name = \"main\"; port = 80; hosts = [ \"a\", \"b\" ];\n"
+        "limits = { mem = 4.5; cpu = 2; extra = true; };\n"
+        "s = \"@include \\\"nope.cfg\\\"\";\n"));
+
+    // the files under main, but not main itself.
+    CHECK(cache->size() == 3);
+
+    // from the current directory.
+    REQUIRE(cfg.parse("@include \"" + dir + "sub/more.cfg\"\n"));
+    CHECK(same_as(cfg, "mem = 4.5;"));
+
+    // an absolute name
+    REQUIRE(cfg.parse("x = 1; @include \"" + full_path(dir + "defaults.cfg") + "\" y = 2;"));
+    CHECK(same_as(cfg, "x = 1; port = 80; hosts = [ \"a\", \"b\" ]; y = 2;"));
+
+    // no includes at all.
+    REQUIRE(cfg.parse("plain = 1;"));
+}
+
+TEST_CASE("problems") {
+    files make;
+    make("a.cfg", "a = 1;\n@include \"b.cfg\"\n");
+    make("b.cfg", "b = 1;\n\n@include \"a.cfg\"\n");
+    make("self.cfg", "@include \"self.cfg\"\n");
+    make("bad.cfg", "ok = 1;\nbad = ;\n");
+    make("dup.cfg", "x = 1;\n");
+    make("uses-bad.cfg", "@include \"bad.cfg\"\n");
+
+    auto check = [](const std::string &text, const std::string &expected) {
+        Config cfg;
+        cfg.set_include_cache(nullptr);
+        CHECK_FALSE(cfg.parse(text));
+        CHECK(errors(cfg) == expected);
+    };
+
+    Config cfg;
+    CHECK_FALSE(cfg.parse_file(dir + "a.cfg"));
+    CHECK(errors(cfg) == "line 1 : In file " + dir + "b.cfg, line 2 : Include cycle through " +
+            dir + "a.cfg\n");
+
+    CHECK_FALSE(cfg.parse_file(dir + "self.cfg"));
+    CHECK(errors(cfg) == "line 0 : Include cycle through " + dir + "self.cfg\n");
+
+    check("x = 1;\n@include \"" + dir + "nope.cfg\"\ny = 2;\n",
+            "line 1 : Could not open file " + dir + "nope.cfg\n");
+    check("\n@include \"" + dir + "uses-bad.cfg\"\n",
+            "line 1 : In file " + dir + "uses-bad.cfg, line 0 : In file " + dir +
+            "bad.cfg, line 1 : Expecting a value\n");
+    check("x = 2;\n@include \"" + dir + "dup.cfg\"\n",
+            "line 1 : Setting named x already defined in this context\n");
+    check("x = ( @include \"" + dir + "dup.cfg\" );",
+            "line 0 : Expecting a value\n"
+            "line 0 : Didn't find close of setting list\n"
+            "line 0 : Not at end of input!\n");
+    check("@include;",
+            "line 0 : Expecting a file name after @include\n"
+            "line 0 : Not at end of input!\n");
+    check("@includes \"x\"",
+            "line 0 : Expecting @include\n"
+            "line 0 : Not at end of input!\n");
+
+    // the same file twice isn't a cycle.
+    make("c.cfg", "@include \"d.cfg\"\n@include \"d.cfg\"\n");
+    make("d.cfg", "");
+    CHECK(cfg.parse_file(dir + "c.cfg"));
+
+    // only Config loads them.
+    event_handler nothing;
+    std::ostringstream errs;
+    CHECK_FALSE(parse_events("@include \"a.cfg\"", nothing, &errs));
+    CHECK(errs.str() == "line 0 : @include isn't supported here\n");
+}
+
+TEST_CASE("caching") {
+    files make;
+    auto shared = make("shared.cfg", "common = { level = 1; };\n");
+    std::vector<std::string> tenants;
+    for (int i = 0; i < 20; ++i) {
+        tenants.push_back(make("tenant" + std::to_string(i) + ".cfg",
+            "id = " + std::to_string(i) + ";\n@include \"shared.cfg\"\n"));
+    }
+
+    auto cache = std::make_shared<include_cache>();
+    auto load = [&](int i) {
+        Config cfg;
+        cfg.set_include_cache(cache);
+        REQUIRE(cfg.parse_file(tenants[std::size_t(i)]));
+        CHECK(cfg.get_settings().at("common").at("level").get<long>() == 1);
+    };
+
+    load(0);
+    auto first = cache->find(full_path(shared));
+    REQUIRE(first);
+    for (int i = 1; i < 5; ++i) load(i);
+    CHECK(cache->find(full_path(shared)) == first);
+    CHECK(cache->size() == 1);
+
+    // a change to the file is noticed.
+    make("shared.cfg", "common = { level = 22; };\n");
+    CHECK_FALSE(cache->find(full_path(shared)));
+    Config cfg;
+    cfg.set_include_cache(cache);
+    REQUIRE(cfg.parse_file(tenants[0]));
+    CHECK(cfg.get_settings().at("common").at("level").get<long>() == 22);
+
+    // and by what includes it.
+    make("inner.cfg", "v = 1;\n");
+    auto outer = make("outer.cfg", "@include \"inner.cfg\"\n");
+    auto top = make("top.cfg", "@include \"outer.cfg\"\n");
+    REQUIRE(cfg.parse_file(top));
+    make("inner.cfg", "v = 333;\n");
+    CHECK_FALSE(cache->find(full_path(outer)));
+    REQUIRE(cfg.parse_file(top));
+    CHECK(cfg.get_settings().at("v").get<long>() == 333);
+
+    // prune() drops what has changed, and nothing else.
+    auto before = cache->size();
+    make("inner.cfg", "v = 4444;\n");
+    CHECK(cache->prune() == 2);
+    CHECK(cache->size() == before - 2);
+    CHECK(cache->find(full_path(shared)));
+    CHECK(cache->prune() == 0);
+
+    // many Configs at once, all sharing one load.
+    make("shared.cfg", "common = { level = 1; };\n");
+    cache->clear();
+    std::vector<std::thread> threads;
+    std::vector<std::string> problems(tenants.size());
+    for (std::size_t i = 0; i < tenants.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            Config c;
+            c.set_include_cache(cache);
+            if (not c.parse_file(tenants[i])) problems[i] = errors(c);
+            else if (c.get_settings().at("id").get<long>() != long(i)) problems[i] = "wrong id";
+        });
+    }
+    for (auto &t : threads) t.join();
+    for (auto &p : problems) CHECK(p == "");
+    CHECK(cache->size() == 1);
+}
+
+TEST_CASE("many includes") {
+    files make;
+    std::string main_text, expected;
+    for (int i = 0; i < 16; ++i) {
+        std::string piece;
+        for (int j = 0; j < 200; ++j) {
+            piece += "k" + std::to_string(j) + " = " + std::to_string(i * 1000 + j) + ";\n";
+        }
+        make("part" + std::to_string(i) + ".cfg", piece);
+        main_text += "g" + std::to_string(i) + " = { @include \"part" + std::to_string(i) + ".cfg\" };\n";
+        expected += "g" + std::to_string(i) + " = {\n" + piece + "};\n";
+    }
+    auto main = make("many.cfg", main_text);
+
+    Config cfg;
+    cfg.set_include_cache(nullptr);
+    REQUIRE(cfg.parse_file(main));
+    CHECK(same_as(cfg, expected.c_str()));
+
+    // the lazy and parallel parses just parse it all.
+    REQUIRE(cfg.parse_file_lazy(main));
+    CHECK(same_as(cfg, expected.c_str()));
+    REQUIRE(cfg.parse_file_parallel(main, 4));
+    CHECK(same_as(cfg, expected.c_str()));
+}
+
+TEST_CASE("schema") {
+    files make;
+    make("typed.cfg", "port = \"eighty\";\n");
+    auto main = make("typed-main.cfg", "name = \"x\";\n@include \"typed.cfg\"\n");
+
+    Config cfg;
+    REQUIRE(cfg.set_schema(
+        "name = { type : \"string\", required : \"yes\" }\n"
+        "port = { type : \"int\", required : \"yes\" }\n"));
+    CHECK_FALSE(cfg.parse_file(main));
+    CHECK(errors(cfg) == "line 1 : Setting port has type string, but the schema wants int\n");
+
+    make("typed.cfg", "port = 80;\n");
+    CHECK(cfg.parse_file(main));
+}
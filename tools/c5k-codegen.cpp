@@ -0,0 +1,693 @@
+// c5k-codegen : C++ structs and a parser for them, from a schema.
+//
+//     c5k-codegen <schema> <output> <name> [<namespace>]
+//
+// Reads a schema (in the README format) and writes <output>.hpp, with a
+// struct called <name> for the top level and one for each group in it,
+// and <output>.cpp, with
+//
+//     bool parse(std::string_view input, <name> &out, std::ostream *errs = nullptr);
+//     bool parse_file(const std::string &file_name, <name> &out, std::ostream *errs = nullptr);
+//
+// The parser is an EventParser whose handler puts each value straight
+// into its field. No Settings are made, and the key of each value is
+// found with a switch on a perfect hash of it (see codegen.hpp) and one
+// compare. c5k_generate() in tools/CMakeLists.txt runs this from a build.
+//
+// What goes in the structs:
+//   - "string", "bool", "int" and "float" are std::string, bool, long and
+//     double.
+//   - A group with keys is a struct. If it has key* too, the other keys go
+//     in a std::map member called `others`. A group with only key* is a
+//     std::map.
+//   - Settings that aren't required are std::optional (maps are just
+//     empty).
+//   - Anything else (lists, arrays, groups the schema says nothing about,
+//     entries that can be more than one type) has no C++ type. It is still
+//     checked against the types it may have, then stepped over.
+
+#include <mapped_file.hpp>
+#include <codegen.hpp>
+#include <parser.hpp>
+#include <schema.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Configinator5000;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    using ST = Setting::setting_type;
+
+    enum class kind { scalar, structure, map, skipped };
+
+    struct member {
+        std::string key;
+        // in C++
+        std::string name;
+        int node;
+        bool required;
+    };
+
+    struct gen_node {
+        std::uint8_t types = 0;
+        kind what = kind::skipped;
+
+        // the C++ type, for all but skipped.
+        std::string type;
+
+        // for structures and maps, the number the handler knows it by.
+        int frame = -1;
+
+        // structures : the members, and the node for any other key (or -1).
+        // The members are found by slot_hash(key, seed) & mask.
+        std::vector<member> members;
+        int others = -1;
+        std::uint32_t seed = 0;
+        std::uint32_t mask = 0;
+
+        // maps : the node for the values.
+        int value = -1;
+    };
+
+    // What the parser sees, for each callback.
+    struct event {
+        const char *callback;
+        const char *param;
+        ST type;
+        // the value, in C++, for scalars.
+        const char *value;
+    };
+
+    const event events[] = {
+        {"on_bool", "bool v", ST::BOOL, "v"},
+        {"on_integer", "long v", ST::INTEGER, "v"},
+        {"on_float", "double v", ST::FLOAT, "v"},
+        {"on_string", "std::string_view v", ST::STRING, "std::string(v)"},
+        {"begin_group", nullptr, ST::GROUP, nullptr},
+        {"begin_list", nullptr, ST::LIST, nullptr},
+        {"begin_array", nullptr, ST::ARRAY, nullptr},
+    };
+
+    // by setting_type
+    const char *type_name[] = {"string", "bool", "int", "float", "group", "list", "array"};
+
+    const std::set<std::string> keywords = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool",
+        "break", "case", "catch", "char", "char16_t", "char32_t", "class", "compl",
+        "const", "constexpr", "const_cast", "continue", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+        "false", "float", "for", "friend", "goto", "if", "inline", "int", "long",
+        "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr",
+        "operator", "or", "or_eq", "private", "protected", "public", "register",
+        "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+        "static_assert", "static_cast", "struct", "switch", "template", "this",
+        "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+        "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+        "xor", "xor_eq"};
+
+    bool is_scalar(ST t) { return t != ST::GROUP and t != ST::LIST and t != ST::ARRAY; }
+
+    std::string quoted(std::string_view s) { return "\"" + std::string(s) + "\""; }
+
+    // A key as a C++ name. Keys can have a '*' in them, and can be
+    // keywords.
+    std::string identifier(std::string_view key) {
+        std::string retval{key};
+        for (auto &c : retval) {
+            if (c == '*') c = '_';
+        }
+        if (keywords.count(retval) or retval.front() == '_') retval += '_';
+        return retval;
+    }
+
+    class generator {
+        const Schema &schema_;
+        std::vector<gen_node> nodes_;
+
+        // the structures, in the order they have to be declared.
+        std::vector<int> structs_;
+
+        // their names, which have to differ.
+        std::set<std::string> struct_names_;
+
+        // the structures and maps, by frame number.
+        std::vector<int> frames_;
+
+        // the most words of required bits any structure needs.
+        std::size_t words_ = 1;
+
+        std::string error_;
+
+        // set when a callback's value is put somewhere.
+        mutable bool value_used_ = false;
+
+    public :
+        explicit generator(const Schema &s) : schema_{s} {}
+
+        const std::string &error() const { return error_; }
+
+        bool build(const std::string &name) {
+            build(0, name, true);
+            return error_.empty();
+        }
+
+        std::string header(const std::string &from, const std::string &name, const std::string &ns);
+        std::string source(const std::string &from, const std::string &include,
+                const std::string &name, const std::string &ns);
+
+    private :
+        int build(std::uint32_t n, const std::string &name, bool top);
+
+        // name, or with _2, _3, ... on the end if a structure has it.
+        std::string unique_struct_name(const std::string &name);
+        void find_seed(gen_node &g, const std::string &name);
+
+        std::string wants(const gen_node &g) const { return quoted(Schema::type_names(g.types)); }
+
+        // The code for a value of ev going into node t. `into` is what to
+        // assign to, or the address to fill for groups. `key` is its key
+        // for messages, as a C++ expression. Sets `used` if into is used.
+        std::string accept(int t, const event &ev, const std::string &into,
+                const std::string &key, bool &used, const std::string &indent) const;
+
+        // The code for a value of ev for a key of map m (a C++ expression)
+        // whose values are node t.
+        std::string entry(int t, const event &ev, const std::string &m, bool &used,
+                const std::string &indent) const;
+
+        std::string callback(const event &ev) const;
+    };
+
+    int generator::build(std::uint32_t n, const std::string &name, bool top) {
+        int idx = int(nodes_.size());
+        nodes_.emplace_back();
+        nodes_[idx].types = schema_.types(n);
+
+        auto types = schema_.types(n);
+        auto set = [&](kind what, std::string type) {
+            nodes_[idx].what = what;
+            nodes_[idx].type = std::move(type);
+        };
+
+        if (types == Schema::type_bit(ST::STRING)) {
+            set(kind::scalar, "std::string");
+        } else if (types == Schema::type_bit(ST::BOOL)) {
+            set(kind::scalar, "bool");
+        } else if (types == Schema::type_bit(ST::INTEGER)) {
+            set(kind::scalar, "long");
+        } else if (types == (Schema::type_bit(ST::FLOAT) | Schema::type_bit(ST::INTEGER)) or
+                types == Schema::type_bit(ST::FLOAT)) {
+            set(kind::scalar, "double");
+        } else if (top or (types == Schema::type_bit(ST::GROUP) and not schema_.open(n))) {
+            auto keys = schema_.keys(n);
+            auto any = schema_.any_key(n);
+
+            if (keys.empty() and any >= 0 and not top) {
+                auto value = build(std::uint32_t(any), name + "_entry", false);
+                if (nodes_[value].what != kind::skipped) {
+                    set(kind::map, "std::map<std::string, " + nodes_[value].type + ">");
+                    nodes_[idx].value = value;
+                    nodes_[idx].frame = int(frames_.size());
+                    frames_.push_back(idx);
+                }
+                return idx;
+            }
+
+            auto type = unique_struct_name(name);
+            set(kind::structure, type);
+            nodes_[idx].frame = int(frames_.size());
+            frames_.push_back(idx);
+
+            std::set<std::string> names;
+            if (any >= 0) names.insert("others");
+
+            std::vector<member> members;
+            for (auto const &k : keys) {
+                member m{std::string(k.key), identifier(k.key), 0, schema_.required(k.node)};
+                if (not names.insert(m.name).second) {
+                    error_ = "The key " + m.key + " of " + type + " would be member " + m.name +
+                        ", which is taken";
+                }
+                m.node = build(k.node, type + "_" + m.name, false);
+                members.push_back(std::move(m));
+            }
+
+            nodes_[idx].members = std::move(members);
+            if (any >= 0) nodes_[idx].others = build(std::uint32_t(any), type + "_entry", false);
+
+            words_ = std::max(words_, (nodes_[idx].members.size() + 63) / 64);
+            find_seed(nodes_[idx], type);
+
+            structs_.push_back(idx);
+        }
+
+        return idx;
+    }
+
+    std::string generator::unique_struct_name(const std::string &name) {
+        // the key a_b and the key b of group a both make top_a_b; so do
+        // the key entry and key* of a group.
+        auto retval = name;
+        for (int n = 2; not struct_names_.insert(retval).second; ++n) {
+            retval = name + "_" + std::to_string(n);
+        }
+        return retval;
+    }
+
+    // The smallest table (then the first seed) that gives every key of g
+    // a slot of its own.
+    void generator::find_seed(gen_node &g, const std::string &name) {
+        auto count = g.members.size();
+        if (count == 0) return;
+
+        unsigned bits = 0;
+        while ((std::size_t(1) << bits) < count) ++bits;
+
+        for (unsigned b = bits; b < bits + 4 and b < 31; ++b) {
+            std::uint32_t mask = (1u << b) - 1;
+            std::vector<bool> used(std::size_t(mask) + 1);
+
+            for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+                std::fill(used.begin(), used.end(), false);
+                bool clash = false;
+                for (auto const &m : g.members) {
+                    auto slot = codegen::slot_hash(m.key, seed) & mask;
+                    if (used[slot]) {
+                        clash = true;
+                        break;
+                    }
+                    used[slot] = true;
+                }
+                if (not clash) {
+                    g.seed = seed;
+                    g.mask = mask;
+                    return;
+                }
+            }
+        }
+
+        error_ = "Couldn't find a perfect hash for the keys of " + name;
+    }
+
+    std::string generator::accept(int t, const event &ev, const std::string &into,
+            const std::string &key, bool &used, const std::string &indent) const {
+        auto const &g = nodes_[t];
+        std::string type = type_name[unsigned(ev.type)];
+
+        if (not (g.types & Schema::type_bit(ev.type))) {
+            return indent + "return wrong(name, " + quoted(type) + ", " + wants(g) + ");\n";
+        }
+
+        switch (g.what) {
+            case kind::skipped :
+                return indent + (is_scalar(ev.type) ? "return event_action::proceed;\n" :
+                        "return event_action::skip;\n");
+
+            case kind::scalar : {
+                used = true;
+                std::string value = ev.value;
+                if (g.type == "double" and ev.type == ST::INTEGER) value = "double(v)";
+                value_used_ = true;
+                return indent + into + " = " + value + ";\n" +
+                    indent + "return event_action::proceed;\n";
+            }
+
+            default :
+                used = true;
+                return indent + "return push(" + std::to_string(g.frame) + ", " + into + ", " + key +
+                    ");\n";
+        }
+    }
+
+    std::string generator::entry(int t, const event &ev, const std::string &m, bool &used,
+            const std::string &indent) const {
+        auto const &g = nodes_[t];
+        if (g.what == kind::skipped or not (g.types & Schema::type_bit(ev.type))) {
+            return accept(t, ev, "", "", used, indent);
+        }
+
+        used = true;
+        bool ignored = false;
+        std::string retval = indent + "{\n" +
+            indent + "    auto [at, added] = " + m + ".try_emplace(std::string(name));\n" +
+            indent + "    if (not added) return again(name);\n";
+        if (g.what == kind::scalar) {
+            retval += accept(t, ev, "at->second", "", ignored, indent + "    ");
+        } else {
+            retval += accept(t, ev, "&at->second", "at->first", ignored, indent + "    ");
+        }
+        return retval + indent + "}\n";
+    }
+
+    std::string generator::callback(const event &ev) const {
+        value_used_ = false;
+        std::string retval;
+
+        for (std::size_t fr = 0; fr < frames_.size(); ++fr) {
+            auto const &g = nodes_[frames_[fr]];
+            std::string body;
+            bool used = false;
+            std::string in = "                    ";
+
+            if (g.what == kind::map) {
+                body = entry(g.value, ev, "o", used, in);
+            } else {
+                body = in + "switch (member(f, find_" + std::to_string(fr) + "(name))) {\n" +
+                    in + "    case -2 :\n" +
+                    in + "        return again(name);\n";
+                for (std::size_t i = 0; i < g.members.size(); ++i) {
+                    auto const &m = g.members[i];
+                    auto const &mn = nodes_[m.node];
+
+                    std::string into = "o." + m.name;
+                    if (not is_scalar(ev.type)) {
+                        into = (m.required or mn.what == kind::map) ? "&" + into : "&" + into + ".emplace()";
+                    }
+                    body += in + "    case " + std::to_string(i) + " :\n" +
+                        accept(m.node, ev, into, quoted(m.key), used, in + "        ");
+                }
+                body += in + "}\n";
+
+                if (g.others >= 0) {
+                    body += entry(g.others, ev, "o.others", used, in);
+                } else {
+                    body += in + "return unknown(name);\n";
+                }
+            }
+
+            retval += "                case " + std::to_string(fr) + " : {\n";
+            if (used) {
+                retval += in + "auto &o = *static_cast<" + g.type + " *>(f.obj);\n";
+            }
+            retval += body + "                }\n";
+        }
+
+        // the value's name is left out if nothing takes it.
+        std::string param;
+        if (ev.param) {
+            param = ", "s + ev.param;
+            if (not value_used_) param.pop_back();
+        }
+
+        return "        event_action " + std::string(ev.callback) + "(std::string_view name" + param +
+            ") {\n" +
+            "            auto &f = stack_.back();\n" +
+            "            switch (f.node) {\n" +
+            retval +
+            "            }\n"
+            "            return event_action::proceed;\n"
+            "        }\n";
+    }
+
+    std::string generator::header(const std::string &from, const std::string &name,
+            const std::string &ns) {
+        std::ostringstream out;
+        std::string in = ns.empty() ? "" : "    ";
+
+        out << "// Made by c5k-codegen from " << from << ". Change that, not this.\n\n"
+            << "#pragma once\n\n"
+            << "#include <map>\n"
+            << "#include <optional>\n"
+            << "#include <ostream>\n"
+            << "#include <string>\n"
+            << "#include <string_view>\n\n";
+
+        if (not ns.empty()) out << "namespace " << ns << " {\n\n";
+
+        for (auto s : structs_) {
+            auto const &g = nodes_[s];
+            out << in << "struct " << g.type << " {\n";
+            for (auto const &m : g.members) {
+                auto const &mn = nodes_[m.node];
+                out << in << "    ";
+                if (mn.what == kind::skipped) {
+                    out << "// " << m.key << " (" << Schema::type_names(mn.types) << ") isn't kept.\n";
+                } else if (m.required or mn.what == kind::map) {
+                    out << mn.type << " " << m.name;
+                    if (mn.type == "long" or mn.type == "double") out << " = 0";
+                    if (mn.type == "bool") out << " = false";
+                    out << ";\n";
+                } else {
+                    out << "std::optional<" << mn.type << "> " << m.name << ";\n";
+                }
+            }
+            if (g.others >= 0 and nodes_[g.others].what != kind::skipped) {
+                out << in << "    // the keys that aren't above.\n"
+                    << in << "    std::map<std::string, " << nodes_[g.others].type << "> others;\n";
+            }
+            out << in << "};\n\n";
+        }
+
+        out << in << "// Parse input into out (which is emptied first). Returns false if it\n"
+            << in << "// isn't good libconfig or doesn't match the schema. Parsing stops at the\n"
+            << in << "// first problem, which is written to errs (if given).\n"
+            << in << "bool parse(std::string_view input, " << name << " &out, std::ostream *errs = nullptr);\n"
+            << in << "bool parse_file(const std::string &file_name, " << name
+            << " &out, std::ostream *errs = nullptr);\n";
+
+        if (not ns.empty()) out << "\n} // end namespace " << ns << "\n";
+
+        return out.str();
+    }
+
+    std::string generator::source(const std::string &from, const std::string &include,
+            const std::string &name, const std::string &ns) {
+        std::ostringstream out;
+        std::string q = ns.empty() ? "" : ns + "::";
+
+        out << "// Made by c5k-codegen from " << from << ". Change that, not this.\n\n"
+            << "#include \"" << include << "\"\n\n"
+            << "#include <codegen.hpp>\n"
+            << "#include <mapped_file.hpp>\n"
+            << "#include <parser.hpp>\n\n"
+            << "#include <cstdint>\n"
+            << "#include <vector>\n\n"
+            << "namespace {\n\n"
+            << "    using Configinator5000::event_action;\n"
+            << "    using Configinator5000::codegen::slot_hash;\n";
+        if (not ns.empty()) out << "    using namespace " << ns << ";\n";
+        out << "\n"
+            << "    constexpr unsigned words = " << words_ << ";\n\n";
+
+        // the keys of each structure, which are required, and how to find them.
+        for (std::size_t fr = 0; fr < frames_.size(); ++fr) {
+            auto const &g = nodes_[frames_[fr]];
+            if (g.what != kind::structure) continue;
+            auto f = std::to_string(fr);
+
+            out << "    // " << g.type << "\n";
+            if (not g.members.empty()) {
+                out << "    const char *const keys_" << f << "[] = {";
+                for (std::size_t i = 0; i < g.members.size(); ++i) {
+                    out << (i ? ", " : "") << quoted(g.members[i].key);
+                }
+                out << "};\n";
+            } else {
+                out << "    const char *const keys_" << f << "[] = {\"\"};\n";
+            }
+
+            std::vector<std::uint64_t> required(words_, 0);
+            for (std::size_t i = 0; i < g.members.size(); ++i) {
+                if (g.members[i].required) required[i / 64] |= std::uint64_t(1) << (i % 64);
+            }
+            out << "    const std::uint64_t required_" << f << "[words] = {";
+            for (std::size_t w = 0; w < words_; ++w) {
+                out << (w ? ", " : "") << "0x" << std::hex << required[w] << std::dec << "u";
+            }
+            out << "};\n\n";
+
+            if (g.members.empty()) {
+                out << "    int find_" << f << "(std::string_view) { return -1; }\n\n";
+                continue;
+            }
+
+            out << "    int find_" << f << "(std::string_view key) {\n"
+                << "        switch (slot_hash(key, " << g.seed << "u) & " << g.mask << "u) {\n";
+            for (std::size_t i = 0; i < g.members.size(); ++i) {
+                auto slot = codegen::slot_hash(g.members[i].key, g.seed) & g.mask;
+                out << "            case " << slot << " : return key == " << quoted(g.members[i].key)
+                    << " ? " << i << " : -1;\n";
+            }
+            out << "        }\n"
+                << "        return -1;\n"
+                << "    }\n\n";
+        }
+
+        out << "    //\n"
+            << "    // Fills in the structs from the parser's events. There is a frame for\n"
+            << "    // each struct and map being filled in.\n"
+            << "    //\n"
+            << "    class handler : public Configinator5000::event_handler {\n"
+            << "        struct frame {\n"
+            << "            int node;\n"
+            << "            void *obj;\n"
+            << "            // for messages.\n"
+            << "            std::string_view key;\n"
+            << "            // the members given so far.\n"
+            << "            std::uint64_t seen[words];\n"
+            << "        };\n"
+            << "        std::vector<frame> stack_;\n\n"
+            << "        std::string path(std::string_view name = {}) const {\n"
+            << "            std::string retval;\n"
+            << "            for (auto const &f : stack_) {\n"
+            << "                if (f.key.empty()) continue;\n"
+            << "                if (not retval.empty()) retval += '.';\n"
+            << "                retval += f.key;\n"
+            << "            }\n"
+            << "            if (not name.empty()) {\n"
+            << "                if (not retval.empty()) retval += '.';\n"
+            << "                retval += name;\n"
+            << "            }\n"
+            << "            return retval;\n"
+            << "        }\n\n"
+            << "        // idx (from find_*()) if it is a member of f that hasn't been seen,\n"
+            << "        // -1 if it isn't a member, or -2 if it has been seen.\n"
+            << "        static int member(frame &f, int idx) {\n"
+            << "            if (idx < 0) return -1;\n"
+            << "            auto bit = std::uint64_t(1) << (idx % 64);\n"
+            << "            if (f.seen[idx / 64] & bit) return -2;\n"
+            << "            f.seen[idx / 64] |= bit;\n"
+            << "            return idx;\n"
+            << "        }\n\n"
+            << "        event_action push(int node, void *obj, std::string_view key) {\n"
+            << "            stack_.push_back(frame{node, obj, key, {}});\n"
+            << "            return event_action::proceed;\n"
+            << "        }\n\n"
+            << "        event_action unknown(std::string_view name) {\n"
+            << "            return fail(\"Setting \" + path(name) + \" is not in the schema\");\n"
+            << "        }\n\n"
+            << "        event_action again(std::string_view name) {\n"
+            << "            return fail(\"Setting named \" + std::string(name) + \" already defined in this context\");\n"
+            << "        }\n\n"
+            << "        event_action wrong(std::string_view name, const char *type, const char *wants) {\n"
+            << "            return fail(\"Setting \" + path(name) + \" has type \" + type +\n"
+            << "                    \", but the schema wants \" + wants);\n"
+            << "        }\n\n"
+            << "        event_action missing(const frame &f, const char *const *keys, const std::uint64_t *required) {\n"
+            << "            for (unsigned w = 0; w < words; ++w) {\n"
+            << "                auto left = required[w] & ~f.seen[w];\n"
+            << "                if (left == 0) continue;\n"
+            << "                unsigned b = 0;\n"
+            << "                while (not (left & 1)) {\n"
+            << "                    left >>= 1;\n"
+            << "                    ++b;\n"
+            << "                }\n"
+            << "                auto what = stack_.size() == 1 ? std::string(\"The top level\") : \"Group \" + path();\n"
+            << "                return fail(what + \" is missing required setting \" + keys[w * 64 + b]);\n"
+            << "            }\n"
+            << "            return event_action::proceed;\n"
+            << "        }\n\n"
+            << "    public :\n"
+            << "        explicit handler(" << q << name << " &out) { push(0, &out, {}); }\n\n"
+            << "        // What the top level is missing, once the parse is done.\n"
+            << "        event_action finish() { return missing(stack_.front(), keys_0, required_0); }\n\n";
+
+        for (auto const &ev : events) out << callback(ev) << "\n";
+
+        out << "        event_action end_group() {\n"
+            << "            auto retval = event_action::proceed;\n"
+            << "            switch (stack_.back().node) {\n";
+        for (std::size_t fr = 0; fr < frames_.size(); ++fr) {
+            if (nodes_[frames_[fr]].what != kind::structure) continue;
+            auto f = std::to_string(fr);
+            out << "                case " << f << " :\n"
+                << "                    retval = missing(stack_.back(), keys_" << f << ", required_" << f << ");\n"
+                << "                    break;\n";
+        }
+        out << "            }\n"
+            << "            stack_.pop_back();\n"
+            << "            return retval;\n"
+            << "        }\n"
+            << "    };\n\n"
+            << "}\n\n";
+
+        std::string in;
+        if (not ns.empty()) {
+            out << "namespace " << ns << " {\n\n";
+            in = "    ";
+        }
+
+        out << in << "bool parse(std::string_view input, " << name << " &out, std::ostream *errs) {\n"
+            << in << "    out = " << name << "{};\n"
+            << in << "    handler h{out};\n"
+            << in << "    Configinator5000::EventParser<handler> parser{input, h};\n"
+            << in << "    bool ok = parser.do_parse();\n"
+            << in << "    if (ok and h.finish() == event_action::stop) {\n"
+            << in << "        parser.record_error(h.failure());\n"
+            << in << "        ok = false;\n"
+            << in << "    }\n"
+            << in << "    if (errs) *errs << parser.errors;\n"
+            << in << "    return ok;\n"
+            << in << "}\n\n"
+            << in << "bool parse_file(const std::string &file_name, " << name << " &out, std::ostream *errs) {\n"
+            << in << "    Configinator5000::mapped_file file{file_name};\n"
+            << in << "    if (not file.is_open()) {\n"
+            << in << "        if (errs) *errs << \"line 0 : Could not open file \" << file_name << \"\\n\";\n"
+            << in << "        return false;\n"
+            << in << "    }\n"
+            << in << "    return parse(file.view(), out, errs);\n"
+            << in << "}\n";
+
+        if (not ns.empty()) out << "\n} // end namespace " << ns << "\n";
+
+        return out.str();
+    }
+
+    bool write(const std::string &file_name, const std::string &text) {
+        std::ofstream out{file_name, std::ios::binary};
+        out << text;
+        out.close();
+        if (not out) {
+            std::cerr << "c5k-codegen : couldn't write " << file_name << "\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4 or argc > 5) {
+        std::cerr << "usage : c5k-codegen <schema> <output> <name> [<namespace>]\n";
+        return 2;
+    }
+
+    std::string schema_file = argv[1];
+    std::string output = argv[2];
+    std::string name = argv[3];
+    std::string ns = argc > 4 ? argv[4] : "";
+
+    mapped_file file{schema_file};
+    if (not file.is_open()) {
+        std::cerr << "c5k-codegen : couldn't open " << schema_file << "\n";
+        return 1;
+    }
+
+    Schema schema;
+    error_list errs;
+    if (not schema.load(file.view(), errs)) {
+        std::cerr << schema_file << " :\n" << errs;
+        return 1;
+    }
+
+    generator gen{schema};
+    if (not gen.build(name)) {
+        std::cerr << schema_file << " : " << gen.error() << "\n";
+        return 1;
+    }
+
+    auto slash = output.find_last_of("/\\");
+    auto include = (slash == std::string::npos ? output : output.substr(slash + 1)) + ".hpp";
+
+    if (not write(output + ".hpp", gen.header(schema_file, name, ns))) return 1;
+    if (not write(output + ".cpp", gen.source(schema_file, include, name, ns))) return 1;
+
+    return 0;
+}